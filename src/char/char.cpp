@@ -22,6 +22,7 @@
 #include <common/random.hpp>
 #include <common/showmsg.hpp>
 #include <common/socket.hpp>
+#include <common/sqlworker.hpp>
 #include <common/strlib.hpp>
 #include <common/timer.hpp>
 #include <common/utilities.hpp>
@@ -58,6 +59,10 @@ int32 fame_list_size_taekwon = MAX_FAME_LIST;
 struct fame_list smith_fame_list[MAX_FAME_LIST];
 struct fame_list chemist_fame_list[MAX_FAME_LIST];
 struct fame_list taekwon_fame_list[MAX_FAME_LIST];
+// Connections used to load character lists off the main thread.
+// Saves (char_mmo_char_tosql) and every other query stay synchronous: they diff against
+// and update char_db in place, which is owned by the main thread.
+SqlWorkerPool char_sql_workers;
 
 #define CHAR_MAX_MSG 300	//max number of msg_conf
 static char* msg_table[CHAR_MAX_MSG]; // Login Server messages_conf
@@ -899,6 +904,166 @@ int32 char_mmo_gender( const struct char_session_data *sd, const struct mmo_char
 
 int32 char_mmo_char_tobuf(uint8* buf, struct mmo_charstatus* p);
 
+/**
+ * Builds the query to load the basic character rooster for the given account.
+ * The column order is the one expected by char_mmo_chars_bind.
+ */
+static std::string char_mmo_chars_query( uint32 account_id ){
+	char query[1024];
+
+	safesnprintf( query, sizeof( query ), "SELECT "
+		"`char_id`,`char_num`,`name`,`class`,`base_level`,`job_level`,`base_exp`,`job_exp`,`zeny`,"
+		"`str`,`agi`,`vit`,`int`,`dex`,`luk`,`max_hp`,`hp`,`max_sp`,`sp`,"
+		"`status_point`,`skill_point`,`option`,`karma`,`manner`,`hair`,`hair_color`,"
+		"`clothes_color`,`body`,`weapon`,`shield`,`head_top`,`head_mid`,`head_bottom`,`last_map`,`rename`,`delete_date`,"
+		"`robe`,`moves`,`unban_time`,`font`,`uniqueitem_counter`,`sex`,`hotkey_rowshift`,`title_id`,`show_equip`,"
+		"`hotkey_rowshift2`,"
+		"`max_ap`,`ap`,`trait_point`,`pow`,`sta`,`wis`,`spl`,`con`,`crt`,"
+		"`inventory_slots`,`body_direction`,`disable_call`,`disable_partyinvite`,`disable_showcostumes`"
+		" FROM `%s` WHERE `account_id`='%d' AND `char_num` < '%d'", schema_config.char_db, account_id, MAX_CHARS );
+
+	return query;
+}
+
+/**
+ * Binds the columns of the character rooster query to a character.
+ * The statement and the SQL worker path share it, so both convert the columns the same way.
+ * @param bind: function binding a column index to a buffer of the given data type and length
+ * @param p: character to load the columns into
+ * @param sex: buffer for the gender column
+ * @param sex_len: length of the gender buffer
+ * @return true if all columns were bound
+ */
+template <typename F> static bool char_mmo_chars_bind( F bind, struct mmo_charstatus& p, char* sex, size_t sex_len ){
+	return bind(  0, SQLDT_INT32, &p.char_id, 0 )
+		&& bind(  1, SQLDT_UCHAR, &p.slot, 0 )
+		&& bind(  2, SQLDT_STRING, &p.name, sizeof(p.name) )
+		&& bind(  3, SQLDT_INT16, &p.class_, 0 )
+		&& bind(  4, SQLDT_UINT32, &p.base_level, 0 )
+		&& bind(  5, SQLDT_UINT32, &p.job_level, 0 )
+		&& bind(  6, SQLDT_UINT64, &p.base_exp, 0 )
+		&& bind(  7, SQLDT_UINT64, &p.job_exp, 0 )
+		&& bind(  8, SQLDT_INT32, &p.zeny, 0 )
+		&& bind(  9, SQLDT_INT16, &p.str, 0 )
+		&& bind( 10, SQLDT_INT16, &p.agi, 0 )
+		&& bind( 11, SQLDT_INT16, &p.vit, 0 )
+		&& bind( 12, SQLDT_INT16, &p.int_, 0 )
+		&& bind( 13, SQLDT_INT16, &p.dex, 0 )
+		&& bind( 14, SQLDT_INT16, &p.luk, 0 )
+		&& bind( 15, SQLDT_UINT32, &p.max_hp, 0 )
+		&& bind( 16, SQLDT_UINT32, &p.hp, 0 )
+		&& bind( 17, SQLDT_UINT32, &p.max_sp, 0 )
+		&& bind( 18, SQLDT_UINT32, &p.sp, 0 )
+		&& bind( 19, SQLDT_UINT32, &p.status_point, 0 )
+		&& bind( 20, SQLDT_UINT32, &p.skill_point, 0 )
+		&& bind( 21, SQLDT_UINT32, &p.option, 0 )
+		&& bind( 22, SQLDT_UCHAR, &p.karma, 0 )
+		&& bind( 23, SQLDT_INT16, &p.manner, 0 )
+		&& bind( 24, SQLDT_INT16, &p.hair, 0 )
+		&& bind( 25, SQLDT_INT16, &p.hair_color, 0 )
+		&& bind( 26, SQLDT_INT16, &p.clothes_color, 0 )
+		&& bind( 27, SQLDT_INT16, &p.body, 0 )
+		&& bind( 28, SQLDT_INT16, &p.weapon, 0 )
+		&& bind( 29, SQLDT_INT16, &p.shield, 0 )
+		&& bind( 30, SQLDT_INT16, &p.head_top, 0 )
+		&& bind( 31, SQLDT_INT16, &p.head_mid, 0 )
+		&& bind( 32, SQLDT_INT16, &p.head_bottom, 0 )
+		&& bind( 33, SQLDT_STRING, &p.last_point.map, sizeof(p.last_point.map) )
+		&& bind( 34, SQLDT_INT16, &p.rename, 0 )
+		&& bind( 35, SQLDT_UINT32, &p.delete_date, 0 )
+		&& bind( 36, SQLDT_INT16, &p.robe, 0 )
+		&& bind( 37, SQLDT_UINT32, &p.character_moves, 0 )
+		&& bind( 38, SQLDT_LONG, &p.unban_time, 0 )
+		&& bind( 39, SQLDT_UCHAR, &p.font, 0 )
+		&& bind( 40, SQLDT_UINT32, &p.uniqueitem_counter, 0 )
+		&& bind( 41, SQLDT_ENUM, sex, sex_len )
+		&& bind( 42, SQLDT_UCHAR, &p.hotkey_rowshift, 0 )
+		&& bind( 43, SQLDT_ULONG, &p.title_id, 0 )
+		&& bind( 44, SQLDT_UINT16, &p.show_equip, 0 )
+		&& bind( 45, SQLDT_UCHAR, &p.hotkey_rowshift2, 0 )
+		&& bind( 46, SQLDT_UINT32, &p.max_ap, 0 )
+		&& bind( 47, SQLDT_UINT32, &p.ap, 0 )
+		&& bind( 48, SQLDT_UINT32, &p.trait_point, 0 )
+		&& bind( 49, SQLDT_INT16, &p.pow, 0 )
+		&& bind( 50, SQLDT_INT16, &p.sta, 0 )
+		&& bind( 51, SQLDT_INT16, &p.wis, 0 )
+		&& bind( 52, SQLDT_INT16, &p.spl, 0 )
+		&& bind( 53, SQLDT_INT16, &p.con, 0 )
+		&& bind( 54, SQLDT_INT16, &p.crt, 0 )
+		&& bind( 55, SQLDT_UINT16, &p.inventory_slots, 0 )
+		&& bind( 56, SQLDT_UINT8, &p.body_direction, 0 )
+		&& bind( 57, SQLDT_UINT16, &p.disable_call, 0 )
+		&& bind( 58, SQLDT_UINT8, &p.disable_partyinvite, 0 )
+		&& bind( 59, SQLDT_UINT8, &p.disable_showcostumes, 0 );
+}
+
+/**
+ * Adds a character of the rooster to the session and writes the client's character info structure.
+ * @param sd: session the rooster is loaded for
+ * @param p: character as loaded by char_mmo_chars_bind
+ * @param sex: gender column of the character
+ * @param buf: buffer to write the character info to
+ * @return size of the written character info
+ */
+static int32 char_mmo_chars_add( struct char_session_data* sd, struct mmo_charstatus& p, char sex, uint8* buf ){
+	if( p.slot >= MAX_CHARS ){
+		return 0;
+	}
+
+	sd->found_char[p.slot] = p.char_id;
+	sd->unban_time[p.slot] = p.unban_time;
+	p.sex = char_mmo_gender( sd, &p, sex );
+
+	// Addon System
+	// store the required info into the session
+	sd->char_moves[p.slot] = p.character_moves;
+
+	return char_mmo_char_tobuf( buf, &p );
+}
+
+/**
+ * Resets the character slots of the session before the rooster is loaded.
+ */
+static void char_mmo_chars_reset( struct char_session_data* sd ){
+	for( int32 i = 0; i < MAX_CHARS; i++ ) {
+		sd->found_char[i] = -1;
+		sd->unban_time[i] = 0;
+	}
+}
+
+/**
+ * Converts the rows of the character rooster query, as returned by the SQL workers, into the client's character info structures.
+ * @return total buffer used
+ */
+static int32 char_mmo_chars_fromrows( struct char_session_data* sd, const std::vector<std::vector<std::string>>& rows, uint8* buf, uint8* count ){
+	int32 j = 0, i;
+
+	char_mmo_chars_reset( sd );
+
+	for( i = 0; i < MAX_CHARS && i < static_cast<int32>( rows.size() ); i++ ){
+		const std::vector<std::string>& row = rows[i];
+		struct mmo_charstatus p = {};
+		char sex[2];
+
+		if( !char_mmo_chars_bind( [&row]( size_t idx, SqlDataType type, void* buffer, size_t buffer_len ){
+			return idx < row.size() && SqlWorkerPool::get_column( row[idx], type, buffer, buffer_len );
+		}, p, sex, sizeof( sex ) ) ){
+			ShowError( "char_mmo_chars_fromrows: Invalid character row for account %d.\n", sd->account_id );
+			break;
+		}
+
+		j += char_mmo_chars_add( sd, p, sex[0], WBUFP( buf, j ) );
+	}
+
+	if( count != nullptr ){
+		*count = i;
+	}
+
+	memset(sd->new_name,0,sizeof(sd->new_name));
+
+	return j;
+}
+
 //=====================================================================================================
 // Loads the basic character rooster for the given account. Returns total buffer used.
 int32 char_mmo_chars_fromsql(struct char_session_data* sd, uint8* buf, uint8* count ) {
@@ -909,83 +1074,14 @@ int32 char_mmo_chars_fromsql(struct char_session_data* sd, uint8* buf, uint8* co
 
 	memset(&p, 0, sizeof(p));
 
-	for( i = 0; i < MAX_CHARS; i++ ) {
-		sd->found_char[i] = -1;
-		sd->unban_time[i] = 0;
-	}
+	char_mmo_chars_reset( sd );
 
 	// read char data
-	if( SQL_ERROR == stmt.Prepare( "SELECT "
-		"`char_id`,`char_num`,`name`,`class`,`base_level`,`job_level`,`base_exp`,`job_exp`,`zeny`,"
-		"`str`,`agi`,`vit`,`int`,`dex`,`luk`,`max_hp`,`hp`,`max_sp`,`sp`,"
-		"`status_point`,`skill_point`,`option`,`karma`,`manner`,`hair`,`hair_color`,"
-		"`clothes_color`,`body`,`weapon`,`shield`,`head_top`,`head_mid`,`head_bottom`,`last_map`,`rename`,`delete_date`,"
-		"`robe`,`moves`,`unban_time`,`font`,`uniqueitem_counter`,`sex`,`hotkey_rowshift`,`title_id`,`show_equip`,"
-		"`hotkey_rowshift2`,"
-		"`max_ap`,`ap`,`trait_point`,`pow`,`sta`,`wis`,`spl`,`con`,`crt`,"
-		"`inventory_slots`,`body_direction`,`disable_call`,`disable_partyinvite`,`disable_showcostumes`"
-		" FROM `%s` WHERE `account_id`='%d' AND `char_num` < '%d'", schema_config.char_db, sd->account_id, MAX_CHARS)
+	if( SQL_ERROR == stmt.PrepareStr( char_mmo_chars_query( sd->account_id ).c_str() )
 	||	SQL_ERROR == stmt.Execute()
-	||	SQL_ERROR == stmt.BindColumn( 0,  SQLDT_INT32, &p.char_id )
-	||	SQL_ERROR == stmt.BindColumn( 1,  SQLDT_UCHAR, &p.slot )
-	||	SQL_ERROR == stmt.BindColumn( 2,  SQLDT_STRING, &p.name, sizeof(p.name) )
-	||	SQL_ERROR == stmt.BindColumn( 3,  SQLDT_INT16, &p.class_ )
-	||	SQL_ERROR == stmt.BindColumn( 4,  SQLDT_UINT32, &p.base_level )
-	||	SQL_ERROR == stmt.BindColumn( 5,  SQLDT_UINT32, &p.job_level )
-	||	SQL_ERROR == stmt.BindColumn( 6,  SQLDT_UINT64, &p.base_exp )
-	||	SQL_ERROR == stmt.BindColumn( 7,  SQLDT_UINT64, &p.job_exp )
-	||	SQL_ERROR == stmt.BindColumn( 8,  SQLDT_INT32, &p.zeny )
-	||	SQL_ERROR == stmt.BindColumn( 9,  SQLDT_INT16, &p.str )
-	||	SQL_ERROR == stmt.BindColumn( 10, SQLDT_INT16, &p.agi )
-	||	SQL_ERROR == stmt.BindColumn( 11, SQLDT_INT16, &p.vit )
-	||	SQL_ERROR == stmt.BindColumn( 12, SQLDT_INT16, &p.int_ )
-	||	SQL_ERROR == stmt.BindColumn( 13, SQLDT_INT16, &p.dex )
-	||	SQL_ERROR == stmt.BindColumn( 14, SQLDT_INT16, &p.luk )
-	||	SQL_ERROR == stmt.BindColumn( 15, SQLDT_UINT32, &p.max_hp )
-	||	SQL_ERROR == stmt.BindColumn( 16, SQLDT_UINT32, &p.hp )
-	||	SQL_ERROR == stmt.BindColumn( 17, SQLDT_UINT32, &p.max_sp )
-	||	SQL_ERROR == stmt.BindColumn( 18, SQLDT_UINT32, &p.sp )
-	||	SQL_ERROR == stmt.BindColumn( 19, SQLDT_UINT32, &p.status_point )
-	||	SQL_ERROR == stmt.BindColumn( 20, SQLDT_UINT32, &p.skill_point )
-	||	SQL_ERROR == stmt.BindColumn( 21, SQLDT_UINT32, &p.option )
-	||	SQL_ERROR == stmt.BindColumn( 22, SQLDT_UCHAR, &p.karma )
-	||	SQL_ERROR == stmt.BindColumn( 23, SQLDT_INT16, &p.manner )
-	||	SQL_ERROR == stmt.BindColumn( 24, SQLDT_INT16, &p.hair )
-	||	SQL_ERROR == stmt.BindColumn( 25, SQLDT_INT16, &p.hair_color )
-	||	SQL_ERROR == stmt.BindColumn( 26, SQLDT_INT16, &p.clothes_color )
-	||	SQL_ERROR == stmt.BindColumn( 27, SQLDT_INT16, &p.body )
-	||	SQL_ERROR == stmt.BindColumn( 28, SQLDT_INT16, &p.weapon )
-	||	SQL_ERROR == stmt.BindColumn( 29, SQLDT_INT16, &p.shield )
-	||	SQL_ERROR == stmt.BindColumn( 30, SQLDT_INT16, &p.head_top )
-	||	SQL_ERROR == stmt.BindColumn( 31, SQLDT_INT16, &p.head_mid )
-	||	SQL_ERROR == stmt.BindColumn( 32, SQLDT_INT16, &p.head_bottom )
-	||	SQL_ERROR == stmt.BindColumn( 33, SQLDT_STRING, &p.last_point.map, sizeof(p.last_point.map) )
-	||	SQL_ERROR == stmt.BindColumn( 34, SQLDT_INT16, &p.rename )
-	||	SQL_ERROR == stmt.BindColumn( 35, SQLDT_UINT32, &p.delete_date )
-	||	SQL_ERROR == stmt.BindColumn( 36, SQLDT_INT16, &p.robe )
-	||	SQL_ERROR == stmt.BindColumn( 37, SQLDT_UINT32, &p.character_moves )
-	||	SQL_ERROR == stmt.BindColumn( 38, SQLDT_LONG, &p.unban_time )
-	||	SQL_ERROR == stmt.BindColumn( 39, SQLDT_UCHAR, &p.font )
-	||	SQL_ERROR == stmt.BindColumn( 40, SQLDT_UINT32, &p.uniqueitem_counter )
-	||	SQL_ERROR == stmt.BindColumn( 41, SQLDT_ENUM, &sex, sizeof(sex) )
-	||	SQL_ERROR == stmt.BindColumn( 42, SQLDT_UCHAR, &p.hotkey_rowshift )
-	||	SQL_ERROR == stmt.BindColumn( 43, SQLDT_ULONG, &p.title_id )
-	||	SQL_ERROR == stmt.BindColumn( 44, SQLDT_UINT16, &p.show_equip )
-	||	SQL_ERROR == stmt.BindColumn( 45, SQLDT_UCHAR, &p.hotkey_rowshift2 )
-	||	SQL_ERROR == stmt.BindColumn( 46, SQLDT_UINT32, &p.max_ap )
-	||	SQL_ERROR == stmt.BindColumn( 47, SQLDT_UINT32, &p.ap )
-	||	SQL_ERROR == stmt.BindColumn( 48, SQLDT_UINT32, &p.trait_point )
-	||	SQL_ERROR == stmt.BindColumn( 49, SQLDT_INT16, &p.pow )
-	||	SQL_ERROR == stmt.BindColumn( 50, SQLDT_INT16, &p.sta )
-	||	SQL_ERROR == stmt.BindColumn( 51, SQLDT_INT16, &p.wis )
-	||	SQL_ERROR == stmt.BindColumn( 52, SQLDT_INT16, &p.spl )
-	||	SQL_ERROR == stmt.BindColumn( 53, SQLDT_INT16, &p.con )
-	||	SQL_ERROR == stmt.BindColumn( 54, SQLDT_INT16, &p.crt )
-	||	SQL_ERROR == stmt.BindColumn( 55, SQLDT_UINT16, &p.inventory_slots )
-	||	SQL_ERROR == stmt.BindColumn( 56, SQLDT_UINT8, &p.body_direction )
-	||	SQL_ERROR == stmt.BindColumn( 57, SQLDT_UINT16, &p.disable_call )
-	||	SQL_ERROR == stmt.BindColumn( 58, SQLDT_UINT8, &p.disable_partyinvite )
-	||	SQL_ERROR == stmt.BindColumn( 59, SQLDT_UINT8, &p.disable_showcostumes )
+	||	!char_mmo_chars_bind( [&stmt]( size_t idx, SqlDataType type, void* buffer, size_t buffer_len ){
+			return SQL_SUCCESS == stmt.BindColumn( idx, type, buffer, buffer_len );
+		}, p, sex, sizeof( sex ) )
 	)
 	{
 		SqlStmt_ShowDebug(stmt);
@@ -994,14 +1090,7 @@ int32 char_mmo_chars_fromsql(struct char_session_data* sd, uint8* buf, uint8* co
 
 	for( i = 0; i < MAX_CHARS && SQL_SUCCESS == stmt.NextRow(); i++ )
 	{
-		sd->found_char[p.slot] = p.char_id;
-		sd->unban_time[p.slot] = p.unban_time;
-		p.sex = char_mmo_gender(sd, &p, sex[0]);
-		j += char_mmo_char_tobuf(WBUFP(buf, j), &p);
-
-		// Addon System
-		// store the required info into the session
-		sd->char_moves[p.slot] = p.character_moves;
+		j += char_mmo_chars_add( sd, p, sex[0], WBUFP( buf, j ) );
 	}
 
 	if( count != nullptr ){
@@ -1013,6 +1102,53 @@ int32 char_mmo_chars_fromsql(struct char_session_data* sd, uint8* buf, uint8* co
 	return j;
 }
 
+/**
+ * Loads the basic character rooster for the given account on a SQL worker thread.
+ * Until the result arrived, the session is marked as pending and its packets are held back.
+ * If the SQL workers are disabled the rooster is loaded directly.
+ * @param fd: session of the client
+ * @param sd: session data of the client
+ * @param callback: function to call with the character info buffer once the rooster was loaded,
+ *                  it is not called if the client disconnected in the meantime
+ */
+void char_mmo_chars_fromsql_async( int32 fd, struct char_session_data* sd, std::function<void( int32 fd, struct char_session_data* sd, uint8* buf, int32 len, uint8 count )> callback ){
+	uint8 buf[MAX_CHARS * MAX_CHAR_BUF];
+	uint8 count = 0;
+
+	if( !char_sql_workers.is_enabled() ){
+		int32 len = char_mmo_chars_fromsql( sd, buf, &count );
+
+		callback( fd, sd, buf, len, count );
+		return;
+	}
+
+	uint32 account_id = sd->account_id;
+	uint32 request = ++sd->charlist_request;
+
+	sd->charlist_pending = true;
+
+	char_sql_workers.enqueue( char_mmo_chars_query( account_id ), [fd, account_id, request, callback]( s_sql_worker_result& result ){
+		// The client disconnected or the session was reused meanwhile
+		if( !session_isActive( fd ) ){
+			return;
+		}
+
+		struct char_session_data* sd = (struct char_session_data*)session[fd]->session_data;
+
+		if( sd == nullptr || sd->account_id != account_id || sd->charlist_request != request ){
+			return;
+		}
+
+		uint8 buf[MAX_CHARS * MAX_CHAR_BUF];
+		uint8 count = 0;
+		int32 len = char_mmo_chars_fromrows( sd, result.rows, buf, &count );
+
+		sd->charlist_pending = false;
+
+		callback( fd, sd, buf, len, count );
+	} );
+}
+
 //=====================================================================================================
 int32 char_mmo_char_fromsql(uint32 char_id, struct mmo_charstatus* p, bool load_everything) {
 	int32 i;
@@ -2792,6 +2928,7 @@ void char_set_defaults(){
 #endif
 
 	charserv_config.clear_parties = 0;
+	charserv_config.sql_worker_threads = 2;
 }
 
 /**
@@ -2947,6 +3084,12 @@ bool char_config_read(const char* cfgName, bool normal){
 			console_msg_log = atoi(w2);
 		} else if  (strcmpi(w1, "console_log_filepath") == 0) {
 			safestrncpy(console_log_filepath, w2, sizeof(console_log_filepath));
+		} else if (strcmpi(w1, "console_log_format") == 0) {
+			console_log_format = strcmpi(w2, "binary") == 0 ? CONSOLE_LOG_BINARY : CONSOLE_LOG_TEXT;
+		} else if (strcmpi(w1, "console_async") == 0) {
+			console_async = config_switch(w2);
+		} else if (strcmpi(w1, "console_rate_limit") == 0) {
+			console_rate_limit = cap_value(atoi(w2), 0, INT_MAX);
 		} else if(strcmpi(w1,"stdout_with_ansisequence")==0){
 			stdout_with_ansisequence = config_switch(w2);
 		} else if (strcmpi(w1, "char_maintenance") == 0) {
@@ -3074,6 +3217,8 @@ bool char_config_read(const char* cfgName, bool normal){
 			charserv_config.allowed_job_flag = atoi(w2);
 		} else if (strcmpi(w1, "clear_parties") == 0) {
 			charserv_config.clear_parties = config_switch(w2);
+		} else if (strcmpi(w1, "sql_worker_threads") == 0) {
+			charserv_config.sql_worker_threads = cap_value(atoi(w2), 0, 32);
 		} else if (strcmpi(w1, "import") == 0) {
 			char_config_read(w2, normal);
 		}
@@ -3115,6 +3260,8 @@ void CharacterServer::finalize(){
 	char_set_all_offline(-1);
 	char_set_all_offline_sql();
 
+	char_sql_workers.finalize();
+
 	inter_final();
 
 	flush_fifos();
@@ -3138,6 +3285,17 @@ void CharacterServer::finalize(){
 	ShowStatus("Finished.\n");
 }
 
+void CharacterServer::handle_main( t_tick next ){
+	// Do not wait for network events longer than needed while queries are running on the SQL workers
+	if( char_sql_workers.get_pending() > 0 ){
+		next = std::min<t_tick>( next, CHAR_SQLWORKER_POLL_INTERVAL );
+	}
+
+	do_sockets( next );
+
+	char_sql_workers.process();
+}
+
 /// Called when a terminate signal is received.
 void CharacterServer::handle_shutdown(){
 	ShowStatus("Shutting down...\n");
@@ -3174,6 +3332,11 @@ bool CharacterServer::initialize( int32 argc, char *argv[] ){
 	char_mmo_sql_init();
 	char_read_fame_list(); //Read fame lists.
 
+	if( !char_sql_workers.initialize( charserv_config.sql_worker_threads, char_server_id.c_str(), char_server_pw.c_str(), char_server_ip.c_str(), (uint16)char_server_port, char_server_db.c_str(), default_codepage.c_str() ) ){
+		ShowFatalError( "Failed to start the SQL worker threads.\n" );
+		return false;
+	}
+
 	if ((naddr_ != 0) && (!(charserv_config.login_ip) || !(charserv_config.char_ip) ))
 	{
 		char ip_str[16];
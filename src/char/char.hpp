@@ -4,6 +4,7 @@
 #ifndef CHAR_HPP
 #define CHAR_HPP
 
+#include <functional>
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -11,6 +12,7 @@
 #include <common/core.hpp> // CORE_ST_LAST
 #include <common/mmo.hpp>
 #include <common/msg_conf.hpp>
+#include <common/sqlworker.hpp>
 #include <common/timer.hpp>
 #include <config/core.hpp>
 
@@ -24,6 +26,7 @@ class CharacterServer : public Core {
 	protected:
 		bool initialize( int32 argc, char* argv[] ) override;
 		void finalize() override;
+		void handle_main( t_tick next ) override;
 		void handle_shutdown() override;
 
 	public:
@@ -206,8 +209,10 @@ struct CharServ_Config {
 
 	int32 allowed_job_flag;
 	int32 clear_parties;
+	uint16 sql_worker_threads; // amount of threads running queries off the main thread, 0 disables them
 };
 extern struct CharServ_Config charserv_config;
+extern SqlWorkerPool char_sql_workers;
 
 #define MAX_MAP_SERVERS 2 //how many mapserver a char server can handle
 struct mmo_map_server {
@@ -274,6 +279,8 @@ struct char_session_data {
 	time_t unban_time[MAX_CHARS];
 	int32 charblock_timer;
 	uint8 flag; // &1 - Retrieving guild bound items
+	bool charlist_pending; // character list is being loaded by a SQL worker, client packets are held back meanwhile
+	uint32 charlist_request; // id of the latest character list request, stale results are discarded
 };
 
 std::unordered_map<uint32, std::shared_ptr<struct mmo_charstatus>>& char_get_chardb();
@@ -288,6 +295,7 @@ extern struct fame_list chemist_fame_list[MAX_FAME_LIST];
 extern struct fame_list taekwon_fame_list[MAX_FAME_LIST];
 
 #define DEFAULT_AUTOSAVE_INTERVAL 300*1000
+#define CHAR_SQLWORKER_POLL_INTERVAL 10 // maximum time in ms to wait for network events while SQL worker queries are pending
 #define MAX_CHAR_BUF sizeof( struct CHARACTER_INFO ) //Max size (for WFIFOHEAD calls)
 
 int32 char_search_mapserver( const std::string& map, uint32 ip, uint16 port );
@@ -306,6 +314,7 @@ int32 char_mmo_char_tobuf(uint8* buffer, struct mmo_charstatus* p);
 int32 char_mmo_char_tosql(uint32 char_id, struct mmo_charstatus* p);
 int32 char_mmo_char_fromsql(uint32 char_id, struct mmo_charstatus* p, bool load_everything);
 int32 char_mmo_chars_fromsql(struct char_session_data* sd, uint8* buf, uint8* count = nullptr);
+void char_mmo_chars_fromsql_async( int32 fd, struct char_session_data* sd, std::function<void( int32 fd, struct char_session_data* sd, uint8* buf, int32 len, uint8 count )> callback );
 enum e_char_del_response char_delete(struct char_session_data* sd, uint32 char_id);
 int32 char_rename_char_sql(struct char_session_data *sd, uint32 char_id);
 int32 char_divorce_char_sql(int32 partner_id1, int32 partner_id2);
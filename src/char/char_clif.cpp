@@ -385,7 +385,7 @@ void chclif_charlist_notify( int32 fd, struct char_session_data* sd ){
 //----------------------------------------
 // Function to send characters to a player
 //----------------------------------------
-int32 chclif_mmo_send006b(int32 fd, struct char_session_data* sd){
+int32 chclif_mmo_send006b( int32 fd, struct char_session_data* sd, uint8* chars, int32 len ){
 	int32 j, offset;
 
 #if PACKETVER >= 20100413
@@ -406,7 +406,8 @@ int32 chclif_mmo_send006b(int32 fd, struct char_session_data* sd){
 		WFIFOB(fd,6) = MIN_CHARS+sd->chars_vip; // Premium slots. (Any existent chars past sd->char_slots but within MAX_CHARS will show a 'Premium Service' in red)
 #endif
 	memset(WFIFOP(fd,4 + offset), 0, 20); // unknown bytes
-	j+=char_mmo_chars_fromsql(sd, WFIFOP(fd,j));
+	memcpy(WFIFOP(fd,j), chars, len);
+	j += len;
 	WFIFOW(fd,2) = j; // packet len
 	WFIFOSET(fd,j);
 
@@ -431,12 +432,11 @@ void chclif_mmo_send082d(int32 fd, struct char_session_data* sd) {
 	WFIFOSET(fd,29);
 }
 
-void chclif_mmo_send099d(int32 fd, struct char_session_data *sd) {
-	uint8 count = 0;
-
+void chclif_mmo_send099d( int32 fd, struct char_session_data *sd, uint8* chars, int32 len, uint8 count ){
 	WFIFOHEAD(fd,4 + (MAX_CHARS*MAX_CHAR_BUF));
 	WFIFOW(fd,0) = HEADER_HC_ACK_CHARINFO_PER_PAGE;
-	WFIFOW(fd,2) = char_mmo_chars_fromsql(sd, WFIFOP(fd,4), &count) + 4;
+	memcpy(WFIFOP(fd,4), chars, len);
+	WFIFOW(fd,2) = len + 4;
 	WFIFOSET(fd,WFIFOW(fd,2));
 
 	// This is something special Gravity came up with.
@@ -452,20 +452,31 @@ void chclif_mmo_send099d(int32 fd, struct char_session_data *sd) {
 
 /*
  * Function to choose wich kind of charlist to send to client depending on his version
+ * The character list might be loaded asynchronously, packets that have to follow it
+ * must be sent from the callback.
  */
-void chclif_mmo_char_send(int32 fd, struct char_session_data* sd){
+void chclif_mmo_char_send( int32 fd, struct char_session_data* sd, std::function<void( int32 fd, struct char_session_data* sd )> callback ){
 #if PACKETVER >= 20130000
 	chclif_mmo_send082d(fd, sd);
-	chclif_mmo_send006b(fd, sd);
-	chclif_charlist_notify(fd, sd);
+#endif
+
+	char_mmo_chars_fromsql_async( fd, sd, [callback]( int32 fd, struct char_session_data* sd, uint8* chars, int32 len, uint8 count ){
+#if PACKETVER >= 20130000
+		chclif_mmo_send006b(fd, sd, chars, len);
+		chclif_charlist_notify(fd, sd);
 #else
-	chclif_mmo_send006b(fd,sd);
-	//@FIXME dump from kro doesn't show 6b transmission
+		chclif_mmo_send006b(fd, sd, chars, len);
+		//@FIXME dump from kro doesn't show 6b transmission
 #endif
 
 #if PACKETVER >= 20060819
- 	chclif_block_character(fd,sd);
+		chclif_block_character(fd,sd);
 #endif
+
+		if( callback != nullptr ){
+			callback( fd, sd );
+		}
+	} );
 }
 
 /*
@@ -528,18 +539,26 @@ void chclif_char_delete2_ack(int32 fd, uint32 char_id, uint32 result, time_t del
 /// 7 Character Deletion has failed because you have entered an incorrect e-mail address.
 /// Any (0x718): An unknown error has occurred.
 /// HC: <082a>.W <char id>.L <Msg>.L
+static void chclif_char_delete2_accept_ack_sub( int32 fd, uint32 char_id, uint32 result ){
+	WFIFOHEAD(fd,10);
+	WFIFOW(fd,0) = 0x82a;
+	WFIFOL(fd,2) = char_id;
+	WFIFOL(fd,6) = result;
+	WFIFOSET(fd,10);
+}
+
 void chclif_char_delete2_accept_ack(int32 fd, uint32 char_id, uint32 result) {
 #if PACKETVER >= 20130000
 	if(result == 1 ){
-		chclif_mmo_char_send(fd, (char_session_data*)session[fd]->session_data);
+		// The acknowledgement has to follow the refreshed character list
+		chclif_mmo_char_send( fd, (char_session_data*)session[fd]->session_data, [char_id, result]( int32 fd, struct char_session_data* sd ){
+			chclif_char_delete2_accept_ack_sub( fd, char_id, result );
+		} );
+		return;
 	}
 #endif
 
-	WFIFOHEAD(fd,10);
-	WFIFOW(fd,0) = 0x82a;
-	WFIFOL(fd,2) = char_id;
-	WFIFOL(fd,6) = result;
-	WFIFOSET(fd,10);
+	chclif_char_delete2_accept_ack_sub( fd, char_id, result );
 }
 
 /// @param result
@@ -848,7 +867,9 @@ int32 chclif_parse_reqtoconnect(int32 fd, struct char_session_data* sd,uint32 ip
 int32 chclif_parse_req_charlist(int32 fd, struct char_session_data* sd){
 	FIFOSD_CHECK(2);
 	RFIFOSKIP(fd,2);
-	chclif_mmo_send099d(fd,sd);
+	char_mmo_chars_fromsql_async( fd, sd, []( int32 fd, struct char_session_data* sd, uint8* chars, int32 len, uint8 count ){
+		chclif_mmo_send099d( fd, sd, chars, len, count );
+	} );
 	return 1;
 }
 
@@ -1608,6 +1629,11 @@ int32 chclif_parse(int32 fd) {
 		return 0;
 	}
 
+	// Hold back further packets until the character list was loaded
+	if( sd != nullptr && sd->charlist_pending ){
+		return 0;
+	}
+
 	while( RFIFOREST(fd) >= 2 ) {
 		int32 next = 1;
 		uint16 cmd;
@@ -4,6 +4,8 @@
 #ifndef CHAR_CLIF_HPP
 #define CHAR_CLIF_HPP
 
+#include <functional>
+
 #include <common/cbasetypes.hpp>
 #include <common/timer.hpp> //time_t
 
@@ -24,10 +26,10 @@ void chclif_reject(int32 fd, uint8 errCode);
 void chclif_refuse_delchar(int32 fd, uint8 errCode);
 void chclif_charlist_notify( int32 fd, struct char_session_data* sd );
 void chclif_block_character( int32 fd, struct char_session_data* sd );
-int32 chclif_mmo_send006b(int32 fd, struct char_session_data* sd);
+int32 chclif_mmo_send006b( int32 fd, struct char_session_data* sd, uint8* chars, int32 len );
 void chclif_mmo_send082d(int32 fd, struct char_session_data* sd);
-void chclif_mmo_send099d(int32 fd, struct char_session_data *sd);
-void chclif_mmo_char_send(int32 fd, struct char_session_data* sd);
+void chclif_mmo_send099d( int32 fd, struct char_session_data *sd, uint8* chars, int32 len, uint8 count );
+void chclif_mmo_char_send( int32 fd, struct char_session_data* sd, std::function<void( int32 fd, struct char_session_data* sd )> callback = nullptr );
 void chclif_send_auth_result(int32 fd,char result);
 void chclif_char_delete2_ack(int32 fd, uint32 char_id, uint32 result, time_t delete_date);
 void chclif_char_delete2_accept_ack(int32 fd, uint32 char_id, uint32 result);
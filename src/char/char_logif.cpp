@@ -360,10 +360,11 @@ int32 chlogif_parse_reqaccdata(int32 fd){
 			chclif_reject(u_fd,0);
 		} else {
 			// send characters to player
-			chclif_mmo_char_send(u_fd, sd);
+			chclif_mmo_char_send( u_fd, sd, []( int32 fd, struct char_session_data* sd ){
 #if PACKETVER_SUPPORTS_PINCODE
-			chlogif_pincode_start(u_fd,sd);
+				chlogif_pincode_start( fd, sd );
 #endif
+			} );
 		}
 	}
 	RFIFOSKIP(fd,75);
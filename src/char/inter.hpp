@@ -37,6 +37,13 @@ int32 inter_log(const char *fmt,...);
 
 extern uint32 party_share_level;
 
+extern int32 char_server_port;
+extern std::string char_server_ip;
+extern std::string char_server_id;
+extern std::string char_server_pw;
+extern std::string char_server_db;
+extern std::string default_codepage;
+
 extern Sql* sql_handle;
 extern Sql* lsql_handle;
 
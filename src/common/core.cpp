@@ -11,6 +11,7 @@
 #ifndef MINICORE
 #include "database.hpp"
 #include "ers.hpp"
+#include "profiler.hpp"
 #include "socket.hpp"
 #include "timer.hpp"
 #include "sql.hpp"
@@ -128,6 +129,8 @@ static void sig_proc(int32 sn) {
 		if( global_core != nullptr ){
 			global_core->signal_crash();
 		}
+		// Get the queued messages out before the process dies, showmsg_flush is not async-signal-safe
+		showmsg_crash();
 		// Pass the signal to the system's default handler
 		compat_signal(sn, SIG_DFL);
 		raise(sn);
@@ -355,6 +358,9 @@ int32 Core::start( int32 argc, char **argv ){
 	}
 
 	malloc_init();// needed for Show* in display_title() [FlavioJS]
+#ifndef MINICORE
+	showmsg_init();
+#endif
 	display_title();
 	usercheck();
 
@@ -386,9 +392,19 @@ int32 Core::start( int32 argc, char **argv ){
 		if( !this->m_run_once ){
 			// Main runtime cycle
 			while( this->get_status() == e_core_status::RUNNING ){
+				bool profiling = profiler_enabled;
+
+				if( profiling ){
+					profiler_tick_begin();
+				}
+
 				t_tick next = do_timer( gettick_nocache() );
 
 				this->handle_main( next );
+
+				if( profiling ){
+					profiler_tick_end();
+				}
 			}
 		}
 #endif
@@ -401,6 +417,7 @@ int32 Core::start( int32 argc, char **argv ){
 
 	this->set_status( e_core_status::CORE_FINALIZING );
 #ifndef MINICORE
+	profiler_final();
 	timer_final();
 	socket_final();
 	db_final();
@@ -408,6 +425,9 @@ int32 Core::start( int32 argc, char **argv ){
 #endif
 
 	malloc_final();
+#ifndef MINICORE
+	showmsg_final();
+#endif
 	this->set_status( e_core_status::CORE_FINALIZED );
 
 #if defined(BUILDBOT)
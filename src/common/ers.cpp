@@ -28,13 +28,18 @@
  *    destroyed so memory will usually only be recovered near the end.       *
  *  - Always wastes space for entries smaller than a pointer.                *
  *                                                                           *
- *  WARNING: The system is not thread-safe at the moment.                    *
+ *  Entries are carved from page aligned slabs in address order. Every       *
+ *  thread keeps a small magazine of free entries per cache, so entries can  *
+ *  be allocated and freed by any thread and the lock of a cache is only     *
+ *  taken to refill or flush a magazine.                                     *
  *                                                                           *
  *  HISTORY:                                                                 *
  *    0.1 - Initial version                                                  *
  *    1.0 - ERS Rework                                                       *
+ *    1.1 - Slabs, thread-local magazines and statistics, the 1.0 manager    *
+ *          stays available through ers_new_legacy for comparisons           *
  *                                                                           *
- * @version 1.0 - ERS Rework                                                 *
+ * @version 1.1 - Slabs, thread-local magazines and statistics               *
  * @author GreenBox @ rAthena Project                                        *
  * @encoding US-ASCII                                                        *
  * @see common#ers.hpp                                                         *
@@ -42,18 +47,621 @@
 
 #include "ers.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
+#include <mutex>
+
+#ifdef ERS_HUGE_PAGES
+#include <sys/mman.h>
+#endif
 
 #include "cbasetypes.hpp"
-#include "malloc.hpp" // CREATE, RECREATE, aMalloc, aFree
+#include "malloc.hpp" // RECREATE, aStrdup, aFree
 #include "nullpo.hpp"
 #include "showmsg.hpp" // ShowMessage, ShowError, ShowFatalError, CL_BOLD, CL_NORMAL
+#include "timer.hpp" // gettick
+#include "utils.hpp" // cap_value
 
 #ifndef DISABLE_ERS
 
 #define ERS_BLOCK_ENTRIES 2048
 
+#ifdef ERS_HUGE_PAGES
+#define ERS_SLAB_ALIGN (2 * 1024 * 1024)
+#else
+#define ERS_SLAB_ALIGN 4096
+#endif
+
+// Bytes of free entries a thread keeps per cache, limited to ERS_MAGAZINE_MIN..ERS_MAGAZINE_MAX entries
+#define ERS_MAGAZINE_BYTES 16384
+#define ERS_MAGAZINE_MIN 4
+#define ERS_MAGAZINE_MAX 64
+
+struct ers_list
+{
+	struct ers_list *Next;
+};
+
+struct ers_slab
+{
+	unsigned char *Data;
+	size_t Size;
+};
+
+struct ers_instance_t;
+
+typedef struct ers_cache
+{
+	// Allocated object size, including ers_list size
+	uint32 ObjectSize;
+
+	// Number of ers_instances referencing this
+	int32 ReferenceCount;
+
+	// Index of the magazines of this cache in the thread-local magazine arrays
+	uint32 Id;
+
+	// Entries a magazine is refilled with, twice this amount makes it flush
+	uint32 MagazineSize;
+
+	// Protects everything below
+	std::mutex Lock;
+
+	// Reuse linked list
+	struct ers_list *ReuseList;
+
+	// Entries in the reuse list
+	uint32 Reusable;
+
+	// Slabs array
+	struct ers_slab *Slabs;
+
+	// Max number of slabs
+	uint32 Max;
+
+	// Entries not carved from the last slab yet
+	uint32 Free;
+
+	// Used slabs count
+	uint32 Used;
+
+	// Entries carved from all slabs
+	uint32 Capacity;
+
+	// Bytes of all slabs
+	size_t Memory;
+
+	// Default = ERS_BLOCK_ENTRIES, can be adjusted for performance for individual cache sizes.
+	uint32 ChunkSize;
+
+	// Misc options, some options are shared from the instance
+	enum ERSOptions Options;
+
+	// Linked list
+	struct ers_cache *Next, *Prev;
+} ers_cache_t;
+
+struct ers_instance_t {
+	// Interface to ERS
+	struct eri VTable;
+
+	// Name, used for debugging purposes
+	char *Name;
+
+	// Misc options
+	enum ERSOptions Options;
+
+	// Our cache
+	ers_cache_t *Cache;
+
+	// Count of objects in use, used for detecting memory leaks
+	std::atomic<uint32> Count;
+
+	// Highest count since the last reset
+	std::atomic<uint32> Peak;
+
+	// Objects allocated since the last reset
+	std::atomic<uint64> Allocs;
+
+	// Allocations and time of the previous ers_stats call, for the allocation rate
+	uint64 RateAllocs;
+	t_tick RateTick;
+
+	struct ers_instance_t *Next, *Prev;
+};
+
+/// Free entries of a cache that belong to a thread
+struct ers_magazine {
+	struct ers_list *Head;
+	uint32 Count;
+};
+
+/// Magazines of a thread, indexed by the id of the cache
+struct ers_thread_cache {
+	std::vector<struct ers_magazine> Magazines;
+
+	~ers_thread_cache();
+};
+
+
+// Protects the lists and the registry below
+static std::recursive_mutex ListLock;
+// Array containing a pointer for all ers_cache structures
+static ers_cache_t *CacheList = nullptr;
+static struct ers_instance_t *InstanceList = nullptr;
+// Caches indexed by their id, nullptr once a cache is freed
+static std::vector<ers_cache_t*> CacheRegistry;
+
+static thread_local struct ers_thread_cache ThreadCache;
+
+static unsigned char *ers_slab_alloc(size_t size)
+{
+	void *data = nullptr;
+
+#ifdef _WIN32
+	data = _aligned_malloc(size, ERS_SLAB_ALIGN);
+#else
+	if (posix_memalign(&data, ERS_SLAB_ALIGN, size) != 0)
+		data = nullptr;
+#endif
+
+	if (data == nullptr) {
+		ShowFatalError("ers_slab_alloc: out of memory allocating a slab of %" PRIuPTR " bytes.\n", size);
+		exit(EXIT_FAILURE);
+	}
+
+#if defined(ERS_HUGE_PAGES) && defined(MADV_HUGEPAGE)
+	madvise(data, size, MADV_HUGEPAGE);
+#endif
+
+	// Entries of ERS_OPT_CLEAN caches are expected to be zeroed
+	memset(data, 0, size);
+
+	return (unsigned char *)data;
+}
+
+static void ers_slab_free(unsigned char *data)
+{
+#ifdef _WIN32
+	_aligned_free(data);
+#else
+	free(data);
+#endif
+}
+
+/**
+ * Add a new slab to the cache.
+ * The cache must be locked.
+ **/
+static void ers_cache_grow(ers_cache_t *cache)
+{
+	size_t size = static_cast<size_t>( cache->ObjectSize ) * cache->ChunkSize;
+
+	// Round up to whole pages, the rest of the page is used for more entries
+	size = ( size + ERS_SLAB_ALIGN - 1 ) / ERS_SLAB_ALIGN * ERS_SLAB_ALIGN;
+
+	if (cache->Used == cache->Max) {
+		cache->Max = (cache->Max * 4) + 3;
+		RECREATE(cache->Slabs, struct ers_slab, cache->Max);
+	}
+
+	cache->Slabs[cache->Used].Data = ers_slab_alloc(size);
+	cache->Slabs[cache->Used].Size = size;
+	cache->Used++;
+
+	cache->Free = static_cast<uint32>( size / cache->ObjectSize );
+	cache->Capacity += cache->Free;
+	cache->Memory += size;
+}
+
+/**
+ * Move free entries of the cache into a magazine until it holds MagazineSize entries.
+ * Reusable entries are preferred, new entries are carved in address order.
+ **/
+static void ers_magazine_refill(ers_cache_t *cache, struct ers_magazine *magazine)
+{
+	std::lock_guard<std::mutex> lock(cache->Lock);
+
+	while (magazine->Count < cache->MagazineSize) {
+		if (cache->ReuseList != nullptr) {
+			struct ers_list *reuse = cache->ReuseList;
+
+			cache->ReuseList = reuse->Next;
+			cache->Reusable--;
+			reuse->Next = magazine->Head;
+			magazine->Head = reuse;
+			magazine->Count++;
+			continue;
+		}
+
+		if (cache->Free == 0)
+			ers_cache_grow(cache);
+
+		struct ers_slab *slab = &cache->Slabs[cache->Used - 1];
+		uint32 total = static_cast<uint32>( slab->Size / cache->ObjectSize );
+		uint32 count = std::min(cache->Free, cache->MagazineSize - magazine->Count);
+		unsigned char *first = slab->Data + static_cast<size_t>( total - cache->Free ) * cache->ObjectSize;
+
+		// Link them so the lowest address is handed out first
+		for (uint32 i = count; i > 0; i--) {
+			struct ers_list *entry = (struct ers_list *)(first + static_cast<size_t>( i - 1 ) * cache->ObjectSize);
+
+			entry->Next = magazine->Head;
+			magazine->Head = entry;
+		}
+
+		cache->Free -= count;
+		magazine->Count += count;
+	}
+}
+
+/**
+ * Move entries of a magazine back into the reuse list of the cache, keeping keep entries.
+ **/
+static void ers_magazine_flush(ers_cache_t *cache, struct ers_magazine *magazine, uint32 keep)
+{
+	std::lock_guard<std::mutex> lock(cache->Lock);
+
+	while (magazine->Count > keep) {
+		struct ers_list *reuse = magazine->Head;
+
+		magazine->Head = reuse->Next;
+		magazine->Count--;
+		reuse->Next = cache->ReuseList;
+		cache->ReuseList = reuse;
+		cache->Reusable++;
+	}
+}
+
+static inline struct ers_magazine *ers_magazine_get(ers_cache_t *cache)
+{
+	std::vector<struct ers_magazine> &magazines = ThreadCache.Magazines;
+
+	if (cache->Id >= magazines.size())
+		magazines.resize(cache->Id + 1, { nullptr, 0 });
+
+	return &magazines[cache->Id];
+}
+
+/**
+ * Give the entries of a finished thread back to their caches.
+ **/
+ers_thread_cache::~ers_thread_cache()
+{
+	std::lock_guard<std::recursive_mutex> lock(ListLock);
+
+	for (size_t id = 0; id < this->Magazines.size(); id++) {
+		if (this->Magazines[id].Count > 0 && CacheRegistry[id] != nullptr)
+			ers_magazine_flush(CacheRegistry[id], &this->Magazines[id], 0);
+	}
+
+	this->Magazines.clear();
+}
+
+/**
+ * @param Options the options from the instance seeking a cache, we use it to give it a cache with matching configuration
+ **/
+static ers_cache_t *ers_find_cache(uint32 size, enum ERSOptions Options) {
+	ers_cache_t *cache;
+
+	// ERS_OPT_FLEX_CHUNK instances change the chunk size, so they keep their entries in a cache of their own
+	if (!(Options & ERS_OPT_FLEX_CHUNK)) {
+		for (cache = CacheList; cache; cache = cache->Next)
+			if ( cache->ObjectSize == size && cache->Options == ( Options & ERS_CACHE_OPTIONS ) )
+				return cache;
+	}
+
+	cache = new ers_cache_t{};
+	cache->ObjectSize = size;
+	cache->ReferenceCount = 0;
+	cache->Id = static_cast<uint32>( CacheRegistry.size() );
+	cache->MagazineSize = cap_value(ERS_MAGAZINE_BYTES / size, ERS_MAGAZINE_MIN, ERS_MAGAZINE_MAX);
+	cache->ReuseList = nullptr;
+	cache->Reusable = 0;
+	cache->Slabs = nullptr;
+	cache->Free = 0;
+	cache->Used = 0;
+	cache->Capacity = 0;
+	cache->Memory = 0;
+	cache->Max = 0;
+	cache->ChunkSize = ERS_BLOCK_ENTRIES;
+	cache->Options = (enum ERSOptions)(Options & ERS_CACHE_OPTIONS);
+
+	CacheRegistry.push_back(cache);
+
+	if (CacheList == nullptr)
+	{
+		CacheList = cache;
+	}
+	else
+	{
+		cache->Next = CacheList;
+		cache->Next->Prev = cache;
+		CacheList = cache;
+		CacheList->Prev = nullptr;
+	}
+
+	return cache;
+}
+
+static void ers_free_cache(ers_cache_t *cache, bool remove)
+{
+	uint32 i;
+
+	// Entries of other threads are lost with the slabs, only ours have to be forgotten
+	if (cache->Id < ThreadCache.Magazines.size())
+		ThreadCache.Magazines[cache->Id] = { nullptr, 0 };
+
+	CacheRegistry[cache->Id] = nullptr;
+
+	for (i = 0; i < cache->Used; i++)
+		ers_slab_free(cache->Slabs[i].Data);
+
+	if (cache->Next)
+		cache->Next->Prev = cache->Prev;
+
+	if (cache->Prev)
+		cache->Prev->Next = cache->Next;
+	else
+		CacheList = cache->Next;
+
+	aFree(cache->Slabs);
+
+	delete cache;
+}
+
+static void *ers_obj_alloc_entry(ERS *self)
+{
+	struct ers_instance_t *instance = (struct ers_instance_t *)self;
+	struct ers_magazine *magazine;
+	struct ers_list *reuse;
+	uint32 count, peak;
+
+	if (instance == nullptr) {
+		ShowError("ers_obj_alloc_entry: nullptr object, aborting entry freeing.\n");
+		return nullptr;
+	}
+
+	magazine = ers_magazine_get(instance->Cache);
+
+	if (magazine->Count == 0)
+		ers_magazine_refill(instance->Cache, magazine);
+
+	reuse = magazine->Head;
+	magazine->Head = reuse->Next;
+	magazine->Count--;
+
+	count = instance->Count.fetch_add(1, std::memory_order_relaxed) + 1;
+	peak = instance->Peak.load(std::memory_order_relaxed);
+	while (count > peak && !instance->Peak.compare_exchange_weak(peak, count, std::memory_order_relaxed));
+	instance->Allocs.fetch_add(1, std::memory_order_relaxed);
+
+	return (void *)((unsigned char *)reuse + sizeof(struct ers_list));
+}
+
+static void ers_obj_free_entry(ERS *self, void *entry)
+{
+	struct ers_instance_t *instance = (struct ers_instance_t *)self;
+	struct ers_list *reuse = (struct ers_list *)((unsigned char *)entry - sizeof(struct ers_list));
+	struct ers_magazine *magazine;
+
+	if (instance == nullptr) {
+		ShowError("ers_obj_free_entry: nullptr object, aborting entry freeing.\n");
+		return;
+	} else if (entry == nullptr) {
+		ShowError("ers_obj_free_entry: nullptr entry, nothing to free.\n");
+		return;
+	}
+
+	if( instance->Cache->Options & ERS_OPT_CLEAN )
+		memset((unsigned char*)reuse + sizeof(struct ers_list), 0, instance->Cache->ObjectSize - sizeof(struct ers_list));
+
+	magazine = ers_magazine_get(instance->Cache);
+	reuse->Next = magazine->Head;
+	magazine->Head = reuse;
+	magazine->Count++;
+
+	if (magazine->Count >= instance->Cache->MagazineSize * 2)
+		ers_magazine_flush(instance->Cache, magazine, instance->Cache->MagazineSize);
+
+	instance->Count.fetch_sub(1, std::memory_order_relaxed);
+}
+
+static size_t ers_obj_entry_size(ERS *self)
+{
+	struct ers_instance_t *instance = (struct ers_instance_t *)self;
+
+	if (instance == nullptr) {
+		ShowError("ers_obj_entry_size: nullptr object, aborting entry freeing.\n");
+		return 0;
+	}
+
+	return instance->Cache->ObjectSize;
+}
+
+static void ers_obj_destroy(ERS *self)
+{
+	struct ers_instance_t *instance = (struct ers_instance_t *)self;
+
+	if (instance == nullptr) {
+		ShowError("ers_obj_destroy: nullptr object, aborting entry freeing.\n");
+		return;
+	}
+
+	std::lock_guard<std::recursive_mutex> lock(ListLock);
+
+	if (instance->Count > 0)
+		if (!(instance->Options & ERS_OPT_CLEAR))
+			ShowWarning("Memory leak detected at ERS '%s', %d objects not freed.\n", instance->Name, instance->Count.load());
+
+	if (--instance->Cache->ReferenceCount <= 0)
+		ers_free_cache(instance->Cache, true);
+
+	if (instance->Next)
+		instance->Next->Prev = instance->Prev;
+
+	if (instance->Prev)
+		instance->Prev->Next = instance->Next;
+	else
+		InstanceList = instance->Next;
+
+	if( instance->Options & ERS_OPT_FREE_NAME )
+		aFree(instance->Name);
+
+	delete instance;
+}
+
+void ers_cache_size(ERS *self, uint32 new_size) {
+	struct ers_instance_t *instance = (struct ers_instance_t *)self;
+
+	nullpo_retv(instance);
+
+	if( !(instance->Cache->Options&ERS_OPT_FLEX_CHUNK) ) {
+		ShowWarning("ers_cache_size: '%s' has adjusted its chunk size to '%d', however ERS_OPT_FLEX_CHUNK is missing!\n",instance->Name,new_size);
+	}
+
+	std::lock_guard<std::mutex> lock(instance->Cache->Lock);
+
+	instance->Cache->ChunkSize = new_size;
+}
+
+
+ERS *ers_new(uint32 size, const char *name, enum ERSOptions options)
+{
+	struct ers_instance_t *instance = new ers_instance_t{};
+
+	size += sizeof(struct ers_list);
+
+#if ERS_ALIGNED > 1 // If it's aligned to 1-byte boundaries, no need to bother.
+	if (size % ERS_ALIGNED)
+		size += ERS_ALIGNED - size % ERS_ALIGNED;
+#endif
+
+	instance->VTable.alloc = ers_obj_alloc_entry;
+	instance->VTable.free = ers_obj_free_entry;
+	instance->VTable.entry_size = ers_obj_entry_size;
+	instance->VTable.destroy = ers_obj_destroy;
+	instance->VTable.chunk_size = ers_cache_size;
+
+	instance->Name = ( options & ERS_OPT_FREE_NAME ) ? (char *)aStrdup(name) : (char *)name;
+	instance->Options = options;
+	instance->RateTick = gettick();
+
+	std::lock_guard<std::recursive_mutex> lock(ListLock);
+
+	instance->Cache = ers_find_cache(size,instance->Options);
+
+	instance->Cache->ReferenceCount++;
+
+	if (InstanceList == nullptr) {
+		InstanceList = instance;
+	} else {
+		instance->Next = InstanceList;
+		instance->Next->Prev = instance;
+		InstanceList = instance;
+		InstanceList->Prev = nullptr;
+	}
+
+	return &instance->VTable;
+}
+
+void ers_report(void) {
+	std::lock_guard<std::recursive_mutex> list_lock(ListLock);
+	ers_cache_t *cache;
+	struct ers_instance_t *instance;
+	uint32 cache_c = 0, blocks_u = 0, blocks_a = 0;
+	size_t memory_b = 0, memory_t = 0;
+
+	for (cache = CacheList; cache; cache = cache->Next) {
+		std::lock_guard<std::mutex> lock(cache->Lock);
+		uint32 used = 0;
+
+		for (instance = InstanceList; instance; instance = instance->Next)
+			if (instance->Cache == cache)
+				used += instance->Count.load(std::memory_order_relaxed);
+
+		cache_c++;
+		ShowMessage(CL_BOLD"[ERS Cache of size '" CL_NORMAL "" CL_WHITE "%u" CL_NORMAL "" CL_BOLD "' report]\n" CL_NORMAL, cache->ObjectSize);
+		ShowMessage("\tinstances          : %u\n", cache->ReferenceCount);
+		ShowMessage("\tblocks in use      : %u/%u\n", used, cache->Capacity);
+		ShowMessage("\tblocks unused      : %u\n", cache->Capacity - used);
+		ShowMessage("\tmemory in use      : %.2f MB\n", (double)used * cache->ObjectSize / 1024 / 1024);
+		ShowMessage("\tmemory allocated   : %.2f MB in %u slabs\n", (double)cache->Memory / 1024 / 1024, cache->Used);
+		blocks_u += used;
+		blocks_a += cache->Capacity;
+		memory_b += static_cast<size_t>( used ) * cache->ObjectSize;
+		memory_t += cache->Memory;
+	}
+	ShowInfo("ers_report: '" CL_WHITE "%u" CL_NORMAL "' caches in use\n",cache_c);
+	ShowInfo("ers_report: '" CL_WHITE "%u" CL_NORMAL "' blocks in use, consuming '" CL_WHITE "%.2f MB" CL_NORMAL "'\n",blocks_u,(double)memory_b/1024/1024);
+	ShowInfo("ers_report: '" CL_WHITE "%u" CL_NORMAL "' blocks total, consuming '" CL_WHITE "%.2f MB" CL_NORMAL "' \n",blocks_a,(double)memory_t/1024/1024);
+}
+
+void ers_stats(std::vector<s_ers_stats>& stats) {
+	std::lock_guard<std::recursive_mutex> lock(ListLock);
+	t_tick tick = gettick();
+
+	stats.clear();
+
+	for (struct ers_instance_t *instance = InstanceList; instance; instance = instance->Next) {
+		s_ers_stats entry = {};
+		uint64 allocs = instance->Allocs.load(std::memory_order_relaxed);
+		t_tick elapsed = DIFF_TICK(tick, instance->RateTick);
+
+		entry.name = instance->Name;
+		entry.entry_size = instance->Cache->ObjectSize - sizeof(struct ers_list);
+		entry.live = instance->Count.load(std::memory_order_relaxed);
+		entry.peak = instance->Peak.load(std::memory_order_relaxed);
+		entry.allocs = allocs;
+		entry.rate = elapsed > 0 ? (allocs - instance->RateAllocs) * 1000 / elapsed : 0;
+
+		{
+			std::lock_guard<std::mutex> cache_lock(instance->Cache->Lock);
+
+			entry.memory = instance->Cache->Memory;
+		}
+
+		instance->RateAllocs = allocs;
+		instance->RateTick = tick;
+
+		stats.push_back(entry);
+	}
+}
+
+void ers_reset_stats(void) {
+	std::lock_guard<std::recursive_mutex> lock(ListLock);
+
+	for (struct ers_instance_t *instance = InstanceList; instance; instance = instance->Next) {
+		instance->Peak.store(instance->Count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		instance->Allocs.store(0, std::memory_order_relaxed);
+		instance->RateAllocs = 0;
+		instance->RateTick = gettick();
+	}
+}
+
+/**
+ * Call on shutdown to clear remaining entries
+ **/
+void ers_final(void) {
+	std::lock_guard<std::recursive_mutex> lock(ListLock);
+	struct ers_instance_t *instance = InstanceList, *next;
+
+	while( instance ) {
+		next = instance->Next;
+		ers_obj_destroy((ERS*)instance);
+		instance = next;
+	}
+}
+
+/*****************************************************************************\
+ *  The ERS before version 1.1, entries are handed out backwards from the     *
+ *  end of plain chunks and reused through a single list. It is kept for     *
+ *  comparing the versions with ers_new_legacy, it is not thread-safe.       *
+\*****************************************************************************/
+namespace ers_legacy {
+
 struct ers_list
 {
 	struct ers_list *Next;
@@ -311,7 +919,7 @@ ERS *ers_new(uint32 size, const char *name, enum ERSOptions options)
 	instance->Name = ( options & ERS_OPT_FREE_NAME ) ? (char *)aStrdup(name) : (char *)name;
 	instance->Options = options;
 
-	instance->Cache = ers_find_cache(size,instance->Options);
+	instance->Cache = ers_legacy::ers_find_cache(size,instance->Options);
 
 	instance->Cache->ReferenceCount++;
 
@@ -329,39 +937,11 @@ ERS *ers_new(uint32 size, const char *name, enum ERSOptions options)
 	return &instance->VTable;
 }
 
-void ers_report(void) {
-	ers_cache_t *cache;
-	uint32 cache_c = 0, blocks_u = 0, blocks_a = 0, memory_b = 0, memory_t = 0;
-
-	for (cache = CacheList; cache; cache = cache->Next) {
-		cache_c++;
-		ShowMessage(CL_BOLD"[ERS Cache of size '" CL_NORMAL "" CL_WHITE "%u" CL_NORMAL "" CL_BOLD "' report]\n" CL_NORMAL, cache->ObjectSize);
-		ShowMessage("\tinstances          : %u\n", cache->ReferenceCount);
-		ShowMessage("\tblocks in use      : %u/%u\n", cache->UsedObjs, cache->UsedObjs+cache->Free);
-		ShowMessage("\tblocks unused      : %u\n", cache->Free);
-		ShowMessage("\tmemory in use      : %.2f MB\n", cache->UsedObjs == 0 ? 0. : (double)((cache->UsedObjs * cache->ObjectSize)/1024)/1024);
-		ShowMessage("\tmemory allocated   : %.2f MB\n", (cache->Free+cache->UsedObjs) == 0 ? 0. : (double)(((cache->UsedObjs+cache->Free) * cache->ObjectSize)/1024)/1024);
-		blocks_u += cache->UsedObjs;
-		blocks_a += cache->UsedObjs + cache->Free;
-		memory_b += cache->UsedObjs * cache->ObjectSize;
-		memory_t += (cache->UsedObjs+cache->Free) * cache->ObjectSize;
-	}
-	ShowInfo("ers_report: '" CL_WHITE "%u" CL_NORMAL "' caches in use\n",cache_c);
-	ShowInfo("ers_report: '" CL_WHITE "%u" CL_NORMAL "' blocks in use, consuming '" CL_WHITE "%.2f MB" CL_NORMAL "'\n",blocks_u,(double)((memory_b)/1024)/1024);
-	ShowInfo("ers_report: '" CL_WHITE "%u" CL_NORMAL "' blocks total, consuming '" CL_WHITE "%.2f MB" CL_NORMAL "' \n",blocks_a,(double)((memory_t)/1024)/1024);
-}
-
-/**
- * Call on shutdown to clear remaining entries
- **/
-void ers_final(void) {
-	struct ers_instance_t *instance = InstanceList, *next;
+} // namespace ers_legacy
 
-	while( instance ) {
-		next = instance->Next;
-		ers_obj_destroy((ERS*)instance);
-		instance = next;
-	}
+ERS *ers_new_legacy(uint32 size, const char *name, enum ERSOptions options)
+{
+	return ers_legacy::ers_new(size, name, options);
 }
 
 #endif
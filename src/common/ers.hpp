@@ -28,18 +28,26 @@
  *    destroyed so memory will usually only be recovered near the end.       *
  *  - Always wastes space for entries smaller than a pointer.                *
  *                                                                           *
- *  WARNING: The system is not thread-safe at the moment.                    *
+ *  Entries are carved from page aligned slabs in address order. Every       *
+ *  thread keeps a small magazine of free entries per cache, so entries can  *
+ *  be allocated and freed by any thread and the lock of a cache is only     *
+ *  taken to refill or flush a magazine.                                     *
  *                                                                           *
  *  HISTORY:                                                                 *
  *    0.1 - Initial version                                                  *
+ *    1.0 - ERS Rework                                                       *
+ *    1.1 - Slabs, thread-local magazines and statistics, the 1.0 manager    *
+ *          stays available through ers_new_legacy for comparisons           *
  *                                                                           *
- * @version 0.1 - Initial version                                            *
+ * @version 1.1 - Slabs, thread-local magazines and statistics               *
  * @author Flavio @ Amazon Project                                           *
  * @encoding US-ASCII                                                        *
 \*****************************************************************************/
 #ifndef ERS_HPP
 #define ERS_HPP
 
+#include <vector>
+
 #include "cbasetypes.hpp"
 
 /*****************************************************************************\
@@ -48,6 +56,7 @@
  *  ERS_ALIGNED           - Alignment of the entries in the blocks.          *
  *  ERS                   - Entry manager.                                   *
  *  ers_new               - Allocate an instance of an entry manager.        *
+ *  ers_new_legacy        - Allocate an instance of the 1.0 entry manager.   *
  *  ers_report            - Print a report about the current state.          *
  *  ers_final             - Clears the remainder of the managers.           *
 \*****************************************************************************/
@@ -59,6 +68,13 @@
  */
 //#define DISABLE_ERS
 
+/**
+ * Back the slabs of entries with transparent huge pages (Linux only).
+ * Slabs are then aligned to and allocated in multiples of 2 MB, which wastes
+ * memory for managers with few entries but saves TLB misses on big servers.
+ */
+//#define ERS_HUGE_PAGES
+
 /**
  * Entries are aligned to ERS_ALIGNED bytes in the blocks of entries.
  * By default it aligns to one byte, using the "natural order" of the entries.
@@ -84,6 +100,17 @@ enum ERSOptions {
 	ERS_DBN_OPTIONS     = ERS_OPT_CLEAN|ERS_OPT_WAIT|ERS_OPT_FREE_NAME,
 };
 
+/// Statistics of a single instance of the manager
+struct s_ers_stats {
+	const char* name;
+	size_t entry_size;
+	uint32 live;		///< Entries currently allocated
+	uint32 peak;		///< Maximum of live entries since the last reset
+	uint64 allocs;		///< Entries allocated since the last reset
+	uint64 rate;		///< Entries allocated per second since the previous call of ers_stats
+	size_t memory;		///< Bytes of the slabs of the cache of the instance
+};
+
 /**
  * Public interface of the entry manager.
  * @param alloc Allocate an entry from this manager
@@ -139,7 +166,10 @@ typedef struct eri {
 #	define ers_chunk_size(obj,size)
 // Disable the public functions
 #	define ers_new(size,name,options) nullptr
+#	define ers_new_legacy(size,name,options) nullptr
 #	define ers_report()
+#	define ers_stats(stats)
+#	define ers_reset_stats()
 #	define ers_final()
 #else /* not DISABLE_ERS */
 // These defines should be used to allow the code to keep working whenever
@@ -162,6 +192,14 @@ typedef struct eri {
  */
 ERS *ers_new(uint32 size, const char *name, enum ERSOptions options);
 
+/**
+ * Get a new instance of the manager before version 1.1, for comparisons with ers_new.
+ * Its caches are separate from the caches of ers_new and it must only be used by one thread.
+ * @param The requested size of the entry in bytes
+ * @return Interface of the object
+ */
+ERS *ers_new_legacy(uint32 size, const char *name, enum ERSOptions options);
+
 /**
  * Print a report about the current state of the Entry Reusage System.
  * Shows information about the global system and each entry manager.
@@ -171,6 +209,17 @@ ERS *ers_new(uint32 size, const char *name, enum ERSOptions options);
  */
 void ers_report(void);
 
+/**
+ * Collect the statistics of every instance of the manager.
+ * @param stats Receives one entry per instance
+ */
+void ers_stats(std::vector<s_ers_stats>& stats);
+
+/**
+ * Reset the peak and the allocation counters of every instance.
+ */
+void ers_reset_stats(void);
+
 /**
  * Clears the remainder of the managers
  **/
@@ -3,12 +3,20 @@
 
 #include "malloc.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <vector>
 
 #include "core.hpp"
 #include "showmsg.hpp"
+#include "utils.hpp"
 
 #if defined(__64BIT__)
 	#define FREED_POINTER 0xdeadbeafL
@@ -72,6 +80,49 @@
 
 #endif
 
+/// Allocation calls of the thread that malloc_trace_start records
+struct s_malloc_trace {
+	std::vector<s_malloc_trace_op>* ops;
+	std::unordered_map<void*, uint32> indexes;	///< Trace index of every live allocation
+	uint32 count;								///< Allocations recorded so far
+};
+
+static thread_local struct s_malloc_trace* malloc_trace = nullptr;
+
+/// Records an allocation call of the current thread.
+/// Memory allocated before the recording started is not part of the trace, freeing it is not recorded.
+static void malloc_trace_record( e_malloc_trace type, void* old_ptr, void* new_ptr, size_t size )
+{
+	uint32 index = 0;
+
+	if( old_ptr != nullptr ) {
+		auto it = malloc_trace->indexes.find( old_ptr );
+
+		if( it != malloc_trace->indexes.end() ) {
+			index = it->second;
+			malloc_trace->indexes.erase( it );
+		} else if( type == MALLOC_TRACE_FREE ) {
+			return;
+		} else {
+			type = MALLOC_TRACE_ALLOC;
+		}
+	} else if( type == MALLOC_TRACE_FREE ) {
+		return;
+	} else {
+		type = MALLOC_TRACE_ALLOC;
+	}
+
+	if( type == MALLOC_TRACE_ALLOC ) {
+		index = malloc_trace->count++;
+	}
+
+	if( new_ptr != nullptr ) {
+		malloc_trace->indexes[new_ptr] = index;
+	}
+
+	malloc_trace->ops->push_back( { type, index, (uint32)cap_value( size, 0, UINT32_MAX ) } );
+}
+
 void* aMalloc_(size_t size, const char *file, int32 line, const char *func)
 {
 	void *ret = MALLOC(size, file, line, func);
@@ -80,6 +131,8 @@ void* aMalloc_(size_t size, const char *file, int32 line, const char *func)
 		ShowFatalError("%s:%d: in func %s: aMalloc error out of memory!\n",file,line,func);
 		exit(EXIT_FAILURE);
 	}
+	if( malloc_trace != nullptr )
+		malloc_trace_record( MALLOC_TRACE_ALLOC, nullptr, ret, size );
 
 	return ret;
 }
@@ -91,6 +144,8 @@ void* aCalloc_(size_t num, size_t size, const char *file, int32 line, const char
 		ShowFatalError("%s:%d: in func %s: aCalloc error out of memory!\n", file, line, func);
 		exit(EXIT_FAILURE);
 	}
+	if( malloc_trace != nullptr )
+		malloc_trace_record( MALLOC_TRACE_ALLOC, nullptr, ret, num * size );
 	return ret;
 }
 void* aRealloc_(void *p, size_t size, const char *file, int32 line, const char *func)
@@ -101,6 +156,8 @@ void* aRealloc_(void *p, size_t size, const char *file, int32 line, const char *
 		ShowFatalError("%s:%d: in func %s: aRealloc error out of memory!\n",file,line,func);
 		exit(EXIT_FAILURE);
 	}
+	if( malloc_trace != nullptr )
+		malloc_trace_record( MALLOC_TRACE_REALLOC, p, ret, size );
 	return ret;
 }
 char* aStrdup_(const char *p, const char *file, int32 line, const char *func)
@@ -111,11 +168,15 @@ char* aStrdup_(const char *p, const char *file, int32 line, const char *func)
 		ShowFatalError("%s:%d: in func %s: aStrdup error out of memory!\n", file, line, func);
 		exit(EXIT_FAILURE);
 	}
+	if( malloc_trace != nullptr )
+		malloc_trace_record( MALLOC_TRACE_ALLOC, nullptr, ret, strlen( ret ) + 1 );
 	return ret;
 }
 void aFree_(void *p, const char *file, int32 line, const char *func)
 {
 	// ShowMessage("%s:%d: in func %s: aFree %p\n",file,line,func,p);
+	if( malloc_trace != nullptr )
+		malloc_trace_record( MALLOC_TRACE_FREE, p, nullptr, 0 );
 	if (p)
 		FREE(p, file, line, func);
 }
@@ -127,6 +188,39 @@ void aFree_(void *p, const char *file, int32 line, const char *func)
 #define DEBUG_MEMMGR
 #endif
 
+#ifdef LOG_MEMMGR
+static char memmer_logfile[128];
+static FILE *log_fp;
+
+static void memmgr_log (char *buf)
+{
+	if( !log_fp )
+	{
+		const char* version;
+		time_t raw;
+		struct tm* t;
+
+		log_fp = fopen(memmer_logfile,"at");
+		if (!log_fp) log_fp = stdout;
+
+		time(&raw);
+		t = localtime(&raw);
+
+		if( ( version = get_git_hash() ) && version[0] != UNKNOWN_VERSION ){
+			fprintf(log_fp, "\nMemory manager: Memory leaks found at %d/%02d/%02d %02dh%02dm%02ds (Git Hash %s).\n", (t->tm_year+1900), (t->tm_mon+1), t->tm_mday, t->tm_hour, t->tm_min, t->tm_sec, version );
+		}else if( ( version = get_svn_revision() ) && version[0] != UNKNOWN_VERSION ){
+			fprintf(log_fp, "\nMemory manager: Memory leaks found at %d/%02d/%02d %02dh%02dm%02ds (SVN Revision %s).\n", (t->tm_year + 1900), (t->tm_mon + 1), t->tm_mday, t->tm_hour, t->tm_min, t->tm_sec, version );
+		}else{
+			fprintf(log_fp, "\nMemory manager: Memory leaks found at %d/%02d/%02d %02dh%02dm%02ds (Unknown version).\n", (t->tm_year + 1900), (t->tm_mon + 1), t->tm_mday, t->tm_hour, t->tm_min, t->tm_sec );
+		}
+	}
+	fprintf(log_fp, "%s", buf);
+	return;
+}
+#endif /* LOG_MEMMGR */
+
+namespace memmgr_legacy {
+
 /* USE_MEMMGR */
 
 /*
@@ -522,36 +616,6 @@ size_t memmgr_usage (void)
 	return memmgr_usage_bytes / 1024;
 }
 
-#ifdef LOG_MEMMGR
-static char memmer_logfile[128];
-static FILE *log_fp;
-
-static void memmgr_log (char *buf)
-{
-	if( !log_fp )
-	{
-		const char* version;
-		time_t raw;
-		struct tm* t;
-
-		log_fp = fopen(memmer_logfile,"at");
-		if (!log_fp) log_fp = stdout;
-
-		time(&raw);
-		t = localtime(&raw);
-
-		if( ( version = get_git_hash() ) && version[0] != UNKNOWN_VERSION ){
-			fprintf(log_fp, "\nMemory manager: Memory leaks found at %d/%02d/%02d %02dh%02dm%02ds (Git Hash %s).\n", (t->tm_year+1900), (t->tm_mon+1), t->tm_mday, t->tm_hour, t->tm_min, t->tm_sec, version );
-		}else if( ( version = get_svn_revision() ) && version[0] != UNKNOWN_VERSION ){
-			fprintf(log_fp, "\nMemory manager: Memory leaks found at %d/%02d/%02d %02dh%02dm%02ds (SVN Revision %s).\n", (t->tm_year + 1900), (t->tm_mon + 1), t->tm_mday, t->tm_hour, t->tm_min, t->tm_sec, version );
-		}else{
-			fprintf(log_fp, "\nMemory manager: Memory leaks found at %d/%02d/%02d %02dh%02dm%02ds (Unknown version).\n", (t->tm_year + 1900), (t->tm_mon + 1), t->tm_mday, t->tm_hour, t->tm_min, t->tm_sec );
-		}
-	}
-	fprintf(log_fp, "%s", buf);
-	return;
-}
-#endif /* LOG_MEMMGR */
 
 /// Returns true if the memory location is active.
 /// Active means it is allocated and points to a usable part.
@@ -599,7 +663,7 @@ bool memmgr_verify(void* ptr)
 	return false;
 }
 
-static void memmgr_final (void)
+void memmgr_final (void)
 {
 	struct block *block = block_first;
 	struct unit_head_large *large = unit_head_large_first;
@@ -653,7 +717,7 @@ static void memmgr_final (void)
 #endif /* LOG_MEMMGR */
 }
 
-static void memmgr_init (void)
+void memmgr_init (void)
 {
 #ifdef LOG_MEMMGR
 	sprintf(memmer_logfile, "log/%s.leaks", SERVER_NAME);
@@ -661,6 +725,742 @@ static void memmgr_init (void)
 	memset(hash_unfill, 0, sizeof(hash_unfill));
 #endif /* LOG_MEMMGR */
 }
+
+} /* namespace memmgr_legacy */
+
+namespace memmgr_thread {
+
+/*
+ * Thread caching memory manager
+ *     Small allocations are served from spans that hold units of a single size class.
+ *     Every thread allocates from its own heap of spans, so allocating and freeing memory
+ *     of the same thread does not take any lock.
+ *
+ *     A unit freed by another thread is pushed onto a lock-free list of the heap that owns
+ *     its span. The owner takes the units back once it runs out of units of a size class.
+ *     Heaps of finished threads are handed to the next thread that starts, so memory freed
+ *     after its thread ended is not lost.
+ *
+ *     Allocations larger than the biggest size class are passed to malloc.
+ */
+
+/* The size of a span */
+#define SPAN_SIZE			( 128 * 1024 )
+
+/* The number of spans to be allocated at a time */
+#define SPAN_ALLOC			16
+
+/* Size classes: 16 byte steps up to 256 bytes, then 4 classes per power of two up to 16KB */
+#define CLASS_SMALL_MAX		256
+#define CLASS_SMALL_COUNT	( CLASS_SMALL_MAX / 16 )
+#define CLASS_MAX_SIZE		( 16 * 1024 )
+#define CLASS_COUNT			( CLASS_SMALL_COUNT + 6 * 4 )
+#define CLASS_LARGE			0xFFFF
+
+struct unit_head {
+	struct span*      span;			/* The span of the unit */
+	struct unit_head* next;			/* The next freed unit */
+	const  char*      file;
+	uint16 line;
+	uint16 size_class;				/* CLASS_LARGE if directly secured by malloc () */
+	uint32 size;					/* The requested size, 0 if the unit is free */
+};
+
+struct span {
+	struct thread_heap*      heap;			/* The owner, nullptr if the span is unused */
+	struct span*      prev;			/* The previous span of the heap with free units */
+	struct span*      next;			/* The next span of the heap with free units */
+	struct unit_head* unfill;		/* Freed units */
+	uint16 size_class;
+	uint16 unit_size;				/* The size of the unit, including the head */
+	uint16 unit_count;				/* The number of units */
+	uint16 unit_used;				/* The number of used units */
+	uint16 unit_maxused;			/* The maximum value of units used */
+	bool   linked;					/* Whether the span is in the list of spans with free units */
+	alignas(16) char data[ SPAN_SIZE - 64 ];
+};
+
+struct thread_heap {
+	struct span* partial[ CLASS_COUNT ];	/* Spans with free units, per size class */
+	std::atomic<struct unit_head*> remote;	/* Units freed by other threads */
+	std::atomic<int64> usage;				/* Bytes allocated minus bytes freed by the thread of the heap */
+	struct thread_heap* heap_next;					/* The next heap */
+	struct thread_heap* free_next;					/* The next heap of a finished thread */
+};
+
+/* Data for areas that do not use the memory be turned */
+struct unit_head_large {
+	size_t                  size;
+	struct unit_head_large* prev;
+	struct unit_head_large* next;
+	struct unit_head        unit_head;
+};
+
+/* Guards the spans, the heaps and the large units */
+static std::mutex memmgr_mutex;
+static std::vector<struct span*> span_chunks;
+static struct span* span_unused = nullptr;
+static struct thread_heap* heap_first = nullptr;
+static struct thread_heap* heap_unused = nullptr;
+static struct unit_head_large *unit_head_large_first = nullptr;
+
+/* Returns the heap to the unused heaps when its thread ends */
+struct heap_owner {
+	struct thread_heap* heap = nullptr;
+	~heap_owner();
+};
+
+static thread_local struct thread_heap* memmgr_heap = nullptr;
+static thread_local bool memmgr_heap_released = false;
+static thread_local struct heap_owner memmgr_heap_owner;
+
+#define span2unit(p, n) ((struct unit_head*)(&(p)->data[ (p)->unit_size * (n) ]))
+#define memmgr_assert(v) do { if(!(v)) { ShowError("Memory manager: assertion '" #v "' failed!\n"); } } while(0)
+
+static_assert( sizeof( struct unit_head ) % 16 == 0, "unit_head must keep the alignment of the data" );
+static_assert( sizeof( struct span ) <= SPAN_SIZE, "span does not fit into SPAN_SIZE" );
+static_assert( offsetof( struct unit_head_large, unit_head ) + sizeof( struct unit_head ) == sizeof( struct unit_head_large ), "the data must follow unit_head_large" );
+
+static uint16 size2class( size_t size )
+{
+	uint16 shift = 8;
+
+	if( size <= CLASS_SMALL_MAX ) {
+		return (uint16)( ( size + 15 ) / 16 - 1 );
+	}
+
+	// size is in ( 2^shift, 2^(shift+1) ]
+	while( ( (size_t)1 << ( shift + 1 ) ) < size ) {
+		shift++;
+	}
+
+	return (uint16)( CLASS_SMALL_COUNT + ( shift - 8 ) * 4 + ( size - 1 - ( (size_t)1 << shift ) ) / ( (size_t)1 << ( shift - 2 ) ) );
+}
+
+static size_t class2size( uint16 size_class )
+{
+	if( size_class < CLASS_SMALL_COUNT ) {
+		return ( size_class + 1 ) * 16;
+	} else {
+		size_t shift = ( size_class - CLASS_SMALL_COUNT ) / 4 + 8;
+
+		return ( (size_t)1 << shift ) + ( ( size_class - CLASS_SMALL_COUNT ) % 4 + 1 ) * ( (size_t)1 << ( shift - 2 ) );
+	}
+}
+
+static inline void memmgr_set_guard( char* data, size_t size )
+{
+	long guard = FREED_POINTER;
+
+	memcpy( data + size, &guard, sizeof( guard ) );
+}
+
+static inline bool memmgr_check_guard( char* data, size_t size )
+{
+	long guard;
+
+	memcpy( &guard, data + size, sizeof( guard ) );
+
+	return guard == FREED_POINTER;
+}
+
+/* Only the thread of the heap writes its usage, so no atomic read-modify-write is needed */
+static inline void heap_usage_add( struct thread_heap* heap, int64 bytes )
+{
+	heap->usage.store( heap->usage.load( std::memory_order_relaxed ) + bytes, std::memory_order_relaxed );
+}
+
+/* The heap of the current thread */
+static struct thread_heap* heap_get( void )
+{
+	struct thread_heap* heap = memmgr_heap;
+
+	if( heap != nullptr ) {
+		return heap;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( memmgr_mutex );
+
+		if( heap_unused != nullptr ) {
+			heap = heap_unused;
+			heap_unused = heap->free_next;
+		} else {
+			heap = (struct thread_heap*)MALLOC( sizeof( struct thread_heap ), __FILE__, __LINE__, __func__ );
+			if( heap == nullptr ) {
+				ShowFatalError( "Memory manager::heap_get failed.\n" );
+				exit( EXIT_FAILURE );
+			}
+			new( heap ) thread_heap{};
+			heap->heap_next = heap_first;
+			heap_first = heap;
+		}
+		heap->free_next = nullptr;
+	}
+
+	memmgr_heap = heap;
+
+	// A thread that allocates while its thread locals are destroyed keeps the heap
+	if( !memmgr_heap_released ) {
+		memmgr_heap_owner.heap = heap;
+	}
+
+	return heap;
+}
+
+heap_owner::~heap_owner()
+{
+	if( this->heap == nullptr ) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock( memmgr_mutex );
+
+	this->heap->free_next = heap_unused;
+	heap_unused = this->heap;
+	this->heap = nullptr;
+	memmgr_heap = nullptr;
+	memmgr_heap_released = true;
+}
+
+static void span_link( struct thread_heap* heap, struct span* span )
+{
+	span->prev = nullptr;
+	span->next = heap->partial[ span->size_class ];
+	if( span->next ) {
+		span->next->prev = span;
+	}
+	heap->partial[ span->size_class ] = span;
+	span->linked = true;
+}
+
+static void span_unlink( struct thread_heap* heap, struct span* span )
+{
+	if( span->prev ) {
+		span->prev->next = span->next;
+	} else {
+		heap->partial[ span->size_class ] = span->next;
+	}
+	if( span->next ) {
+		span->next->prev = span->prev;
+	}
+	span->prev = nullptr;
+	span->next = nullptr;
+	span->linked = false;
+}
+
+/* Allocating spans */
+static struct span* span_malloc( struct thread_heap* heap, uint16 size_class )
+{
+	struct span* p;
+
+	{
+		std::lock_guard<std::mutex> lock( memmgr_mutex );
+
+		if( span_unused == nullptr ) {
+			int32 i;
+			/* Newly allocated space for the spans */
+			p = (struct span*)MALLOC( sizeof( struct span ) * SPAN_ALLOC, __FILE__, __LINE__, __func__ );
+			if( p == nullptr ) {
+				ShowFatalError( "Memory manager::span_malloc failed.\n" );
+				exit( EXIT_FAILURE );
+			}
+			span_chunks.push_back( p );
+			for( i = 0; i < SPAN_ALLOC; i++ ) {
+				p[i].heap = nullptr;
+				p[i].next = span_unused;
+				span_unused = &p[i];
+			}
+		}
+
+		p = span_unused;
+		span_unused = p->next;
+	}
+
+	p->heap         = heap;
+	p->unfill       = nullptr;
+	p->size_class   = size_class;
+	p->unit_size    = (uint16)( class2size( size_class ) + sizeof( struct unit_head ) );
+	p->unit_count   = (uint16)( sizeof( p->data ) / p->unit_size );
+	p->unit_used    = 0;
+	p->unit_maxused = 0;
+#ifdef DEBUG_MEMMGR
+	memset( p->data, 0xfd, sizeof( p->data ) );
+#endif
+	span_link( heap, p );
+	return p;
+}
+
+static void span_free( struct span* p )
+{
+	std::lock_guard<std::mutex> lock( memmgr_mutex );
+
+	p->heap = nullptr;
+	p->next = span_unused;
+	span_unused = p;
+}
+
+/* Put a freed unit back into its span, must be called by the thread of the heap */
+static void unit_release( struct thread_heap* heap, struct unit_head* head )
+{
+	struct span* span = head->span;
+
+	head->next = span->unfill;
+	span->unfill = head;
+	memmgr_assert( span->unit_used > 0 );
+	span->unit_used--;
+
+	if( !span->linked ) {
+		span_link( heap, span );
+	} else if( span->unit_used == 0 && ( span->prev != nullptr || span->next != nullptr ) ) {
+		// Keep a single empty span per size class, return the others
+		span_unlink( heap, span );
+		span_free( span );
+	}
+}
+
+/* Take back the units that other threads freed */
+static void heap_collect( struct thread_heap* heap )
+{
+	struct unit_head* head = heap->remote.exchange( nullptr, std::memory_order_acquire );
+
+	while( head ) {
+		struct unit_head* next = head->next;
+
+		unit_release( heap, head );
+		head = next;
+	}
+}
+
+void* _mmalloc(size_t size, const char *file, int32 line, const char *func )
+{
+	struct thread_heap* heap;
+	struct span* span;
+	struct unit_head* head;
+	uint16 size_class;
+
+	if( static_cast<long>( size ) < 0 || size == 0 ){
+		ShowError( "_mmalloc: Invalid allocation size %" PRIuPTR " bytes at %s:%d\n", size, file, line );
+		return nullptr;
+	}
+
+	heap = heap_get();
+	heap_usage_add( heap, size );
+
+	/* To ensure the area that exceeds the biggest size class, using malloc () to */
+	if( size + sizeof( long ) > CLASS_MAX_SIZE ) {
+		struct unit_head_large* p = (struct unit_head_large*)MALLOC( sizeof( struct unit_head_large ) + size + sizeof( long ), file, line, func );
+		if( p != nullptr ) {
+			p->size                 = size;
+			p->unit_head.span       = nullptr;
+			p->unit_head.next       = nullptr;
+			p->unit_head.size_class = CLASS_LARGE;
+			p->unit_head.size       = (uint32)cap_value( size, 1, UINT32_MAX );
+			p->unit_head.file       = file;
+			p->unit_head.line       = line;
+			p->prev = nullptr;
+			memmgr_set_guard( (char*)p + sizeof( struct unit_head_large ), size );
+			{
+				std::lock_guard<std::mutex> lock( memmgr_mutex );
+
+				if( unit_head_large_first != nullptr ) {
+					unit_head_large_first->prev = p;
+				}
+				p->next = unit_head_large_first;
+				unit_head_large_first = p;
+			}
+			return (char*)p + sizeof( struct unit_head_large );
+		} else {
+			ShowFatalError("Memory manager::memmgr_alloc failed (allocating %" PRIuPTR  "+%" PRIuPTR " bytes at %s:%d).\n", sizeof(struct unit_head_large), size, file, line);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	size_class = size2class( size + sizeof( long ) );
+	span = heap->partial[ size_class ];
+
+	if( span == nullptr ) {
+		heap_collect( heap );
+		span = heap->partial[ size_class ];
+	}
+	if( span == nullptr ) {
+		span = span_malloc( heap, size_class );
+	}
+
+	if( span->unfill ) {
+		head = span->unfill;
+		span->unfill = head->next;
+	} else {
+		memmgr_assert( span->unit_maxused < span->unit_count );
+		head = span2unit( span, span->unit_maxused );
+		head->span = span;
+		head->size_class = size_class;
+		span->unit_maxused++;
+	}
+	span->unit_used++;
+
+	if( span->unfill == nullptr && span->unit_maxused >= span->unit_count ) {
+		// Since I ran out of the unit, removed from the list of spans with free units
+		span_unlink( heap, span );
+	}
+
+#ifdef DEBUG_MEMMGR
+	{
+		size_t i, sz = class2size( size_class );
+		for( i=0; i<sz; i++ )
+		{
+			if( ((unsigned char*)( head + 1 ))[i] != 0xfd )
+			{
+				if( head->file != nullptr )
+				{
+					ShowError("Memory manager: freed-data is changed. (freed in %s line %d)\n", head->file,head->line);
+				}
+				else
+				{
+					ShowError("Memory manager: not-allocated-data is changed.\n");
+				}
+				break;
+			}
+		}
+		memset( head + 1, 0xcd, sz );
+	}
+#endif
+
+	head->next = nullptr;
+	head->file = file;
+	head->line = line;
+	head->size = (uint32)size;
+	memmgr_set_guard( (char*)( head + 1 ), size );
+	return head + 1;
+}
+
+void* _mcalloc(size_t num, size_t size, const char *file, int32 line, const char *func )
+{
+	void *p = _mmalloc(num * size,file,line,func);
+	memset(p,0,num * size);
+	return p;
+}
+
+void* _mrealloc(void *memblock, size_t size, const char *file, int32 line, const char *func )
+{
+	struct unit_head* head;
+	size_t old_size;
+
+	if(memblock == nullptr) {
+		return _mmalloc(size,file,line,func);
+	}
+
+	head = (struct unit_head*)memblock - 1;
+	if( head->size_class == CLASS_LARGE ) {
+		old_size = ( (struct unit_head_large*)( (char*)head - offsetof( struct unit_head_large, unit_head ) ) )->size;
+	} else {
+		old_size = head->size;
+	}
+	if(old_size > size) {
+		// Size reduction - return> as it is (negligence)
+		return memblock;
+	}  else {
+		// Size Large
+		void *p = _mmalloc(size,file,line,func);
+		if(p != nullptr) {
+			memcpy(p,memblock,old_size);
+		}
+		_mfree(memblock,file,line,func);
+		return p;
+	}
+}
+
+char* _mstrdup(const char *p, const char *file, int32 line, const char *func )
+{
+	if(p == nullptr) {
+		return nullptr;
+	} else {
+		size_t len = strlen(p);
+		char *string  = (char *)_mmalloc(len + 1,file,line,func);
+		memcpy(string,p,len+1);
+		return string;
+	}
+}
+
+void _mfree(void *ptr, const char *file, int32 line, const char *func )
+{
+	struct unit_head *head;
+	struct span *span;
+	struct thread_heap *heap;
+
+	if (ptr == nullptr)
+		return;
+
+	head = (struct unit_head*)ptr - 1;
+	if( head->size_class == CLASS_LARGE ) {
+		/* area that is directly secured by malloc () */
+		struct unit_head_large *head_large = (struct unit_head_large*)( (char*)head - offsetof( struct unit_head_large, unit_head ) );
+		if( !memmgr_check_guard( (char*)ptr, head_large->size ) ) {
+			ShowError("Memory manager: args of aFree 0x%p is overflowed pointer %s line %d\n", ptr, file, line);
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock( memmgr_mutex );
+
+			if(head_large->prev) {
+				head_large->prev->next = head_large->next;
+			} else {
+				unit_head_large_first  = head_large->next;
+			}
+			if(head_large->next) {
+				head_large->next->prev = head_large->prev;
+			}
+		}
+		head->size_class = 0;
+		head->size = 0;
+		heap_usage_add( heap_get(), -(int64)head_large->size );
+#ifdef DEBUG_MEMMGR
+		// set freed memory to 0xfd
+		memset(ptr, 0xfd, head_large->size);
+#endif
+		FREE(head_large,file,line,func);
+		return;
+	}
+
+	/* Release unit */
+	span = head->span;
+	if( head->size_class >= CLASS_COUNT || span == nullptr || (char*)head < span->data || (char*)head >= span->data + sizeof( span->data ) ) {
+		ShowError("Memory manager: args of aFree 0x%p is invalid pointer %s line %d\n", ptr, file, line);
+		return;
+	} else if( head->size == 0 ) {
+		ShowError("Memory manager: args of aFree 0x%p is freed pointer %s:%d@%s\n", ptr, file, line, func);
+		return;
+	} else if( !memmgr_check_guard( (char*)ptr, head->size ) ) {
+		ShowError("Memory manager: args of aFree 0x%p is overflowed pointer %s line %d\n", ptr, file, line);
+		return;
+	}
+
+	heap = heap_get();
+	heap_usage_add( heap, -(int64)head->size );
+	head->size = 0;
+#ifdef DEBUG_MEMMGR
+	memset( ptr, 0xfd, span->unit_size - sizeof( struct unit_head ) );
+	head->file = file;
+	head->line = line;
+#endif
+
+	if( span->heap == heap ) {
+		unit_release( heap, head );
+	} else {
+		// The span belongs to another thread, hand the unit over to it
+		struct thread_heap* owner = span->heap;
+
+		head->next = owner->remote.load( std::memory_order_relaxed );
+		while( !owner->remote.compare_exchange_weak( head->next, head, std::memory_order_release, std::memory_order_relaxed ) );
+	}
+}
+
+size_t memmgr_usage (void)
+{
+	std::lock_guard<std::mutex> lock( memmgr_mutex );
+	int64 bytes = 0;
+
+	for( struct thread_heap* heap = heap_first; heap != nullptr; heap = heap->heap_next ) {
+		bytes += heap->usage.load( std::memory_order_relaxed );
+	}
+
+	return (size_t)( std::max<int64>( bytes, 0 ) / 1024 );
+}
+
+/// Returns true if the memory location is active.
+/// Active means it is allocated and points to a usable part.
+///
+/// @param ptr Pointer to the memory
+/// @return true if the memory is active
+bool memmgr_verify(void* ptr)
+{
+	std::lock_guard<std::mutex> lock( memmgr_mutex );
+
+	if( ptr == nullptr )
+		return false;// never valid
+
+	// search spans
+	for( struct span* chunk : span_chunks )
+	{
+		if( (char*)ptr >= (char*)chunk && (char*)ptr < (char*)( chunk + SPAN_ALLOC ) )
+		{// found memory chunk
+			struct span* span = chunk + ( (char*)ptr - (char*)chunk ) / sizeof( struct span );
+
+			if( span->heap != nullptr && (char*)ptr >= span->data )
+			{// span is being used and ptr points to a sub-unit
+				size_t i = (size_t)((char*)ptr - span->data)/span->unit_size;
+				struct unit_head* head = span2unit(span, i);
+				if( i < span->unit_maxused && head->size != 0 )
+				{// memory unit is allocated, check if ptr points to the usable part
+					return ( (char*)ptr >= (char*)( head + 1 ) && (char*)ptr < (char*)( head + 1 ) + head->size );
+				}
+			}
+			return false;
+		}
+	}
+
+	// search large blocks
+	for( struct unit_head_large* large = unit_head_large_first; large != nullptr; large = large->next )
+	{
+		if( (char*)ptr >= (char*)large && (char*)ptr < (char*)( &large->unit_head + 1 ) + large->size )
+		{// found memory block, check if ptr points to the usable part
+			return (char*)ptr >= (char*)( &large->unit_head + 1 );
+		}
+	}
+	return false;
+}
+
+void memmgr_final (void)
+{
+	std::vector<void*> leaks;
+
+#ifdef LOG_MEMMGR
+	int32 count = 0;
+#endif /* LOG_MEMMGR */
+
+	{
+		std::lock_guard<std::mutex> lock( memmgr_mutex );
+
+		for( struct span* chunk : span_chunks ) {
+			for( struct span* span = chunk; span < chunk + SPAN_ALLOC; span++ ) {
+				if( span->heap == nullptr || span->unit_used == 0 ) {
+					continue;
+				}
+				for( int32 i = 0; i < span->unit_maxused; i++ ) {
+					struct unit_head *head = span2unit(span, i);
+					if( head->size != 0 ) {
+#ifdef LOG_MEMMGR
+						char buf[1024];
+						sprintf (buf,
+							"%04d : %s line %d size %lu address 0x%p\n", ++count,
+							head->file, head->line, (unsigned long)head->size, head + 1);
+						memmgr_log (buf);
+#endif /* LOG_MEMMGR */
+						leaks.push_back( head + 1 );
+					}
+				}
+			}
+		}
+
+		for( struct unit_head_large* large = unit_head_large_first; large != nullptr; large = large->next ) {
+#ifdef LOG_MEMMGR
+			char buf[1024];
+			sprintf (buf,
+				"%04d : %s line %d size %lu address 0x%p\n", ++count,
+				large->unit_head.file, large->unit_head.line, (unsigned long)large->size, &large->unit_head + 1);
+			memmgr_log (buf);
+#endif /* LOG_MEMMGR */
+			leaks.push_back( &large->unit_head + 1 );
+		}
+	}
+
+	// get unit pointer and free it [celest]
+	for( void* ptr : leaks ) {
+		_mfree( ptr, ALC_MARK );
+	}
+
+	// Give the spans and heaps back to the system, threads that allocate afterwards start over
+	{
+		std::lock_guard<std::mutex> lock( memmgr_mutex );
+
+		for( struct span* chunk : span_chunks ) {
+			FREE( chunk, __FILE__, __LINE__, __func__ );
+		}
+		span_chunks.clear();
+		span_unused = nullptr;
+
+		while( heap_first != nullptr ) {
+			struct thread_heap* heap = heap_first;
+
+			heap_first = heap->heap_next;
+			heap->~thread_heap();
+			FREE( heap, __FILE__, __LINE__, __func__ );
+		}
+		heap_unused = nullptr;
+	}
+
+	memmgr_heap = nullptr;
+	memmgr_heap_owner.heap = nullptr;
+
+#ifdef LOG_MEMMGR
+	if(count == 0) {
+		ShowInfo("Memory manager: No memory leaks found.\n");
+	} else {
+		ShowWarning("Memory manager: Memory leaks found and fixed.\n");
+		fclose(log_fp);
+	}
+#endif /* LOG_MEMMGR */
+}
+
+void memmgr_init (void)
+{
+#ifdef LOG_MEMMGR
+	sprintf(memmer_logfile, "log/%s.leaks", SERVER_NAME);
+	ShowStatus("Memory manager initialised: " CL_WHITE "%s" CL_RESET "\n", memmer_logfile);
+#endif /* LOG_MEMMGR */
+}
+
+} /* namespace memmgr_thread */
+
+/* LEGACY_MEMMGR selects the manager behind aMalloc, the other one is only used by malloc_backends */
+#ifdef LEGACY_MEMMGR
+namespace memmgr = memmgr_legacy;
+#else
+namespace memmgr = memmgr_thread;
+#endif
+
+void* _mmalloc(size_t size, const char *file, int32 line, const char *func )
+{
+	void* p = memmgr::_mmalloc( size, file, line, func );
+
+	if( malloc_trace != nullptr ) {
+		malloc_trace_record( MALLOC_TRACE_ALLOC, nullptr, p, size );
+	}
+
+	return p;
+}
+
+void* _mcalloc(size_t num, size_t size, const char *file, int32 line, const char *func )
+{
+	void* p = memmgr::_mcalloc( num, size, file, line, func );
+
+	if( malloc_trace != nullptr ) {
+		malloc_trace_record( MALLOC_TRACE_ALLOC, nullptr, p, num * size );
+	}
+
+	return p;
+}
+
+void* _mrealloc(void *memblock, size_t size, const char *file, int32 line, const char *func )
+{
+	void* p = memmgr::_mrealloc( memblock, size, file, line, func );
+
+	if( malloc_trace != nullptr ) {
+		malloc_trace_record( MALLOC_TRACE_REALLOC, memblock, p, size );
+	}
+
+	return p;
+}
+
+char* _mstrdup(const char *p, const char *file, int32 line, const char *func )
+{
+	char* string = memmgr::_mstrdup( p, file, line, func );
+
+	if( malloc_trace != nullptr && string != nullptr ) {
+		malloc_trace_record( MALLOC_TRACE_ALLOC, nullptr, string, strlen( string ) + 1 );
+	}
+
+	return string;
+}
+
+void _mfree(void *ptr, const char *file, int32 line, const char *func )
+{
+	if( malloc_trace != nullptr ) {
+		malloc_trace_record( MALLOC_TRACE_FREE, ptr, nullptr, 0 );
+	}
+
+	memmgr::_mfree( ptr, file, line, func );
+}
 #endif /* USE_MEMMGR */
 
 
@@ -682,7 +1482,7 @@ void malloc_memory_check(void)
 bool malloc_verify_ptr(void* ptr)
 {
 #ifdef USE_MEMMGR
-	return memmgr_verify(ptr) && MEMORY_VERIFY(ptr);
+	return memmgr::memmgr_verify(ptr) && MEMORY_VERIFY(ptr);
 #else
 	return MEMORY_VERIFY(ptr);
 #endif
@@ -692,16 +1492,81 @@ bool malloc_verify_ptr(void* ptr)
 size_t malloc_usage (void)
 {
 #ifdef USE_MEMMGR
-	return memmgr_usage ();
+	return memmgr::memmgr_usage ();
 #else
 	return MEMORY_USAGE();
 #endif
 }
 
+/// Starts recording the allocation calls of the current thread into ops.
+void malloc_trace_start( std::vector<s_malloc_trace_op>& ops )
+{
+	malloc_trace_stop();
+	malloc_trace = new s_malloc_trace{ &ops, {}, 0 };
+}
+
+/// Stops the recording of the current thread.
+/// @return amount of allocations in the trace
+uint32 malloc_trace_stop( void )
+{
+	uint32 count = 0;
+
+	if( malloc_trace != nullptr ) {
+		count = malloc_trace->count;
+		delete malloc_trace;
+		malloc_trace = nullptr;
+	}
+
+	return count;
+}
+
+#if !defined(USE_MEMMGR)
+#define MALLOC_ACTIVE_BACKEND "system"
+#elif defined(LEGACY_MEMMGR)
+#define MALLOC_ACTIVE_BACKEND "legacy"
+#else
+#define MALLOC_ACTIVE_BACKEND "thread caching"
+#endif
+
+/// Allocators a trace can be replayed against.
+/// The memory managers that aMalloc does not use are only meant for a single thread.
+static const s_malloc_backend malloc_backend_list[] = {
+#ifdef USE_MEMMGR
+	{ "thread caching",
+		[]( size_t size ) { return memmgr_thread::_mmalloc( size, ALC_MARK ); },
+		[]( void* p, size_t size ) { return memmgr_thread::_mrealloc( p, size, ALC_MARK ); },
+		[]( void* p ) { memmgr_thread::_mfree( p, ALC_MARK ); } },
+	{ "legacy",
+		[]( size_t size ) { return memmgr_legacy::_mmalloc( size, ALC_MARK ); },
+		[]( void* p, size_t size ) { return memmgr_legacy::_mrealloc( p, size, ALC_MARK ); },
+		[]( void* p ) { memmgr_legacy::_mfree( p, ALC_MARK ); } },
+#endif
+	{ "system",
+		[]( size_t size ) { return MALLOC( size, __FILE__, __LINE__, __func__ ); },
+		[]( void* p, size_t size ) { return REALLOC( p, size, __FILE__, __LINE__, __func__ ); },
+		[]( void* p ) { FREE( p, __FILE__, __LINE__, __func__ ); } },
+};
+
+/// Returns the allocators a trace can be replayed against.
+/// @param count receives the amount of allocators
+/// @return array of the allocators
+const s_malloc_backend* malloc_backends( size_t& count )
+{
+	count = ARRAYLENGTH( malloc_backend_list );
+
+	return malloc_backend_list;
+}
+
+/// Returns the name of the allocator behind aMalloc, as listed by malloc_backends.
+const char* malloc_active_backend( void )
+{
+	return MALLOC_ACTIVE_BACKEND;
+}
+
 void malloc_final (void)
 {
 #ifdef USE_MEMMGR
-	memmgr_final ();
+	memmgr::memmgr_final ();
 #endif
 	MEMORY_CHECK();
 }
@@ -718,6 +1583,6 @@ void malloc_init (void)
 	GC_INIT();
 #endif
 #ifdef USE_MEMMGR
-	memmgr_init ();
+	memmgr::memmgr_init ();
 #endif
 }
@@ -4,6 +4,8 @@
 #ifndef MALLOC_HPP
 #define MALLOC_HPP
 
+#include <vector>
+
 #include <config/core.hpp>
 
 #include "cbasetypes.hpp"
@@ -25,6 +27,8 @@
 
 //////////////////////////////////////////////////////////////////////
 // Athena's built-in Memory Manager
+// Every thread allocates from its own cache of size classes.
+// Define LEGACY_MEMMGR to use the old single-threaded block manager instead.
 #ifdef USE_MEMMGR
 
 // Enable memory manager logging by default
@@ -105,4 +109,31 @@ size_t malloc_usage (void);
 void malloc_init (void);
 void malloc_final (void);
 
+/// Kinds of recorded allocation calls
+enum e_malloc_trace : uint8 {
+	MALLOC_TRACE_ALLOC = 0,	///< aMalloc, aCalloc or aStrdup, starts a new allocation
+	MALLOC_TRACE_REALLOC,	///< aRealloc of an allocation of the trace
+	MALLOC_TRACE_FREE,		///< aFree of an allocation of the trace
+};
+
+/// Allocation call recorded by malloc_trace_start
+struct s_malloc_trace_op {
+	e_malloc_trace type;
+	uint32 index;	///< Allocation the call works on, allocations are numbered in their order
+	uint32 size;	///< Requested size, 0 for MALLOC_TRACE_FREE
+};
+
+/// Allocator that a recorded trace can be replayed against
+struct s_malloc_backend {
+	const char* name;
+	void* (*allocate)( size_t size );
+	void* (*reallocate)( void* p, size_t size );
+	void (*release)( void* p );
+};
+
+void malloc_trace_start( std::vector<s_malloc_trace_op>& ops );
+uint32 malloc_trace_stop( void );
+const s_malloc_backend* malloc_backends( size_t& count );
+const char* malloc_active_backend( void );
+
 #endif /* MALLOC_HPP */
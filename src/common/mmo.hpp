@@ -282,7 +282,7 @@ enum e_mode {
 struct s_aura_effect {
 	uint16 effect_id = 0;
 	uint32 replay_interval = 0;
-	int32 replay_tid = INVALID_TIMER;
+	t_tick replay_next = 0; ///< Tick of the next replay, only used if replay_interval is set
 };
 
 struct s_unit_common_data {
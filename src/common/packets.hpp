@@ -9,6 +9,7 @@
 
 #include <common/cbasetypes.hpp>
 #include <common/mmo.hpp>
+#include <common/profiler.hpp>
 #include <common/showmsg.hpp>
 #include <common/socket.hpp>
 #include <common/utilities.hpp>
@@ -276,8 +277,13 @@ public:
 				return false;
 			}
 
+			uint64 start = profiler_enabled ? profiler_clock() : 0;
 			bool ret = info->func( fd, sd );
 
+			if( profiler_enabled ){
+				profiler_record( PROFILER_PACKET, static_cast<uint16>( p->packetType ), start, profiler_packet_name );
+			}
+
 			RFIFOSKIP( fd, info->size );
 
 			return ret;
@@ -294,8 +300,13 @@ public:
 				return false;
 			}
 
+			uint64 start = profiler_enabled ? profiler_clock() : 0;
 			bool ret = info->func( fd, sd );
 
+			if( profiler_enabled ){
+				profiler_record( PROFILER_PACKET, static_cast<uint16>( p->packetType ), start, profiler_packet_name );
+			}
+
 			RFIFOSKIP( fd, p->packetLength );
 
 			return ret;
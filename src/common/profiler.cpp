@@ -0,0 +1,278 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "showmsg.hpp"
+#include "strlib.hpp"
+#include "timer.hpp"
+
+bool profiler_enabled = false;
+
+static std::unordered_map<uint64, s_profiler_entry*> profiler_entries;
+/// Entries that were called during the current tick
+static std::vector<s_profiler_entry*> profiler_tick_entries;
+static uint32 profiler_tick_serial = 1;
+static uint64 profiler_tick_start = 0;
+
+static uint32 profiler_slow_tick = 100;
+static uint32 profiler_dump_interval = 0;
+static t_tick profiler_next_dump = 0;
+static uint64 profiler_slow_ticks = 0;
+
+static const char* profiler_category_names[PROFILER_MAX] = { "timer", "packet", "skill", "function" };
+
+/**
+ * Find the entry of a timer function or packet handler, creating it on first use.
+ * @param name: called once to resolve the name of a new entry
+ */
+static s_profiler_entry* profiler_entry( e_profiler_category category, uintptr_t key, ProfilerNameFunc name ){
+	uint64 index = ( static_cast<uint64>( key ) << 2 ) | category;
+	auto it = profiler_entries.find( index );
+
+	if( it != profiler_entries.end() ){
+		return it->second;
+	}
+
+	s_profiler_entry* entry = new s_profiler_entry{};
+
+	entry->category = category;
+	entry->key = key;
+	safestrncpy( entry->name, name != nullptr ? name( key ) : "unknown", sizeof( entry->name ) );
+
+	profiler_entries[index] = entry;
+
+	return entry;
+}
+
+/**
+ * Resolves the name of a packet handler, which is keyed by its packet id.
+ */
+const char* profiler_packet_name( uintptr_t key ){
+	static char name[16];
+
+	safesnprintf( name, sizeof( name ), "0x%04x", static_cast<uint32>( key ) );
+
+	return name;
+}
+
+/**
+ * Resolves the name of a hot function, which is keyed by its name.
+ */
+const char* profiler_function_name( uintptr_t key ){
+	return reinterpret_cast<const char*>( key );
+}
+
+/**
+ * Record a call of a timer function or packet handler.
+ * @param start: profiler_clock() before the call
+ * @param name: resolves the name of the key, only called the first time the key is seen
+ */
+void profiler_record( e_profiler_category category, uintptr_t key, uint64 start, ProfilerNameFunc name ){
+	uint64 duration = profiler_clock() - start;
+	s_profiler_entry* entry = profiler_entry( category, key, name );
+	size_t bucket = 0;
+
+	while( bucket < PROFILER_HISTOGRAM_BUCKETS - 1 && ( 1ULL << bucket ) <= duration ){
+		bucket++;
+	}
+
+	entry->calls++;
+	entry->total += duration;
+	entry->max = std::max( entry->max, duration );
+	entry->histogram[bucket]++;
+
+	if( entry->tick_serial != profiler_tick_serial ){
+		entry->tick_serial = profiler_tick_serial;
+		entry->tick_total = 0;
+		entry->tick_calls = 0;
+		profiler_tick_entries.push_back( entry );
+	}
+
+	entry->tick_total += duration;
+	entry->tick_calls++;
+}
+
+/**
+ * Mark the start of a main loop iteration.
+ */
+void profiler_tick_begin(){
+	profiler_tick_start = profiler_clock();
+}
+
+/**
+ * Mark the end of a main loop iteration.
+ * Logs the most expensive calls if the tick took longer than the slow tick threshold
+ * and dumps the statistics when the dump interval has passed.
+ */
+void profiler_tick_end(){
+	uint64 busy = 0;
+
+	for( s_profiler_entry* entry : profiler_tick_entries ){
+		// Functions run inside of timers and packet handlers, which already count them
+		if( entry->category != PROFILER_FUNCTION ){
+			busy += entry->tick_total;
+		}
+	}
+
+	if( profiler_slow_tick > 0 && busy >= profiler_slow_tick * 1000ULL ){
+		size_t count = std::min<size_t>( profiler_tick_entries.size(), 5 );
+		char buf[512];
+		size_t len = 0;
+
+		std::partial_sort( profiler_tick_entries.begin(), profiler_tick_entries.begin() + count, profiler_tick_entries.end(), []( const s_profiler_entry* a, const s_profiler_entry* b ){
+			return a->tick_total > b->tick_total;
+		} );
+
+		buf[0] = '\0';
+
+		for( size_t i = 0; i < count; i++ ){
+			const s_profiler_entry* entry = profiler_tick_entries[i];
+			int32 written = safesnprintf( buf + len, sizeof( buf ) - len, "%s%s %s (%" PRIu64 " ms, %u calls)", ( i > 0 ? ", " : "" ), profiler_category_names[entry->category], entry->name, entry->tick_total / 1000, entry->tick_calls );
+
+			if( written < 0 ){
+				break;
+			}
+
+			len += written;
+		}
+
+		profiler_slow_ticks++;
+		ShowWarning( "Slow tick: %" PRIu64 " ms spent in timers and packet handlers (loop took %" PRIu64 " ms). Offenders: %s\n", busy / 1000, ( profiler_clock() - profiler_tick_start ) / 1000, buf );
+	}
+
+	profiler_tick_entries.clear();
+	profiler_tick_serial++;
+
+	if( profiler_dump_interval > 0 && DIFF_TICK( gettick(), profiler_next_dump ) >= 0 ){
+		profiler_next_dump = gettick() + profiler_dump_interval * 1000;
+
+		profiler_dump( 10, []( const char* line ){
+			ShowInfo( "%s\n", line );
+		} );
+	}
+}
+
+void profiler_set_enabled( bool enabled ){
+	if( enabled && !profiler_enabled ){
+		profiler_next_dump = gettick() + profiler_dump_interval * 1000;
+		profiler_tick_start = profiler_clock();
+	}
+
+	profiler_enabled = enabled;
+	profiler_tick_entries.clear();
+	profiler_tick_serial++;
+}
+
+/**
+ * Set the slow tick threshold.
+ * @param threshold: duration in milliseconds, 0 disables the slow tick log
+ */
+void profiler_set_slow_tick( uint32 threshold ){
+	profiler_slow_tick = threshold;
+}
+
+/**
+ * Set the interval of the periodic dump.
+ * @param interval: interval in seconds, 0 disables the periodic dump
+ */
+void profiler_set_dump_interval( uint32 interval ){
+	profiler_dump_interval = interval;
+	profiler_next_dump = gettick() + interval * 1000;
+}
+
+/**
+ * Forget all recorded statistics.
+ */
+void profiler_reset(){
+	for( auto& pair : profiler_entries ){
+		delete pair.second;
+	}
+
+	profiler_entries.clear();
+	profiler_tick_entries.clear();
+	profiler_tick_serial++;
+	profiler_slow_ticks = 0;
+}
+
+/**
+ * Upper bound of the bucket that contains the given percentile.
+ * @param percentile: percentile between 0 and 100
+ * @return duration in microseconds
+ */
+static uint64 profiler_percentile( const s_profiler_entry* entry, uint32 percentile ){
+	uint64 target = ( entry->calls * percentile + 99 ) / 100;
+	uint64 seen = 0;
+
+	for( size_t i = 0; i < PROFILER_HISTOGRAM_BUCKETS; i++ ){
+		seen += entry->histogram[i];
+
+		if( seen >= target ){
+			return std::min<uint64>( 1ULL << i, entry->max );
+		}
+	}
+
+	return entry->max;
+}
+
+/**
+ * Report the entries with the highest cumulative duration.
+ * @param limit: maximum amount of entries per category
+ * @param output: called for each line of the report
+ */
+void profiler_dump( size_t limit, std::function<void( const char* line )> output ){
+	char line[256];
+
+	safesnprintf( line, sizeof( line ), "Profiler: %" PRIuPTR " entries, %" PRIu64 " slow ticks.", profiler_entries.size(), profiler_slow_ticks );
+	output( line );
+
+	for( uint8 category = PROFILER_TIMER; category < PROFILER_MAX; category++ ){
+		std::vector<const s_profiler_entry*> entries;
+
+		for( const auto& pair : profiler_entries ){
+			if( pair.second->category == category ){
+				entries.push_back( pair.second );
+			}
+		}
+
+		if( entries.empty() ){
+			continue;
+		}
+
+		std::sort( entries.begin(), entries.end(), []( const s_profiler_entry* a, const s_profiler_entry* b ){
+			return a->total > b->total;
+		} );
+
+		for( size_t i = 0; i < entries.size() && i < limit; i++ ){
+			const s_profiler_entry* entry = entries[i];
+
+			safesnprintf( line, sizeof( line ), "[%s] %s: %" PRIu64 " calls, %" PRIu64 " ms total, %" PRIu64 " us avg, %" PRIu64 " us p99, %" PRIu64 " us max",
+				profiler_category_names[category], entry->name, entry->calls, entry->total / 1000, entry->total / entry->calls, profiler_percentile( entry, 99 ), entry->max );
+			output( line );
+		}
+	}
+}
+
+/**
+ * Look up the statistics of a timer function, packet handler or hot function by its name.
+ * @return nullptr if it was not called since the last reset
+ */
+const s_profiler_entry* profiler_find( e_profiler_category category, const char* name ){
+	for( const auto& pair : profiler_entries ){
+		if( pair.second->category == category && strcmp( pair.second->name, name ) == 0 ){
+			return pair.second;
+		}
+	}
+
+	return nullptr;
+}
+
+void profiler_final(){
+	profiler_enabled = false;
+	profiler_reset();
+}
@@ -0,0 +1,83 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <chrono>
+#include <functional>
+
+#include "cbasetypes.hpp"
+
+/// Kind of work measured by the profiler
+enum e_profiler_category : uint8{
+	PROFILER_TIMER = 0, ///< Timer callback, keyed by TimerFunc
+	PROFILER_PACKET,    ///< Packet handler, keyed by packet id
+	PROFILER_SKILL,     ///< Splash skill cast, keyed by skill and target count
+	PROFILER_FUNCTION,  ///< Hot function measured with ProfilerScope, keyed by its name
+	PROFILER_MAX
+};
+
+/// Amount of histogram buckets, bucket n counts calls that took less than 2^n microseconds
+#define PROFILER_HISTOGRAM_BUCKETS 24
+
+/// Statistics of a single timer function or packet handler.
+/// Only touched by the main thread, so no synchronization is needed.
+struct s_profiler_entry{
+	e_profiler_category category;
+	uintptr_t key;
+	char name[64];
+	uint64 calls;
+	uint64 total; ///< Cumulative duration in microseconds
+	uint64 max;   ///< Longest call in microseconds
+	uint64 histogram[PROFILER_HISTOGRAM_BUCKETS];
+
+	// Current tick
+	uint32 tick_serial;
+	uint64 tick_total;
+	uint32 tick_calls;
+};
+
+typedef const char* (*ProfilerNameFunc)( uintptr_t key );
+
+extern bool profiler_enabled;
+
+/// Current time of the profiler clock in microseconds
+static inline uint64 profiler_clock(){
+	return static_cast<uint64>( std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count() );
+}
+
+const char* profiler_packet_name( uintptr_t key );
+const char* profiler_function_name( uintptr_t key );
+void profiler_record( e_profiler_category category, uintptr_t key, uint64 start, ProfilerNameFunc name );
+void profiler_tick_begin();
+void profiler_tick_end();
+
+void profiler_set_enabled( bool enabled );
+void profiler_set_slow_tick( uint32 threshold );
+void profiler_set_dump_interval( uint32 interval );
+void profiler_reset();
+void profiler_dump( size_t limit, std::function<void( const char* line )> output );
+const s_profiler_entry* profiler_find( e_profiler_category category, const char* name );
+
+void profiler_final();
+
+/// Measures the enclosing scope as a call of a hot function while the profiler is enabled.
+/// The time includes everything the function calls, so nested functions are counted by both.
+class ProfilerScope{
+private:
+	const char* name;
+	uint64 start;
+
+public:
+	ProfilerScope( const char* scope_name ) : name( scope_name ), start( profiler_enabled ? profiler_clock() : 0 ){
+	}
+
+	~ProfilerScope(){
+		if( this->start != 0 ){
+			profiler_record( PROFILER_FUNCTION, reinterpret_cast<uintptr_t>( this->name ), this->start, profiler_function_name );
+		}
+	}
+};
+
+#endif /* PROFILER_HPP */
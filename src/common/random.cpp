@@ -3,9 +3,115 @@
 
 #include "random.hpp"
 
-std::uniform_int_distribution<int32> int31_distribution = std::uniform_int_distribution<int32>(0, SINT32_MAX);
+#include <mutex>
+
+Xoshiro256 generator;
+Xoshiro256 random_streams[RND_STREAM_MAX];
+
+/// Source of the streams handed out by rnd_split, each one is jumped ahead of the previous
+static Xoshiro256 rnd_master;
+static std::mutex rnd_master_mutex;
+
+/// Seeds everything from the system's entropy source before main runs
+static struct s_random_init{
+	s_random_init(){
+		std::random_device device;
+
+		rnd_seed( ( static_cast<uint64>( device() ) << 32 ) | device() );
+	}
+} random_init;
+
+/**
+ * Expand a seed into the state with splitmix64, as recommended by the authors of xoshiro.
+ * @param seed: any value, 0 included
+ */
+void Xoshiro256::seed( uint64 seed ){
+	for( uint64& word : this->state ){
+		uint64 z = ( seed += 0x9E3779B97F4A7C15ULL );
+
+		z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+		z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+		word = z ^ ( z >> 31 );
+	}
+}
+
+/**
+ * Advance the generator by 2^128 draws.
+ * Generators jumped from the same state never overlap in practice, so they are used as independent streams.
+ */
+void Xoshiro256::jump(){
+	static const uint64 polynomial[] = { 0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL, 0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL };
+	uint64 jumped[4] = {};
+
+	for( uint64 word : polynomial ){
+		for( int32 bit = 0; bit < 64; bit++ ){
+			if( word & ( 1ULL << bit ) ){
+				for( size_t i = 0; i < 4; i++ ){
+					jumped[i] ^= this->state[i];
+				}
+			}
+
+			( *this )();
+		}
+	}
+
+	std::copy( std::begin( jumped ), std::end( jumped ), std::begin( this->state ) );
+}
 
 /// Generates a random number in the interval [0, SINT32_MAX]
 int32 rnd( void ){
-	return int31_distribution( generator );
+	return static_cast<int32>( generator() >> 33 );
+}
+
+/**
+ * Seed the global generator and the subsystem streams.
+ * The same seed always yields the same numbers, which the replay and benchmark harnesses rely on.
+ * @param seed: seed value
+ */
+void rnd_seed( uint64 seed ){
+	std::lock_guard<std::mutex> lock( rnd_master_mutex );
+
+	rnd_master.seed( seed );
+	generator = rnd_master;
+
+	for( Xoshiro256& stream : random_streams ){
+		rnd_master.jump();
+		stream = rnd_master;
+	}
+
+	rnd_master.jump();
+}
+
+/**
+ * Create a new stream that is independent of all others, for example for a worker thread.
+ * Streams are deterministic for a given seed and order of calls.
+ * @return generator owned by the caller
+ */
+Xoshiro256 rnd_split(){
+	std::lock_guard<std::mutex> lock( rnd_master_mutex );
+	Xoshiro256 stream = rnd_master;
+
+	rnd_master.jump();
+
+	return stream;
+}
+
+/**
+ * Fill an array with random numbers in the interval [min, max] from the stream of a subsystem.
+ * Used to roll whole drop tables at once.
+ * @param stream: stream to draw from
+ * @param values: array of at least count entries
+ * @param count: amount of numbers
+ */
+void rnd_fill( e_random_stream stream, int32* values, size_t count, int32 min, int32 max ){
+	if( min > max ){
+		std::swap( min, max );
+	}
+
+	Xoshiro256& gen = random_streams[stream];
+	uint32 range = static_cast<uint32>( max ) - static_cast<uint32>( min ) + 1;
+
+	for( size_t i = 0; i < count; i++ ){
+		values[i] = static_cast<int32>( static_cast<uint32>( min ) + rnd_bounded( gen, range ) );
+	}
 }
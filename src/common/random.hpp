@@ -11,22 +11,129 @@
 
 #include "cbasetypes.hpp"
 
-inline std::random_device device;
-inline std::mt19937 generator = std::mt19937(device());
+/// xoshiro256** generator by David Blackman and Sebastiano Vigna.
+/// Much smaller and faster than std::mt19937 and meets UniformRandomBitGenerator,
+/// so it can be used with the standard distributions and algorithms.
+class Xoshiro256{
+private:
+	uint64 state[4];
+
+	static uint64 rotl( uint64 x, int32 k ){
+		return ( x << k ) | ( x >> ( 64 - k ) );
+	}
+
+public:
+	typedef uint64 result_type;
+
+	Xoshiro256( uint64 seed = 0 ){
+		this->seed( seed );
+	}
+
+	static constexpr result_type min(){
+		return 0;
+	}
+
+	static constexpr result_type max(){
+		return UINT64_MAX;
+	}
+
+	result_type operator()(){
+		uint64 result = rotl( this->state[1] * 5, 7 ) * 9;
+		uint64 t = this->state[1] << 17;
+
+		this->state[2] ^= this->state[0];
+		this->state[3] ^= this->state[1];
+		this->state[1] ^= this->state[2];
+		this->state[0] ^= this->state[3];
+		this->state[2] ^= t;
+		this->state[3] = rotl( this->state[3], 45 );
+
+		return result;
+	}
+
+	void seed( uint64 seed );
+	void jump();
+};
+
+/// Independent random streams of subsystems, so that one subsystem drawing more numbers
+/// does not shift the rolls of another one when replaying with a fixed seed
+enum e_random_stream : uint8{
+	RND_STREAM_DROP = 0, ///< Item drops of monsters
+	RND_STREAM_BATTLE, ///< Hit and critical rolls
+	RND_STREAM_MAX
+};
+
+extern Xoshiro256 generator;
+extern Xoshiro256 random_streams[RND_STREAM_MAX];
 
 int32 rnd(void);// [0, SINT32_MAX]
+void rnd_seed( uint64 seed );
+Xoshiro256 rnd_split();
+void rnd_fill( e_random_stream stream, int32* values, size_t count, int32 min, int32 max );
 
 /*
- * Generates a random number in the interval [min, max]
+ * Generates a random number in the interval [0, range) without modulo bias
+ * Uses Lemire's multiply and shift, which only divides in the rare case of a rejection
+ * @param range: size of the interval, 0 for 2^32
+ * @return random number
+ */
+static inline uint32 rnd_bounded( Xoshiro256& gen, uint32 range ){
+	if( range == 0 ){
+		return static_cast<uint32>( gen() >> 32 );
+	}
+
+	uint64 m = ( gen() >> 32 ) * range;
+	uint32 low = static_cast<uint32>( m );
+
+	if( low < range ){
+		uint32 threshold = ( 0u - range ) % range;
+
+		while( low < threshold ){
+			m = ( gen() >> 32 ) * range;
+			low = static_cast<uint32>( m );
+		}
+	}
+
+	return static_cast<uint32>( m >> 32 );
+}
+
+/*
+ * Generates a random number in the interval [min, max] from a given generator
  * @return random number
  */
 template <typename T>
-typename std::enable_if<std::is_integral<T>::value, T>::type rnd_value(T min, T max) {
+typename std::enable_if<std::is_integral<T>::value, T>::type rnd_value( Xoshiro256& gen, T min, T max ){
 	if (min > max) {
 		std::swap(min, max);
 	}
+
+	typedef typename std::make_unsigned<T>::type U;
+	uint64 span = static_cast<U>( static_cast<U>( max ) - static_cast<U>( min ) );
+
+	if( span < UINT32_MAX ){
+		return static_cast<T>( static_cast<U>( min ) + rnd_bounded( gen, static_cast<uint32>( span + 1 ) ) );
+	}
+
 	std::uniform_int_distribution<T> dist(min, max);
-	return dist(generator);
+	return dist(gen);
+}
+
+/*
+ * Generates a random number in the interval [min, max]
+ * @return random number
+ */
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value, T>::type rnd_value(T min, T max) {
+	return rnd_value<T>( generator, min, max );
+}
+
+/*
+ * Generates a random number in the interval [min, max] from the stream of a subsystem
+ * @return random number
+ */
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value, T>::type rnd_value( e_random_stream stream, T min, T max ){
+	return rnd_value<T>( random_streams[stream], min, max );
 }
 
 /*
@@ -3,8 +3,16 @@
 
 #include "showmsg.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdlib> // atexit
 #include <ctime>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
 
 #ifdef WIN32
 	#include "winapi.hpp"
@@ -662,13 +670,489 @@ int32	FPRINTF(FILE *file, const char *fmt, ...)
 
 char timestamp_format[20] = ""; //For displaying Timestamps
 
+int32 console_async = 1;
+int32 console_rate_limit = 20;
+int32 console_log_format = CONSOLE_LOG_TEXT;
+
+///////////////////////////////////////////////////////////////////////////////
+/// asynchronous output
+///
+/// Messages are formatted by the calling thread and pushed to a lock-free
+/// multi producer single consumer queue. A writer thread pops them and does
+/// the console and file output, so a flood of messages never blocks the
+/// caller on terminal I/O. Fatal errors, messages before showmsg_init and
+/// messages with console_async disabled are written directly, after the
+/// queue has been drained to keep the order.
+
+#define SHOWMSG_WAIT_MS 100 // Longest sleep of the writer thread, also the resolution of the rate limit windows
+#define SHOWMSG_RATE_WINDOW 1000 // Identical messages are counted per window of this many milliseconds
+#define SHOWMSG_BINARY_MAGIC "RAMSGLOG"
+#define SHOWMSG_BINARY_VERSION 1
+
+struct s_showmsg_record {
+	std::atomic<s_showmsg_record*> next;
+	enum msg_type flag;
+	bool print; // Shown on the console, false if silenced by console_silent
+	bool log; // Written to console_log_filepath
+	int64 time; // Unix time in milliseconds
+	std::string prefix;
+	std::string text;
+	std::promise<void>* flushed; // Flush marker, set once everything queued before it was written
+};
+
+/// Identical messages seen in the current window
+struct s_showmsg_rate {
+	int64 start;
+	uint32 count;
+	uint32 suppressed;
+	enum msg_type flag;
+	std::string text;
+};
+
+// Producers push at the head, the writer pops at the tail
+static s_showmsg_record showmsg_stub;
+static std::atomic<s_showmsg_record*> showmsg_head{ &showmsg_stub };
+static s_showmsg_record* showmsg_tail = &showmsg_stub;
+static std::atomic<uint32> showmsg_pending{ 0 };
+
+static std::thread showmsg_thread;
+static std::atomic<bool> showmsg_running{ false };
+static bool showmsg_writer_alive = false; // Protected by showmsg_write_mutex
+static std::atomic<bool> showmsg_waiting{ false };
+static std::atomic<bool> showmsg_crashed{ false }; // Set by the crash handler, the writer stops popping
+static std::atomic<bool> showmsg_writing{ false }; // The writer is popping or writing records
+static std::mutex showmsg_wait_mutex;
+static std::condition_variable showmsg_wait_cond;
+
+// Serializes the actual output between the writer and direct writes
+static std::mutex showmsg_write_mutex;
+static std::unordered_map<size_t, s_showmsg_rate> showmsg_rates;
+static FILE* showmsg_log_file = nullptr;
+static char showmsg_log_path[sizeof(console_log_filepath)] = "";
+static int32 showmsg_log_format = CONSOLE_LOG_TEXT;
+
+static int64 showmsg_time(){
+	return std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::system_clock::now().time_since_epoch() ).count();
+}
+
+static void showmsg_push( s_showmsg_record* record ){
+	record->next.store( nullptr, std::memory_order_relaxed );
+
+	s_showmsg_record* prev = showmsg_head.exchange( record, std::memory_order_acq_rel );
+
+	prev->next.store( record, std::memory_order_release );
+
+	showmsg_pending++;
+
+	if( showmsg_waiting ){
+		std::lock_guard<std::mutex> lock( showmsg_wait_mutex );
+
+		showmsg_wait_cond.notify_one();
+	}
+}
+
+/**
+ * Pop the oldest record, only called by the writer thread.
+ * @return nullptr if the queue is empty or a producer is still linking its record
+ */
+static s_showmsg_record* showmsg_pop(){
+	s_showmsg_record* tail = showmsg_tail;
+	s_showmsg_record* next = tail->next.load( std::memory_order_acquire );
+
+	if( tail == &showmsg_stub ){
+		if( next == nullptr ){
+			return nullptr;
+		}
+
+		showmsg_tail = tail = next;
+		next = next->next.load( std::memory_order_acquire );
+	}
+
+	if( next != nullptr ){
+		showmsg_tail = next;
+		showmsg_pending--;
+		return tail;
+	}
+
+	if( tail != showmsg_head.load( std::memory_order_acquire ) ){
+		return nullptr;
+	}
+
+	showmsg_push( &showmsg_stub );
+	showmsg_pending--;
+
+	next = tail->next.load( std::memory_order_acquire );
+
+	if( next != nullptr ){
+		showmsg_tail = next;
+		showmsg_pending--;
+		return tail;
+	}
+
+	return nullptr;
+}
+
+/**
+ * Remove the ANSI escape sequences of a message.
+ */
+static std::string showmsg_strip( const std::string& text ){
+	std::string stripped;
+
+	stripped.reserve( text.size() );
+
+	for( size_t i = 0; i < text.size(); i++ ){
+		if( text[i] == 0x1b && i + 1 < text.size() && text[i + 1] == '[' ){
+			for( i += 2; i < text.size() && ( ISDIGIT( text[i] ) || text[i] == ';' ); i++ );
+			continue;
+		}
+
+		stripped += text[i];
+	}
+
+	return stripped;
+}
+
+/**
+ * Write a message to console_log_filepath, the file is kept open until the path or format changes.
+ */
+static void showmsg_write_log( const s_showmsg_record* record ){
+	if( showmsg_log_file != nullptr && ( strcmp( showmsg_log_path, console_log_filepath ) != 0 || showmsg_log_format != console_log_format ) ){
+		fclose( showmsg_log_file );
+		showmsg_log_file = nullptr;
+	}
+
+	if( showmsg_log_file == nullptr ){
+		if( ( showmsg_log_file = fopen( console_log_filepath, console_log_format == CONSOLE_LOG_BINARY ? "ab" : "a+" ) ) == nullptr ){
+			return;
+		}
+
+		safestrncpy( showmsg_log_path, console_log_filepath, sizeof( showmsg_log_path ) );
+		showmsg_log_format = console_log_format;
+
+		if( showmsg_log_format == CONSOLE_LOG_BINARY ){
+			fseek( showmsg_log_file, 0, SEEK_END );
+
+			if( ftell( showmsg_log_file ) == 0 ){
+				uint32 version = SHOWMSG_BINARY_VERSION;
+
+				fwrite( SHOWMSG_BINARY_MAGIC, 1, 8, showmsg_log_file );
+				fwrite( &version, sizeof( version ), 1, showmsg_log_file );
+			}
+		}
+	}
+
+	if( showmsg_log_format == CONSOLE_LOG_BINARY ){
+		// Record: int64 unix time in ms, uint8 msg_type, 3 bytes padding, uint32 length, text without escape sequences
+		std::string text = showmsg_strip( record->text );
+		uint8 header[16] = {};
+		uint32 length = static_cast<uint32>( text.size() );
+
+		memcpy( header, &record->time, sizeof( record->time ) );
+		header[8] = static_cast<uint8>( record->flag );
+		memcpy( header + 12, &length, sizeof( length ) );
+
+		fwrite( header, 1, sizeof( header ), showmsg_log_file );
+		fwrite( text.data(), 1, text.size(), showmsg_log_file );
+	}else{
+		char timestring[255];
+		time_t curtime = static_cast<time_t>( record->time / 1000 );
+
+		strftime( timestring, 254, "%m/%d/%Y %H:%M:%S", localtime( &curtime ) );
+		fprintf( showmsg_log_file, "(%s) [ %s ] : %s",
+			timestring,
+			record->flag == MSG_WARNING ? "Warning" :
+			record->flag == MSG_ERROR ? "Error" :
+			record->flag == MSG_SQL ? "SQL Error" :
+			record->flag == MSG_DEBUG ? "Debug" :
+			"Unknown",
+			record->text.c_str() );
+	}
+}
+
+static void showmsg_write_console( enum msg_type flag, const char* prefix, const char* text ){
+	if (flag == MSG_ERROR || flag == MSG_FATALERROR || flag == MSG_SQL)
+	{	//Send Errors to StdErr [Skotlex]
+		FPRINTF(STDERR, "%s ", prefix);
+		FPRINTF(STDERR, "%s", text);
+	} else {
+		if (flag != MSG_NONE)
+			FPRINTF(STDOUT, "%s ", prefix);
+		FPRINTF(STDOUT, "%s", text);
+	}
+
+#if defined(DEBUGLOGMAP) || defined(DEBUGLOGCHAR) || defined(DEBUGLOGLOGIN)
+	if(strlen(DEBUGLOGPATH) > 0) {
+		FILE *fp=fopen(DEBUGLOGPATH,"a");
+		if (fp == nullptr)	{
+			FPRINTF(STDERR, CL_RED "[ERROR]" CL_RESET ": Could not open '" CL_WHITE "%s" CL_RESET "', access denied.\n", DEBUGLOGPATH);
+			FFLUSH(STDERR);
+		} else {
+			fprintf(fp,"%s %s", prefix, text);
+			fclose(fp);
+		}
+	} else {
+		FPRINTF(STDERR, CL_RED "[ERROR]" CL_RESET ": DEBUGLOGPATH not defined!\n");
+		FFLUSH(STDERR);
+	}
+#endif
+}
+
+/**
+ * Report the identical messages that were suppressed in the windows that have ended.
+ * @param all: end all windows, used on shutdown
+ */
+static void showmsg_rate_expire( int64 now, bool all ){
+	for( auto it = showmsg_rates.begin(); it != showmsg_rates.end(); ){
+		s_showmsg_rate& rate = it->second;
+
+		if( !all && now - rate.start < SHOWMSG_RATE_WINDOW ){
+			++it;
+			continue;
+		}
+
+		if( rate.suppressed > 0 ){
+			char line[160];
+			std::string text = showmsg_strip( rate.text );
+			size_t end = text.find_first_of( "\r\n" );
+
+			if( end != std::string::npos ){
+				text.resize( end );
+			}
+
+			safesnprintf( line, sizeof( line ), "Previous message repeated %u more times: %.80s\n", rate.suppressed, text.c_str() );
+			showmsg_write_console( rate.flag, CL_YELLOW "[Notice]" CL_RESET ":" CL_CLL, line );
+		}
+
+		it = showmsg_rates.erase( it );
+	}
+}
+
+/**
+ * Do the output of a message, the write mutex must be held.
+ */
+static void showmsg_write( const s_showmsg_record* record ){
+	if( record->log ){
+		showmsg_write_log( record );
+	}
+
+	if( !record->print ){
+		return;
+	}
+
+	// Raw output is often printed piece by piece, so only prefixed messages are limited
+	if( console_rate_limit > 0 && record->flag != MSG_NONE && record->flag != MSG_FATALERROR ){
+		size_t key = std::hash<std::string>{}( record->text ) ^ static_cast<size_t>( record->flag );
+		s_showmsg_rate& rate = showmsg_rates[key];
+
+		if( rate.count == 0 ){
+			rate.start = record->time;
+			rate.flag = record->flag;
+			rate.text = record->text;
+		}
+
+		if( ++rate.count > static_cast<uint32>( console_rate_limit ) ){
+			rate.suppressed++;
+			return;
+		}
+	}
+
+	showmsg_write_console( record->flag, record->prefix.c_str(), record->text.c_str() );
+}
+
+static void showmsg_flush_output(){
+	FFLUSH(STDOUT);
+	FFLUSH(STDERR);
+
+	if( showmsg_log_file != nullptr ){
+		fflush( showmsg_log_file );
+	}
+}
+
+static void showmsg_writer(){
+	while( true ){
+		bool wrote = false;
+		s_showmsg_record* record;
+
+		{
+			std::lock_guard<std::mutex> lock( showmsg_write_mutex );
+
+			showmsg_writing = true;
+
+			while( !showmsg_crashed && ( record = showmsg_pop() ) != nullptr ){
+				if( record->flushed != nullptr ){
+					showmsg_flush_output();
+					record->flushed->set_value();
+				}else{
+					showmsg_write( record );
+					wrote = true;
+				}
+
+				delete record;
+			}
+
+			if( !showmsg_rates.empty() ){
+				showmsg_rate_expire( showmsg_time(), false );
+			}
+
+			if( wrote ){
+				showmsg_flush_output();
+			}
+
+			showmsg_writing = false;
+		}
+
+		if( !showmsg_running && showmsg_pending == 0 ){
+			std::lock_guard<std::mutex> lock( showmsg_write_mutex );
+
+			// Records pushed from here on are written directly by their producers
+			if( showmsg_pending == 0 ){
+				showmsg_writer_alive = false;
+				break;
+			}
+
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock( showmsg_wait_mutex );
+
+		showmsg_waiting = true;
+		showmsg_wait_cond.wait_for( lock, std::chrono::milliseconds( SHOWMSG_WAIT_MS ), [](){
+			return showmsg_pending > 0 || !showmsg_running;
+		} );
+		showmsg_waiting = false;
+	}
+}
+
+/**
+ * Wait until every queued message has been written.
+ */
+void showmsg_flush(void){
+	{
+		std::lock_guard<std::mutex> lock( showmsg_write_mutex );
+
+		if( !showmsg_writer_alive ){
+			return;
+		}
+	}
+
+	std::promise<void> flushed;
+	s_showmsg_record* record = new s_showmsg_record{};
+
+	std::future<void> done = flushed.get_future();
+
+	record->flushed = &flushed;
+	showmsg_push( record );
+
+	while( done.wait_for( std::chrono::milliseconds( SHOWMSG_WAIT_MS ) ) == std::future_status::timeout ){
+		std::lock_guard<std::mutex> lock( showmsg_write_mutex );
+
+		// The writer stopped before it saw the marker, it is never popped
+		if( !showmsg_writer_alive ){
+			return;
+		}
+	}
+}
+
+#ifndef WIN32
+static void showmsg_crash_write( int fd, const char* data, size_t left ){
+	while( left > 0 ){
+		ssize_t written = write( fd, data, left );
+
+		if( written <= 0 ){
+			return;
+		}
+
+		data += written;
+		left -= written;
+	}
+}
+#endif
+
+/**
+ * Write the queued messages from a crash signal handler.
+ * Only uses atomics and write(2), the queue is neither locked nor freed.
+ * The stdio buffers are not flushed, output already handed to them can be lost.
+ */
+void showmsg_crash(void){
+#ifndef WIN32
+	showmsg_crashed = true;
+
+	// The writer can be the crashing thread itself, so only wait for it a little
+	for( int32 i = 0; showmsg_writing && i < SHOWMSG_WAIT_MS; i++ ){
+		struct timespec wait = { 0, 1000000 };
+
+		nanosleep( &wait, nullptr );
+	}
+
+	if( showmsg_writing ){
+		return;
+	}
+
+	for( s_showmsg_record* record = showmsg_tail; record != nullptr; record = record->next.load( std::memory_order_acquire ) ){
+		if( record == &showmsg_stub || record->flushed != nullptr || !record->print ){
+			continue;
+		}
+
+		int fd = ( record->flag == MSG_ERROR || record->flag == MSG_FATALERROR || record->flag == MSG_SQL ) ? STDERR_FILENO : STDOUT_FILENO;
+
+		if( record->flag != MSG_NONE ){
+			showmsg_crash_write( fd, record->prefix.data(), record->prefix.size() );
+			showmsg_crash_write( fd, " ", 1 );
+		}
+
+		showmsg_crash_write( fd, record->text.data(), record->text.size() );
+	}
+#endif
+}
+
+/**
+ * Start the writer thread, messages are written directly until then.
+ */
+void showmsg_init(void){
+	if( showmsg_thread.joinable() ){
+		return;
+	}
+
+	showmsg_running = true;
+	showmsg_writer_alive = true;
+	showmsg_thread = std::thread( showmsg_writer );
+
+	// Drain the queue when exit() is called outside of the normal shutdown
+	atexit( showmsg_final );
+}
+
+/**
+ * Write the remaining messages and stop the writer thread.
+ */
+void showmsg_final(void){
+	if( showmsg_thread.joinable() ){
+		{
+			std::lock_guard<std::mutex> lock( showmsg_wait_mutex );
+
+			showmsg_running = false;
+			showmsg_wait_cond.notify_one();
+		}
+
+		showmsg_thread.join();
+	}
+
+	std::lock_guard<std::mutex> lock( showmsg_write_mutex );
+
+	showmsg_rate_expire( 0, true );
+	showmsg_flush_output();
+
+	if( showmsg_log_file != nullptr ){
+		fclose( showmsg_log_file );
+		showmsg_log_file = nullptr;
+	}
+}
+
 int32 _vShowMessage(enum msg_type flag, const char *string, va_list ap)
 {
 	va_list apcopy;
 	char prefix[100];
-#if defined(DEBUGLOGMAP) || defined(DEBUGLOGCHAR) || defined(DEBUGLOGLOGIN)
-	FILE *fp;
-#endif
+	char buf[SBUF_SIZE];
+	int32 len;
 	
 	if (!string || *string == '\0') {
 		ShowError("Empty string passed to _vShowMessage().\n");
@@ -684,30 +1168,10 @@ int32 _vShowMessage(enum msg_type flag, const char *string, va_list ap)
 		buildbotflag = 1;
 	}
 #endif
-	if(
-		( flag == MSG_WARNING && console_msg_log&1 ) ||
+	bool log = ( flag == MSG_WARNING && console_msg_log&1 ) ||
 		( ( flag == MSG_ERROR || flag == MSG_SQL ) && console_msg_log&2 ) ||
-		( flag == MSG_DEBUG && console_msg_log&4 ) ) {//[Ind]
-		FILE *log = nullptr;
-		if( (log = fopen(console_log_filepath, "a+")) ) {
-			char timestring[255];
-			time_t curtime;
-			time(&curtime);
-			strftime(timestring, 254, "%m/%d/%Y %H:%M:%S", localtime(&curtime));
-			fprintf(log,"(%s) [ %s ] : ",
-				timestring,
-				flag == MSG_WARNING ? "Warning" :
-				flag == MSG_ERROR ? "Error" :
-				flag == MSG_SQL ? "SQL Error" :
-				flag == MSG_DEBUG ? "Debug" :
-				"Unknown");
-			va_copy(apcopy, ap);
-			vfprintf(log,string,apcopy);
-			va_end(apcopy);
-			fclose(log);
-		}
-	}
-	if(
+		( flag == MSG_DEBUG && console_msg_log&4 ); //[Ind]
+	bool print = !(
 	    (flag == MSG_INFORMATION && msg_silent&1) ||
 	    (flag == MSG_STATUS && msg_silent&2) ||
 	    (flag == MSG_NOTICE && msg_silent&4) ||
@@ -715,7 +1179,9 @@ int32 _vShowMessage(enum msg_type flag, const char *string, va_list ap)
 	    (flag == MSG_ERROR && msg_silent&16) ||
 	    (flag == MSG_SQL && msg_silent&16) ||
 	    (flag == MSG_DEBUG && msg_silent&32)
-	)
+	);
+
+	if( !log && !print )
 		return 0; //Do not print it.
 
 	if (timestamp_format[0] && flag != MSG_NONE)
@@ -756,40 +1222,48 @@ int32 _vShowMessage(enum msg_type flag, const char *string, va_list ap)
 			return 1;
 	}
 
-	if (flag == MSG_ERROR || flag == MSG_FATALERROR || flag == MSG_SQL)
-	{	//Send Errors to StdErr [Skotlex]
-		FPRINTF(STDERR, "%s ", prefix);
-		va_copy(apcopy, ap);
-		VFPRINTF(STDERR, string, apcopy);
-		va_end(apcopy);
-		FFLUSH(STDERR);
-	} else {
-		if (flag != MSG_NONE)
-			FPRINTF(STDOUT, "%s ", prefix);
+	s_showmsg_record* record = new s_showmsg_record{};
+
+	record->flag = flag;
+	record->print = print;
+	record->log = log;
+	record->time = showmsg_time();
+	record->prefix = prefix;
+
+	va_copy(apcopy, ap);
+	len = vsnprintf(buf, sizeof(buf), string, apcopy);
+	va_end(apcopy);
+
+	if( len < 0 ){
+		delete record;
+		return 1;
+	}else if( len < SBUF_SIZE ){
+		record->text.assign(buf, len);
+	}else{
+		record->text.resize(len + 1);
 		va_copy(apcopy, ap);
-		VFPRINTF(STDOUT, string, apcopy);
+		vsnprintf(&record->text[0], len + 1, string, apcopy);
 		va_end(apcopy);
-		FFLUSH(STDOUT);
+		record->text.resize(len);
 	}
 
-#if defined(DEBUGLOGMAP) || defined(DEBUGLOGCHAR) || defined(DEBUGLOGLOGIN)
-	if(strlen(DEBUGLOGPATH) > 0) {
-		fp=fopen(DEBUGLOGPATH,"a");
-		if (fp == nullptr)	{
-			FPRINTF(STDERR, CL_RED "[ERROR]" CL_RESET ": Could not open '" CL_WHITE "%s" CL_RESET "', access denied.\n", DEBUGLOGPATH);
-			FFLUSH(STDERR);
-		} else {
-			fprintf(fp,"%s ", prefix);
-			va_copy(apcopy, ap);
-			vfprintf(fp,string,apcopy);
-			va_end(apcopy);
-			fclose(fp);
-		}
-	} else {
-		FPRINTF(STDERR, CL_RED "[ERROR]" CL_RESET ": DEBUGLOGPATH not defined!\n");
-		FFLUSH(STDERR);
+	if( console_async && flag != MSG_FATALERROR && showmsg_running ){
+		showmsg_push(record);
+		return 0;
 	}
-#endif
+
+	// Keep the order with the messages that are still queued
+	if( showmsg_pending > 0 )
+		showmsg_flush();
+
+	{
+		std::lock_guard<std::mutex> lock( showmsg_write_mutex );
+
+		showmsg_write(record);
+		showmsg_flush_output();
+	}
+
+	delete record;
 
 	return 0;
 }
@@ -74,6 +74,14 @@ extern int32 msg_silent; //Specifies how silent the console is. [Skotlex]
 extern int32 console_msg_log; //Specifies what error messages to log. [Ind]
 extern char console_log_filepath[32]; ///< Filepath to save console_msg_log. [Cydh]
 extern char timestamp_format[20]; //For displaying Timestamps [Skotlex]
+extern int32 console_async; ///< Write the messages from a background thread
+extern int32 console_rate_limit; ///< Identical messages shown per second, 0 for no limit
+extern int32 console_log_format; ///< Format of console_log_filepath, see e_console_log_format
+
+enum e_console_log_format {
+	CONSOLE_LOG_TEXT = 0,
+	CONSOLE_LOG_BINARY,
+};
 
 enum msg_type {
 	MSG_NONE,
@@ -87,6 +95,10 @@ enum msg_type {
 	MSG_FATALERROR
 };
 
+extern void showmsg_init(void);
+extern void showmsg_flush(void);
+extern void showmsg_crash(void);
+extern void showmsg_final(void);
 extern void ClearScreen(void);
 extern int32 _vShowMessage(enum msg_type flag, const char *string, va_list ap);
 extern void ShowMessage(const char *, ...);
@@ -598,6 +598,36 @@ int32 make_listen_bind(uint32 ip, uint16 port)
 	return fd;
 }
 
+/// Creates a session that is not connected to anything and is never polled.
+/// The data it reads has to be placed into its read buffer by the caller, the data it sends is passed to func_send.
+/// It still owns a socket handle, so that its fd does not collide with real connections and do_close works as usual.
+int32 make_virtual_session(SendFunc func_send, ParseFunc func_parse)
+{
+	int32 fd = sSocket(AF_INET, SOCK_STREAM, 0);
+
+	if( fd == -1 ){
+		ShowError("make_virtual_session: socket creation failed (%s)!\n", error_msg());
+		return -1;
+	}
+	if( fd == 0 ){// reserved
+		ShowError("make_virtual_session: Socket #0 is reserved - Please report this!!!\n");
+		sClose(fd);
+		return -1;
+	}
+	if( fd >= MAXCONN ){
+		ShowError("make_virtual_session: New socket #%d is greater than can we handle! Increase the value of MAXCONN (currently %d) for your OS.\n", fd, MAXCONN);
+		sClose(fd);
+		return -1;
+	}
+
+	if( fd_max <= fd ) fd_max = fd + 1;
+
+	create_session(fd, null_recv, func_send, func_parse);
+	session[fd]->client_addr = 0;
+
+	return fd;
+}
+
 int32 make_connection(uint32 ip, uint16 port, bool silent,int32 timeout) {
 	struct sockaddr_in remote_address;
 	int32 fd;
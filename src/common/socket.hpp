@@ -133,6 +133,7 @@ extern bool session_isActive(int32 fd);
 
 int32 make_listen_bind(uint32 ip, uint16 port);
 int32 make_connection(uint32 ip, uint16 port, bool silent, int32 timeout);
+int32 make_virtual_session(SendFunc func_send, ParseFunc func_parse);
 #define realloc_fifo( fd, rfifo_size, wfifo_size ) _realloc_fifo( ( fd ), ( rfifo_size ), ( wfifo_size ), ALC_MARK )
 #define realloc_writefifo( fd, addition ) _realloc_writefifo( ( fd ), ( addition ), ALC_MARK )
 int32 _realloc_fifo( int32 fd, uint32 rfifo_size, uint32 wfifo_size, const char* file, int32 line, const char* func );
@@ -0,0 +1,391 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#include "sqlworker.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include "showmsg.hpp"
+
+// MySQL 8.0 or later removed my_bool typedef.
+// Reintroduce it as a bandaid fix.
+// See https://bugs.mysql.com/?id=87337
+#if !defined(MARIADB_BASE_VERSION) && !defined(MARIADB_VERSION_ID) && MYSQL_VERSION_ID >= 80001 && MYSQL_VERSION_ID != 80002
+#define my_bool bool
+#endif
+
+SqlWorkerPool::SqlWorkerPool(){
+	this->terminate = false;
+	this->pending = 0;
+	this->executed = 0;
+	this->failed = 0;
+	this->max_duration = 0;
+}
+
+SqlWorkerPool::~SqlWorkerPool(){
+	this->finalize();
+}
+
+/**
+ * Opens the connections and starts the worker threads.
+ * Connections are established on the calling thread, so errors can be reported directly.
+ * @param count: amount of worker threads and connections, 0 keeps the pool disabled
+ * @return true on success, false if a connection could not be established
+ */
+bool SqlWorkerPool::initialize( uint16 count, const char* user, const char* passwd, const char* host, uint16 port, const char* db, const char* codepage ){
+	if( count == 0 || this->is_enabled() ){
+		return true;
+	}
+
+	this->terminate = false;
+
+	for( uint16 i = 0; i < count; i++ ){
+		MYSQL* connection = mysql_init( nullptr );
+
+		if( connection == nullptr ){
+			ShowError( "SqlWorkerPool: Failed to allocate connection %hu.\n", i );
+			this->finalize();
+			return false;
+		}
+
+		my_bool reconnect = 1;
+		mysql_options( connection, MYSQL_OPT_RECONNECT, &reconnect );
+
+#if !defined(MARIADB_BASE_VERSION) && !defined(MARIADB_VERSION_ID) && MYSQL_VERSION_ID >= 50710
+		uint32 md = SSL_MODE_DISABLED;
+
+		mysql_options( connection, MYSQL_OPT_SSL_MODE, &md );
+#endif
+
+		if( !mysql_real_connect( connection, host, user, passwd, db, (uint32)port, nullptr, 0 ) ){
+			ShowSQL( "SqlWorkerPool: %s\n", mysql_error( connection ) );
+			mysql_close( connection );
+			this->finalize();
+			return false;
+		}
+
+		if( codepage != nullptr && codepage[0] != '\0' && mysql_set_character_set( connection, codepage ) != 0 ){
+			ShowSQL( "SqlWorkerPool: %s\n", mysql_error( connection ) );
+		}
+
+		this->connections.push_back( connection );
+	}
+
+	for( MYSQL* connection : this->connections ){
+		this->threads.emplace_back( &SqlWorkerPool::run, this, connection );
+	}
+
+	ShowInfo( "Started " CL_WHITE "%hu" CL_RESET " SQL worker threads.\n", count );
+
+	return true;
+}
+
+/**
+ * Stops the worker threads after the queued queries were executed, runs the remaining callbacks and closes the connections.
+ */
+void SqlWorkerPool::finalize(){
+	{
+		std::lock_guard<std::mutex> lock( this->queued_mutex );
+
+		this->terminate = true;
+	}
+
+	this->queued_cv.notify_all();
+
+	for( std::thread& thread : this->threads ){
+		if( thread.joinable() ){
+			thread.join();
+		}
+	}
+
+	this->threads.clear();
+
+	// Deliver everything that finished while shutting down
+	this->process();
+
+	for( MYSQL* connection : this->connections ){
+		mysql_close( connection );
+	}
+
+	this->connections.clear();
+}
+
+bool SqlWorkerPool::is_enabled() const{
+	return !this->threads.empty();
+}
+
+/**
+ * Worker thread main loop.
+ * Must not use anything besides the MySQL client library and the standard library.
+ */
+void SqlWorkerPool::run( MYSQL* connection ){
+	mysql_thread_init();
+
+	while( true ){
+		s_job* job;
+
+		{
+			std::unique_lock<std::mutex> lock( this->queued_mutex );
+
+			this->queued_cv.wait( lock, [this](){ return this->terminate || !this->queued.empty(); } );
+
+			if( this->queued.empty() ){
+				// Terminating and nothing left to do
+				break;
+			}
+
+			job = this->queued.front();
+			this->queued.pop_front();
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		s_sql_worker_result& result = job->result;
+
+		if( mysql_real_query( connection, job->query.c_str(), (unsigned long)job->query.length() ) != 0 ){
+			result.success = false;
+			result.error_code = mysql_errno( connection );
+			result.error = mysql_error( connection );
+		}else{
+			MYSQL_RES* res = mysql_store_result( connection );
+
+			if( res == nullptr && mysql_field_count( connection ) != 0 ){
+				result.success = false;
+				result.error_code = mysql_errno( connection );
+				result.error = mysql_error( connection );
+			}else{
+				result.success = true;
+				result.affected_rows = (uint64)mysql_affected_rows( connection );
+				result.insert_id = (uint64)mysql_insert_id( connection );
+
+				if( res != nullptr ){
+					uint32 columns = mysql_num_fields( res );
+					MYSQL_ROW row;
+
+					result.rows.reserve( (size_t)mysql_num_rows( res ) );
+
+					while( ( row = mysql_fetch_row( res ) ) != nullptr ){
+						unsigned long* lengths = mysql_fetch_lengths( res );
+						std::vector<std::string> values;
+
+						values.reserve( columns );
+
+						for( uint32 i = 0; i < columns; i++ ){
+							if( row[i] != nullptr ){
+								values.emplace_back( row[i], lengths[i] );
+							}else{
+								values.emplace_back();
+							}
+						}
+
+						result.rows.push_back( std::move( values ) );
+					}
+
+					mysql_free_result( res );
+				}
+			}
+		}
+
+		result.duration = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - start ).count();
+
+		std::lock_guard<std::mutex> lock( this->completed_mutex );
+
+		this->completed.push_back( job );
+	}
+
+	mysql_thread_end();
+}
+
+/**
+ * Queues a query for execution on a worker thread.
+ * The callback is run on the main thread from process(), after the query was executed.
+ * @param query: complete query, any user input must already be escaped
+ * @param callback: function to call with the result, can be nullptr
+ */
+void SqlWorkerPool::enqueue( const std::string& query, t_callback callback ){
+	s_job* job = new s_job();
+
+	job->query = query;
+	job->callback = callback;
+	job->result.success = false;
+	job->result.error_code = 0;
+	job->result.affected_rows = 0;
+	job->result.insert_id = 0;
+	job->result.duration = 0;
+
+	this->pending++;
+
+	{
+		std::lock_guard<std::mutex> lock( this->queued_mutex );
+
+		this->queued.push_back( job );
+	}
+
+	this->queued_cv.notify_one();
+}
+
+/**
+ * Runs the callbacks of all completed queries.
+ * Must be called from the main thread.
+ * @return amount of completed queries
+ */
+size_t SqlWorkerPool::process(){
+	std::deque<s_job*> jobs;
+
+	{
+		std::lock_guard<std::mutex> lock( this->completed_mutex );
+
+		jobs.swap( this->completed );
+	}
+
+	for( s_job* job : jobs ){
+		this->pending--;
+		this->executed++;
+
+		if( !job->result.success ){
+			this->failed++;
+			ShowSQL( "SqlWorkerPool: DB error - %s (%u)\n", job->result.error.c_str(), job->result.error_code );
+			ShowDebug( "SqlWorkerPool: Query: %s\n", job->query.c_str() );
+		}
+
+		if( job->result.duration > this->max_duration ){
+			this->max_duration = job->result.duration;
+		}
+
+		if( job->callback != nullptr ){
+			job->callback( job->result );
+		}
+
+		delete job;
+	}
+
+	return jobs.size();
+}
+
+/**
+ * Blocks until all queued queries were executed and their callbacks were run.
+ * Must be called from the main thread.
+ */
+void SqlWorkerPool::wait(){
+	while( this->process() > 0 || this->pending > 0 ){
+		if( this->pending > 0 ){
+			std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+		}
+	}
+}
+
+size_t SqlWorkerPool::get_pending() const{
+	return this->pending;
+}
+
+uint64 SqlWorkerPool::get_executed() const{
+	return this->executed;
+}
+
+uint64 SqlWorkerPool::get_failed() const{
+	return this->failed;
+}
+
+t_tick SqlWorkerPool::get_max_duration() const{
+	return this->max_duration;
+}
+
+/**
+ * Converts a column of a result into a buffer, like SqlStmt::BindColumn does for statements.
+ * Integers are written with the size of the data type, strings and enums are nul-terminated and blobs are
+ * cleared behind the data.
+ * @param data: column as returned in s_sql_worker_result::rows
+ * @param type: data type of the buffer
+ * @param buffer: buffer to write the column to
+ * @param buffer_len: length of the buffer, only needed for strings, enums and blobs
+ * @return false if the data type is not supported or the column does not fit into the buffer
+ */
+bool SqlWorkerPool::get_column( const std::string& data, SqlDataType type, void* buffer, size_t buffer_len ){
+	switch( type ){
+		case SQLDT_INT8:
+		case SQLDT_CHAR: {
+			int8 value = (int8)strtol( data.c_str(), nullptr, 10 );
+			memcpy( buffer, &value, sizeof( value ) );
+			return true;
+		}
+		case SQLDT_UINT8:
+		case SQLDT_UCHAR: {
+			uint8 value = (uint8)strtoul( data.c_str(), nullptr, 10 );
+			memcpy( buffer, &value, sizeof( value ) );
+			return true;
+		}
+		case SQLDT_INT16: {
+			int16 value = (int16)strtol( data.c_str(), nullptr, 10 );
+			memcpy( buffer, &value, sizeof( value ) );
+			return true;
+		}
+		case SQLDT_UINT16: {
+			uint16 value = (uint16)strtoul( data.c_str(), nullptr, 10 );
+			memcpy( buffer, &value, sizeof( value ) );
+			return true;
+		}
+		case SQLDT_INT32: {
+			int32 value = (int32)strtoll( data.c_str(), nullptr, 10 );
+			memcpy( buffer, &value, sizeof( value ) );
+			return true;
+		}
+		case SQLDT_UINT32: {
+			uint32 value = (uint32)strtoull( data.c_str(), nullptr, 10 );
+			memcpy( buffer, &value, sizeof( value ) );
+			return true;
+		}
+		case SQLDT_INT64:
+		case SQLDT_LONGLONG: {
+			int64 value = strtoll( data.c_str(), nullptr, 10 );
+			memcpy( buffer, &value, sizeof( value ) );
+			return true;
+		}
+		case SQLDT_UINT64:
+		case SQLDT_ULONGLONG: {
+			uint64 value = strtoull( data.c_str(), nullptr, 10 );
+			memcpy( buffer, &value, sizeof( value ) );
+			return true;
+		}
+		case SQLDT_LONG: {
+			long value = strtol( data.c_str(), nullptr, 10 );
+			memcpy( buffer, &value, sizeof( value ) );
+			return true;
+		}
+		case SQLDT_ULONG: {
+			unsigned long value = strtoul( data.c_str(), nullptr, 10 );
+			memcpy( buffer, &value, sizeof( value ) );
+			return true;
+		}
+		case SQLDT_FLOAT: {
+			float value = strtof( data.c_str(), nullptr );
+			memcpy( buffer, &value, sizeof( value ) );
+			return true;
+		}
+		case SQLDT_DOUBLE: {
+			double value = strtod( data.c_str(), nullptr );
+			memcpy( buffer, &value, sizeof( value ) );
+			return true;
+		}
+		case SQLDT_STRING:
+		case SQLDT_ENUM:
+			// Room for the nul-terminator
+			if( buffer_len < 1 || data.length() > buffer_len - 1 ){
+				return false;
+			}
+
+			memcpy( buffer, data.c_str(), data.length() );
+			memset( (char*)buffer + data.length(), 0, buffer_len - data.length() );
+			return true;
+		case SQLDT_BLOB:
+			if( data.length() > buffer_len ){
+				return false;
+			}
+
+			memcpy( buffer, data.data(), data.length() );
+			memset( (char*)buffer + data.length(), 0, buffer_len - data.length() );
+			return true;
+		default:
+			return false;
+	}
+}
@@ -0,0 +1,92 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#ifndef SQLWORKER_HPP
+#define SQLWORKER_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef WIN32
+#include "winapi.hpp"
+#endif
+
+#include <mysql.h>
+
+#include "cbasetypes.hpp"
+#include "sql.hpp"
+#include "timer.hpp"
+
+/// Result of a query executed by a SqlWorkerPool.
+/// NULL columns are returned as empty strings.
+struct s_sql_worker_result{
+	bool success;
+	uint32 error_code;
+	std::string error;
+	uint64 affected_rows;
+	uint64 insert_id;
+	std::vector<std::vector<std::string>> rows;
+	t_tick duration; ///< Time the query spent on the worker in milliseconds
+};
+
+/// Pool of SQL connections served by background threads.
+///
+/// Queries are queued by the main thread and executed by one of the worker threads on its own connection.
+/// Results are handed back to the main thread, which runs the callbacks from process().
+/// The workers only use the MySQL client library and the standard library: they never touch
+/// the memory manager, showmsg or any server state, so callbacks are the only place where results
+/// may be applied to the server.
+class SqlWorkerPool{
+public:
+	typedef std::function<void( s_sql_worker_result& result )> t_callback;
+
+private:
+	struct s_job{
+		std::string query;
+		t_callback callback;
+		s_sql_worker_result result;
+	};
+
+	std::vector<std::thread> threads;
+	std::vector<MYSQL*> connections;
+	std::deque<s_job*> queued;
+	std::deque<s_job*> completed;
+	std::mutex queued_mutex;
+	std::mutex completed_mutex;
+	std::condition_variable queued_cv;
+	bool terminate;
+	size_t pending;
+
+	// Statistics
+	uint64 executed;
+	uint64 failed;
+	t_tick max_duration;
+
+	void run( MYSQL* connection );
+
+public:
+	SqlWorkerPool();
+	~SqlWorkerPool();
+
+	bool initialize( uint16 count, const char* user, const char* passwd, const char* host, uint16 port, const char* db, const char* codepage );
+	void finalize();
+	bool is_enabled() const;
+
+	void enqueue( const std::string& query, t_callback callback );
+	size_t process();
+	void wait();
+
+	size_t get_pending() const;
+	uint64 get_executed() const;
+	uint64 get_failed() const;
+	t_tick get_max_duration() const;
+
+	static bool get_column( const std::string& data, SqlDataType type, void* buffer, size_t buffer_len = 0 );
+};
+
+#endif /* SQLWORKER_HPP */
@@ -11,6 +11,7 @@
 #include "db.hpp"
 #include "malloc.hpp"
 #include "nullpo.hpp"
+#include "profiler.hpp"
 #include "showmsg.hpp"
 #include "utils.hpp"
 #ifdef WIN32
@@ -94,6 +95,12 @@ const char* search_timer_func_list(TimerFunc func)
 	return "unknown timer function";
 }
 
+/// Resolves the name of a timer function for the profiler.
+static const char* timer_profiler_name(uintptr_t key)
+{
+	return search_timer_func_list(reinterpret_cast<TimerFunc>(key));
+}
+
 /*----------------------------
  * 	Get tick time
  *----------------------------*/
@@ -143,9 +150,16 @@ static void rdtsc_calibrate(){
 
 #endif
 
+/// Virtual clock that replaces the system clock while packets are replayed
+static bool tick_virtual = false;
+static t_tick tick_virtual_now = 0;
+
 /// platform-abstracted tick retrieval
 static t_tick tick(void)
 {
+	if( tick_virtual )
+		return tick_virtual_now;
+
 #if defined(ENABLE_RDTSC)
 	// RDTSC: Returns the number of CPU cycles since reset. Unreliable if the CPU frequency is variable.
 	return static_cast<t_tick>( ( __rdtsc() - rdtsc_begintick ) / rdtsc_clock );
@@ -201,6 +215,17 @@ t_tick gettick(void)
 #endif
 //////////////////////////////////////////////////////////////////////////
 
+/// Stops the clock at the given tick, it only advances by further calls.
+/// Used to replay recorded traffic deterministically.
+void timer_set_virtual_tick(t_tick now)
+{
+	tick_virtual = true;
+	tick_virtual_now = now;
+
+	// drop the cached tick
+	gettick_nocache();
+}
+
 /*======================================
  * 	CORE : Timer Heap
  *--------------------------------------*/
@@ -373,11 +398,17 @@ t_tick do_timer(t_tick tick)
 
 		if( timer_data[tid].func )
 		{
+			TimerFunc func = timer_data[tid].func;
+			uint64 start = profiler_enabled ? profiler_clock() : 0;
+
 			if( diff < -1000 )
 				// timer was delayed for more than 1 second, use current tick instead
-				timer_data[tid].func(tid, tick, timer_data[tid].id, timer_data[tid].data);
+				func(tid, tick, timer_data[tid].id, timer_data[tid].data);
 			else
-				timer_data[tid].func(tid, timer_data[tid].tick, timer_data[tid].id, timer_data[tid].data);
+				func(tid, timer_data[tid].tick, timer_data[tid].id, timer_data[tid].data);
+
+			if( profiler_enabled )
+				profiler_record(PROFILER_TIMER, reinterpret_cast<uintptr_t>(func), start, timer_profiler_name);
 		}
 
 		// in the case the function didn't change anything...
@@ -50,6 +50,7 @@ struct TimerData {
 
 t_tick gettick(void);
 t_tick gettick_nocache(void);
+void timer_set_virtual_tick(t_tick now);
 
 int32 add_timer(t_tick tick, TimerFunc func, int32 id, intptr_t data);
 int32 add_timer_interval(t_tick tick, TimerFunc func, int32 id, intptr_t data, int32 interval);
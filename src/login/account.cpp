@@ -6,6 +6,9 @@
 #include <algorithm> //min / max
 #include <cstdlib>
 #include <cstring>
+#include <list>
+#include <string>
+#include <unordered_map>
 
 #include <common/malloc.hpp>
 #include <common/mmo.hpp>
@@ -35,6 +38,10 @@ typedef struct AccountDB_SQL {
 	char account_db[32];
 	char global_acc_reg_num_table[32];
 	char global_acc_reg_str_table[32];
+	// userid -> account_id cache, most recently used first
+	size_t userid_cache_size = 10000;
+	std::list<std::pair<std::string, uint32>> userid_cache_order;
+	std::unordered_map<std::string, std::list<std::pair<std::string, uint32>>::iterator> userid_cache;
 
 } AccountDB_SQL;
 
@@ -69,6 +76,7 @@ bool account_db_sql_disable_monitor_vip( AccountDB* self, const uint32 account_i
 #endif
 
 static bool mmo_auth_fromsql(AccountDB_SQL* db, struct mmo_account* acc, uint32 account_id);
+static void account_db_sql_cache_remove(AccountDB_SQL* db, uint32 account_id);
 static bool mmo_auth_tosql(AccountDB_SQL* db, const struct mmo_account* acc, bool is_new, bool refresh_token);
 
 /// public constructor
@@ -215,6 +223,9 @@ static bool account_db_sql_get_property(AccountDB* self, const char* key, char*
 		else
 		if( strcmpi(key, "case_sensitive") == 0 )
 			safesnprintf(buf, buflen, "%d", (db->case_sensitive ? 1 : 0));
+		else
+		if( strcmpi(key, "userid_cache_size") == 0 )
+			safesnprintf(buf, buflen, "%" PRIuPTR, db->userid_cache_size);
 		else
 			return false;// not found
 		return true;
@@ -274,6 +285,9 @@ static bool account_db_sql_set_property(AccountDB* self, const char* key, const
 		else
 		if( strcmpi(key, "case_sensitive") == 0 )
 			db->case_sensitive = (config_switch(value)==1);
+		else
+		if( strcmpi(key, "userid_cache_size") == 0 )
+			db->userid_cache_size = (size_t)strtoul(value, nullptr, 10);
 		else
 			return false;// not found
 		return true;
@@ -357,6 +371,8 @@ static bool account_db_sql_remove(AccountDB* self, const uint32 account_id) {
 
 	result &= ( SQL_SUCCESS == Sql_QueryStr(sql_handle, (result == true) ? "COMMIT" : "ROLLBACK") );
 
+	account_db_sql_cache_remove(db, account_id);
+
 	return result;
 }
 
@@ -400,6 +416,29 @@ static bool account_db_sql_load_str(AccountDB* self, struct mmo_account* acc, co
 	uint32 account_id;
 	char* data;
 
+	std::string key( userid, strnlen( userid, NAME_LENGTH ) );
+
+	if( !db->case_sensitive ){
+		std::transform( key.begin(), key.end(), key.begin(), []( char c ){ return (char)TOLOWER( c ); } );
+	}
+
+	if( db->userid_cache_size > 0 ){
+		auto it = db->userid_cache.find( key );
+
+		if( it != db->userid_cache.end() ){
+			account_id = it->second->second;
+
+			// The account might have been renamed or deleted by someone else in the meantime
+			if( account_db_sql_load_num(self, acc, account_id) && ( db->case_sensitive ? strcmp(acc->userid, userid) : strcmpi(acc->userid, userid) ) == 0 ){
+				db->userid_cache_order.splice( db->userid_cache_order.begin(), db->userid_cache_order, it->second );
+				return true;
+			}
+
+			db->userid_cache_order.erase( it->second );
+			db->userid_cache.erase( it );
+		}
+	}
+
 	Sql_EscapeString(sql_handle, esc_userid, userid);
 
 	// get the list of account IDs for this user ID
@@ -425,10 +464,36 @@ static bool account_db_sql_load_str(AccountDB* self, struct mmo_account* acc, co
 
 	Sql_GetData(sql_handle, 0, &data, nullptr);
 	account_id = atoi(data);
+	Sql_FreeResult(sql_handle);
+
+	if( db->userid_cache_size > 0 ){
+		db->userid_cache_order.emplace_front( key, account_id );
+		db->userid_cache[key] = db->userid_cache_order.begin();
+
+		while( db->userid_cache.size() > db->userid_cache_size ){
+			db->userid_cache.erase( db->userid_cache_order.back().first );
+			db->userid_cache_order.pop_back();
+		}
+	}
 
 	return account_db_sql_load_num(self, acc, account_id);
 }
 
+/**
+ * Drop an account from the userid cache.
+ * @param db: pointer to db
+ * @param account_id: id of user account
+ */
+static void account_db_sql_cache_remove(AccountDB_SQL* db, uint32 account_id) {
+	for( auto it = db->userid_cache_order.begin(); it != db->userid_cache_order.end(); ++it ){
+		if( it->second == account_id ){
+			db->userid_cache.erase( it->first );
+			db->userid_cache_order.erase( it );
+			return;
+		}
+	}
+}
+
 /**
  * Create a new forward iterator.
  * @param self: pointer to db iterator
@@ -5,15 +5,19 @@
 
 #include <cstdlib>
 #include <cstring>
+#include <ctime>
+#include <deque>
+#include <string>
+#include <unordered_map>
 
 #include <common/cbasetypes.hpp>
 #include <common/showmsg.hpp>
 #include <common/sql.hpp>
+#include <common/sqlworker.hpp>
 #include <common/strlib.hpp>
 #include <common/timer.hpp>
 
 #include "login.hpp"
-#include "loginlog.hpp"
 
 
 std::string ipban_db_hostname = "127.0.0.1";
@@ -23,44 +27,98 @@ std::string ipban_db_password = "";
 std::string ipban_db_database = "ragnarok";
 std::string ipban_codepage = "";
 std::string ipban_table = "ipbanlist";
+uint32 ipban_refresh_interval = 10;
 
 // globals
 static Sql* sql_handle = nullptr;
+static SqlWorkerPool ipban_sql_workers;
 static int32 cleanup_timer_id = INVALID_TIMER;
+static int32 refresh_timer_id = INVALID_TIMER;
 static bool ipban_inited = false;
 
+/// Active bans, ban mask ("a.b.*.*") -> time of release
+static std::unordered_map<std::string, time_t> ipban_list;
+/// Recent password failures, ip -> time of each failure
+static std::unordered_map<uint32, std::deque<time_t>> ipban_failures;
+
 //early declaration
 TIMER_FUNC(ipban_cleanup);
+TIMER_FUNC(ipban_refresh);
+
+/**
+ * Replace the in-memory ban list with the result of ipban_refresh's query.
+ * @param rows: rows of `list` and remaining seconds of the ban
+ */
+static void ipban_list_load(const std::vector<std::vector<std::string>>& rows) {
+	time_t now = time(nullptr);
+
+	ipban_list.clear();
+
+	for( const std::vector<std::string>& row : rows ){
+		time_t release = now + strtol(row[1].c_str(), nullptr, 10);
+		auto it = ipban_list.find(row[0]);
+
+		if( it == ipban_list.end() || it->second < release )
+			ipban_list[row[0]] = release;
+	}
+}
+
+/**
+ * Add a ban to the in-memory ban list and store it in the ipban table.
+ * @param ip: ipv4 ip, the last byte is masked
+ * @param minutes: duration of the ban
+ */
+static void ipban_add(uint32 ip, uint32 minutes) {
+	uint8* p = (uint8*)&ip;
+	char mask[16];
+
+	safesnprintf(mask, sizeof(mask), "%u.%u.%u.*", p[3], p[2], p[1]);
+	ipban_list[mask] = time(nullptr) + minutes * 60;
+
+	if( ipban_sql_workers.is_enabled() ){
+		char query[256];
+
+		safesnprintf(query, sizeof(query), "INSERT INTO `%s`(`list`,`btime`,`rtime`,`reason`) VALUES ('%s', NOW() , NOW() +  INTERVAL %u MINUTE ,'Password error ban')",
+			ipban_table.c_str(), mask, minutes);
+		ipban_sql_workers.enqueue(query, nullptr);
+	}
+	else if( SQL_ERROR == Sql_Query(sql_handle, "INSERT INTO `%s`(`list`,`btime`,`rtime`,`reason`) VALUES ('%s', NOW() , NOW() +  INTERVAL %u MINUTE ,'Password error ban')",
+		ipban_table.c_str(), mask, minutes) )
+		Sql_ShowDebug(sql_handle);
+}
 
 /**
  * Check if ip is in the active bans list.
+ *  Served from memory, the list is reloaded from the ipban table every ipban_refresh_interval.
  * @param ip: ipv4 ip to check if ban
- * @return true if found or error, false if not in list
+ * @return true if found, false if not in list
  */
 bool ipban_check(uint32 ip) {
 	uint8* p = (uint8*)&ip;
-	char* data = nullptr;
-	int32 matches;
+	char masks[4][16];
+	time_t now;
 
 	if( !login_config.ipban )
 		return false;// ipban disabled
 
-	if( SQL_ERROR == Sql_Query(sql_handle, "SELECT count(*) FROM `%s` WHERE `rtime` > NOW() AND (`list` = '%u.*.*.*' OR `list` = '%u.%u.*.*' OR `list` = '%u.%u.%u.*' OR `list` = '%u.%u.%u.%u')",
-		ipban_table.c_str(), p[3], p[3], p[2], p[3], p[2], p[1], p[3], p[2], p[1], p[0]) )
-	{
-		Sql_ShowDebug(sql_handle);
-		// close connection because we can't verify their connectivity.
-		return true;
-	}
+	if( ipban_list.empty() )
+		return false;
 
-	if( SQL_ERROR == Sql_NextRow(sql_handle) )
-		return true;// Shouldn't happen, but just in case...
+	safesnprintf(masks[0], sizeof(masks[0]), "%u.*.*.*", p[3]);
+	safesnprintf(masks[1], sizeof(masks[1]), "%u.%u.*.*", p[3], p[2]);
+	safesnprintf(masks[2], sizeof(masks[2]), "%u.%u.%u.*", p[3], p[2], p[1]);
+	safesnprintf(masks[3], sizeof(masks[3]), "%u.%u.%u.%u", p[3], p[2], p[1], p[0]);
 
-	Sql_GetData(sql_handle, 0, &data, nullptr);
-	matches = atoi(data);
-	Sql_FreeResult(sql_handle);
+	now = time(nullptr);
+
+	for( const char* mask : masks ){
+		auto it = ipban_list.find(mask);
 
-	return( matches > 0 );
+		if( it != ipban_list.end() && it->second > now )
+			return true;
+	}
+
+	return false;
 }
 
 /**
@@ -69,21 +127,23 @@ bool ipban_check(uint32 ip) {
  * @param ip: ipv4 ip to record the failure
  */
 void ipban_log(uint32 ip) {
-	unsigned long failures;
+	time_t now;
 
 	if( !login_config.ipban )
 		return;// ipban disabled
 
-	failures = loginlog_failedattempts(ip, login_config.dynamic_pass_failure_ban_interval);// how many times failed account? in one ip.
+	// how many times failed account? in one ip.
+	std::deque<time_t>& failures = ipban_failures[ip];
+
+	now = time(nullptr);
+	failures.push_back(now);
+
+	while( !failures.empty() && failures.front() <= now - (time_t)login_config.dynamic_pass_failure_ban_interval * 60 )
+		failures.pop_front();
 
 	// if over the limit, add a temporary ban entry
-	if( failures >= login_config.dynamic_pass_failure_ban_limit )
-	{
-		uint8* p = (uint8*)&ip;
-		if( SQL_ERROR == Sql_Query(sql_handle, "INSERT INTO `%s`(`list`,`btime`,`rtime`,`reason`) VALUES ('%u.%u.%u.*', NOW() , NOW() +  INTERVAL %d MINUTE ,'Password error ban')",
-			ipban_table.c_str(), p[3], p[2], p[1], login_config.dynamic_pass_failure_ban_duration) )
-			Sql_ShowDebug(sql_handle);
-	}
+	if( failures.size() >= login_config.dynamic_pass_failure_ban_limit )
+		ipban_add(ip, login_config.dynamic_pass_failure_ban_duration);
 }
 
 /**
@@ -97,15 +157,97 @@ void ipban_log(uint32 ip) {
  * @return 0
  */
 TIMER_FUNC(ipban_cleanup){
+	time_t now;
+
+	if( !login_config.ipban )
+		return 0;// ipban disabled
+
+	if( ipban_sql_workers.is_enabled() ){
+		char query[128];
+
+		safesnprintf(query, sizeof(query), "DELETE FROM `%s` WHERE `rtime` <= NOW()", ipban_table.c_str());
+		ipban_sql_workers.enqueue(query, nullptr);
+	}
+	else if( SQL_ERROR == Sql_Query(sql_handle, "DELETE FROM `%s` WHERE `rtime` <= NOW()", ipban_table.c_str()) )
+		Sql_ShowDebug(sql_handle);
+
+	now = time(nullptr);
+
+	for( auto it = ipban_list.begin(); it != ipban_list.end(); ){
+		if( it->second <= now )
+			it = ipban_list.erase(it);
+		else
+			++it;
+	}
+
+	for( auto it = ipban_failures.begin(); it != ipban_failures.end(); ){
+		if( it->second.back() <= now - (time_t)login_config.dynamic_pass_failure_ban_interval * 60 )
+			it = ipban_failures.erase(it);
+		else
+			++it;
+	}
+
+	return 0;
+}
+
+/**
+ * Timered function to reload the active bans into memory.
+ *  Picks up bans that were added to the ipban table by other tools.
+ *  Performed each ipban_refresh_interval.
+ * @param tid: timer id
+ * @param tick: tick of execution
+ * @param id: unused
+ * @param data: unused
+ * @return 0
+ */
+TIMER_FUNC(ipban_refresh){
+	char query[256];
+
 	if( !login_config.ipban )
 		return 0;// ipban disabled
 
-	if( SQL_ERROR == Sql_Query(sql_handle, "DELETE FROM `%s` WHERE `rtime` <= NOW()", ipban_table.c_str()) )
+	safesnprintf(query, sizeof(query), "SELECT `list`, TIMESTAMPDIFF(SECOND, NOW(), `rtime`) FROM `%s` WHERE `rtime` > NOW()", ipban_table.c_str());
+
+	if( ipban_sql_workers.is_enabled() ){
+		ipban_sql_workers.enqueue(query, []( s_sql_worker_result& result ){
+			if( result.success )
+				ipban_list_load(result.rows);
+		});
+		return 0;
+	}
+
+	if( SQL_ERROR == Sql_QueryStr(sql_handle, query) ){
 		Sql_ShowDebug(sql_handle);
+		return 0;
+	}
+
+	std::vector<std::vector<std::string>> rows;
+
+	while( SQL_SUCCESS == Sql_NextRow(sql_handle) ){
+		char* list;
+		char* remaining;
+
+		Sql_GetData(sql_handle, 0, &list, nullptr);
+		Sql_GetData(sql_handle, 1, &remaining, nullptr);
+		rows.push_back({ list, remaining });
+	}
+
+	Sql_FreeResult(sql_handle);
+	ipban_list_load(rows);
 
 	return 0;
 }
 
+/**
+ * Run the callbacks of finished asynchronous queries.
+ * @return amount of queries still running
+ */
+size_t ipban_process(void) {
+	ipban_sql_workers.process();
+
+	return ipban_sql_workers.get_pending();
+}
+
 /**
  * Read configuration options.
  * @param key: config keyword
@@ -165,6 +307,9 @@ bool ipban_config_read(const char* key, const char* value) {
 		else
 		if( strcmpi(key, "dynamic_pass_failure_ban_duration") == 0 )
 			login_config.dynamic_pass_failure_ban_duration = atoi(value);
+		else
+		if( strcmpi(key, "refresh_interval") == 0 )
+			ipban_refresh_interval = (uint32)strtoul(value, nullptr, 10);
 		else
 			return false;// not found
 		return true;
@@ -202,6 +347,18 @@ void ipban_init(void) {
 	if( !ipban_codepage.empty() && SQL_ERROR == Sql_SetEncoding(sql_handle, ipban_codepage.c_str()) )
 		Sql_ShowDebug(sql_handle);
 
+	// load the active bans before the first client is accepted
+	ipban_refresh(0,0,0,0);
+
+	if( login_config.sql_async_writes && !ipban_sql_workers.initialize(1, ipban_db_username.c_str(), ipban_db_password.c_str(), ipban_db_hostname.c_str(), ipban_db_port, ipban_db_database.c_str(), ipban_codepage.c_str()) )
+		ShowWarning("Failed to start the ipban SQL worker, using synchronous queries.\n");
+
+	if( ipban_refresh_interval > 0 )
+	{
+		add_timer_func_list(ipban_refresh, "ipban_refresh");
+		refresh_timer_id = add_timer_interval(gettick()+ipban_refresh_interval*1000, ipban_refresh, 0, 0, ipban_refresh_interval*1000);
+	}
+
 	if( login_config.ipban_cleanup_interval > 0 )
 	{ // set up periodic cleanup of connection history and active bans
 		add_timer_func_list(ipban_cleanup, "ipban_cleanup");
@@ -222,8 +379,16 @@ void ipban_final(void) {
 		// release data
 		delete_timer(cleanup_timer_id, ipban_cleanup);
 
+	if( ipban_refresh_interval > 0 )
+		delete_timer(refresh_timer_id, ipban_refresh);
+
 	ipban_cleanup(0,0,0,0); // always clean up on login-server stop
 
+	// wait for the queued writes
+	ipban_sql_workers.finalize();
+	ipban_list.clear();
+	ipban_failures.clear();
+
 	// close connections
 	Sql_Free(sql_handle);
 	sql_handle = nullptr;
@@ -9,7 +9,7 @@
 /**
  * Check if ip is in the active bans list.
  * @param ip: ipv4 ip to check if ban
- * @return true if found or error, false if not in list
+ * @return true if found, false if not in list
  */
 bool ipban_check(uint32 ip);
 
@@ -20,6 +20,12 @@ bool ipban_check(uint32 ip);
  */
 void ipban_log(uint32 ip);
 
+/**
+ * Run the callbacks of finished asynchronous queries.
+ * @return amount of queries still running
+ */
+size_t ipban_process(void);
+
 /**
  * Read configuration options.
  * @param key: config keyword
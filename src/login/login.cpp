@@ -4,6 +4,7 @@
 #pragma warning(disable:4800)
 #include "login.hpp"
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <string>
@@ -632,6 +633,12 @@ bool login_config_read(const char* cfgName, bool normal) {
 			console_msg_log = atoi(w2);
 		else if  (strcmpi(w1, "console_log_filepath") == 0)
 			safestrncpy(console_log_filepath, w2, sizeof(console_log_filepath));
+		else if (strcmpi(w1, "console_log_format") == 0)
+			console_log_format = strcmpi(w2, "binary") == 0 ? CONSOLE_LOG_BINARY : CONSOLE_LOG_TEXT;
+		else if (strcmpi(w1, "console_async") == 0)
+			console_async = config_switch(w2);
+		else if (strcmpi(w1, "console_rate_limit") == 0)
+			console_rate_limit = cap_value(atoi(w2), 0, INT_MAX);
 		else if(!strcmpi(w1, "log_login"))
 			login_config.log_login = (bool)config_switch(w2);
 		else if(!strcmpi(w1, "new_account"))
@@ -658,6 +665,12 @@ bool login_config_read(const char* cfgName, bool normal) {
 			login_config.use_dnsbl = (bool)config_switch(w2);
 		else if(!strcmpi(w1, "dnsbl_servers"))
 			safestrncpy(login_config.dnsbl_servs, w2, sizeof(login_config.dnsbl_servs));
+		else if(!strcmpi(w1, "sql_async_writes"))
+			login_config.sql_async_writes = config_switch(w2) != 0;
+		else if(!strcmpi(w1, "auth_rate_limit"))
+			login_config.auth_rate_limit = (uint32)cap_value(atoi(w2), 0, INT_MAX);
+		else if(!strcmpi(w1, "auth_rate_burst"))
+			login_config.auth_rate_burst = (uint32)cap_value(atoi(w2), 1, INT_MAX);
 		else if(!strcmpi(w1, "ipban_cleanup_interval"))
 			login_config.ipban_cleanup_interval = (uint32)atoi(w2);
 		else if(!strcmpi(w1, "ip_sync_interval"))
@@ -772,6 +785,9 @@ void login_set_defaults() {
 	login_config.dynamic_pass_failure_ban_interval = 5;
 	login_config.dynamic_pass_failure_ban_limit = 7;
 	login_config.dynamic_pass_failure_ban_duration = 5;
+	login_config.sql_async_writes = true;
+	login_config.auth_rate_limit = 0;
+	login_config.auth_rate_burst = 100;
 	login_config.use_dnsbl = false;
 	safestrncpy(login_config.dnsbl_servs, "", sizeof(login_config.dnsbl_servs));
 	login_config.allowed_regs = 1;
@@ -843,6 +859,17 @@ void LoginServer::finalize(){
 	ShowStatus("Finished.\n");
 }
 
+void LoginServer::handle_main( t_tick next ){
+	size_t pending = ipban_process() + loginlog_process();
+
+	// Do not wait for network events longer than needed while clients wait for admission or queries are running
+	if( pending > 0 || logclif_admission_waiting() ){
+		next = std::min<t_tick>( next, LOGIN_POLL_INTERVAL );
+	}
+
+	do_sockets( next );
+}
+
 void LoginServer::handle_shutdown(){
 	ShowStatus("Shutting down...\n");
 	// TODO proper shutdown procedure; kick all characters, wait for acks, ...  [FlavioJS]
@@ -22,6 +22,7 @@ class LoginServer : public Core {
 	protected:
 		bool initialize( int32 argc, char* argv[] ) override;
 		void finalize() override;
+		void handle_main( t_tick next ) override;
 		void handle_shutdown() override;
 
 	public:
@@ -57,6 +58,7 @@ struct login_session_data {
 	int32 fd;				///socket of client
 
 	char web_auth_token[WEB_AUTH_TOKEN_LENGTH]; /// web authentication token
+	bool admitted;			/// authentication request passed the admission limit
 };
 
 #define MAX_SERVERS 5 //max number of mapserv that could be attach
@@ -78,6 +80,9 @@ struct client_hash_node {
 	struct client_hash_node *next;	///next entry
 };
 
+/// Maximum time in milliseconds to wait for network events while clients wait for admission or queries are running
+#define LOGIN_POLL_INTERVAL 10
+
 struct Login_Config {
 	uint32 login_ip;                                /// the address to bind to
 	uint16 login_port;                              /// the port to bind to
@@ -99,6 +104,9 @@ struct Login_Config {
 	uint32 dynamic_pass_failure_ban_interval;       /// how far to scan the loginlog for password failures in minutes
 	uint32 dynamic_pass_failure_ban_limit;          /// number of failures needed to trigger the ipban
 	uint32 dynamic_pass_failure_ban_duration;       /// duration of the ipban in minutes
+	bool sql_async_writes;                          /// write login logs and ipbans on background SQL connections ?
+	uint32 auth_rate_limit;                         /// authentication requests admitted per second (0: unlimited)
+	uint32 auth_rate_burst;                         /// authentication requests admitted at once after an idle period
 	bool use_dnsbl;                                 /// dns blacklist blocking ?
 	char dnsbl_servs[1024];                         /// comma-separated list of dnsbl servers
 
@@ -3,6 +3,7 @@
 
 #include "loginclif.hpp"
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 
@@ -497,6 +498,70 @@ public:
 	}
 } login_packet_db;
 
+/// Token bucket limiting the rate of authentication requests after a restart or during a flood
+static struct {
+	double tokens;
+	t_tick last_refill;
+	bool waiting;
+} logclif_admission;
+
+/**
+ * Check if a packet is an authentication request, which costs database work.
+ * @param command: packet id
+ * @return true if the packet has to pass the admission limit
+ */
+static bool logclif_is_auth_request(uint16 command){
+	switch( command ){
+		case HEADER_CA_LOGIN:
+		case HEADER_CA_LOGIN_PCBANG:
+		case HEADER_CA_LOGIN_CHANNEL:
+		case HEADER_CA_LOGIN2:
+		case HEADER_CA_LOGIN3:
+		case HEADER_CA_LOGIN4:
+		case HEADER_CA_SSO_LOGIN_REQ:
+		case HEADER_CT_AUTH:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/**
+ * Take a token from the admission bucket.
+ *  Requests that do not get a token stay in the receive buffer until the bucket is refilled.
+ * @return true if the request may be processed now
+ */
+static bool logclif_admission_take(void){
+	if( login_config.auth_rate_limit == 0 )
+		return true;
+
+	t_tick tick = gettick();
+
+	logclif_admission.tokens = std::min<double>( login_config.auth_rate_burst, logclif_admission.tokens + DIFF_TICK( tick, logclif_admission.last_refill ) * login_config.auth_rate_limit / 1000.0 );
+	logclif_admission.last_refill = tick;
+
+	if( logclif_admission.tokens < 1.0 ){
+		logclif_admission.waiting = true;
+		return false;
+	}
+
+	logclif_admission.tokens -= 1.0;
+
+	return true;
+}
+
+/**
+ * Check if authentication requests were held back by the admission limit since the last call.
+ * @return true if clients are waiting for admission
+ */
+bool logclif_admission_waiting(void){
+	bool waiting = logclif_admission.waiting;
+
+	logclif_admission.waiting = false;
+
+	return waiting;
+}
+
 /**
  * Entry point from client to log-server.
  * Function that checks incoming command, then splits it to the correct handler.
@@ -543,9 +608,19 @@ int32 logclif_parse(int32 fd) {
 			// Connection request of a char-server
 			case 0x2710: logclif_parse_reqcharconnec(fd,sd, ip); return 0; // processing will continue elsewhere
 			default:
+				if( !sd->admitted && logclif_is_auth_request( command ) ){
+					if( !logclif_admission_take() ){
+						return 0; // wait for the next token
+					}
+
+					sd->admitted = true;
+				}
+
 				if( !login_packet_db.handle( fd, *sd ) ){
 					return 0;
 				}
+
+				sd->admitted = false;
 				break;
 		}
 	}
@@ -560,7 +635,9 @@ int32 logclif_parse(int32 fd) {
  * Launched at login-serv start, create db or other long scope variable here.
  */
 void do_init_loginclif(void){
-	return;
+	logclif_admission.tokens = login_config.auth_rate_burst;
+	logclif_admission.last_refill = gettick();
+	logclif_admission.waiting = false;
 }
 
 /**
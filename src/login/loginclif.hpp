@@ -14,6 +14,12 @@
  */
 int32 logclif_parse(int32 fd);
 
+/**
+ * Check if authentication requests were held back by the admission limit since the last call.
+ * @return true if clients are waiting for admission
+ */
+bool logclif_admission_waiting(void);
+
 /**
  * Initialize the module.
  * Launched at login-serv start, create db or other long scope variable here.
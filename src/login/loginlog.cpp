@@ -11,8 +11,11 @@
 #include <common/showmsg.hpp>
 #include <common/socket.hpp>
 #include <common/sql.hpp>
+#include <common/sqlworker.hpp>
 #include <common/strlib.hpp>
 
+#include "login.hpp" // login_config
+
 
 std::string log_db_hostname = "127.0.0.1";
 uint16 log_db_port = 3306;
@@ -23,6 +26,7 @@ std::string log_login_db = "loginlog";
 std::string log_codepage = "";
 
 static Sql* sql_handle = nullptr;
+static SqlWorkerPool loginlog_sql_workers;
 static bool enabled = false;
 
 
@@ -71,6 +75,15 @@ void login_log(uint32 ip, const char* username, int32 rcode, const char* message
 	Sql_EscapeStringLen(sql_handle, esc_username, username, strnlen(username, NAME_LENGTH));
 	Sql_EscapeStringLen(sql_handle, esc_message, message, strnlen(message, 255));
 
+	if( loginlog_sql_workers.is_enabled() ){
+		char query[1024];
+
+		safesnprintf(query, sizeof(query), "INSERT INTO `%s`(`time`,`ip`,`user`,`rcode`,`log`) VALUES (NOW(), '%s', '%s', '%d', '%s')",
+			log_login_db.c_str(), ip2str(ip,nullptr), esc_username, rcode, esc_message);
+		loginlog_sql_workers.enqueue(query, nullptr);
+		return;
+	}
+
 	retcode = Sql_Query(sql_handle,
 		"INSERT INTO `%s`(`time`,`ip`,`user`,`rcode`,`log`) VALUES (NOW(), '%s', '%s', '%d', '%s')",
 		log_login_db.c_str(), ip2str(ip,nullptr), esc_username, rcode, esc_message);
@@ -79,6 +92,16 @@ void login_log(uint32 ip, const char* username, int32 rcode, const char* message
 		Sql_ShowDebug(sql_handle);
 }
 
+/**
+ * Run the callbacks of finished asynchronous queries.
+ * @return amount of queries still running
+ */
+size_t loginlog_process(void) {
+	loginlog_sql_workers.process();
+
+	return loginlog_sql_workers.get_pending();
+}
+
 /**
  * Read configuration options.
  * @param key: config keyword
@@ -135,6 +158,9 @@ bool loginlog_init(void) {
 	if( !log_codepage.empty() && SQL_ERROR == Sql_SetEncoding(sql_handle, log_codepage.c_str()) )
 		Sql_ShowDebug(sql_handle);
 
+	if( login_config.sql_async_writes && !loginlog_sql_workers.initialize(1, log_db_username.c_str(), log_db_password.c_str(), log_db_hostname.c_str(), log_db_port, log_db_database.c_str(), log_codepage.c_str()) )
+		ShowWarning("Failed to start the login log SQL worker, using synchronous queries.\n");
+
 	enabled = true;
 
 	return true;
@@ -147,6 +173,10 @@ bool loginlog_init(void) {
  * @return true success
  */
 bool loginlog_final(void) {
+	// wait for the queued log entries
+	loginlog_sql_workers.finalize();
+	enabled = false;
+
 	Sql_Free(sql_handle);
 	sql_handle = nullptr;
 	return true;
@@ -25,6 +25,12 @@ unsigned long loginlog_failedattempts(uint32 ip, uint32 minutes);
  */
 void login_log(uint32 ip, const char* username, int32 rcode, const char* message);
 
+/**
+ * Run the callbacks of finished asynchronous queries.
+ * @return amount of queries still running
+ */
+size_t loginlog_process(void);
+
 /**
  * Read configuration options.
  * @param key: config keyword
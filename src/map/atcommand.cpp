@@ -11,9 +11,11 @@
 #include <common/cbasetypes.hpp>
 #include <common/database.hpp>
 #include <common/cli.hpp>
+#include <common/ers.hpp>
 #include <common/malloc.hpp>
 #include <common/mmo.hpp>
 #include <common/nullpo.hpp>
+#include <common/profiler.hpp>
 #include <common/random.hpp>
 #include <common/showmsg.hpp>
 #include <common/socket.hpp>
@@ -24,6 +26,7 @@
 
 #include "achievement.hpp"
 #include "aura.hpp"
+#include "autocombat.hpp"
 #include "battle.hpp"
 #include "buyingstore.hpp"
 #include "channel.hpp"
@@ -55,6 +58,7 @@
 #include "rune.hpp"
 #include "script.hpp"
 #include "storage.hpp"
+#include "trace.hpp"
 #include "trade.hpp"
 #include "vending.hpp"
 
@@ -4386,6 +4390,16 @@ ACMD_FUNC(reloadscript){
 	}
 	mapit_free(iter);
 
+	// Only reload the files that changed since they were loaded
+	if (message && *message && !strcmpi(message, "changed")) {
+		flush_fifos();
+		map_reloadnpc(true); // reload config files seeking for npcs
+
+		sprintf(atcmd_output, msg_txt(sd,1555), npc_reload_changed()); // '%d' changed script files have been reloaded.
+		clif_displaymessage(fd, atcmd_output);
+		return 0;
+	}
+
 	for (auto &bg : bg_queues) {
 		for (auto &bg_sd : bg->teama_members)
 			bg_team_leave(bg_sd, false, false); // Kick Team A from battlegrounds
@@ -7771,6 +7785,150 @@ ACMD_FUNC(uptime)
 	return 0;
 }
 
+/*==========================================
+ * @profiler
+ * Controls the tick profiler and shows its statistics.
+ *------------------------------------------*/
+ACMD_FUNC(profiler)
+{
+	char action[16];
+	int32 value = 0;
+
+	nullpo_retr(-1, sd);
+
+	memset(action, '\0', sizeof(action));
+
+	if (!message || !*message || sscanf(message, "%15s %11d", action, &value) < 1) {
+		clif_displaymessage(fd, msg_txt(sd,1542)); // Usage: @profiler <on|off|reset|dump [<count>]|slowtick <ms>>
+		return -1;
+	}
+
+	if (!strcmpi(action, "on")) {
+		profiler_set_enabled(true);
+		clif_displaymessage(fd, msg_txt(sd,1539)); // Profiler enabled.
+	} else if (!strcmpi(action, "off")) {
+		profiler_set_enabled(false);
+		clif_displaymessage(fd, msg_txt(sd,1540)); // Profiler disabled.
+	} else if (!strcmpi(action, "reset")) {
+		profiler_reset();
+		memset(member_update_stats, 0, sizeof(member_update_stats));
+		ac_scheduler_reset_stats();
+		memset(&aura_stats, 0, sizeof(aura_stats));
+		clif_displaymessage(fd, msg_txt(sd,1541)); // Profiler statistics have been reset.
+	} else if (!strcmpi(action, "dump")) {
+		profiler_dump(value > 0 ? value : 10, [fd]( const char* line ){
+			clif_displaymessage(fd, line);
+		});
+
+		const s_mapreg_metrics& mapreg = mapreg_get_metrics();
+
+		// Mapreg: %u dirty, %u queued batches, %u flushes, %u rows written, %u failed. Last flush %u us (max %u us), last write %u ms (max %u ms).
+		sprintf(atcmd_output, msg_txt(sd,1544), (uint32)mapreg.dirty, (uint32)mapreg.pending, (uint32)mapreg.flushes, (uint32)mapreg.rows_written, (uint32)mapreg.failed,
+			(uint32)mapreg.last_flush, (uint32)mapreg.max_flush, (uint32)mapreg.last_write, (uint32)mapreg.max_write);
+		clif_displaymessage(fd, atcmd_output);
+
+		const s_member_update_stats* updates = member_update_stats;
+
+		// Member updates (sent/suppressed, packets in writes): party %u/%u, %u in %u; guild %u/%u, %u in %u; battleground %u/%u, %u in %u.
+		sprintf(atcmd_output, msg_txt(sd,1549),
+			(uint32)updates[MEMBER_UPDATE_PARTY].sent, (uint32)updates[MEMBER_UPDATE_PARTY].suppressed, (uint32)updates[MEMBER_UPDATE_PARTY].packets, (uint32)updates[MEMBER_UPDATE_PARTY].writes,
+			(uint32)updates[MEMBER_UPDATE_GUILD].sent, (uint32)updates[MEMBER_UPDATE_GUILD].suppressed, (uint32)updates[MEMBER_UPDATE_GUILD].packets, (uint32)updates[MEMBER_UPDATE_GUILD].writes,
+			(uint32)updates[MEMBER_UPDATE_BG].sent, (uint32)updates[MEMBER_UPDATE_BG].suppressed, (uint32)updates[MEMBER_UPDATE_BG].packets, (uint32)updates[MEMBER_UPDATE_BG].writes);
+		clif_displaymessage(fd, atcmd_output);
+
+		s_ac_scheduler_stats bots;
+
+		ac_scheduler_stats(bots);
+		// Autocombat: %u bots, %.1f turns/tick, %u decisions/s, tick cost p99 %u us (max %u us), %u decisions waiting, %u postponed.
+		sprintf(atcmd_output, msg_txt(sd,1550), bots.bots, bots.turns_per_tick, bots.decisions_per_second, bots.p99, bots.max, bots.deferred, (uint32)bots.postponed);
+		clif_displaymessage(fd, atcmd_output);
+
+		// Auras: %u effect replays in %u timer calls and %u area scans, %u packets in %u writes.
+		sprintf(atcmd_output, msg_txt(sd,1556), (uint32)aura_stats.replays, (uint32)aura_stats.timer_calls, (uint32)aura_stats.scans, (uint32)aura_stats.packets, (uint32)aura_stats.writes);
+		clif_displaymessage(fd, atcmd_output);
+	} else if (!strcmpi(action, "slowtick")) {
+		value = cap_value(value, 0, INT_MAX);
+		profiler_set_slow_tick(value);
+		sprintf(atcmd_output, msg_txt(sd,1543), value); // Slow tick threshold set to %d ms.
+		clif_displaymessage(fd, atcmd_output);
+	} else {
+		clif_displaymessage(fd, msg_txt(sd,1542)); // Usage: @profiler <on|off|reset|dump [<count>]|slowtick <ms>>
+		return -1;
+	}
+
+	return 0;
+}
+
+/*==========================================
+ * @ers [reset]
+ * => Shows the usage of the entry caches
+ *------------------------------------------*/
+ACMD_FUNC(ers)
+{
+	std::vector<s_ers_stats> stats;
+	uint32 live = 0;
+
+	nullpo_retr(-1, sd);
+
+	if (message && *message) {
+		if (strcmpi(message, "reset")) {
+			clif_displaymessage(fd, msg_txt(sd,1545)); // Usage: @ers [reset]
+			return -1;
+		}
+
+		ers_reset_stats();
+		clif_displaymessage(fd, msg_txt(sd,1547)); // ERS peak and allocation counters have been reset.
+		return 0;
+	}
+
+	ers_stats(stats);
+
+	std::sort(stats.begin(), stats.end(), []( const s_ers_stats& a, const s_ers_stats& b ){
+		return a.memory > b.memory;
+	});
+
+	for (const s_ers_stats& entry : stats)
+		live += entry.live;
+
+	sprintf(atcmd_output, msg_txt(sd,1548), (uint32)stats.size(), live); // ERS: %u instances, %u entries live.
+	clif_displaymessage(fd, atcmd_output);
+
+	for (const s_ers_stats& entry : stats) {
+		// %s: %u bytes, %u live, %u peak, %u allocs (%u/s), %u KB
+		safesnprintf(atcmd_output, sizeof(atcmd_output), msg_txt(sd,1546), entry.name, (uint32)entry.entry_size, entry.live, entry.peak, (uint32)entry.allocs, (uint32)entry.rate, (uint32)(entry.memory / 1024));
+		clif_displaymessage(fd, atcmd_output);
+	}
+
+	return 0;
+}
+
+/*==========================================
+ * @packettrace <on|off>
+ * => Records the client and char-server packets for a later replay
+ *------------------------------------------*/
+ACMD_FUNC(packettrace)
+{
+	nullpo_retr(-1, sd);
+
+	if (message && !strcmpi(message, "on")) {
+		if (!trace_record_start(trace_config.file)) {
+			clif_displaymessage(fd, msg_txt(sd,1554)); // The packet trace could not be started, see the map-server console.
+			return -1;
+		}
+
+		sprintf(atcmd_output, msg_txt(sd,1552), trace_config.file); // Recording the packet trace to '%s'.
+		clif_displaymessage(fd, atcmd_output);
+	} else if (message && !strcmpi(message, "off")) {
+		trace_record_stop();
+		clif_displaymessage(fd, msg_txt(sd,1553)); // Packet trace recording stopped.
+	} else {
+		clif_displaymessage(fd, msg_txt(sd,1551)); // Usage: @packettrace <on|off>
+		return -1;
+	}
+
+	return 0;
+}
+
 /*==========================================
  * @changesex 
  * => Changes one's account sex. Switch from male to female or visversa
@@ -11590,6 +11748,9 @@ void atcommand_basecommands(void) {
 		ACMD_DEF(unmute),
 		ACMD_DEF(clearweather),
 		ACMD_DEF(uptime),
+		ACMD_DEF(profiler),
+		ACMD_DEF(ers),
+		ACMD_DEF(packettrace),
 		ACMD_DEF(changesex),
 		ACMD_DEF(changecharsex),
 		ACMD_DEF(mute),
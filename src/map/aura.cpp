@@ -3,11 +3,50 @@
 
 #include "aura.hpp"
 
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include <common/socket.hpp>
+
 #include "battle.hpp"
+#include "clif.hpp"
 #include "map.hpp"
 #include "pc.hpp"
 
+/// Replays due within this many milliseconds are handled together
+#define AURA_SCHEDULE_GRANULARITY 100
+/// Maximum amount of effect packets coalesced into one write
+#define AURA_PACKETS_PER_WRITE 1000
+
 AuraDatabase aura_db;
+s_aura_stats aura_stats;
+
+/// A unit with replaying effects waiting in a schedule
+struct s_aura_due {
+	int32 id;
+	uint32 generation; ///< Entries of an older generation are stale and skipped
+};
+
+/// Replay schedule of a map, driven by a single timer
+struct s_aura_schedule {
+	std::map<t_tick, std::vector<s_aura_due>> due; ///< Units by the tick their next effects are due
+	int32 tid = INVALID_TIMER;
+	t_tick timer_tick = 0;
+};
+
+/// An effect packet waiting to be written to an observer
+struct s_aura_packet {
+	int32 fd;
+	int32 id;
+	uint16 effect_id;
+};
+
+static std::unordered_map<int16, s_aura_schedule> aura_schedules;
+/// Schedule generation of every unit with replaying effects
+static std::unordered_map<int32, uint32> aura_units;
+static uint32 aura_generation = 0;
 
 std::unordered_map<uint16, enum e_aura_special> special_effects{
 	{202, AURA_SPECIAL_HIDE_DISAPPEAR},
@@ -114,62 +153,223 @@ enum e_aura_special aura_special(uint16 effect_id) {
 }
 
 /*==========================================
-* Method: aura_effects_timer_sub
-* Description: Processing function used to traverse nearby players and send them specified halo effects
-* Access: public
+* Method: aura_schedule_add
+* Description: Put a unit into the schedule of its map at the tick its next effect is due
+* Access: private
+* Parameter: struct block_list * bl
+* Parameter: uint32 generation
+* Parameter: t_tick due
+* Returns: void
+ *------------------------------------------*/
+static void aura_schedule_add(struct block_list* bl, uint32 generation, t_tick due) {
+	// Round up, so that replays due close to each other share a timer call
+	due += AURA_SCHEDULE_GRANULARITY - 1;
+	due -= due % AURA_SCHEDULE_GRANULARITY;
+
+	s_aura_schedule& schedule = aura_schedules[bl->m];
+
+	schedule.due[due].push_back({ bl->id, generation });
+
+	if (schedule.tid == INVALID_TIMER) {
+		schedule.tid = add_timer(due, aura_schedule_timer, bl->m, 0);
+		schedule.timer_tick = due;
+	}
+	else if (DIFF_TICK(due, schedule.timer_tick) < 0) {
+		settick_timer(schedule.tid, due);
+		schedule.timer_tick = due;
+	}
+}
+
+/*==========================================
+* Method: aura_observer_sub
+* Description: Collect the players that can see the aura of a unit
+* Access: private
 * Parameter: struct block_list * bl traverses to nearby player units
 * Parameter: va_list ap
 * Returns: int
-* Author: Sola丶小克(CairoLee) 2021/12/29 21:27
  *------------------------------------------*/
-int aura_effects_timer_sub(struct block_list* bl, va_list ap) {
-	map_session_data* sd = nullptr;
+static int aura_observer_sub(struct block_list* bl, va_list ap) {
 	struct block_list* effect_unit_bl = va_arg(ap, struct block_list*);
-	unsigned int effect_id = va_arg(ap, unsigned int);
+	std::vector<map_session_data*>* observers = va_arg(ap, std::vector<map_session_data*>*);
 
 	if (!bl || !effect_unit_bl || bl->type != BL_PC) {
 		return 0;
 	}
 
-	sd = BL_CAST(BL_PC, bl);
-
 	if (aura_need_hiding(effect_unit_bl, bl)) {
 		return 0;
 	}
 
-	clif_specialeffect_single(effect_unit_bl, effect_id, sd->fd);
+	observers->push_back(BL_CAST(BL_PC, bl));
 	return 1;
 }
 
 /*==========================================
-* Method: aura_effects_timer
-* Description: Timer processing function for scheduled playback of non-persistent special effects
+* Method: aura_replay_unit
+* Description: Replay the due effects of a unit and schedule its next replay.
+*              Observers are looked up once for all effects due at the same time.
+* Access: private
+* Parameter: struct block_list * bl
+* Parameter: uint32 generation
+* Parameter: t_tick tick
+* Parameter: std::vector<s_aura_packet> & packets receives the packets to send
+* Returns: void
+ *------------------------------------------*/
+static void aura_replay_unit(struct block_list* bl, uint32 generation, t_tick tick, std::vector<s_aura_packet>& packets) {
+	static std::vector<uint16> effects;
+	static std::vector<map_session_data*> observers;
+
+	struct s_unit_common_data* ucd = status_get_ucd(bl);
+	if (!ucd) return;
+
+	t_tick next = 0;
+
+	effects.clear();
+
+	for (auto& it : ucd->aura.effects) {
+		if (!it->replay_interval) continue;
+
+		if (DIFF_TICK(it->replay_next, tick) <= 0) {
+			effects.push_back(it->effect_id);
+
+			it->replay_next += it->replay_interval;
+			if (DIFF_TICK(it->replay_next, tick) <= 0) {
+				it->replay_next = tick + it->replay_interval;
+			}
+		}
+
+		if (next == 0 || DIFF_TICK(it->replay_next, next) < 0) {
+			next = it->replay_next;
+		}
+	}
+
+	if (next == 0) {
+		aura_units.erase(bl->id);
+		return;
+	}
+
+	aura_schedule_add(bl, generation, next);
+
+	if (effects.empty() || bl->prev == nullptr) return;
+
+	struct map_data* mapdata = map_getmapdata(bl->m);
+	if (!mapdata || !mapdata->users) return;
+
+	observers.clear();
+	map_foreachinallrange(aura_observer_sub, bl, AREA_SIZE, BL_PC, bl, &observers);
+
+	aura_stats.replays += effects.size();
+	aura_stats.scans++;
+
+	for (map_session_data* sd : observers) {
+		for (uint16 effect_id : effects) {
+			packets.push_back({ sd->fd, bl->id, effect_id });
+		}
+	}
+}
+
+/*==========================================
+* Method: aura_send_packets
+* Description: Write the effect packets, coalesced into one write per observer
+* Access: private
+* Parameter: std::vector<s_aura_packet> & packets
+* Returns: void
+ *------------------------------------------*/
+static void aura_send_packets(std::vector<s_aura_packet>& packets) {
+	std::stable_sort(packets.begin(), packets.end(), [](const s_aura_packet& a, const s_aura_packet& b) {
+		return a.fd < b.fd;
+	});
+
+	static std::vector<s_specialeffect_single> batch;
+
+	for (size_t i = 0; i < packets.size(); ) {
+		int32 fd = packets[i].fd;
+		size_t count = 0;
+
+		while (i + count < packets.size() && packets[i + count].fd == fd && count < AURA_PACKETS_PER_WRITE) {
+			count++;
+		}
+
+		if (session_isActive(fd)) {
+			batch.clear();
+			for (size_t j = 0; j < count; j++) {
+				batch.push_back({ packets[i + j].id, packets[i + j].effect_id });
+			}
+			clif_specialeffect_single_batch(fd, batch);
+
+			aura_stats.packets += count;
+			aura_stats.writes++;
+		}
+
+		i += count;
+	}
+
+	packets.clear();
+}
+
+/*==========================================
+* Method: aura_schedule_timer
+* Description: Timer of a map schedule, replays the effects of all units that are due
 * Access: public
-* Parameter: aura_effects_timer
+* Parameter: aura_schedule_timer id is the map index
 * Returns:
-* Author: Sola丶小克(CairoLee) 2021/04/24 14:56
  *------------------------------------------*/
-TIMER_FUNC(aura_effects_timer) {
-	struct block_list* bl = map_id2bl(id);
-	if (!bl) {
-		delete_timer(tid, aura_effects_timer);
-		return 1;
+TIMER_FUNC(aura_schedule_timer) {
+	static std::vector<s_aura_packet> packets;
+
+	auto found = aura_schedules.find(static_cast<int16>(id));
+	if (found == aura_schedules.end() || found->second.tid != tid) {
+		return 0;
 	}
 
-	struct s_unit_common_data* ucd = status_get_ucd(bl);
-	if (!ucd) {
-		delete_timer(tid, aura_effects_timer);
-		return 1;
+	s_aura_schedule& schedule = found->second;
+	schedule.tid = INVALID_TIMER;
+	aura_stats.timer_calls++;
+
+	while (!schedule.due.empty() && DIFF_TICK(schedule.due.begin()->first, tick) <= 0) {
+		std::vector<s_aura_due> units = std::move(schedule.due.begin()->second);
+
+		schedule.due.erase(schedule.due.begin());
+
+		for (const s_aura_due& due : units) {
+			auto unit = aura_units.find(due.id);
+			if (unit == aura_units.end() || unit->second != due.generation) continue;
+
+			struct block_list* bl = map_id2bl(due.id);
+			if (!bl) {
+				aura_units.erase(unit);
+				continue;
+			}
+
+			// Units that changed maps move to the schedule of their new map
+			aura_replay_unit(bl, due.generation, tick, packets);
+		}
 	}
 
-	for (auto it : ucd->aura.effects) {
-		if (it->replay_tid != tid) continue;
-		map_foreachinallrange(aura_effects_timer_sub, bl, AREA_SIZE, BL_PC, bl, it->effect_id);
+	aura_send_packets(packets);
+
+	// The schedule may have been re-armed while replaying units of this map
+	if (!schedule.due.empty() && schedule.tid == INVALID_TIMER) {
+		schedule.timer_tick = schedule.due.begin()->first;
+		schedule.tid = add_timer(schedule.timer_tick, aura_schedule_timer, id, 0);
 	}
 
 	return 0;
 }
 
+/*==========================================
+* Method: aura_effects_unschedule
+* Description: Stop replaying the effects of a unit, its entries in the schedules become stale
+* Access: public
+* Parameter: struct block_list * bl
+* Returns: void
+ *------------------------------------------*/
+void aura_effects_unschedule(struct block_list* bl) {
+	if (!bl) return;
+
+	aura_units.erase(bl->id);
+}
+
 /*==========================================  
 * Method: aura_need_hiding  
 * Description: Determine whether the aura needs to be hidden (or not displayed)  
@@ -211,12 +411,9 @@ void aura_effects_clear(struct block_list* bl) {
 
 	for (auto &it : ucd->aura.effects) {
 		clif_specialeffect_remove(bl, it->effect_id, AREA, bl);
-		if (it->replay_tid != INVALID_TIMER) {
-			delete_timer(it->replay_tid, aura_effects_timer);
-			it->replay_tid = INVALID_TIMER;
-		}
 	}
 	ucd->aura.effects.clear();
+	aura_effects_unschedule(bl);
 }
 
 /*==========================================
@@ -238,20 +435,27 @@ void aura_effects_refill(struct block_list* bl) {
 	std::shared_ptr<s_aura> aura = aura_search(ucd->aura.id);
 	if (!aura) return;
 
+	t_tick first = gettick() + 100;
+	bool replaying = false;
+
 	for (auto it : aura->effects) {
 		auto effect = std::make_shared<s_aura_effect>();
 		effect->effect_id = it->effect_id;
 		effect->replay_interval = it->replay_interval;
-		effect->replay_tid = INVALID_TIMER;
 		
 		if (effect->replay_interval) {
-			effect->replay_tid = add_timer_interval(
-				gettick() + 100, aura_effects_timer, bl->id, 0, effect->replay_interval
-			);
+			effect->replay_next = first;
+			replaying = true;
 		}
 		
 		ucd->aura.effects.push_back(effect);
 	}
+
+	// All replaying effects of the unit share one entry in the schedule of its map
+	if (replaying) {
+		aura_units[bl->id] = ++aura_generation;
+		aura_schedule_add(bl, aura_generation, first);
+	}
 }
 
 /*==========================================
@@ -370,6 +574,8 @@ void aura_reload(void) {
  *------------------------------------------*/
 void do_final_aura(void) {
 	aura_db.clear();
+	aura_schedules.clear();
+	aura_units.clear();
 }
 
 /*==========================================
@@ -381,7 +587,7 @@ void do_final_aura(void) {
 * Author: Sola丶小克(CairoLee) 2020/09/26 16:41
  *------------------------------------------*/
 void do_init_aura(void) {
-	add_timer_func_list(aura_effects_timer, "aura_effects_timer");
+	add_timer_func_list(aura_schedule_timer, "aura_schedule_timer");
 
 	aura_db.load();
 }
@@ -29,13 +29,26 @@ public:
 
 extern AuraDatabase aura_db;
 
+/// Counters of the aura replay scheduler.
+/// Before the scheduler every replay was a timer call and an area scan of its own, with one write per packet.
+struct s_aura_stats {
+	uint64 replays; ///< Replayed effects
+	uint64 timer_calls; ///< Calls of the per-map schedule timers
+	uint64 scans; ///< Area scans for observers, one per unit and batch
+	uint64 packets; ///< Effect packets sent to observers
+	uint64 writes; ///< Writes the packets were coalesced into
+};
+
+extern s_aura_stats aura_stats;
+
 void aura_reload(void);
 void do_final_aura(void);
 void do_init_aura(void);
 
 std::shared_ptr<s_aura> aura_search(uint32 aura_id);
 enum e_aura_special aura_special(uint16 effect_id);
-TIMER_FUNC(aura_effects_timer);
+TIMER_FUNC(aura_schedule_timer);
+void aura_effects_unschedule(struct block_list* bl);
 bool aura_need_hiding(struct block_list* bl, struct block_list* observer_bl = nullptr);
 void aura_effects_clear(struct block_list* bl);
 void aura_effects_refill(struct block_list* bl);
@@ -11,6 +11,7 @@
 #include "pc.hpp"
 #include "skill.hpp"
 
+#include <deque>
 #include <random>
 #include <queue>
 #include <cmath>
@@ -21,6 +22,7 @@
 #include <common/database.hpp>
 #include <common/malloc.hpp>
 #include <common/nullpo.hpp>
+#include <common/profiler.hpp>
 #include <common/showmsg.hpp>
 #include <common/socket.hpp>
 #include <common/sql.hpp>
@@ -625,23 +627,28 @@ void ac_clear_detection_cache(map_session_data* sd) {
     sd->ac.detection_cache.cached_items.shrink_to_fit();  
 }
 
-void ac_mob_ai_search_mvpcheck(struct block_list* bl, struct mob_data* md){
+static int ac_mob_ai_search_mvpcheck_sub(struct block_list* bl, va_list ap) {
+	TBL_PC* sd = BL_CAST(BL_PC, bl);
+
+	if (sd && sd->state.autocombat)
+		ac_teleport(sd);
+
+	return 0;
+}
+
+// Teleport the bots that see a boss monster
+void ac_mob_ai_search_mvpcheck(struct mob_data* md, int range) {
 	if (!battle_config.autocombat_teleport_mvp)
 		return;
 
-	if (bl->type == BL_PC) {
-		TBL_PC* sd = BL_CAST(BL_PC, bl);
-		if (sd->state.autocombat) {
-			e_mob_bosstype bosstype = md->get_bosstype();
-
-			//if (sd->ac.teleport.tp_mvp && bosstype == BOSSTYPE_MVP)
-			if (bosstype == BOSSTYPE_MVP)
-				ac_teleport(sd);
-			//else if (sd->ac.teleport.tp_miniboss && bosstype == BOSSTYPE_MINIBOSS)
-			else if (bosstype == BOSSTYPE_MINIBOSS)
-				ac_teleport(sd);
-		}
-	}
+	e_mob_bosstype bosstype = md->get_bosstype();
+
+	//if (sd->ac.teleport.tp_mvp && bosstype == BOSSTYPE_MVP)
+	//else if (sd->ac.teleport.tp_miniboss && bosstype == BOSSTYPE_MINIBOSS)
+	if (bosstype != BOSSTYPE_MVP && bosstype != BOSSTYPE_MINIBOSS)
+		return;
+
+	map_foreachinallrange(ac_mob_ai_search_mvpcheck_sub, md, range, BL_PC);
 }
 
 void ac_priority_on_hit(map_session_data* sd, struct block_list* src) {
@@ -846,28 +853,6 @@ int buildin_autopick_sub(struct block_list *bl, va_list ap) {
     return 1;
 }
 
-int buildin_autopick_sub_cached(struct block_list *bl, va_list ap) {  
-    // Extract arguments from va_list  
-    std::vector<unsigned int>* found_items = va_arg(ap, std::vector<unsigned int>*);  
-    int src_id = va_arg(ap, int);  
-  
-    if (!bl || bl->type != BL_ITEM)  
-        return 0;  
-  
-    // Retrieve sd from player  
-    map_session_data* sd = map_id2sd(src_id);  
-    if (!sd || !bl) // Validate both source and target block lists  
-        return 0;  
-  
-    // Check item pickup conditions  
-    if (!ac_check_item_pickup(sd, bl))  
-        return 0;  
-  
-    // Add to found items list for caching  
-    found_items->push_back(bl->id);  
-    return 1;  
-}
-
 //Check if an item can be pick up around
 bool ac_check_item_pickup(map_session_data *sd, struct block_list *bl) {
     struct flooritem_data* fitem = (struct flooritem_data*)bl;
@@ -965,30 +950,20 @@ unsigned int ac_check_item_pickup_onfloor(map_session_data* sd) {
             sd->ac.detection_cache.cached_items.clear();  
         }  
   
-        // Perform fresh search and cache results  
-        std::vector<unsigned int> found_items;  
-  
-        // Iterate through the detection radius to find suitable items  
-        for (int radius = 0; radius < battle_config.autocombat_pdetection; ++radius) {  
-            map_foreachinarea(  
-                buildin_autopick_sub_cached,  
-                sd->m,  
-                sd->x - radius,  
-                sd->y - radius,  
-                sd->x + radius,  
-                sd->y + radius,  
-                BL_ITEM,  
-                &found_items,  
-                sd->id  
-            );  
-  
-            // If an item is found, set the item pick ID and break  
-            if (!found_items.empty()) {  
-                sd->ac.itempick_id = found_items[0]; // Use first valid item  
-                break;  
-            }  
-        }  
-  
+        // Perform fresh search and cache the closest items
+        std::vector<block_list*> nearest;
+        std::vector<unsigned int> found_items;
+
+        map_findnearest_k(sd, battle_config.autocombat_pdetection - 1, BL_ITEM, AC_DETECTION_CACHE_SIZE, [sd](block_list* bl) {
+            return ac_check_item_pickup(sd, bl);
+        }, nearest);
+
+        for (block_list* bl : nearest)
+            found_items.push_back(bl->id);
+
+        if (!found_items.empty())
+            sd->ac.itempick_id = found_items[0]; // Closest valid item
+
         // Update cache with results  
         sd->ac.detection_cache.cached_items = std::move(found_items);  
         sd->ac.detection_cache.last_update = current_tick;  
@@ -1095,31 +1070,6 @@ int buildin_autocombat_sub(struct block_list* bl, va_list ap) {
 	return 1;
 }
 
-int buildin_autocombat_sub_cached(struct block_list* bl, va_list ap) {  
-    // Retrieve arguments passed via the va_list  
-    std::vector<unsigned int>* found_monsters = va_arg(ap, std::vector<unsigned int>*);  
-    int src_id = va_arg(ap, int);  
-  
-    if (!bl || bl->type != BL_MOB)  
-        return 0;  
-  
-    // Retrieve sd  
-    map_session_data* sd = map_id2sd(src_id);  
-  
-    // Validate source and target blocks  
-    if (!sd)  
-        return 0;  
-  
-    // Verify target eligibility  
-    if (!ac_check_target(sd, bl->id)) {  
-        return 0;  
-    }  
-  
-    // Add to found monsters list for caching  
-    found_monsters->push_back(bl->id);  
-    return 1;  
-}
-
 int buildin_autocombat_monsters_sub(struct block_list* bl, va_list ap) {
 	// Retrieve arguments passed via the va_list
 	std::unordered_set<int>* counted_monsters = va_arg(ap, std::unordered_set<int>*);
@@ -1179,31 +1129,22 @@ unsigned int ac_check_target_alive(map_session_data* sd) {
             sd->ac.detection_cache.cached_monsters.clear();  
         }  
   
-        // Perform fresh search and cache results  
+        // Perform fresh search and cache the closest targets
+        std::vector<block_list*> nearest;
         std::vector<unsigned int> found_monsters;
 
-		// Search for a new target within detection radius
-		for (int radius = 0; radius < battle_config.autocombat_mdetection; ++radius) {
-			map_foreachinarea(
-				buildin_autocombat_sub_cached,
-				sd->m,
-				sd->x - radius,
-				sd->y - radius,
-				sd->x + radius,
-				sd->y + radius,
-				BL_MOB,
-				&found_monsters,
-				sd->id
-			);
-
-            // If a target is found, set the target ID and break  
-            if (!found_monsters.empty()) {  
-                target_id_ = found_monsters[0]; // Use first valid target  
-                ac_target_change(sd, target_id_);  
-                break;  
-            }  
-        }  
-  
+        map_findnearest_k(sd, battle_config.autocombat_mdetection - 1, BL_MOB, AC_DETECTION_CACHE_SIZE, [sd](block_list* bl) {
+            return ac_check_target(sd, bl->id);
+        }, nearest);
+
+        for (block_list* bl : nearest)
+            found_monsters.push_back(bl->id);
+
+        if (!found_monsters.empty()) {
+            target_id_ = found_monsters[0]; // Closest valid target
+            ac_target_change(sd, target_id_);
+        }
+
         // Update cache with results  
         sd->ac.detection_cache.cached_monsters = std::move(found_monsters);  
         sd->ac.detection_cache.last_update = current_tick;  
@@ -1220,8 +1161,10 @@ int ac_check_surround_monster(map_session_data* sd) {
 
     ac_target_change(sd, 0);
 
-    // Search for a new target within detection radius
-    for (int radius = 0; radius < battle_config.autocombat_mdetection; ++radius) {
+    // Count the monsters targeting the player within detection radius
+    int radius = battle_config.autocombat_mdetection - 1;
+
+    if (radius >= 0)
         map_foreachinarea(
             buildin_autocombat_monsters_sub,
             sd->m,
@@ -1233,7 +1176,6 @@ int ac_check_surround_monster(map_session_data* sd) {
             &counted_monsters,  // Passer le set en parametre
             sd->id
         );
-    }
 
     return static_cast<int>(counted_monsters.size());
 }
@@ -1539,35 +1481,42 @@ bool ac_elemallowed(struct mob_data* md, int ele) {
 	}
 }
 
-// 0 nothing - 1 pick up - 2 heal
-int ac_status(map_session_data* sd) {
-	if (!sd) return -1;
-
+/**
+ * Survival phase of the brain: duration, weight, rest, potions, heals and buffs.
+ * It runs on every turn of the bot, even when the scheduler is out of budget.
+ * @param result: brain result when the bot is done for this turn
+ * @return true if the decision phase should run
+ */
+static bool ac_status_upkeep(map_session_data* sd, t_tick last_tick, int& result) {
 	ac_invalidate_cache_on_move(sd);
 
 	if(sd->state.storage_flag){
 		std::string msg = "Automessage - Storage open, close it first!";
 		ac_message(sd, "Storage", msg.data(), 300, nullptr);
 		status_change_end(sd, SC_AUTOCOMBAT);
-		return 0;
+		result = 0;
+		return false;
 	}
 
 	if (battle_config.autocombat_duration_type == 1) {
 		if (sd->ac.duration_ <= 0) {
 			std::string msg = "Automessage - You don't have timer left on autocombat system!";
 			ac_message(sd, "TimerOut", msg.data(), 5, nullptr);
-			return -1;
+			result = -1;
+			return false;
 		}
 
+		// Kept in memory, #ac_duration is written when the character is saved
 		sd->ac.duration_ = sd->ac.duration_ - battle_config.autocombat_timer;
-		pc_setaccountreg(sd, add_str("#ac_duration"), sd->ac.duration_);
+		sd->ac.duration_dirty = true;
 	}
 
 	else if (battle_config.autocombat_duration_type == 2) {  
 		if (sd->status.ap <= 0) {  
 			std::string msg = "Automessage - You don't have AP left on autocombat system!";  
 			ac_message(sd, "APOut", msg.data(), 5, nullptr);  
-			return -1;  
+			result = -1;
+			return false;
 		}  
 
 		status_heal(sd, 0, 0, -battle_config.autocombat_ap_per_tick, 0);  
@@ -1581,22 +1530,26 @@ int ac_status(map_session_data* sd) {
 		std::string msg = "Automessage - I'm overweight - System Off!";
 		ac_message(sd, "Overweight", msg.data(), 300, p);
 		status_change_end(sd, SC_AUTOCOMBAT);
-		return 0;
+		result = 0;
+		return false;
 	}
 
 	struct status_data* status = status_get_status_data(*sd);
-	t_tick last_tick = gettick();
 
 	//if surrounded by too much monsters
 	if (sd->ac.monster_surround && ac_check_surround_monster(sd) > sd->ac.monster_surround) {
 		ac_teleport(sd);
-		return 2;
+		result = 2;
+		return false;
 	}
 
 	// Brain, what the bot need to do during the loop
 	// Priority 1 - rest (sit / stand)
 	ac_status_rest(sd, status, last_tick);
-	if (pc_issit(sd)) return 1;
+	if (pc_issit(sd)) {
+		result = 1;
+		return false;
+	}
 
 	// Priority 2 - Buff item
 	ac_status_buffitem(sd, last_tick);
@@ -1605,10 +1558,26 @@ int ac_status(map_session_data* sd) {
 	ac_status_potion(sd, status);
 
 	// Priority 4 - heal
-	if (ac_status_heal(sd, status, last_tick)) return 3;
+	if (ac_status_heal(sd, status, last_tick)) {
+		result = 3;
+		return false;
+	}
 
 	// Priority 5 - Buffs
-	if (ac_status_buffs(sd, last_tick)) return 5;
+	if (ac_status_buffs(sd, last_tick)) {
+		result = 5;
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Decision phase of the brain: pickup, target search, attack and pathing.
+ * @return brain result
+ */
+static int ac_status_decide(map_session_data* sd, t_tick last_tick) {
+	struct status_data* status = status_get_status_data(*sd);
 
 	// Check targets
 	if (sd->ac.target_id && !ac_check_target(sd, sd->ac.target_id))
@@ -1653,6 +1622,31 @@ int ac_status(map_session_data* sd) {
 	return 10;
 }
 
+// 0 nothing - 1 pick up - 2 heal
+int ac_status(map_session_data* sd) {
+	if (!sd) return -1;
+
+	t_tick last_tick = gettick();
+	int result = 0;
+
+	if (!ac_status_upkeep(sd, last_tick, result))
+		return result;
+
+	return ac_status_decide(sd, last_tick);
+}
+
+/**
+ * Write the remaining autocombat duration to #ac_duration.
+ * The brain only updates it in memory, this is called before the registry is saved.
+ */
+void ac_save_duration(map_session_data* sd) {
+	if (!sd->ac.duration_dirty)
+		return;
+
+	pc_setaccountreg(sd, add_str("#ac_duration"), sd->ac.duration_);
+	sd->ac.duration_dirty = false;
+}
+
 bool ac_status_checkteleport_delay(map_session_data* sd, t_tick last_tick) {
 	t_tick attack_ = DIFF_TICK(last_tick, sd->ac.last_attack);
 	t_tick pick_ = DIFF_TICK(last_tick, sd->ac.last_pick);
@@ -2337,7 +2331,7 @@ void ac_getusablepotions(map_session_data* sd, t_itemid* inventory_potion_id, in
 	for (int i = 0; i < MAX_INVENTORY; ++i) {
 		const auto& inv_item = sd->inventory.u.items_inventory[i];
 
-		if (auto item_data = item_db.find(inv_item.nameid)) {
+		if (auto item_data = sd->inventory_data[i]) {
 			if (item_data->type == IT_HEALING) {
 				inventory_potion_id[*amount] = inv_item.nameid;
 				inventory_potion_amount[*amount] = inv_item.amount;
@@ -2351,15 +2345,12 @@ void ac_getusablepotions(map_session_data* sd, t_itemid* inventory_potion_id, in
 }
 
 uint32 ac_getrental_search_inventory(map_session_data* sd, t_itemid nameid) {
-	short i;
 	uint32 expire_time = 0;
 	nullpo_retr(-1, sd);
 
-	for (i = 0; i < MAX_INVENTORY; i++) {
-		if (sd->inventory.u.items_inventory[i].nameid == nameid) {
-			if (sd->inventory.u.items_inventory[i].expire_time > 0) {
-				expire_time = sd->inventory.u.items_inventory[i].expire_time;
-			}
+	for (int16 i : pc_inventory_slots(*sd, nameid)) {
+		if (sd->inventory.u.items_inventory[i].expire_time > 0) {
+			expire_time = sd->inventory.u.items_inventory[i].expire_time;
 		}
 	}
 
@@ -2739,6 +2730,7 @@ bool ac_changestate_autocombat(map_session_data* sd, int flag) {
 			}
 		}
 		sd->state.autocombat = false;
+		ac_scheduler_remove(sd->id);
 		
         if (battle_config.autocombat_hateffect) {  
             struct unit_data* ud = unit_bl2ud(sd);  
@@ -2780,3 +2772,252 @@ bool ac_party_request(map_session_data* sd) {
 	party_join(*sd, sd->party_invite);
 	return true;
 }
+
+/// Bot registered to the scheduler
+struct s_ac_scheduler_bot {
+	size_t slot;
+	bool deferred; ///< Decision phase is waiting in the deferred queue
+};
+
+/// Cost of a single scheduler tick
+struct s_ac_scheduler_sample {
+	uint32 cost; ///< Duration in microseconds
+	uint16 turns;
+	uint16 decisions;
+};
+
+/// Bots are spread over the slots of an autocombat_timer period, one slot runs per scheduler tick
+static std::vector<std::vector<uint32>> ac_scheduler_slots;
+static std::unordered_map<uint32, s_ac_scheduler_bot> ac_scheduler_bots;
+static std::deque<uint32> ac_scheduler_deferred;
+static size_t ac_scheduler_current = 0;
+static s_ac_scheduler_sample ac_scheduler_samples[AC_SCHEDULER_WINDOW];
+static size_t ac_scheduler_sample_count = 0;
+static size_t ac_scheduler_sample_next = 0;
+static uint64 ac_scheduler_postponed = 0;
+
+/**
+ * Amount of slots of an autocombat_timer period.
+ */
+static size_t ac_scheduler_slot_count() {
+	return max(1, (battle_config.autocombat_timer + AC_SCHEDULER_INTERVAL / 2) / AC_SCHEDULER_INTERVAL);
+}
+
+/**
+ * Find the slot with the least bots, so bots that start together don't think on the same tick.
+ */
+static size_t ac_scheduler_least_loaded() {
+	size_t best = 0;
+
+	for (size_t i = 1; i < ac_scheduler_slots.size(); i++) {
+		if (ac_scheduler_slots[i].size() < ac_scheduler_slots[best].size())
+			best = i;
+	}
+
+	return best;
+}
+
+/**
+ * Spread the bots again after autocombat_timer changed.
+ */
+static void ac_scheduler_rebalance(size_t count) {
+	size_t slot = 0;
+
+	ac_scheduler_slots.assign(count, std::vector<uint32>());
+	ac_scheduler_current %= count;
+
+	for (auto& bot : ac_scheduler_bots) {
+		bot.second.slot = slot;
+		ac_scheduler_slots[slot].push_back(bot.first);
+		slot = (slot + 1) % count;
+	}
+}
+
+/**
+ * Start running the brain of a bot.
+ */
+void ac_scheduler_add(map_session_data* sd) {
+	if (ac_scheduler_bots.find(sd->id) != ac_scheduler_bots.end())
+		return;
+
+	size_t count = ac_scheduler_slot_count();
+
+	if (ac_scheduler_slots.size() != count)
+		ac_scheduler_rebalance(count);
+
+	size_t slot = ac_scheduler_least_loaded();
+
+	ac_scheduler_bots[sd->id] = { slot, false };
+	ac_scheduler_slots[slot].push_back(sd->id);
+}
+
+/**
+ * Stop running the brain of a bot.
+ */
+void ac_scheduler_remove(uint32 id) {
+	auto it = ac_scheduler_bots.find(id);
+
+	if (it == ac_scheduler_bots.end())
+		return;
+
+	util::vector_erase_if_exists(ac_scheduler_slots[it->second.slot], id);
+	ac_scheduler_bots.erase(it);
+	// Entries of the deferred queue are dropped when they come up
+}
+
+/**
+ * Bot that is due for a turn, or nullptr if it stopped autocombat.
+ */
+static map_session_data* ac_scheduler_bot(uint32 id) {
+	map_session_data* sd = map_id2sd(id);
+
+	if (sd == nullptr || !sd->state.autocombat || sd->sc.getSCE(SC_AUTOCOMBAT) == nullptr) {
+		ac_scheduler_remove(id);
+		return nullptr;
+	}
+
+	return sd;
+}
+
+/**
+ * Run the bots of the current slot.
+ * The survival phase of every bot runs on its turn. Once the tick spent more than
+ * autocombat_tick_budget, decision phases are postponed to the following ticks.
+ */
+TIMER_FUNC(ac_scheduler_timer) {
+	uint64 start = profiler_clock();
+	uint64 budget = battle_config.autocombat_tick_budget;
+	uint32 turns = 0, decisions = 0;
+	size_t count = ac_scheduler_slot_count();
+
+	if (ac_scheduler_bots.empty() && ac_scheduler_deferred.empty())
+		return 0;
+
+	if (ac_scheduler_slots.size() != count)
+		ac_scheduler_rebalance(count);
+
+	auto over_budget = [start, budget]() {
+		return budget > 0 && profiler_clock() - start >= budget;
+	};
+
+	FreeBlockLock freeLock;
+
+	// Decision phases postponed by the previous ticks come first
+	for (size_t pending = ac_scheduler_deferred.size(); pending > 0 && !over_budget(); pending--) {
+		uint32 id = ac_scheduler_deferred.front();
+
+		ac_scheduler_deferred.pop_front();
+
+		auto it = ac_scheduler_bots.find(id);
+
+		if (it == ac_scheduler_bots.end())
+			continue;
+
+		it->second.deferred = false;
+
+		map_session_data* sd = ac_scheduler_bot(id);
+
+		if (sd == nullptr)
+			continue;
+
+		ac_status_decide(sd, tick);
+		decisions++;
+	}
+
+	ac_scheduler_current = (ac_scheduler_current + 1) % ac_scheduler_slots.size();
+
+	// The brain can add or remove bots
+	std::vector<uint32> slot = ac_scheduler_slots[ac_scheduler_current];
+
+	for (uint32 id : slot) {
+		map_session_data* sd = ac_scheduler_bot(id);
+		int result = 0;
+
+		if (sd == nullptr)
+			continue;
+
+		turns++;
+
+		if (!ac_status_upkeep(sd, tick, result))
+			continue;
+
+		auto it = ac_scheduler_bots.find(id);
+
+		if (it == ac_scheduler_bots.end())
+			continue;
+
+		// A decision that is still queued from an earlier turn runs from the deferred queue
+		if (it->second.deferred)
+			continue;
+
+		if (over_budget()) {
+			it->second.deferred = true;
+			ac_scheduler_deferred.push_back(id);
+			ac_scheduler_postponed++;
+			continue;
+		}
+
+		ac_status_decide(sd, tick);
+		decisions++;
+	}
+
+	s_ac_scheduler_sample& sample = ac_scheduler_samples[ac_scheduler_sample_next];
+
+	sample.cost = static_cast<uint32>(std::min<uint64>(profiler_clock() - start, UINT32_MAX));
+	sample.turns = static_cast<uint16>(std::min<uint32>(turns, UINT16_MAX));
+	sample.decisions = static_cast<uint16>(std::min<uint32>(decisions, UINT16_MAX));
+	ac_scheduler_sample_next = (ac_scheduler_sample_next + 1) % AC_SCHEDULER_WINDOW;
+	ac_scheduler_sample_count = std::min<size_t>(ac_scheduler_sample_count + 1, AC_SCHEDULER_WINDOW);
+
+	return 0;
+}
+
+/**
+ * Statistics of the scheduler over the last AC_SCHEDULER_WINDOW ticks.
+ */
+void ac_scheduler_stats(s_ac_scheduler_stats& stats) {
+	std::vector<uint32> costs;
+	uint64 turns = 0, decisions = 0;
+
+	stats = {};
+	stats.bots = static_cast<uint32>(ac_scheduler_bots.size());
+	stats.deferred = static_cast<uint32>(ac_scheduler_deferred.size());
+	stats.postponed = ac_scheduler_postponed;
+
+	if (ac_scheduler_sample_count == 0)
+		return;
+
+	costs.reserve(ac_scheduler_sample_count);
+
+	for (size_t i = 0; i < ac_scheduler_sample_count; i++) {
+		costs.push_back(ac_scheduler_samples[i].cost);
+		turns += ac_scheduler_samples[i].turns;
+		decisions += ac_scheduler_samples[i].decisions;
+	}
+
+	size_t p99 = (costs.size() * 99 + 99) / 100 - 1;
+
+	std::nth_element(costs.begin(), costs.begin() + p99, costs.end());
+
+	stats.turns_per_tick = static_cast<double>(turns) / ac_scheduler_sample_count;
+	stats.decisions_per_second = static_cast<uint32>(decisions * 1000 / (ac_scheduler_sample_count * AC_SCHEDULER_INTERVAL));
+	stats.p99 = costs[p99];
+	stats.max = *std::max_element(costs.begin(), costs.end());
+}
+
+void ac_scheduler_reset_stats() {
+	ac_scheduler_sample_count = 0;
+	ac_scheduler_sample_next = 0;
+	ac_scheduler_postponed = 0;
+}
+
+void do_init_autocombat() {
+	add_timer_func_list(ac_scheduler_timer, "ac_scheduler_timer");
+	add_timer_interval(gettick() + AC_SCHEDULER_INTERVAL, ac_scheduler_timer, 0, 0, AC_SCHEDULER_INTERVAL);
+}
+
+void do_final_autocombat() {
+	ac_scheduler_slots.clear();
+	ac_scheduler_bots.clear();
+	ac_scheduler_deferred.clear();
+}
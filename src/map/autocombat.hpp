@@ -18,6 +18,9 @@
 #include <common/db.hpp>
 
 constexpr auto AC_WALK_CELL = 13;
+constexpr auto AC_DETECTION_CACHE_SIZE = 5; // Closest targets and items kept between searches
+constexpr auto AC_SCHEDULER_INTERVAL = 50; // Interval of the bot scheduler ticks in ms
+constexpr auto AC_SCHEDULER_WINDOW = 1200; // Scheduler ticks covered by the statistics
 constexpr auto AC_PREFIX_NAME = "[AUTO]";
 const std::vector<int> AC_HATEFFECTS = { 97, 131, 123, 31, 3 };
 extern std::vector<t_itemid> AC_ITEMIDS;
@@ -140,6 +143,17 @@ struct s_detection_cache {
     s_detection_cache() : last_update(0), last_x(-1), last_y(-1), cache_radius(0) {}  
 };
 
+/// Statistics of the bot scheduler
+struct s_ac_scheduler_stats {
+	uint32 bots; ///< Bots running
+	double turns_per_tick; ///< Average bot turns per scheduler tick
+	uint32 decisions_per_second; ///< Decision phases that ran per second
+	uint32 p99; ///< 99th percentile of the tick cost in microseconds
+	uint32 max; ///< Most expensive tick in microseconds
+	uint32 deferred; ///< Decision phases waiting for a tick with budget left
+	uint64 postponed; ///< Decision phases postponed since the last reset
+};
+
 struct s_autocombat {
 	time_t last_teleport;
 	time_t last_move;
@@ -174,6 +188,7 @@ struct s_autocombat {
 	int action_on_end;
 	int monster_surround;
 	t_tick duration_;
+	bool duration_dirty; // duration_ changed since #ac_duration was written
 	unsigned int unique_id;
 	uint32 client_addr;
 	int skill_range;
@@ -183,7 +198,7 @@ struct s_autocombat {
 void ac_save(map_session_data* sd);
 void ac_load(map_session_data* sd);
 void ac_skill_range_calc(map_session_data* sd);
-void ac_mob_ai_search_mvpcheck(struct block_list* bl, struct mob_data* md);
+void ac_mob_ai_search_mvpcheck(struct mob_data* md, int range);
 void ac_priority_on_hit(map_session_data* sd, struct block_list* src);
 void ac_target_change(map_session_data* sd, int id);
 void ac_reset_ondead(map_session_data* sd);
@@ -229,5 +244,14 @@ bool ac_changestate_autocombat(map_session_data* sd, int flag);
 int ac_get_random_coords(int16 m, int& x, int& y);
 bool ac_party_request(map_session_data* sd);
 void ac_moblist_reset_mapchange(map_session_data* sd);
+void ac_save_duration(map_session_data* sd);
+
+void ac_scheduler_add(map_session_data* sd);
+void ac_scheduler_remove(uint32 id);
+void ac_scheduler_stats(s_ac_scheduler_stats& stats);
+void ac_scheduler_reset_stats();
+
+void do_init_autocombat();
+void do_final_autocombat();
 
 #endif /* AUTOCOMBAT_HPP */
\ No newline at end of file
@@ -3142,7 +3142,7 @@ static bool is_attack_critical(struct Damage* wd, block_list *src, block_list *t
 		}
 		if(tsd && tsd->bonus.critical_def)
 			cri = cri * ( 100 - tsd->bonus.critical_def ) / 100;
-		return (rnd()%1000 < cri);
+		return (rnd_value(RND_STREAM_BATTLE, 0, 999) < cri);
 	}
 	return false;
 }
@@ -3391,7 +3391,7 @@ static bool is_attack_hitting(struct Damage* wd, block_list *src, block_list *ta
 	if(skill_id == PA_SHIELDCHAIN)
 		hitrate += 20; //Rapid Smiting gives a flat +20 hit after the hitrate was capped
 
-	return (rnd()%100 < hitrate);
+	return (rnd_value(RND_STREAM_BATTLE, 0, 99) < hitrate);
 }
 
 /*==========================================
@@ -12364,6 +12364,10 @@ static const struct _battle_data {
 	{ "major_overweight_rate",              &battle_config.major_overweight_rate,           90,     0,      100             },
 	{ "trade_count_stackable",              &battle_config.trade_count_stackable,           1,      0,      1,              },
 	{ "enable_bonus_map_drops",             &battle_config.enable_bonus_map_drops,          1,      0,      1,              },
+	{ "party_update_distance",              &battle_config.party_update_distance,           1,      1,      MAX_WALKPATH,   },
+	{ "guild_update_distance",              &battle_config.guild_update_distance,           1,      1,      MAX_WALKPATH,   },
+	{ "bg_update_distance",                 &battle_config.bg_update_distance,              1,      1,      MAX_WALKPATH,   },
+	{ "skill_splash_precalc",               &battle_config.skill_splash_precalc,            0,      0,      1,              },
 
 #include <custom/battle_config_init.inc>
 };
@@ -777,6 +777,10 @@ struct Battle_Config
 	int32 major_overweight_rate;
 	int32 trade_count_stackable;
 	int32 enable_bonus_map_drops;
+	int32 party_update_distance;
+	int32 guild_update_distance;
+	int32 bg_update_distance;
+	int32 skill_splash_precalc;
 
 #include <custom/battle_config_struct.inc>
 };
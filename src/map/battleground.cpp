@@ -531,6 +531,7 @@ bool bg_team_join(int32 bg_id, map_session_data *sd, bool is_queue)
 
 		sd->bg_id = bg_id;
 		member.sd = sd;
+		member.m = sd->m;
 		member.x = sd->x;
 		member.y = sd->y;
 		if (is_queue) { // Save the location from where the person entered the battleground
@@ -741,18 +742,26 @@ void bg_send_message(map_session_data *sd, const char *mes, size_t len)
  */
 int32 bg_send_xy_timer_sub(std::shared_ptr<s_battleground_data> bg)
 {
-	map_session_data *sd;
+	s_member_update_stats& stats = member_update_stats[MEMBER_UPDATE_BG];
+	map_session_data* moved[MAX_BG_MEMBERS];
+	size_t moved_count = 0;
 
 	for (auto &pl_sd : bg->members) {
-		sd = pl_sd.sd;
+		map_session_data *sd = pl_sd.sd;
 
-		if (sd->x != pl_sd.x || sd->y != pl_sd.y) { // xy update
+		if (sd->m != pl_sd.m || distance(sd->x - pl_sd.x, sd->y - pl_sd.y) >= battle_config.bg_update_distance) { // xy update
+			pl_sd.m = sd->m;
 			pl_sd.x = sd->x;
 			pl_sd.y = sd->y;
-			clif_bg_xy(sd);
-		}
+			moved[moved_count++] = sd;
+		} else
+			stats.suppressed++;
 	}
 
+	// Send all updates of the team at once, one write per member
+	if (moved_count > 0)
+		clif_bg_updates(*bg, moved, moved_count);
+
 	return 0;
 }
 
@@ -888,7 +897,7 @@ static bool bg_queue_check_status(map_session_data* sd, const char *name)
 		if (sd->sc.getSCE(SC_ENTRY_QUEUE_APPLY_DELAY)) { // Exclude any player who's recently left a battleground queue
 			char buf[CHAT_SIZE_MAX];
 
-			sprintf(buf, msg_txt(sd, 339), static_cast<int32>((get_timer(sd->sc.getSCE(SC_ENTRY_QUEUE_APPLY_DELAY)->timer)->tick - gettick()) / 1000)); // You can't apply to a battleground queue for %d seconds due to recently leaving one.
+			sprintf(buf, msg_txt(sd, 339), static_cast<int32>((status_change_get_timer_tick(sd->sc, SC_ENTRY_QUEUE_APPLY_DELAY) - gettick()) / 1000)); // You can't apply to a battleground queue for %d seconds due to recently leaving one.
 			clif_bg_queue_apply_result(BG_APPLY_NONE, name, sd);
 			clif_messagecolor(sd, color_table[COLOR_LIGHT_GREEN], buf, false, SELF);
 			return false;
@@ -896,7 +905,7 @@ static bool bg_queue_check_status(map_session_data* sd, const char *name)
 
 		if (sd->sc.getSCE(SC_ENTRY_QUEUE_NOTIFY_ADMISSION_TIME_OUT)) { // Exclude any player who's recently deserted a battleground
 			char buf[CHAT_SIZE_MAX];
-			int32 status_tick = static_cast<int32>(DIFF_TICK(get_timer(sd->sc.getSCE(SC_ENTRY_QUEUE_NOTIFY_ADMISSION_TIME_OUT)->timer)->tick, gettick()) / 1000);
+			int32 status_tick = static_cast<int32>(DIFF_TICK(status_change_get_timer_tick(sd->sc, SC_ENTRY_QUEUE_NOTIFY_ADMISSION_TIME_OUT), gettick()) / 1000);
 
 			sprintf(buf, msg_txt(sd, 338), status_tick / 60, status_tick % 60); // You can't apply to a battleground queue due to recently deserting a battleground. Time remaining: %d minutes and %d seconds.
 			clif_bg_queue_apply_result(BG_APPLY_NONE, name, sd);
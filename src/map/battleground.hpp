@@ -17,6 +17,7 @@ struct block_list;
 #define MAX_BG_MEMBERS 30
 
 struct s_battleground_member_data {
+	int16 m;
 	uint16 x, y;
 	map_session_data *sd;
 	unsigned afk : 1;
@@ -0,0 +1,1531 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#include <config/core.hpp>
+
+#ifdef MAP_BENCH
+
+#include "bench.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <common/core.hpp>
+#include <common/ers.hpp>
+#include <common/malloc.hpp>
+#include <common/mmo.hpp>
+#include <common/profiler.hpp>
+#include <common/random.hpp>
+#include <common/showmsg.hpp>
+#include <common/socket.hpp>
+#include <common/strlib.hpp>
+
+#include "battle.hpp"
+#include "chrif.hpp"
+#include "clif.hpp"
+#include "itemdb.hpp"
+#include "map.hpp"
+#include "mapreg.hpp"
+#include "mob.hpp"
+#include "npc.hpp"
+#include "pc.hpp"
+#include "script.hpp"
+#include "skill.hpp"
+#include "status.hpp"
+#include "unit.hpp"
+
+/// Interval of the think timer of the players
+#define BENCH_THINK_INTERVAL 100
+/// Interval in which killed monsters are replaced
+#define BENCH_SPAWN_INTERVAL 1000
+/// Monsters, floor items and script runs of the workload of --bench-alloc
+#define BENCH_ALLOC_OBJECTS 200
+/// Allocations that --bench-alloc frees on another thread
+#define BENCH_ALLOC_REMOTE 5000
+/// Entries of --bench-ers that are in use at the same time, like pending timers
+#define BENCH_ERS_LIVE 4096
+
+struct s_bench_config{
+	uint32 players;
+	uint32 mobs; ///< Monsters per map
+	std::vector<std::string> maps;
+	std::vector<int32> mob_ids;
+	t_tick duration; ///< Virtual milliseconds
+	uint32 seed;
+	uint32 items; ///< Filled inventory slots per player, potions first
+	std::string script; ///< Item script every player runs when it thinks
+	uint32 random_rolls; ///< Rolls of the random number microbenchmark, 0 to skip it
+	uint32 variable_runs; ///< Runs of each script of the script variable microbenchmark, 0 to skip it
+	uint32 chat_messages; ///< Messages of the npc chat pattern check, 0 to skip it
+	uint32 status_changes; ///< Buffs every player starts with, whose ends are checked, 0 to skip it
+	uint32 nearest_queries; ///< Queries of the nearest search check, 0 to skip it
+	uint32 alloc_rounds; ///< Replays of the allocation trace per allocator, 0 to skip it
+	uint32 ers_operations; ///< Allocations per cache of the entry manager comparison, 0 to skip it
+};
+
+static s_bench_config bench_config = { 100, 200, {}, {}, 60000, 0, 0, "", 0, 0, 0, 0, 0, 0, 0 };
+
+/// Potions of the synthetic inventories, used whenever a player is below half of its HP
+static const t_itemid bench_potions[] = { 501, 502, 503, 504, 505 };
+/// Script of --bench-items, when no other script was given
+static const char* bench_default_script = "if( countitem( 501 ) > 0 ){ delitem 501, 1; getitem 501, 1; } .@count = countitem( 502 ) + countitem( 503 ) + countitem( 504 ) + countitem( 505 );";
+
+/// Loops of --bench-vars, modelled on the shop and War of Emperium scripts. Both store their result in $@bench_vars.
+static const struct{
+	const char* name;
+	const char* code;
+} bench_variable_scripts[] = {
+	{ "shop",
+		"setarray .@items, 501, 502, 503, 504, 505, 506, 507, 508, 509, 510, 511, 512, 513, 514, 515, 516, 517, 518, 519, 520;"
+		"setarray .@prices, 50, 200, 550, 1200, 2500, 30, 60, 90, 120, 150, 180, 210, 240, 270, 300, 330, 360, 390, 420, 450;"
+		".@size = getarraysize( .@items );"
+		"for( .@round = 0; .@round < 10; .@round++ ){"
+		"	.@total = 0;"
+		"	.@count = 0;"
+		"	for( .@i = 0; .@i < .@size; .@i++ ){"
+		"		.@amount = ( .@i + .@round ) % 7;"
+		"		if( .@amount == 0 )"
+		"			continue;"
+		"		.@total += .@prices[.@i] * .@amount;"
+		"		.@count += .@amount;"
+		"		if( .@total > .max_zeny )"
+		"			.max_zeny = .@total;"
+		"	}"
+		"	.sales += .@count;"
+		"}"
+		"$@bench_vars = .@total + .sales + .max_zeny;" },
+	{ "woe",
+		"for( .@castle = 0; .@castle < 20; .@castle++ ){"
+		"	.@guardians = 0;"
+		"	.@hp = 0;"
+		"	for( .@g = 0; .@g < 8; .@g++ ){"
+		"		if( ( .@castle * 8 + .@g ) % 3 != 0 ){"
+		"			.@guardians++;"
+		"			.@hp += 15670 + .@g * 1000;"
+		"		}"
+		"	}"
+		"	.@economy = ( .@castle * 13 ) % 100;"
+		"	.@defense = ( .@castle * 7 ) % 100;"
+		"	.@score += .@guardians * .@economy + .@defense + .@hp / 1000;"
+		"	.rounds++;"
+		"}"
+		"$@bench_vars = .@score + .rounds;" },
+};
+
+/// Sizes of the memory --bench-alloc frees on other threads, around the size classes of the memory manager
+static const size_t bench_alloc_sizes[] = { 1, 16, 17, 100, 256, 257, 1000, 4096, 16383, 20000 };
+
+/// Entry managers of --bench-ers, by the name ers_stats lists them with and the options they are created with
+static const struct{
+	const char* name;
+	ERSOptions options;
+} bench_ers_caches[] = {
+	{ "npc.cpp::timer_event_ers", ERS_OPT_NONE },
+	{ "skill.cpp::skill_timer_ers", ERS_CACHE_OPTIONS },
+	{ "script.cpp::st_ers", ERS_CACHE_OPTIONS },
+};
+
+/// Script states of the --bench-alloc workload, building and splitting strings like item list NPCs do
+static const char* bench_alloc_script =
+	"for( .@i = 0; .@i < 20; .@i++ ){"
+	"	.@names$[.@i] = \"Item \" + .@i;"
+	"}"
+	".@list$ = implode( .@names$, \",\" );"
+	"explode( .@parts$, .@list$, \",\" );"
+	"$@bench_alloc = getarraysize( .@parts$ );";
+
+#ifdef PCRE_SUPPORT
+/// Patterns of --bench-chat, like shop, quiz and greeting NPCs use them. Set 4 stays inactive.
+/// The second script adds a back reference, which disables the combined pattern of the NPC.
+static const char* bench_chat_scripts[] = {
+	"defpattern 1, \"^!buy (\\\\w+) (\\\\d+)$\", \"OnBuy\";"
+	"defpattern 1, \"^!sell (\\\\w+)$\", \"OnSell\";"
+	"defpattern 1, \"price of (\\\\w+)\", \"OnPrice\";"
+	"defpattern 2, \"^(\\\\d+)\\\\s*\\\\+\\\\s*(\\\\d+)$\", \"OnSum\";"
+	"defpattern 2, \"^answer:? (.+)$\", \"OnAnswer\";"
+	"defpattern 3, \"\\\\b(hello|hi|hey)\\\\b\", \"OnGreet\";"
+	"defpattern 3, \"^warp (prontera|geffen|payon)$\", \"OnWarp\";"
+	"defpattern 3, \"[a-z]+@[a-z]+\\\\.com\", \"OnMail\";"
+	"defpattern 4, \".\", \"OnAll\";"
+	"activatepset 1; activatepset 2; activatepset 3;",
+	"defpattern 5, \"\\\\b(\\\\w)\\\\1\\\\b\", \"OnDouble\";"
+	"activatepset 5;",
+};
+
+/// Words the messages of --bench-chat are made of
+static const char* bench_chat_words[] = { "!buy", "!sell", "price", "of", "hello", "Hi", "HEY", "warp", "prontera", "geffen", "answer", "answer:", "apple", "potion", "12", "7", "+", "a@b.com", "aa", "zz", "x" };
+#endif
+
+/// Buffs of --bench-sc, none of them is cast by the players or ended by other statuses of the benchmark
+static const sc_type bench_statuses[] = { SC_GLORIA, SC_ANGELUS, SC_MAGNIFICAT, SC_IMPOSITIO, SC_ASSUMPTIO, SC_WEAPONPERFECTION, SC_TRUESIGHT, SC_CONCENTRATE };
+
+struct s_bench_skill{
+	uint16 id;
+	uint16 level;
+};
+
+/// Job of a synthetic player and the skills it uses
+struct s_bench_job{
+	int16 class_;
+	s_bench_skill skills[3];
+};
+
+static const s_bench_job bench_jobs[] = {
+	{ JOB_KNIGHT, { { SM_BASH, 10 }, { SM_MAGNUM, 10 }, { KN_BOWLINGBASH, 10 } } },
+	{ JOB_WIZARD, { { MG_FIREBOLT, 10 }, { WZ_STORMGUST, 10 }, { WZ_HEAVENDRIVE, 5 } } },
+	{ JOB_PRIEST, { { AL_HEAL, 10 }, { AL_BLESSING, 10 }, { AL_INCAGI, 10 } } },
+};
+
+struct s_bench_player{
+	uint32 account_id;
+	const s_bench_job* job;
+	t_tick next_think;
+	std::vector<std::pair<sc_type, t_tick>> statuses; ///< Buffs of --bench-sc and the tick they have to end on
+};
+
+struct s_bench_map{
+	int16 m;
+	std::vector<int32> mobs; ///< Ids of the spawned monsters, some may be dead already
+};
+
+static std::vector<s_bench_player> bench_players;
+static std::vector<s_bench_map> bench_maps;
+static int32 bench_char_fd = -1;
+static bool bench_running = false;
+static bool bench_finished = false;
+static t_tick bench_next_spawn = 0;
+static std::vector<t_itemid> bench_filler; ///< Light stackable items that fill the inventory after the potions
+static script_code* bench_script = nullptr;
+
+static struct{
+	uint32 login_failed;
+	uint64 login_time;
+	uint64 skills;
+	uint64 attacks;
+	uint64 walks;
+	uint64 revives;
+	uint64 spawns;
+	uint64 potions;
+	uint64 scripts;
+	uint64 status_started;
+	uint64 status_expired;
+	uint64 status_lost; ///< Ended by the death of the player
+	uint64 status_mismatches;
+	uint64 bytes_sent;
+	t_tick tick_start;
+	uint64 wall_start;
+	std::clock_t cpu_start;
+} bench_stats;
+
+/// Hot paths of the report, which sum up one or more profiler entries
+static const struct{
+	const char* name;
+	e_profiler_category category;
+	const char* entries[2];
+} bench_subsystems[] = {
+	{ "mob AI", PROFILER_TIMER, { "mob_ai_hard", "mob_ai_lazy" } },
+	{ "clif_send", PROFILER_FUNCTION, { "clif_send", nullptr } },
+	{ "status_calc_pc", PROFILER_FUNCTION, { "status_calc_pc", nullptr } },
+	{ "path_search", PROFILER_FUNCTION, { "path_search", nullptr } },
+	{ "skill_unit_timer", PROFILER_TIMER, { "skill_unit_timer", nullptr } },
+	{ "potion use", PROFILER_FUNCTION, { "bench_potion", nullptr } },
+	{ "item script", PROFILER_FUNCTION, { "bench_script", nullptr } },
+};
+
+/**
+ * Split a comma separated option value.
+ */
+static std::vector<std::string> bench_split( const char* value ){
+	std::vector<std::string> list;
+	std::string current;
+
+	for( const char* p = value; ; p++ ){
+		if( *p == ',' || *p == '\0' ){
+			if( !current.empty() ){
+				list.push_back( current );
+				current.clear();
+			}
+
+			if( *p == '\0' ){
+				break;
+			}
+		}else{
+			current += *p;
+		}
+	}
+
+	return list;
+}
+
+/**
+ * Read the benchmark options from the command line.
+ * Consumed options are cleared, so that cli_get_options skips them.
+ */
+void bench_get_options( int32 argc, char** argv ){
+	static const char* options[] = { "--bench-players", "--bench-mobs", "--bench-maps", "--bench-mob-ids", "--bench-ticks", "--bench-seed", "--bench-items", "--bench-script", "--bench-rng", "--bench-vars", "--bench-chat", "--bench-sc", "--bench-nearest", "--bench-alloc", "--bench-ers" };
+
+	for( int32 i = 1; i < argc; i++ ){
+		if( argv[i] == nullptr ){
+			continue;
+		}
+
+		size_t option = 0;
+
+		for( ; option < ARRAYLENGTH( options ); option++ ){
+			if( strcmp( argv[i], options[option] ) == 0 ){
+				break;
+			}
+		}
+
+		if( option == ARRAYLENGTH( options ) ){
+			continue;
+		}
+
+		if( i + 1 >= argc || argv[i + 1] == nullptr ){
+			ShowError( "Missing value for option '%s'.\n", argv[i] );
+			exit( EXIT_FAILURE );
+		}
+
+		const char* value = argv[i + 1];
+
+		switch( option ){
+			case 0:
+				bench_config.players = static_cast<uint32>( strtoul( value, nullptr, 10 ) );
+				break;
+			case 1:
+				bench_config.mobs = static_cast<uint32>( strtoul( value, nullptr, 10 ) );
+				break;
+			case 2:
+				bench_config.maps = bench_split( value );
+				break;
+			case 3:
+				bench_config.mob_ids.clear();
+
+				for( const std::string& id : bench_split( value ) ){
+					bench_config.mob_ids.push_back( atoi( id.c_str() ) );
+				}
+				break;
+			case 4:
+				bench_config.duration = static_cast<t_tick>( strtoll( value, nullptr, 10 ) );
+				break;
+			case 5:
+				bench_config.seed = static_cast<uint32>( strtoul( value, nullptr, 10 ) );
+				break;
+			case 6:
+				bench_config.items = std::min<uint32>( static_cast<uint32>( strtoul( value, nullptr, 10 ) ), MAX_INVENTORY );
+				break;
+			case 7:
+				bench_config.script = value;
+				break;
+			case 8:
+				bench_config.random_rolls = static_cast<uint32>( strtoul( value, nullptr, 10 ) );
+				break;
+			case 9:
+				bench_config.variable_runs = static_cast<uint32>( strtoul( value, nullptr, 10 ) );
+				break;
+			case 10:
+				bench_config.chat_messages = static_cast<uint32>( strtoul( value, nullptr, 10 ) );
+				break;
+			case 11:
+				bench_config.status_changes = std::min<uint32>( static_cast<uint32>( strtoul( value, nullptr, 10 ) ), ARRAYLENGTH( bench_statuses ) );
+				break;
+			case 12:
+				bench_config.nearest_queries = static_cast<uint32>( strtoul( value, nullptr, 10 ) );
+				break;
+			case 13:
+				bench_config.alloc_rounds = static_cast<uint32>( strtoul( value, nullptr, 10 ) );
+				break;
+			case 14:
+				bench_config.ers_operations = static_cast<uint32>( strtoul( value, nullptr, 10 ) );
+				break;
+		}
+
+		argv[i] = nullptr;
+		argv[i + 1] = nullptr;
+		i++;
+	}
+}
+
+/**
+ * Stops the clock and seeds the random generator, before any timer is added.
+ */
+void bench_open(){
+	if( bench_config.maps.empty() ){
+		bench_config.maps.push_back( "prt_fild08" );
+	}
+
+	if( bench_config.mob_ids.empty() ){
+		bench_config.mob_ids = { 1002, 1113, 1031, 1004, 1063 };
+	}
+
+	if( bench_config.items > 0 && bench_config.script.empty() ){
+		bench_config.script = bench_default_script;
+	}
+
+	if( bench_config.duration <= 0 ){
+		ShowError( "bench_open: The benchmark needs a positive amount of ticks, using 60000.\n" );
+		bench_config.duration = 60000;
+	}
+
+	timer_set_virtual_tick( gettick() );
+	rnd_seed( bench_config.seed );
+}
+
+/**
+ * Send function of the virtual sessions, the data is only counted.
+ */
+static int32 bench_send( int32 fd ){
+	bench_stats.bytes_sent += session[fd]->wdata_size;
+	session[fd]->wdata_size = 0;
+
+	return 0;
+}
+
+/**
+ * Hand a synthetic answer of the char-server to the char-server link.
+ */
+static void bench_char_packet( const std::vector<uint8>& data ){
+	socket_data* s = session[bench_char_fd];
+
+	RFIFOFLUSH( bench_char_fd );
+
+	if( s->max_rdata < s->rdata_size + data.size() ){
+		realloc_fifo( bench_char_fd, static_cast<uint32>( s->rdata_size + data.size() ), static_cast<uint32>( s->max_wdata ) );
+	}
+
+	memcpy( s->rdata + s->rdata_size, data.data(), data.size() );
+	s->rdata_size += data.size();
+	s->func_parse( bench_char_fd );
+}
+
+/**
+ * Log a synthetic player in through the same handlers a real login passes.
+ * The char-server answers to the authentication, registry, inventory and status change requests are faked.
+ * @return true if the player is on the map afterwards
+ */
+static bool bench_login( s_bench_player& player, uint32 index, const char* mapname ){
+	int32 fd = make_virtual_session( bench_send, clif_parse );
+
+	if( fd == -1 ){
+		return false;
+	}
+
+	uint32 account_id = START_ACCOUNT_NUM + index;
+	uint32 char_id = START_CHAR_NUM + index;
+	uint32 login_id1 = index + 1;
+	map_session_data* sd;
+
+	CREATE( sd, TBL_PC, 1 );
+	new( sd ) map_session_data();
+	sd->fd = fd;
+	session[fd]->session_data = sd;
+
+	pc_setnewpc( sd, account_id, char_id, login_id1, gettick(), SEX_MALE, fd );
+	chrif_authreq( sd, false );
+
+	player.account_id = account_id;
+	player.job = &bench_jobs[index % ARRAYLENGTH( bench_jobs )];
+	player.next_think = gettick() + rnd_value<t_tick>( 500, 1500 );
+
+	std::unique_ptr<mmo_charstatus> status = std::make_unique<mmo_charstatus>();
+
+	status->account_id = account_id;
+	status->char_id = char_id;
+	status->class_ = player.job->class_;
+	status->sex = SEX_MALE;
+	status->base_level = 99;
+	status->job_level = 50;
+	status->str = status->agi = status->vit = status->int_ = status->dex = status->luk = 50;
+	status->hp = status->max_hp = 10000;
+	status->sp = status->max_sp = 10000;
+	status->hair = 1;
+	safesnprintf( status->name, sizeof( status->name ), "bench%u", index );
+	// No coordinates, a random free cell of the map is used
+	safestrncpy( status->last_point.map, mapname, sizeof( status->last_point.map ) );
+	safestrncpy( status->save_point.map, mapname, sizeof( status->save_point.map ) );
+
+	for( const s_bench_skill& skill : player.job->skills ){
+		uint16 idx = skill_get_index( skill.id );
+
+		if( idx > 0 ){
+			status->skill[idx].id = skill.id;
+			status->skill[idx].lv = static_cast<uint8>( skill.level );
+		}
+	}
+
+	// 0x2afd: authentication ok
+	std::vector<uint8> buf( 25 + sizeof( mmo_charstatus ) );
+
+	WBUFW( buf.data(), 0 ) = 0x2afd;
+	WBUFW( buf.data(), 2 ) = static_cast<uint16>( buf.size() );
+	WBUFL( buf.data(), 4 ) = account_id;
+	WBUFL( buf.data(), 8 ) = login_id1;
+	WBUFL( buf.data(), 12 ) = 0;
+	WBUFL( buf.data(), 16 ) = 0;
+	WBUFL( buf.data(), 20 ) = 0;
+	WBUFB( buf.data(), 24 ) = 0;
+	memcpy( buf.data() + 25, status.get(), sizeof( mmo_charstatus ) );
+	bench_char_packet( buf );
+
+	// 0x3804: empty character, account and global account registries, the player joins the id database with the last of them
+	for( uint8 type = 3; type > 0; type-- ){
+		buf.assign( 16, 0 );
+		WBUFW( buf.data(), 0 ) = 0x3804;
+		WBUFW( buf.data(), 2 ) = 16;
+		WBUFL( buf.data(), 4 ) = account_id;
+		WBUFL( buf.data(), 8 ) = char_id;
+		WBUFB( buf.data(), 12 ) = type;
+		bench_char_packet( buf );
+	}
+
+	// 0x388a: inventory of potions and filler items
+	std::unique_ptr<s_storage> inventory = std::make_unique<s_storage>();
+
+	inventory->id = char_id;
+	inventory->type = TABLE_INVENTORY;
+	inventory->max_amount = MAX_INVENTORY;
+
+	for( uint32 i = 0; i < bench_config.items; i++ ){
+		item& it = inventory->u.items_inventory[i];
+
+		if( i < ARRAYLENGTH( bench_potions ) ){
+			it.nameid = bench_potions[i];
+			it.amount = 100;
+		}else if( i - ARRAYLENGTH( bench_potions ) < bench_filler.size() ){
+			it.nameid = bench_filler[i - ARRAYLENGTH( bench_potions )];
+			it.amount = 1;
+		}else{
+			break;
+		}
+
+		it.identify = 1;
+		inventory->amount++;
+	}
+
+	buf.assign( 10 + sizeof( s_storage ), 0 );
+	WBUFW( buf.data(), 0 ) = 0x388a;
+	WBUFW( buf.data(), 2 ) = static_cast<uint16>( buf.size() );
+	WBUFB( buf.data(), 4 ) = TABLE_INVENTORY;
+	WBUFL( buf.data(), 5 ) = account_id;
+	WBUFB( buf.data(), 9 ) = 1;
+	memcpy( buf.data() + 10, inventory.get(), sizeof( s_storage ) );
+	bench_char_packet( buf );
+
+	// 0x2b1d: no saved status changes
+	buf.assign( 14, 0 );
+	WBUFW( buf.data(), 0 ) = 0x2b1d;
+	WBUFW( buf.data(), 2 ) = 14;
+	WBUFL( buf.data(), 4 ) = account_id;
+	WBUFL( buf.data(), 8 ) = char_id;
+	bench_char_packet( buf );
+
+	if( map_id2sd( account_id ) != sd || !sd->state.pc_loaded ){
+		return false;
+	}
+
+	clif_parse_LoadEndAck( fd, sd );
+
+	return sd->prev != nullptr;
+}
+
+/**
+ * Fill up the monsters of a map to the configured amount.
+ */
+static void bench_spawn_mobs( s_bench_map& map ){
+	map.mobs.erase( std::remove_if( map.mobs.begin(), map.mobs.end(), []( int32 id ){
+		mob_data* md = map_id2md( id );
+
+		return md == nullptr || status_isdead( *md );
+	} ), map.mobs.end() );
+
+	while( map.mobs.size() < bench_config.mobs ){
+		int32 mob_id = bench_config.mob_ids[rnd_value<size_t>( 0, bench_config.mob_ids.size() - 1 )];
+		int32 id = mob_once_spawn( nullptr, map.m, 0, 0, "--ja--", mob_id, 1, "", SZ_SMALL, AI_NONE );
+
+		if( id == 0 ){
+			break;
+		}
+
+		map.mobs.push_back( id );
+		bench_stats.spawns++;
+	}
+}
+
+/**
+ * Monster next to a player, that is still alive.
+ */
+static block_list* bench_target( map_session_data* sd ){
+	return map_findnearest( sd, AREA_SIZE, BL_MOB, []( block_list* bl ){
+		return !status_isdead( *bl );
+	} );
+}
+
+/**
+ * Let a player walk to a random cell nearby.
+ */
+static void bench_walk( map_session_data* sd ){
+	int16 x = sd->x, y = sd->y;
+
+	if( map_search_freecell( sd, sd->m, &x, &y, 8, 8, 0 ) && unit_walktoxy( sd, x, y, 4 ) ){
+		bench_stats.walks++;
+	}
+}
+
+/**
+ * Pick the next action of a player: a skill, a normal attack or a walk.
+ */
+static void bench_think( s_bench_player& player ){
+	map_session_data* sd = map_id2sd( player.account_id );
+
+	if( sd == nullptr || sd->prev == nullptr ){
+		return;
+	}
+
+	if( pc_isdead( sd ) ){
+		status_revive( sd, 100, 100 );
+		bench_stats.revives++;
+		return;
+	}
+
+	// Still casting
+	if( sd->ud.skilltimer != INVALID_TIMER ){
+		return;
+	}
+
+	if( sd->battle_status.sp < sd->battle_status.max_sp / 4 ){
+		status_heal( sd, 0, sd->battle_status.max_sp, 0 );
+	}
+
+	// Like an autopotion loop, look the potions up by item id
+	if( sd->battle_status.hp < sd->battle_status.max_hp / 2 ){
+		ProfilerScope profile( "bench_potion" );
+
+		for( t_itemid potion : bench_potions ){
+			int16 index = pc_search_inventory( sd, potion );
+
+			if( index >= 0 && pc_useitem( sd, index ) ){
+				bench_stats.potions++;
+				break;
+			}
+		}
+	}
+
+	if( bench_script != nullptr ){
+		ProfilerScope profile( "bench_script" );
+
+		run_script( bench_script, 0, sd->id, fake_nd->id );
+		bench_stats.scripts++;
+	}
+
+	uint32 roll = rnd_value<uint32>( 0, 99 );
+
+	if( roll < 40 ){
+		const s_bench_skill& skill = player.job->skills[rnd_value<size_t>( 0, ARRAYLENGTH( player.job->skills ) - 1 )];
+
+		if( skill_get_casttype( skill.id ) == CAST_NODAMAGE ){
+			unit_skilluse_id( sd, sd->id, skill.id, skill.level );
+			bench_stats.skills++;
+			return;
+		}
+
+		block_list* target = bench_target( sd );
+
+		if( target == nullptr ){
+			bench_walk( sd );
+			return;
+		}
+
+		if( skill_get_casttype( skill.id ) == CAST_GROUND ){
+			unit_skilluse_pos( sd, target->x, target->y, skill.id, skill.level );
+		}else{
+			unit_skilluse_id( sd, target->id, skill.id, skill.level );
+		}
+
+		bench_stats.skills++;
+	}else if( roll < 75 ){
+		block_list* target = bench_target( sd );
+
+		if( target == nullptr ){
+			bench_walk( sd );
+			return;
+		}
+
+		unit_attack( sd, target->id, 1 );
+		bench_stats.attacks++;
+	}else{
+		bench_walk( sd );
+	}
+}
+
+/**
+ * Report a buff of --bench-sc that does not end on the tick a timer of its own would have ended it.
+ * Only the first mismatch is printed, all of them are counted.
+ */
+static void bench_status_mismatch( const s_bench_player& player, sc_type type, t_tick end, const char* problem ){
+	if( bench_stats.status_mismatches++ == 0 ){
+		ShowError( "bench_status_mismatch: Status %d of account %u should end on tick %" PRtf ", but it %s.\n", type, player.account_id, end, problem );
+	}
+}
+
+/**
+ * Start the buffs of --bench-sc with random durations, restarting some of them first.
+ * Restarting replaces the end of a status, even with an earlier one.
+ */
+static void bench_start_statuses( s_bench_player& player ){
+	map_session_data* sd = map_id2sd( player.account_id );
+
+	if( sd == nullptr ){
+		return;
+	}
+
+	for( uint32 i = 0; i < bench_config.status_changes; i++ ){
+		sc_type type = bench_statuses[i];
+
+		if( rnd_chance( 50, 100 ) ){
+			status_change_start( sd, sd, type, 10000, 1, 0, 0, 0, rnd_value<t_tick>( 1, bench_config.duration ), SCSTART_NOAVOID | SCSTART_NOTICKDEF | SCSTART_NORATEDEF );
+		}
+
+		t_tick duration = rnd_value<t_tick>( 1, bench_config.duration );
+		t_tick end = gettick() + duration;
+
+		if( !status_change_start( sd, sd, type, 10000, 1, 0, 0, 0, duration, SCSTART_NOAVOID | SCSTART_NOTICKDEF | SCSTART_NORATEDEF ) ){
+			bench_status_mismatch( player, type, end, "did not start" );
+			continue;
+		}
+
+		if( status_change_get_timer_tick( sd->sc, type ) != end ){
+			bench_status_mismatch( player, type, end, "was scheduled on another tick" );
+			continue;
+		}
+
+		player.statuses.push_back( std::make_pair( type, end ) );
+		bench_stats.status_started++;
+	}
+}
+
+/**
+ * Check that the buffs of --bench-sc are active with their end scheduled until that tick and gone afterwards.
+ * On the tick itself the order of the timers is undefined, so the check waits for the next think interval.
+ */
+static void bench_check_statuses( s_bench_player& player, t_tick tick ){
+	if( player.statuses.empty() ){
+		return;
+	}
+
+	map_session_data* sd = map_id2sd( player.account_id );
+
+	if( sd == nullptr || pc_isdead( sd ) ){
+		bench_stats.status_lost += player.statuses.size();
+		player.statuses.clear();
+		return;
+	}
+
+	for( auto it = player.statuses.begin(); it != player.statuses.end(); ){
+		sc_type type = it->first;
+		t_tick end = it->second;
+		t_tick diff = DIFF_TICK( tick, end );
+
+		if( diff == 0 ){
+			it++;
+		}else if( diff < 0 ){
+			if( sd->sc.getSCE( type ) == nullptr ){
+				bench_status_mismatch( player, type, end, "ended early" );
+				it = player.statuses.erase( it );
+			}else if( status_change_get_timer_tick( sd->sc, type ) != end ){
+				bench_status_mismatch( player, type, end, "was moved" );
+				it = player.statuses.erase( it );
+			}else{
+				it++;
+			}
+		}else{
+			if( sd->sc.getSCE( type ) != nullptr ){
+				bench_status_mismatch( player, type, end, "is still active" );
+			}else{
+				bench_stats.status_expired++;
+			}
+
+			it = player.statuses.erase( it );
+		}
+	}
+}
+
+static TIMER_FUNC(bench_timer){
+	if( !bench_running ){
+		return 0;
+	}
+
+	for( s_bench_player& player : bench_players ){
+		bench_check_statuses( player, tick );
+
+		if( DIFF_TICK( tick, player.next_think ) >= 0 ){
+			bench_think( player );
+			player.next_think = tick + rnd_value<t_tick>( 500, 1500 );
+		}
+	}
+
+	if( DIFF_TICK( tick, bench_next_spawn ) >= 0 ){
+		for( s_bench_map& map : bench_maps ){
+			bench_spawn_mobs( map );
+		}
+
+		bench_next_spawn = tick + BENCH_SPAWN_INTERVAL;
+	}
+
+	return 0;
+}
+
+/**
+ * Compare the cost of a drop roll between std::mt19937 with std::uniform_int_distribution,
+ * which rnd_value used before, rnd_value and a batch of rnd_fill.
+ * The random generators are seeded again afterwards, so the simulation is the same with or without it.
+ */
+static void bench_random(){
+	uint32 count = bench_config.random_rolls;
+	std::mt19937 mt( bench_config.seed );
+	std::uniform_int_distribution<int32> dist( 0, 9999 );
+	std::vector<int32> rolls( count );
+	uint64 checksum = 0;
+
+	uint64 start = profiler_clock();
+
+	for( uint32 i = 0; i < count; i++ ){
+		checksum += dist( mt );
+	}
+
+	uint64 mt_time = profiler_clock() - start;
+
+	start = profiler_clock();
+
+	for( uint32 i = 0; i < count; i++ ){
+		checksum += rnd_value<int32>( 0, 9999 );
+	}
+
+	uint64 value_time = profiler_clock() - start;
+
+	start = profiler_clock();
+	rnd_fill( RND_STREAM_DROP, rolls.data(), count, 0, 9999 );
+
+	for( int32 roll : rolls ){
+		checksum += roll;
+	}
+
+	uint64 fill_time = profiler_clock() - start;
+
+	ShowInfo( "Random rolls: %u, checksum %" PRIu64 ". Per roll: std::mt19937 %.2f ns, rnd_value %.2f ns, rnd_fill %.2f ns.\n", count, checksum,
+		mt_time * 1000.0 / count, value_time * 1000.0 / count, fill_time * 1000.0 / count );
+
+	rnd_seed( bench_config.seed );
+}
+
+/**
+ * Time typical NPC loops with the scope and npc variables addressed by slot and with all of them in their databases.
+ * Both copies of a script start with empty npc variables, so they have to come to the same result.
+ * The variables of the loops are used by the NPC scripts as well, so the copy with slots has to get them
+ * no matter which scripts were parsed before.
+ */
+static void bench_variables(){
+	int64 result_uid = reference_uid( add_str( "$@bench_vars" ), 0 );
+
+	for( const auto& script : bench_variable_scripts ){
+		uint64 time[2];
+		int64 result[2];
+		uint16 slots = 0;
+
+		for( int32 i = 0; i < 2; i++ ){
+			script_code* code = parse_script( script.code, "bench", 0, SCRIPT_IGNORE_EXTERNAL_BRACKETS | ( i == 0 ? 0 : SCRIPT_NO_VARIABLE_SLOTS ) );
+
+			if( code == nullptr ){
+				ShowFatalError( "bench_variables: The %s script does not compile.\n", script.name );
+				exit( EXIT_FAILURE );
+			}
+
+			if( ( code->slot_count > 0 ) != ( i == 0 ) ){
+				ShowFatalError( "bench_variables: The %s script addresses %u variables by slot, the %s copy should address %s.\n", script.name, code->slot_count, i == 0 ? "first" : "second", i == 0 ? "some" : "none" );
+				exit( EXIT_FAILURE );
+			}
+
+			if( i == 0 ){
+				slots = code->slot_count;
+			}
+
+			uint64 start = profiler_clock();
+
+			for( uint32 run = 0; run < bench_config.variable_runs; run++ ){
+				run_script( code, 0, 0, fake_nd->id );
+			}
+
+			time[i] = profiler_clock() - start;
+			result[i] = mapreg_readreg( result_uid );
+			script_free_code( code );
+		}
+
+		ShowInfo( "Script variables, %s loop: %u variables by slot, %u runs, slots %.2f us, databases %.2f us per run (%.2fx).\n", script.name, slots, bench_config.variable_runs,
+			static_cast<double>( time[0] ) / bench_config.variable_runs, static_cast<double>( time[1] ) / bench_config.variable_runs, time[0] > 0 ? static_cast<double>( time[1] ) / time[0] : 0.0 );
+
+		if( result[0] != result[1] ){
+			ShowError( "bench_variables: The %s loop returned %" PRId64 " with slots but %" PRId64 " without.\n", script.name, result[0], result[1] );
+		}
+	}
+}
+
+/**
+ * Allocate memory of the sizes around the size classes of the memory manager and fill it with a pattern.
+ */
+static void bench_alloc_fill( std::vector<uint8*>& blocks, uint32 seed ){
+
+	blocks.resize( BENCH_ALLOC_REMOTE );
+
+	for( size_t i = 0; i < blocks.size(); i++ ){
+		size_t size = bench_alloc_sizes[i % ARRAYLENGTH( bench_alloc_sizes )];
+
+		blocks[i] = static_cast<uint8*>( aMalloc( size ) );
+		memset( blocks[i], static_cast<int32>( ( i + seed ) & 0xFF ), size );
+	}
+}
+
+/**
+ * Check the pattern of bench_alloc_fill and free the memory.
+ * @return amount of corrupted blocks
+ */
+static uint32 bench_alloc_check( std::vector<uint8*>& blocks, uint32 seed ){
+	uint32 corrupted = 0;
+
+	for( size_t i = 0; i < blocks.size(); i++ ){
+		size_t size = bench_alloc_sizes[i % ARRAYLENGTH( bench_alloc_sizes )];
+		uint8 value = static_cast<uint8>( ( i + seed ) & 0xFF );
+
+		if( blocks[i][0] != value || blocks[i][size - 1] != value ){
+			corrupted++;
+		}
+
+		aFree( blocks[i] );
+	}
+
+	blocks.clear();
+
+	return corrupted;
+}
+
+/**
+ * Free memory on another thread than the one that allocated it, in both directions,
+ * and once after the allocating thread ended. The memory has to come back intact and the usage has to drop again.
+ */
+static void bench_alloc_threads(){
+	std::vector<uint8*> blocks;
+	uint32 corrupted = 0;
+	size_t usage = malloc_usage();
+
+	bench_alloc_fill( blocks, 1 );
+	std::thread( [&blocks, &corrupted](){
+		corrupted += bench_alloc_check( blocks, 1 );
+	} ).join();
+
+	// The main thread reuses the memory the other thread handed back
+	bench_alloc_fill( blocks, 2 );
+	corrupted += bench_alloc_check( blocks, 2 );
+
+	// Memory of a thread that already ended is freed by the main thread, the next thread takes it over
+	std::thread( [&blocks](){
+		bench_alloc_fill( blocks, 3 );
+	} ).join();
+	corrupted += bench_alloc_check( blocks, 3 );
+
+	std::thread( [&blocks, &corrupted](){
+		bench_alloc_fill( blocks, 4 );
+		corrupted += bench_alloc_check( blocks, 4 );
+	} ).join();
+
+	size_t left = malloc_usage();
+
+	if( corrupted > 0 || left > usage + usage / 100 + 64 ){
+		ShowFatalError( "bench_alloc: Freeing on other threads corrupted %u blocks, %" PRIuPTR " KB were in use before and %" PRIuPTR " KB after.\n", corrupted, usage, left );
+		exit( EXIT_FAILURE );
+	}
+
+	ShowInfo( "Allocator, other threads: %u blocks freed across threads, %" PRIuPTR " KB in use before, %" PRIuPTR " KB after.\n", BENCH_ALLOC_REMOTE * 4, usage, left );
+}
+
+/**
+ * Record the allocations of spawning and killing monsters, dropping and clearing items and running script states,
+ * then replay them against every allocator.
+ * The random generators are seeded again afterwards, so the simulation is the same with or without it.
+ */
+static void bench_alloc(){
+	std::vector<s_malloc_trace_op> trace;
+	std::vector<int32> ids;
+	int16 m = bench_maps.front().m;
+	script_code* code = parse_script( bench_alloc_script, "bench", 0, SCRIPT_IGNORE_EXTERNAL_BRACKETS );
+
+	if( code == nullptr ){
+		ShowFatalError( "bench_alloc: The script does not compile.\n" );
+		exit( EXIT_FAILURE );
+	}
+
+	malloc_trace_start( trace );
+
+	for( uint32 i = 0; i < BENCH_ALLOC_OBJECTS; i++ ){
+		int32 mob_id = bench_config.mob_ids[rnd_value<size_t>( 0, bench_config.mob_ids.size() - 1 )];
+		int32 id = mob_once_spawn( nullptr, m, 0, 0, "--ja--", mob_id, 1, "", SZ_SMALL, AI_NONE );
+
+		if( id != 0 ){
+			ids.push_back( id );
+		}
+	}
+
+	for( int32 id : ids ){
+		mob_data* md = map_id2md( id );
+
+		if( md != nullptr ){
+			unit_free( md, CLR_DEAD );
+		}
+	}
+
+	ids.clear();
+
+	for( uint32 i = 0; i < BENCH_ALLOC_OBJECTS; i++ ){
+		item it = {};
+		int16 x = 0, y = 0;
+
+		it.nameid = bench_potions[i % ARRAYLENGTH( bench_potions )];
+		it.identify = 1;
+
+		if( map_search_freecell( nullptr, m, &x, &y, -1, -1, 0 ) ){
+			int32 id = map_addflooritem( &it, 1, m, x, y, 0, 0, 0, 0, 0 );
+
+			if( id != 0 ){
+				ids.push_back( id );
+			}
+		}
+	}
+
+	for( int32 id : ids ){
+		block_list* bl = map_id2bl( id );
+
+		if( bl != nullptr ){
+			map_clearflooritem( bl );
+		}
+	}
+
+	for( uint32 i = 0; i < BENCH_ALLOC_OBJECTS; i++ ){
+		run_script( code, 0, 0, fake_nd->id );
+	}
+
+	uint32 count = malloc_trace_stop();
+
+	script_free_code( code );
+
+	uint32 frees = 0;
+
+	for( const s_malloc_trace_op& op : trace ){
+		if( op.type == MALLOC_TRACE_FREE ){
+			frees++;
+		}
+	}
+
+	ShowInfo( "Allocator trace: %" PRIuPTR " calls, %u allocations, %u freed by the workload.\n", trace.size(), count, frees );
+
+	size_t backend_count;
+	const s_malloc_backend* backends = malloc_backends( backend_count );
+	std::vector<void*> blocks( count );
+	uint64 active_time = 0;
+	std::vector<uint64> times( backend_count );
+
+	for( size_t b = 0; b < backend_count; b++ ){
+		const s_malloc_backend& backend = backends[b];
+		uint64 start = profiler_clock();
+
+		for( uint32 round = 0; round < bench_config.alloc_rounds; round++ ){
+			for( const s_malloc_trace_op& op : trace ){
+				switch( op.type ){
+					case MALLOC_TRACE_ALLOC:
+						blocks[op.index] = backend.allocate( std::max<size_t>( op.size, 1 ) );
+						static_cast<char*>( blocks[op.index] )[0] = 0;
+						break;
+					case MALLOC_TRACE_REALLOC:
+						blocks[op.index] = backend.reallocate( blocks[op.index], std::max<size_t>( op.size, 1 ) );
+						break;
+					case MALLOC_TRACE_FREE:
+						backend.release( blocks[op.index] );
+						blocks[op.index] = nullptr;
+						break;
+				}
+			}
+
+			// Memory the workload kept, like grown databases
+			for( void*& block : blocks ){
+				if( block != nullptr ){
+					backend.release( block );
+					block = nullptr;
+				}
+			}
+		}
+
+		times[b] = profiler_clock() - start;
+
+		if( strcmp( backend.name, malloc_active_backend() ) == 0 ){
+			active_time = times[b];
+		}
+	}
+
+	uint64 calls = static_cast<uint64>( trace.size() ) * bench_config.alloc_rounds;
+
+	for( size_t b = 0; b < backend_count; b++ ){
+		ShowInfo( "Allocator, %s%s: %u rounds, %.2f ns per call (%.2fx of aMalloc).\n", backends[b].name, strcmp( backends[b].name, malloc_active_backend() ) == 0 ? " (aMalloc)" : "",
+			bench_config.alloc_rounds, calls > 0 ? times[b] * 1000.0 / calls : 0.0, active_time > 0 ? static_cast<double>( times[b] ) / active_time : 0.0 );
+	}
+
+	bench_alloc_threads();
+
+	rnd_seed( bench_config.seed );
+}
+
+/**
+ * Churn entries of the size of the timer, skill timer and script state caches through the entry manager
+ * and through the manager before its slabs and magazines. Entries are freed in random order, like timers expire.
+ * The entries are picked by a generator of its own, so the simulation is the same with or without it.
+ */
+static void bench_ers(){
+	std::vector<s_ers_stats> stats;
+	std::mt19937 mt( bench_config.seed );
+	std::vector<uint32> picks( bench_config.ers_operations );
+
+	for( uint32& pick : picks ){
+		pick = mt() % BENCH_ERS_LIVE;
+	}
+
+	ers_stats( stats );
+
+	for( const auto& cache : bench_ers_caches ){
+		auto found = std::find_if( stats.begin(), stats.end(), [&cache]( const s_ers_stats& entry ){
+			return strcmp( entry.name, cache.name ) == 0;
+		} );
+
+		if( found == stats.end() ){
+			ShowWarning( "bench_ers: The entry manager '%s' does not exist.\n", cache.name );
+			continue;
+		}
+
+		size_t size = found->entry_size;
+		uint64 time[2];
+		uint32 corrupted = 0;
+
+		for( int32 i = 0; i < 2; i++ ){
+			ERS* ers = i == 0 ? ers_new( static_cast<uint32>( size ), "bench.cpp::bench_ers", cache.options ) : ers_new_legacy( static_cast<uint32>( size ), "bench.cpp::bench_ers", cache.options );
+
+			if( ers == nullptr ){
+				return;
+			}
+
+			std::vector<uint32*> entries( BENCH_ERS_LIVE );
+
+			uint64 start = profiler_clock();
+
+			for( uint32 j = 0; j < BENCH_ERS_LIVE; j++ ){
+				entries[j] = ers_alloc( ers, uint32 );
+				*entries[j] = j;
+			}
+
+			for( uint32 j = 0; j < bench_config.ers_operations; j++ ){
+				uint32*& entry = entries[picks[j]];
+
+				if( *entry != picks[j] ){
+					corrupted++;
+				}
+
+				ers_free( ers, entry );
+				entry = ers_alloc( ers, uint32 );
+				*entry = picks[j];
+			}
+
+			for( uint32* entry : entries ){
+				ers_free( ers, entry );
+			}
+
+			time[i] = profiler_clock() - start;
+			ers_destroy( ers );
+		}
+
+		uint64 operations = static_cast<uint64>( bench_config.ers_operations ) + BENCH_ERS_LIVE;
+
+		ShowInfo( "Entry manager, %s: %" PRIuPTR " bytes, %u live, %u allocations, slabs %.2f ns, 1.0 %.2f ns per allocation and free (%.2fx), %u corrupted.\n", cache.name, size, BENCH_ERS_LIVE,
+			bench_config.ers_operations, time[0] * 1000.0 / operations, time[1] * 1000.0 / operations, time[0] > 0 ? static_cast<double>( time[1] ) / time[0] : 0.0, corrupted );
+
+		if( corrupted > 0 ){
+			ShowError( "bench_ers: %u entries of '%s' were changed while they were in use.\n", corrupted, cache.name );
+		}
+	}
+}
+
+#ifdef PCRE_SUPPORT
+/**
+ * Match random chat messages against the patterns of a NPC with and without its combined pattern.
+ * The combined pattern only rejects messages early, so both have to pick the same label for every message.
+ * The random generators are seeded again afterwards, so the simulation is the same with or without it.
+ */
+static void bench_chat(){
+	uint32 count = bench_config.chat_messages;
+	std::vector<std::string> messages( count );
+
+	for( std::string& message : messages ){
+		for( uint32 words = rnd_value<uint32>( 1, 5 ); words > 0; words-- ){
+			if( !message.empty() ){
+				message += ' ';
+			}
+
+			message += bench_chat_words[rnd_value<size_t>( 0, ARRAYLENGTH( bench_chat_words ) - 1 )];
+		}
+	}
+
+	for( size_t i = 0; i < ARRAYLENGTH( bench_chat_scripts ); i++ ){
+		script_code* code = parse_script( bench_chat_scripts[i], "bench", 0, SCRIPT_IGNORE_EXTERNAL_BRACKETS );
+
+		if( code == nullptr ){
+			ShowFatalError( "bench_chat: The patterns do not compile.\n" );
+			exit( EXIT_FAILURE );
+		}
+
+		// The patterns of the previous scripts stay defined
+		run_script( code, 0, 0, fake_nd->id );
+		script_free_code( code );
+
+		std::vector<const char*> labels[2];
+		uint64 time[2];
+
+		for( int32 j = 0; j < 2; j++ ){
+			labels[j].reserve( count );
+
+			uint64 start = profiler_clock();
+
+			for( const std::string& message : messages ){
+				labels[j].push_back( npc_chat_match( fake_nd, message.c_str(), static_cast<int32>( message.length() ), j == 0 ) );
+			}
+
+			time[j] = profiler_clock() - start;
+		}
+
+		uint32 matched = 0, mismatches = 0;
+
+		for( uint32 j = 0; j < count; j++ ){
+			if( labels[0][j] != nullptr ){
+				matched++;
+			}
+
+			if( ( labels[0][j] == nullptr ) != ( labels[1][j] == nullptr ) || ( labels[0][j] != nullptr && strcmp( labels[0][j], labels[1][j] ) != 0 ) ){
+				if( mismatches++ == 0 ){
+					ShowError( "bench_chat: '%s' runs %s with the combined pattern, but %s without it.\n", messages[j].c_str(),
+						labels[0][j] != nullptr ? labels[0][j] : "nothing", labels[1][j] != nullptr ? labels[1][j] : "nothing" );
+				}
+			}
+		}
+
+		ShowInfo( "Chat patterns, %s: %u messages, %u matched, combined %.2f us, single %.2f us per message (%.2fx), %u mismatches.\n", i == 0 ? "plain" : "back reference",
+			count, matched, count > 0 ? static_cast<double>( time[0] ) / count : 0.0, count > 0 ? static_cast<double>( time[1] ) / count : 0.0,
+			time[0] > 0 ? static_cast<double>( time[1] ) / time[0] : 0.0, mismatches );
+	}
+
+	npc_chat_finalize( fake_nd );
+	fake_nd->chatdb = nullptr;
+
+	rnd_seed( bench_config.seed );
+}
+#endif
+
+/**
+ * Called once the server is initialized.
+ * Creates the virtual char-server link and checks the maps and monsters of the benchmark.
+ */
+void bench_start(){
+	for( const std::string& name : bench_config.maps ){
+		int16 m = map_mapname2mapid( name.c_str() );
+
+		if( m < 0 ){
+			ShowFatalError( "bench_start: Map '%s' is not loaded by this map-server.\n", name.c_str() );
+			exit( EXIT_FAILURE );
+		}
+
+		bench_maps.push_back( { m, {} } );
+	}
+
+	for( int32 mob_id : bench_config.mob_ids ){
+		if( !mobdb_checkid( mob_id ) ){
+			ShowFatalError( "bench_start: Unknown monster %d.\n", mob_id );
+			exit( EXIT_FAILURE );
+		}
+	}
+
+	bench_char_fd = make_virtual_session( bench_send, nullptr );
+
+	if( bench_char_fd == -1 ){
+		ShowFatalError( "bench_start: Cannot create the char-server session.\n" );
+		exit( EXIT_FAILURE );
+	}
+
+	chrif_attach( bench_char_fd );
+
+	for( const auto& entry : item_db ){
+		item_data* id = entry.second.get();
+
+		if( bench_filler.size() + ARRAYLENGTH( bench_potions ) >= bench_config.items ){
+			break;
+		}
+
+		if( id->type == IT_ETC && id->weight <= 10 && itemdb_isstackable2( id ) ){
+			bench_filler.push_back( id->nameid );
+		}
+	}
+
+	if( !bench_config.script.empty() ){
+		bench_script = parse_script( bench_config.script.c_str(), "bench", 0, SCRIPT_IGNORE_EXTERNAL_BRACKETS );
+
+		if( bench_script == nullptr ){
+			ShowFatalError( "bench_start: The benchmark script does not compile.\n" );
+			exit( EXIT_FAILURE );
+		}
+	}
+
+	if( bench_config.random_rolls > 0 ){
+		bench_random();
+	}
+
+	if( bench_config.variable_runs > 0 ){
+		bench_variables();
+	}
+
+	if( bench_config.alloc_rounds > 0 ){
+		bench_alloc();
+	}
+
+	if( bench_config.ers_operations > 0 ){
+		bench_ers();
+	}
+
+	if( bench_config.chat_messages > 0 ){
+#ifdef PCRE_SUPPORT
+		bench_chat();
+#else
+		ShowWarning( "bench_start: --bench-chat needs a map-server with PCRE support.\n" );
+#endif
+	}
+
+	profiler_set_enabled( true );
+
+	add_timer_func_list( bench_timer, "bench_timer" );
+	add_timer_interval( gettick() + BENCH_THINK_INTERVAL, bench_timer, 0, 0, BENCH_THINK_INTERVAL );
+
+	ShowStatus( "Benchmarking %u players and %u monsters per map on %" PRIuPTR " maps for %" PRtf " virtual ms with seed %u.\n",
+		bench_config.players, bench_config.mobs, bench_maps.size(), bench_config.duration, bench_config.seed );
+}
+
+/**
+ * Log the players in and spawn the monsters.
+ * Done on the first step, the char-server answers are refused while the server is still starting.
+ */
+static void bench_populate(){
+	uint64 start = profiler_clock();
+
+	bench_players.resize( bench_config.players );
+
+	for( uint32 i = 0; i < bench_config.players; i++ ){
+		const s_bench_map& map = bench_maps[i % bench_maps.size()];
+
+		if( !bench_login( bench_players[i], i, map_getmapdata( map.m )->name ) ){
+			bench_stats.login_failed++;
+		}else if( bench_config.status_changes > 0 ){
+			bench_start_statuses( bench_players[i] );
+		}
+	}
+
+	bench_stats.login_time = profiler_clock() - start;
+
+	for( s_bench_map& map : bench_maps ){
+		bench_spawn_mobs( map );
+	}
+
+	send_shortlist_do_sends();
+}
+
+/**
+ * Collect every object of a full area scan.
+ */
+static int32 bench_nearest_sub( block_list* bl, va_list ap ){
+	std::vector<block_list*>* list = va_arg( ap, std::vector<block_list*>* );
+
+	list->push_back( bl );
+
+	return 1;
+}
+
+/**
+ * Search the closest monsters around random players with the block grid and with a full area scan.
+ * Objects at the same distance come in no particular order, so the distances of both results are compared.
+ * The players are picked by a generator of its own, so the simulation is the same with or without it.
+ */
+static void bench_nearest(){
+	static const size_t counts[] = { 1, 3, 8 };
+	std::mt19937 mt( bench_config.seed );
+	std::vector<block_list*> grid, scan;
+	uint64 time[2] = {}, found = 0;
+	uint32 queries = 0, mismatches = 0;
+
+	// Every third monster is rejected, so the search has to look past the first candidates
+	auto predicate = []( block_list* bl ){
+		return !status_isdead( *bl ) && bl->id % 3 != 0;
+	};
+
+	for( uint32 i = 0; i < bench_config.nearest_queries && !bench_players.empty(); i++ ){
+		map_session_data* sd = map_id2sd( bench_players[mt() % bench_players.size()].account_id );
+
+		if( sd == nullptr || sd->prev == nullptr ){
+			continue;
+		}
+
+		int16 range = static_cast<int16>( 1 + mt() % AREA_SIZE );
+		size_t count = counts[mt() % ARRAYLENGTH( counts )];
+
+		grid.clear();
+		scan.clear();
+
+		uint64 start = profiler_clock();
+
+		map_findnearest_k( sd, range, BL_MOB, count, predicate, grid );
+
+		time[0] += profiler_clock() - start;
+		start = profiler_clock();
+
+		map_foreachinallrange( bench_nearest_sub, sd, range, BL_MOB, &scan );
+		scan.erase( std::remove_if( scan.begin(), scan.end(), [&predicate]( block_list* bl ){
+			return !predicate( bl );
+		} ), scan.end() );
+		std::sort( scan.begin(), scan.end(), [sd]( const block_list* a, const block_list* b ){
+			return distance_bl( sd, a ) < distance_bl( sd, b );
+		} );
+		scan.resize( std::min( scan.size(), count ) );
+
+		time[1] += profiler_clock() - start;
+		queries++;
+		found += grid.size();
+
+		bool equal = grid.size() == scan.size();
+
+		for( size_t j = 0; equal && j < grid.size(); j++ ){
+			equal = distance_bl( sd, grid[j] ) == distance_bl( sd, scan[j] );
+		}
+
+		if( !equal && mismatches++ == 0 ){
+			ShowError( "bench_nearest: The grid found %" PRIuPTR " of %" PRIuPTR " monsters in range %d of %s, the full scan %" PRIuPTR ".\n", grid.size(), count, range, sd->status.name, scan.size() );
+		}
+	}
+
+	ShowInfo( "Nearest search: %u queries, %" PRIu64 " monsters found, grid %.2f us, full scan %.2f us per query (%.2fx), %u mismatches.\n", queries, found,
+		queries > 0 ? static_cast<double>( time[0] ) / queries : 0.0, queries > 0 ? static_cast<double>( time[1] ) / queries : 0.0,
+		time[0] > 0 ? static_cast<double>( time[1] ) / time[0] : 0.0, mismatches );
+}
+
+/**
+ * Print the summary of the benchmark.
+ */
+static void bench_report(){
+	uint64 wall = profiler_clock() - bench_stats.wall_start;
+	t_tick ticks = DIFF_TICK( gettick(), bench_stats.tick_start );
+	double cpu = static_cast<double>( std::clock() - bench_stats.cpu_start ) / CLOCKS_PER_SEC;
+
+	ShowStatus( "Benchmark finished.\n" );
+	ShowInfo( "Players: %u (%u failed to log in), monsters: %u per map on %" PRIuPTR " maps, login took %" PRIu64 " ms.\n",
+		bench_config.players, bench_stats.login_failed, bench_config.mobs, bench_maps.size(), bench_stats.login_time / 1000 );
+	ShowInfo( "Virtual time: %" PRtf " ms, wall time: %" PRIu64 " ms (%.1fx real time), CPU time: %.3f s.\n",
+		ticks, wall / 1000, wall > 0 ? ticks * 1000.0 / wall : 0.0, cpu );
+	ShowInfo( "Actions: %" PRIu64 " skills, %" PRIu64 " attacks, %" PRIu64 " walks, %" PRIu64 " revives, %" PRIu64 " monsters spawned, %" PRIu64 " bytes sent.\n",
+		bench_stats.skills, bench_stats.attacks, bench_stats.walks, bench_stats.revives, bench_stats.spawns, bench_stats.bytes_sent );
+	ShowInfo( "Items: %u inventory slots per player, %" PRIu64 " potions used, %" PRIu64 " item scripts run.\n",
+		bench_config.items, bench_stats.potions, bench_stats.scripts );
+
+	if( bench_config.status_changes > 0 ){
+		ShowInfo( "Status changes: %" PRIu64 " started, %" PRIu64 " expired on time, %" PRIu64 " ended by death, %" PRIu64 " mismatches.\n",
+			bench_stats.status_started, bench_stats.status_expired, bench_stats.status_lost, bench_stats.status_mismatches );
+	}
+
+	ShowInfo( "%-18s %10s %12s %10s %10s %7s\n", "Subsystem", "Calls", "Total ms", "Avg us", "Max us", "Wall" );
+
+	for( const auto& subsystem : bench_subsystems ){
+		uint64 calls = 0, total = 0, max = 0;
+
+		for( const char* name : subsystem.entries ){
+			if( name == nullptr ){
+				continue;
+			}
+
+			const s_profiler_entry* entry = profiler_find( subsystem.category, name );
+
+			if( entry != nullptr ){
+				calls += entry->calls;
+				total += entry->total;
+				max = std::max( max, entry->max );
+			}
+		}
+
+		ShowInfo( "%-18s %10" PRIu64 " %12.3f %10.1f %10" PRIu64 " %6.2f%%\n", subsystem.name, calls, total / 1000.0,
+			calls > 0 ? static_cast<double>( total ) / calls : 0.0, max, wall > 0 ? total * 100.0 / wall : 0.0 );
+	}
+
+	profiler_dump( 10, []( const char* line ){
+		ShowInfo( "%s\n", line );
+	} );
+}
+
+/**
+ * Replaces the socket handling of the main loop.
+ * Advances the clock to the next timer until the configured amount of ticks ran.
+ * @param next: milliseconds until the next timer
+ */
+void bench_step( t_tick next ){
+	if( bench_finished ){
+		return;
+	}
+
+	if( !bench_running ){
+		bench_populate();
+
+		if( bench_config.nearest_queries > 0 ){
+			bench_nearest();
+		}
+
+		// Only the simulation itself is measured
+		profiler_reset();
+		bench_stats.tick_start = gettick();
+		bench_stats.wall_start = profiler_clock();
+		bench_stats.cpu_start = std::clock();
+		bench_next_spawn = gettick() + BENCH_SPAWN_INTERVAL;
+		bench_running = true;
+	}
+
+	timer_set_virtual_tick( gettick() + std::max<t_tick>( next, 1 ) );
+	send_shortlist_do_sends();
+
+	if( DIFF_TICK( gettick(), bench_stats.tick_start ) >= bench_config.duration ){
+		bench_running = false;
+		bench_finished = true;
+
+		bench_report();
+		global_core->signal_shutdown();
+	}
+}
+
+void do_final_bench(){
+	bench_players.clear();
+	bench_maps.clear();
+	bench_filler.clear();
+
+	if( bench_script != nullptr ){
+		script_free_code( bench_script );
+		bench_script = nullptr;
+	}
+}
+
+#endif // ifdef MAP_BENCH
@@ -0,0 +1,21 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <config/core.hpp>
+
+#ifdef MAP_BENCH
+#include <common/cbasetypes.hpp>
+#include <common/timer.hpp>
+
+void bench_get_options( int32 argc, char** argv );
+void bench_open();
+void bench_start();
+void bench_step( t_tick next );
+
+void do_final_bench();
+#endif // ifdef MAP_BENCH
+
+#endif /* BENCH_HPP */
@@ -34,8 +34,10 @@
 #include "rune.hpp"
 #include "script.hpp" // script_config
 #include "storage.hpp"
+#include "trace.hpp"
 
 static TIMER_FUNC(check_connect_char_server);
+int32 chrif_parse(int32 fd);
 
 static struct eri *auth_db_ers; //For reutilizing player login structures.
 static DBMap* auth_db; // int32 id -> struct auth_node*
@@ -265,6 +267,21 @@ int32 chrif_isconnected(void) {
 	return (session_isValid(char_fd) && chrif_state == 2);
 }
 
+/**
+ * Uses a session as an established char-server link, skipping the login.
+ * Used by the packet replay, which feeds the recorded char-server packets into it.
+ * @param fd: virtual session
+ */
+void chrif_attach(int32 fd) {
+	char_fd = fd;
+	session[fd]->func_parse = chrif_parse;
+	session[fd]->flag.server = 1;
+	realloc_fifo(fd, FIFOSIZE_SERVERLINK, FIFOSIZE_SERVERLINK);
+
+	chrif_state = 2;
+	chrif_connected = 1;
+}
+
 /**
  * Saves character data.
  * @param sd: Player data
@@ -312,6 +329,8 @@ int32 chrif_save(map_session_data *sd, int32 flag) {
 	if (flag&CSAVE_QUITTING)
 		sd->state.storage_flag = 0; //Force close it.
 
+	ac_save_duration(sd);
+
 	//Saving of registry values.
 	if (sd->vars_dirty)
 		intif_saveregistry(sd);
@@ -1281,7 +1300,6 @@ int32 chrif_save_scdata(map_session_data *sd) { //parses the sc_data of the play
 	t_tick tick;
 	struct status_change_data data;
 	status_change *sc = &sd->sc;
-	const struct TimerData *timer;
 
 	chrif_check(-1);
 	tick = gettick();
@@ -1293,11 +1311,11 @@ int32 chrif_save_scdata(map_session_data *sd) { //parses the sc_data of the play
 
 	for( const auto& [type, sce] : *sc ){
 		if (sce.timer != INVALID_TIMER) {
-			timer = get_timer(sce.timer);
-			if (timer == nullptr || timer->func != status_change_timer)
+			t_tick timer = status_change_get_timer_tick(*sc, type);
+			if (timer == INFINITE_TICK)
 				continue;
-			if (DIFF_TICK(timer->tick,tick) > 0)
-				data.tick = DIFF_TICK(timer->tick,tick); //Duration that is left before ending.
+			if (DIFF_TICK(timer,tick) > 0)
+				data.tick = DIFF_TICK(timer,tick); //Duration that is left before ending.
 			else
 				data.tick = 0; //Negative tick does not necessarily mean that sc has expired
 		} else
@@ -1769,6 +1787,9 @@ int32 chrif_parse(int32 fd) {
 		if ((int32)RFIFOREST(fd) < packet_len)
 			return 0;
 
+		if (trace_recording)
+			trace_record_server(RFIFOP(fd,0), packet_len);
+
 		//ShowDebug("Received packet 0x%4x (%d bytes) from char-server (connection %d)\n", RFIFOW(fd,0), packet_len, fd);
 
 		switch(cmd) {
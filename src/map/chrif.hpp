@@ -43,6 +43,7 @@ int32 chrif_setip(const char* ip);
 void chrif_setport(uint16 port);
 
 int32 chrif_isconnected(void);
+void chrif_attach(int32 fd);
 
 extern int32 chrif_connected;
 extern int32 other_mapserver_count;
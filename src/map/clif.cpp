@@ -17,6 +17,7 @@
 #include <common/grfio.hpp>
 #include <common/malloc.hpp>
 #include <common/nullpo.hpp>
+#include <common/profiler.hpp>
 #include <common/random.hpp>
 #include <common/showmsg.hpp>
 #include <common/socket.hpp>
@@ -60,6 +61,7 @@
 #include "status.hpp"
 #include "storage.hpp"
 #include "title.hpp"
+#include "trace.hpp"
 #include "unit.hpp"
 #include "vending.hpp"
 #include "./skills/skill_animation.hpp"
@@ -278,8 +280,6 @@ static uint16 map_port = 5121;
 static bool clif_ally_only = false;
 int32 map_fd;
 
-static int32 clif_parse (int32 fd);
-
 /*==========================================
  * Ip setting of map-server
  *------------------------------------------*/
@@ -481,6 +481,7 @@ static int32 clif_send_sub(block_list *bl, va_list ap)
  *------------------------------------------*/
 int32 clif_send(const void* buf, int32 len, block_list* bl, enum send_target type)
 {
+	ProfilerScope profile("clif_send");
 	int32 i;
 	map_session_data *sd, *tsd;
 	struct party_data *p = nullptr;
@@ -1093,7 +1094,7 @@ void clif_send_auras_single(struct block_list* bl, map_session_data* tsd) {
 	if (map_getmapflag(bl->m, MF_NOAURA)) return;
 
 	for (auto it : ucd->aura.effects) {
-		if (it->replay_tid != INVALID_TIMER) continue;
+		if (it->replay_interval) continue;
 		clif_specialeffect_single(bl, it->effect_id, tsd->fd);
 	}
 }
@@ -1121,7 +1122,7 @@ void clif_send_auras(struct block_list* bl, enum send_target target, bool ignore
 	if (!ucd) return;
 
 	for (auto it : ucd->aura.effects) {
-		if (it->replay_tid != INVALID_TIMER) continue;
+		if (it->replay_interval) continue;
 		if (flag != AURA_SPECIAL_NOTHING && (aura_special(it->effect_id) & flag) != flag) continue;
 		clif_specialeffect(bl, it->effect_id, target);
 	}
@@ -3436,6 +3437,25 @@ void clif_clearcart(int32 fd)
 }
 
 
+/// Counters of the periodic position and HP updates of party, guild and battleground members.
+s_member_update_stats member_update_stats[MEMBER_UPDATE_MAX];
+
+/// Writes the member updates gathered for a recipient with a single WFIFOSET.
+static void clif_member_updates_write( map_session_data& tsd, const uint8* buf, size_t len, size_t count, e_member_update_group group ){
+	if( count == 0 ){
+		return;
+	}
+
+	int32 fd = tsd.fd;
+
+	WFIFOHEAD( fd, len );
+	memcpy( WFIFOP( fd, 0 ), buf, len );
+	WFIFOSET( fd, len );
+
+	member_update_stats[group].packets += count;
+	member_update_stats[group].writes++;
+}
+
 /// Sends XY location to all other guild members
 /// 01eb <account id>.L <x>.W <y>.W (ZC_NOTIFY_POSITION_TO_GUILDM)
 void clif_guild_xy( map_session_data& sd ){
@@ -3449,6 +3469,59 @@ void clif_guild_xy( map_session_data& sd ){
 	clif_send(&packet, sizeof(packet), &sd, GUILD_SAMEMAP_WOS);
 }
 
+/// Sends the position changes of several guild members, one write per recipient.
+/// Positions go to the members on the same map, like clif_guild_xy.
+/// @param moved: members whose position changed
+void clif_guild_updates( const struct mmo_guild& g, map_session_data** moved, size_t moved_count ){
+	PACKET_ZC_NOTIFY_POSITION_TO_GUILDM xy[MAX_GUILD];
+	uint8 buf[sizeof( xy )];
+
+	for( size_t i = 0; i < moved_count; i++ ){
+		xy[i] = {};
+		xy[i].packetType = HEADER_ZC_NOTIFY_POSITION_TO_GUILDM;
+		xy[i].aid = moved[i]->status.account_id;
+		xy[i].xPos = moved[i]->x;
+		xy[i].yPos = moved[i]->y;
+	}
+
+	member_update_stats[MEMBER_UPDATE_GUILD].sent += moved_count;
+
+	for( int32 i = 0; i < g.max_member; i++ ){
+		map_session_data* tsd = g.member[i].sd;
+
+		if( tsd == nullptr || !session_isActive( tsd->fd ) ){
+			continue;
+		}
+
+		size_t len = 0, count = 0;
+
+		for( size_t j = 0; j < moved_count; j++ ){
+			if( moved[j] != tsd && moved[j]->m == tsd->m ){
+				memcpy( buf + len, &xy[j], sizeof( xy[j] ) );
+				len += sizeof( xy[j] );
+				count++;
+			}
+		}
+
+		clif_member_updates_write( *tsd, buf, len, count, MEMBER_UPDATE_GUILD );
+	}
+
+	if( !enable_spy ){
+		return;
+	}
+
+	// Spies get every update, like clif_send does
+	s_mapiterator* iter = mapit_getallusers();
+
+	for( map_session_data* tsd = (map_session_data*)mapit_first( iter ); mapit_exists( iter ); tsd = (map_session_data*)mapit_next( iter ) ){
+		if( tsd->guildspy == g.guild_id && session_isActive( tsd->fd ) ){
+			clif_member_updates_write( *tsd, reinterpret_cast<uint8*>( xy ), moved_count * sizeof( xy[0] ), moved_count, MEMBER_UPDATE_GUILD );
+		}
+	}
+
+	mapit_free( iter );
+}
+
 /// Sends XY location to a specific guild member
 /// 01eb <account id>.L <x>.W <y>.W (ZC_NOTIFY_POSITION_TO_GUILDM)
 void clif_guild_xy_single( map_session_data& sd, map_session_data& tsd ){
@@ -4539,9 +4612,9 @@ void clif_changeoption_target( block_list* bl, block_list* target ){
 		//Whenever we send "changeoption" to the client, the provoke icon is lost
 		//There is probably an option for the provoke icon, but as we don't know it, we have to do this for now
 		if( sc->getSCE(SC_PROVOKE) ){
-			const struct TimerData *td = get_timer( sc->getSCE(SC_PROVOKE)->timer );
+			t_tick timer = status_change_get_timer_tick( *sc, SC_PROVOKE );
 
-			clif_status_change( bl, status_db.getIcon(SC_PROVOKE), 1, ( !td ? INFINITE_TICK : DIFF_TICK( td->tick, gettick() ) ), 0, 0, 0 );
+			clif_status_change( bl, status_db.getIcon(SC_PROVOKE), 1, ( timer == INFINITE_TICK ? INFINITE_TICK : DIFF_TICK( timer, gettick() ) ), 0, 0, 0 );
 		}
 	}else{
 		if( disguised( bl ) ){
@@ -6893,11 +6966,11 @@ void clif_efst_status_change_sub(block_list *tbl, block_list *bl, enum send_targ
 	for (i = 0; i < sc_display_count; i++) {
 		enum sc_type type = sc_display[i]->type;
 		status_change *sc = status_get_sc(bl);
-		const struct TimerData *td = (sc && sc->getSCE(type) ? get_timer(sc->getSCE(type)->timer) : nullptr);
+		t_tick timer = (sc && sc->getSCE(type) ? status_change_get_timer_tick(*sc, type) : INFINITE_TICK);
 		t_tick tick = 0;
 
-		if (td)
-			tick = DIFF_TICK(td->tick, gettick());
+		if (timer != INFINITE_TICK)
+			tick = DIFF_TICK(timer, gettick());
 
 		// Status changes that need special handling
 		switch( type ){
@@ -8343,13 +8416,19 @@ void clif_party_message( struct party_data& party, uint32 account_id, const char
 
 /// Updates the position of a party member on the minimap (ZC_NOTIFY_POSITION_TO_GROUPM).
 /// 0107 <account id>.L <x>.W <y>.W
-void clif_party_xy( map_session_data& sd ){
-	PACKET_ZC_NOTIFY_POSITION_TO_GROUPM p = {};
+static void clif_party_xy_packet( map_session_data& sd, PACKET_ZC_NOTIFY_POSITION_TO_GROUPM& p ){
+	p = {};
 
 	p.PacketType = HEADER_ZC_NOTIFY_POSITION_TO_GROUPM;
 	p.AID = sd.status.account_id;
 	p.xPos = sd.x;
 	p.yPos = sd.y;
+}
+
+void clif_party_xy( map_session_data& sd ){
+	PACKET_ZC_NOTIFY_POSITION_TO_GROUPM p;
+
+	clif_party_xy_packet( sd, p );
 
 	clif_send( &p, sizeof( p ), &sd, PARTY_SAMEMAP_WOS );
 }
@@ -8371,8 +8450,8 @@ void clif_party_xy_single( map_session_data& sd, map_session_data& tsd ){
 /// Updates HP bar of a party member.
 /// 0106 <account id>.L <hp>.W <max hp>.W (ZC_NOTIFY_HP_TO_GROUPM)
 /// 080e <account id>.L <hp>.L <max hp>.L (ZC_NOTIFY_HP_TO_GROUPM_R2)
-void clif_party_hp( map_session_data& sd ){
-	PACKET_ZC_NOTIFY_HP_TO_GROUPM p = {};
+static void clif_party_hp_packet( map_session_data& sd, PACKET_ZC_NOTIFY_HP_TO_GROUPM& p ){
+	p = {};
 
 	p.PacketType = HEADER_ZC_NOTIFY_HP_TO_GROUPM;
 	p.AID = sd.status.account_id;
@@ -8389,10 +8468,86 @@ void clif_party_hp( map_session_data& sd ){
 	p.hp = sd.battle_status.hp;
 	p.maxhp = sd.battle_status.max_hp;
 #endif
+}
+
+void clif_party_hp( map_session_data& sd ){
+	PACKET_ZC_NOTIFY_HP_TO_GROUPM p;
+
+	clif_party_hp_packet( sd, p );
 
 	clif_send( &p, sizeof( p ), &sd, PARTY_AREA_WOS );
 }
 
+/// Sends the position and HP changes of several party members, one write per recipient.
+/// Positions go to the members on the same map and HP to the members in the area, like clif_party_xy and clif_party_hp.
+/// @param moved: members whose position changed
+/// @param hurt: members whose HP changed
+void clif_party_updates( struct party_data& party, map_session_data** moved, size_t moved_count, map_session_data** hurt, size_t hurt_count ){
+	PACKET_ZC_NOTIFY_POSITION_TO_GROUPM xy[MAX_PARTY];
+	PACKET_ZC_NOTIFY_HP_TO_GROUPM hp[MAX_PARTY];
+	uint8 buf[sizeof( xy ) + sizeof( hp )];
+
+	for( size_t i = 0; i < moved_count; i++ ){
+		clif_party_xy_packet( *moved[i], xy[i] );
+	}
+
+	for( size_t i = 0; i < hurt_count; i++ ){
+		clif_party_hp_packet( *hurt[i], hp[i] );
+	}
+
+	member_update_stats[MEMBER_UPDATE_PARTY].sent += moved_count + hurt_count;
+
+	for( int32 i = 0; i < MAX_PARTY; i++ ){
+		map_session_data* tsd = party.data[i].sd;
+
+		if( tsd == nullptr || !session_isActive( tsd->fd ) ){
+			continue;
+		}
+
+		size_t len = 0, count = 0;
+
+		for( size_t j = 0; j < moved_count; j++ ){
+			if( moved[j] != tsd && moved[j]->m == tsd->m ){
+				memcpy( buf + len, &xy[j], sizeof( xy[j] ) );
+				len += sizeof( xy[j] );
+				count++;
+			}
+		}
+
+		for( size_t j = 0; j < hurt_count; j++ ){
+			if( hurt[j] != tsd && hurt[j]->m == tsd->m && abs( hurt[j]->x - tsd->x ) <= AREA_SIZE && abs( hurt[j]->y - tsd->y ) <= AREA_SIZE ){
+				memcpy( buf + len, &hp[j], sizeof( hp[j] ) );
+				len += sizeof( hp[j] );
+				count++;
+			}
+		}
+
+		clif_member_updates_write( *tsd, buf, len, count, MEMBER_UPDATE_PARTY );
+	}
+
+	if( !enable_spy ){
+		return;
+	}
+
+	// Spies get every update, like clif_send does
+	size_t len = 0;
+
+	memcpy( buf, xy, moved_count * sizeof( xy[0] ) );
+	len += moved_count * sizeof( xy[0] );
+	memcpy( buf + len, hp, hurt_count * sizeof( hp[0] ) );
+	len += hurt_count * sizeof( hp[0] );
+
+	s_mapiterator* iter = mapit_getallusers();
+
+	for( map_session_data* tsd = (map_session_data*)mapit_first( iter ); mapit_exists( iter ); tsd = (map_session_data*)mapit_next( iter ) ){
+		if( tsd->partyspy == party.party.party_id && session_isActive( tsd->fd ) ){
+			clif_member_updates_write( *tsd, buf, len, moved_count + hurt_count, MEMBER_UPDATE_PARTY );
+		}
+	}
+
+	mapit_free( iter );
+}
+
 /// Notifies the party members of a character's death or revival.
 /// 0AB2 <GID>.L <dead>.B
 void clif_party_dead( map_session_data& sd ){
@@ -10015,6 +10170,24 @@ void clif_specialeffect_single(block_list* bl, int32 type, int32 fd)
 	WFIFOSET(fd,10);
 }
 
+/// Sends several special effects to a single client in one write (ZC_NOTIFY_EFFECT2).
+/// Packets are laid out back to back like clif_specialeffect_single would send them.
+void clif_specialeffect_single_batch(int32 fd, const std::vector<s_specialeffect_single>& effects)
+{
+	if( effects.empty() )
+		return;
+
+	size_t len = effects.size() * 10;
+
+	WFIFOHEAD(fd,len);
+	for( size_t i = 0; i < effects.size(); i++ ){
+		WFIFOW(fd,i*10) = 0x1f3;
+		WFIFOL(fd,i*10+2) = effects[i].id;
+		WFIFOL(fd,i*10+6) = effects[i].type;
+	}
+	WFIFOSET(fd,len);
+}
+
 
 /// Notifies clients of an special/visual effect that accepts an value (ZC_NOTIFY_EFFECT3).
 /// 0284 <id>.L <effect id>.L <num data>.L
@@ -18856,6 +19029,46 @@ void clif_bg_xy(map_session_data *sd)
 	clif_send(buf, packet_len(0x2df), sd, BG_SAMEMAP_WOS);
 }
 
+/// Sends the position changes of several camp members, one write per recipient.
+/// Positions go to the members on the same map, like clif_bg_xy.
+/// @param moved: members whose position changed
+void clif_bg_updates( struct s_battleground_data& bg, map_session_data** moved, size_t moved_count ){
+	PACKET_ZC_BATTLEFIELD_NOTIFY_POSITION xy[MAX_BG_MEMBERS];
+	uint8 buf[sizeof( xy )];
+
+	for( size_t i = 0; i < moved_count; i++ ){
+		xy[i] = {};
+		xy[i].packetType = HEADER_ZC_BATTLEFIELD_NOTIFY_POSITION;
+		xy[i].aid = moved[i]->status.account_id;
+		safestrncpy( xy[i].name, moved[i]->status.name, NAME_LENGTH );
+		xy[i].job = moved[i]->status.class_;
+		xy[i].xPos = moved[i]->x;
+		xy[i].yPos = moved[i]->y;
+	}
+
+	member_update_stats[MEMBER_UPDATE_BG].sent += moved_count;
+
+	for( const auto& member : bg.members ){
+		map_session_data* tsd = member.sd;
+
+		if( tsd == nullptr || !session_isActive( tsd->fd ) ){
+			continue;
+		}
+
+		size_t len = 0, count = 0;
+
+		for( size_t j = 0; j < moved_count; j++ ){
+			if( moved[j] != tsd && moved[j]->m == tsd->m ){
+				memcpy( buf + len, &xy[j], sizeof( xy[j] ) );
+				len += sizeof( xy[j] );
+				count++;
+			}
+		}
+
+		clif_member_updates_write( *tsd, buf, len, count, MEMBER_UPDATE_BG );
+	}
+}
+
 void clif_bg_xy_remove(map_session_data *sd)
 {
 	unsigned char buf[36];
@@ -21749,10 +21962,12 @@ void clif_parse_merge_item_req( int32 fd, map_session_data* sd ){
 	// Merrrrge!!!!
 	for( uint16 idx : indices ){
 		uint16 amount = sd->inventory.u.items_inventory[idx].amount;
+		t_itemid nameid = sd->inventory.u.items_inventory[idx].nameid;
 
 		log_pick_pc( sd, LOG_TYPE_MERGE_ITEM, -amount, &sd->inventory.u.items_inventory[idx] );
 		memset( &sd->inventory.u.items_inventory[idx], 0, sizeof( sd->inventory.u.items_inventory[0] ) );
 		sd->inventory_data[idx] = nullptr;
+		pc_inventory_index_update( *sd, idx, nameid );
 		clif_delitem( *sd, idx, amount, 0 );
 	}
 
@@ -27294,10 +27509,39 @@ void clif_runedecompowindow_result (map_session_data* sd, enum e_runedecompo_res
 #endif
 }
 
+/*==========================================
+ * Calls the handler of a complete client packet and skips it.
+ * The packet id at the start of the read buffer has to be decrypted already.
+ *------------------------------------------*/
+void clif_parse_packet(int32 fd, map_session_data* sd, int32 cmd, int32 packet_len)
+{
+	if( packet_db[cmd].func == clif_parse_debug )
+		packet_db[cmd].func(fd, sd);
+	else if( packet_db[cmd].func != nullptr ) {
+		if( !sd && packet_db[cmd].func != clif_parse_WantToConnection )
+			; //Only valid packet when there is no session
+		else
+		if( sd && sd->prev == nullptr && packet_db[cmd].func != clif_parse_LoadEndAck )
+			; //Only valid packet when player is not on a map
+		else{
+			uint64 start = profiler_enabled ? profiler_clock() : 0;
+
+			packet_db[cmd].func(fd, sd);
+
+			if( profiler_enabled )
+				profiler_record( PROFILER_PACKET, cmd, start, profiler_packet_name );
+		}
+	}
+#ifdef DUMP_UNKNOWN_PACKET
+	else DumpUnknown(fd,sd,cmd,packet_len);
+#endif
+	RFIFOSKIP(fd, packet_len);
+}
+
 /*==========================================
  * Main client packet processing function
  *------------------------------------------*/
-static int32 clif_parse(int32 fd)
+int32 clif_parse(int32 fd)
 {
 	int32 cmd, packet_len;
 	TBL_PC* sd;
@@ -27334,6 +27578,7 @@ static int32 clif_parse(int32 fd)
 		} else {
 			ShowInfo("Closed connection from '" CL_WHITE "%s" CL_RESET "'.\n", ip2str(session[fd]->client_addr, nullptr));
 		}
+		trace_record_close(fd);
 		do_close(fd);
 		return 0;
 	}
@@ -27418,21 +27663,10 @@ static int32 clif_parse(int32 fd)
 		sd->cryptKey = ((sd->cryptKey * clif_cryptKey[1]) + clif_cryptKey[2]) & 0xFFFFFFFF; // Update key for the next packet
 #endif
 
-	if( packet_db[cmd].func == clif_parse_debug )
-		packet_db[cmd].func(fd, sd);
-	else if( packet_db[cmd].func != nullptr ) {
-		if( !sd && packet_db[cmd].func != clif_parse_WantToConnection )
-			; //Only valid packet when there is no session
-		else
-		if( sd && sd->prev == nullptr && packet_db[cmd].func != clif_parse_LoadEndAck )
-			; //Only valid packet when player is not on a map
-		else
-			packet_db[cmd].func(fd, sd);
-	}
-#ifdef DUMP_UNKNOWN_PACKET
-	else DumpUnknown(fd,sd,cmd,packet_len);
-#endif
-	RFIFOSKIP(fd, packet_len);
+	if( trace_recording )
+		trace_record_packet(fd, RFIFOP(fd,0), packet_len, sd == nullptr);
+
+	clif_parse_packet(fd, sd, cmd, packet_len);
 	}; // main loop end
 
 	return 0;
@@ -27509,10 +27743,13 @@ void do_init_clif(void) {
 	packetdb_readdb();
 
 	set_defaultparse(clif_parse);
-	if( make_listen_bind(bind_ip,map_port) == -1 ) {
+#ifndef MAP_BENCH
+	// a replay feeds the recorded clients itself
+	if( !trace_replaying() && make_listen_bind(bind_ip,map_port) == -1 ) {
 		ShowFatalError("Failed to bind to port '" CL_WHITE "%d" CL_RESET "'\n",map_port);
 		exit(EXIT_FAILURE);
 	}
+#endif
 
 	add_timer_func_list(clif_clearunit_delayed_sub, "clif_clearunit_delayed_sub");
 	add_timer_func_list(clif_delayquit, "clif_delayquit");
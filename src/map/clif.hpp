@@ -210,6 +210,30 @@ enum class e_purchase_result : uint8{
 #define packet_len(cmd) packet_db[cmd].len
 extern struct s_packet_db packet_db[MAX_PACKET_DB+1];
 
+/// Kinds of periodic member updates, see member_update_stats
+enum e_member_update_group : uint8 {
+	MEMBER_UPDATE_PARTY = 0,
+	MEMBER_UPDATE_GUILD,
+	MEMBER_UPDATE_BG,
+	MEMBER_UPDATE_MAX
+};
+
+/// Counters of the periodic position and HP updates sent to party, guild and battleground members
+struct s_member_update_stats {
+	uint64 sent; ///< Member updates that were sent
+	uint64 suppressed; ///< Member updates skipped because nothing changed enough
+	uint64 packets; ///< Packets written to the recipients
+	uint64 writes; ///< Batched writes, one per recipient and update run
+};
+
+extern s_member_update_stats member_update_stats[MEMBER_UPDATE_MAX];
+
+/// A special effect of a unit, written by clif_specialeffect_single_batch
+struct s_specialeffect_single {
+	int32 id; ///< Unit that shows the effect
+	int32 type; ///< Effect id, see doc/effect_list.txt
+};
+
 // local define
 enum send_target : uint8_t {
 	ALL_CLIENT = 0,
@@ -1128,6 +1152,7 @@ void clif_party_message( struct party_data& party, uint32 account_id, const char
 void clif_party_xy( map_session_data& sd );
 void clif_party_xy_single( map_session_data& sd, map_session_data& tsd );
 void clif_party_hp( map_session_data& sd );
+void clif_party_updates( struct party_data& party, map_session_data** moved, size_t moved_count, map_session_data** hurt, size_t hurt_count );
 void clif_hpmeter_single( map_session_data& sd, uint32 id, uint32 hp, uint32 maxhp );
 void clif_party_job_and_level( map_session_data& sd );
 void clif_party_dead( map_session_data& sd );
@@ -1160,6 +1185,7 @@ void clif_guild_broken( map_session_data& sd, int32 flag );
 void clif_guild_xy( map_session_data& sd );
 void clif_guild_xy_single( map_session_data& sd, map_session_data& tsd );
 void clif_guild_xy_remove( map_session_data& sd );
+void clif_guild_updates( const struct mmo_guild& g, map_session_data** moved, size_t moved_count );
 void clif_guild_castle_list(map_session_data& sd);
 void clif_guild_castle_teleport_res(map_session_data& sd, enum e_siege_teleport_result result);
 void clif_guild_position_selected(map_session_data& sd);
@@ -1168,6 +1194,7 @@ void clif_guild_position_selected(map_session_data& sd);
 void clif_bg_hp(map_session_data *sd);
 void clif_bg_xy(map_session_data *sd);
 void clif_bg_xy_remove(map_session_data *sd);
+void clif_bg_updates( struct s_battleground_data& bg, map_session_data** moved, size_t moved_count );
 void clif_bg_message(struct s_battleground_data *bg, int32 src_id, const char *name, const char *mes, size_t len);
 void clif_bg_updatescore(int16 m);
 void clif_bg_updatescore_single(map_session_data *sd);
@@ -1224,6 +1251,7 @@ void clif_friendslist_reqack(map_session_data *sd, map_session_data *f_sd, int32
 void clif_weather(int16 m); // [Valaris]
 void clif_specialeffect(block_list* bl, int32 type, enum send_target target); // special effects [Valaris]
 void clif_specialeffect_single(block_list* bl, int32 type, int32 fd);
+void clif_specialeffect_single_batch(int32 fd, const std::vector<s_specialeffect_single>& effects);
 void clif_specialeffect_remove(block_list* bl_src, int32 effect, enum send_target e_target, block_list* bl_target);
 void clif_messagecolor_target(block_list *bl, unsigned long color, const char *msg, bool rgb2bgr, enum send_target type, map_session_data *sd);
 #define clif_messagecolor(bl, color, msg, rgb2bgr, type) clif_messagecolor_target(bl, color, msg, rgb2bgr, type, nullptr) // Mob/Npc color talk [SnakeDrak]
@@ -1276,6 +1304,8 @@ void clif_displayexp(map_session_data *sd, t_exp exp, char type, bool quest, boo
 int32 clif_send(const void* buf, int32 len, block_list* bl, enum send_target type);
 void do_init_clif(void);
 void do_final_clif(void);
+int32 clif_parse(int32 fd);
+void clif_parse_packet(int32 fd, map_session_data* sd, int32 cmd, int32 packet_len);
 
 // MAIL SYSTEM
 enum mail_send_result : uint8_t {
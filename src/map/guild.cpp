@@ -659,14 +659,26 @@ int32 guild_send_xy_timer_sub(const struct mmo_guild& g) {
 		return 0;
 	}
 
+	s_member_update_stats& stats = member_update_stats[MEMBER_UPDATE_GUILD];
+	map_session_data* moved[MAX_GUILD];
+	size_t moved_count = 0;
+
 	for (int32 i = 0; i < g.max_member; i++) {
 		map_session_data* sd = g.member[i].sd;
-		if( sd != nullptr && sd->fd && (sd->guild_x != sd->x || sd->guild_y != sd->y) && !sd->bg_id ) {
-			clif_guild_xy( *sd );
+		if( sd == nullptr || !sd->fd || sd->bg_id )
+			continue;
+		if( sd->guild_m != sd->m || distance( sd->guild_x - sd->x, sd->guild_y - sd->y ) >= battle_config.guild_update_distance ) {
+			moved[moved_count++] = sd;
+			sd->guild_m = sd->m;
 			sd->guild_x = sd->x;
 			sd->guild_y = sd->y;
-		}
+		} else
+			stats.suppressed++;
 	}
+
+	// Send all updates of the guild at once, one write per member
+	if( moved_count > 0 )
+		clif_guild_updates( g, moved, moved_count );
 	return 0;
 }
 
@@ -32,6 +32,7 @@
 #include "quest.hpp"
 #include "status.hpp"
 #include "storage.hpp"
+#include "trace.hpp"
 
 /// Received packet Lengths from inter-server
 static const int32 packet_len_table[] = {
@@ -3768,6 +3769,8 @@ int32 intif_parse(int32 fd)
 	if((int32)RFIFOREST(fd)<packet_len){
 		return 2;
 	}
+	if(trace_recording)
+		trace_record_server(RFIFOP(fd,0), packet_len);
 	// Processing branch
 	switch(cmd){
 	case 0x3800:
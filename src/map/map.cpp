@@ -15,6 +15,7 @@
 #include <common/grfio.hpp>
 #include <common/malloc.hpp>
 #include <common/nullpo.hpp>
+#include <common/profiler.hpp>
 #include <common/random.hpp>
 #include <common/showmsg.hpp>
 #include <common/socket.hpp> // WFIFO*()
@@ -26,8 +27,10 @@
 #include "achievement.hpp"
 #include "atcommand.hpp"
 #include "aura.hpp"
+#include "autocombat.hpp"
 #include "battle.hpp"
 #include "battleground.hpp"
+#include "bench.hpp"
 #include "cashshop.hpp"
 #include "channel.hpp"
 #include "chat.hpp"
@@ -56,6 +59,7 @@
 #include "stall.hpp"
 #include "storage.hpp"
 #include "title.hpp"
+#include "trace.hpp"
 #include "trade.hpp"
 
 using namespace rathena;
@@ -120,7 +124,6 @@ static DBMap* bossid_db=nullptr; /// int32 id -> mob_data* (MVP db)
 static DBMap* map_db=nullptr; /// uint32 mapindex -> struct map_data*
 static DBMap* nick_db=nullptr; /// uint32 char_id -> struct charid2nick* (requested names of offline characters)
 static DBMap* charid_db=nullptr; /// uint32 char_id -> map_session_data*
-static DBMap* regen_db=nullptr; /// int32 id -> block_list* (status_natural_heal processing)
 static DBMap* map_msg_db=nullptr;
 
 static int32 map_users=0;
@@ -135,7 +138,7 @@ static block_list *bl_list[BL_LIST_MAX];
 static int32 bl_list_count = 0;
 
 #ifndef MAP_MAX_MSG
-	#define MAP_MAX_MSG 1550
+	#define MAP_MAX_MSG 1600
 #endif
 
 struct map_data map[MAX_MAP_PER_SERVER];
@@ -832,6 +835,158 @@ int32 map_foreachinshootrange(int32 (*func)(block_list*,va_list),block_list* cen
 	return returnCount;
 }
 
+/**
+ * Lower bound of the distance between a cell and any cell of a block ring.
+ * Ring n holds the blocks whose block coordinates are n blocks away from the block of the cell.
+ * @param x: X coordinate of the cell
+ * @param y: Y coordinate of the cell
+ * @param ring: Ring number
+ * @return Distance, as returned by distance()
+ */
+static uint32 map_nearest_ring_distance(int16 x, int16 y, int32 ring)
+{
+	if( ring <= 0 )
+		return 0;
+
+	int32 ox = x % BLOCK_SIZE;
+	int32 oy = y % BLOCK_SIZE;
+	int32 cells = i32min(i32min(ring * BLOCK_SIZE - ox, (ring - 1) * BLOCK_SIZE + ox + 1), i32min(ring * BLOCK_SIZE - oy, (ring - 1) * BLOCK_SIZE + oy + 1));
+
+#ifdef CIRCULAR_AREA
+	// distance() approximates the euclidean distance and can be slightly shorter than the largest axis
+	cells -= cells / 16 + 1;
+#endif
+
+	return i32max(cells, 0);
+}
+
+/**
+ * Find the closest objects around a center that satisfy a predicate.
+ * Blocks are visited ring by ring around the block of the center and the predicate is called
+ * on the candidates in ascending distance, so the search stops as soon as enough objects
+ * were accepted and no unvisited block can hold anything closer.
+ * Objects at the same distance are returned in no particular order.
+ * @param center: Center of the search, it is never returned
+ * @param range: Maximum distance (square range, or circular with CIRCULAR_AREA)
+ * @param type: Type of bl to search for
+ * @param count: Maximum amount of objects to find
+ * @param predicate: Called on candidates, returns true to accept one
+ * @param result: Accepted objects are appended here, closest first
+ * @return Amount of objects found
+ */
+size_t map_findnearest_k(block_list* center, int16 range, int32 type, size_t count, const std::function<bool(block_list*)>& predicate, std::vector<block_list*>& result)
+{
+	size_t found = 0;
+
+	if( center == nullptr || center->m < 0 || count == 0 || range < 0 )
+		return 0;
+
+	struct map_data *mapdata = map_getmapdata(center->m);
+
+	if( mapdata == nullptr || mapdata->block == nullptr ){
+		return 0;
+	}
+
+	int32 x0 = i16max(center->x - range, 0);
+	int32 y0 = i16max(center->y - range, 0);
+	int32 x1 = i16min(center->x + range, mapdata->xs - 1);
+	int32 y1 = i16min(center->y + range, mapdata->ys - 1);
+	int32 cbx = center->x / BLOCK_SIZE;
+	int32 cby = center->y / BLOCK_SIZE;
+	int32 bx0 = x0 / BLOCK_SIZE, by0 = y0 / BLOCK_SIZE, bx1 = x1 / BLOCK_SIZE, by1 = y1 / BLOCK_SIZE;
+	int32 rings = i32max(i32max(cbx - bx0, bx1 - cbx), i32max(cby - by0, by1 - cby));
+	int32 blockcount = bl_list_count;
+	int32 pending = bl_list_count; // Candidates in [pending, bl_list_count) were not checked yet
+
+	auto closer = [center]( const block_list* a, const block_list* b ){
+		uint32 da = distance_bl(center, a), db = distance_bl(center, b);
+
+		return da < db || ( da == db && a->id < b->id );
+	};
+
+	FreeBlockLock freeLock;
+
+	for( int32 ring = 0; ring <= rings && found < count; ring++ ){
+		for( int32 by = cby - ring; by <= cby + ring; by++ ){
+			if( by < by0 || by > by1 )
+				continue;
+
+			// Only the edges of the ring, the inside was visited by the previous rings
+			int32 step = ( by == cby - ring || by == cby + ring ) ? 1 : i32max(2 * ring, 1);
+
+			for( int32 bx = cbx - ring; bx <= cbx + ring; bx += step ){
+				if( bx < bx0 || bx > bx1 )
+					continue;
+
+				for( int32 list = 0; list < 2; list++ ){
+					block_list *bl;
+
+					if( list == 0 ){
+						if( !( type&~BL_MOB ) )
+							continue;
+						bl = mapdata->block[bx + by * mapdata->bxs];
+					}else{
+						if( !( type&BL_MOB ) )
+							continue;
+						bl = mapdata->block_mob[bx + by * mapdata->bxs];
+					}
+
+					for( ; bl != nullptr; bl = bl->next ){
+						if( bl->type&type && bl != center
+							&& bl->x >= x0 && bl->x <= x1 && bl->y >= y0 && bl->y <= y1
+#ifdef CIRCULAR_AREA
+							&& check_distance_bl(center, bl, range)
+#endif
+							&& bl_list_count < BL_LIST_MAX )
+							bl_list[ bl_list_count++ ] = bl;
+					}
+				}
+			}
+		}
+
+		// Candidates that are not farther than anything in the next ring can be decided now
+		uint32 bound = ring < rings ? map_nearest_ring_distance(center->x, center->y, ring + 1) : UINT32_MAX;
+
+		std::sort(bl_list + pending, bl_list + bl_list_count, closer);
+
+		while( pending < bl_list_count && found < count ){
+			block_list* bl = bl_list[pending];
+
+			if( distance_bl(center, bl) > bound )
+				break;
+
+			pending++;
+
+			//predicate may delete this bl_list[] slot, checking for prev ensures it wasn't queued for deletion.
+			if( bl->prev != nullptr && predicate(bl) ){
+				result.push_back(bl);
+				found++;
+			}
+		}
+	}
+
+	if( bl_list_count >= BL_LIST_MAX )
+		ShowWarning("map_findnearest_k: block count too many!\n");
+
+	bl_list_count = blockcount;
+	return found;
+}
+
+/**
+ * Find the closest object around a center that satisfies a predicate.
+ * @see map_findnearest_k
+ * @return Closest object or nullptr
+ */
+block_list* map_findnearest(block_list* center, int16 range, int32 type, const std::function<bool(block_list*)>& predicate)
+{
+	std::vector<block_list*> result;
+
+	if( map_findnearest_k(center, range, type, 1, predicate, result) == 0 )
+		return nullptr;
+
+	return result.front();
+}
+
 
 /*========================================== [Playtester]
  * range = map m (x0,y0)-(x1,y1)
@@ -2194,7 +2349,7 @@ void map_addiddb(block_list *bl)
 	}
 
 	if( bl->type & BL_REGEN )
-		idb_put(regen_db, bl->id, bl);
+		status_regen_add(bl);
 
 	idb_put(id_db,bl->id,bl);
 }
@@ -2219,7 +2374,7 @@ void map_deliddb(block_list *bl)
 	}
 
 	if( bl->type & BL_REGEN )
-		idb_remove(regen_db,bl->id);
+		status_regen_remove(bl);
 
 	idb_remove(id_db,bl->id);
 }
@@ -2580,28 +2735,6 @@ void map_foreachnpc(int32 (*func)(npc_data* nd, va_list args), ...)
 	dbi_destroy(iter);
 }
 
-/// Applies func to everything in the db.
-/// Stops iterating if func returns -1.
-void map_foreachregen(int32 (*func)(block_list* bl, va_list args), ...)
-{
-	DBIterator* iter;
-	block_list* bl;
-
-	iter = db_iterator(regen_db);
-	for( bl = (block_list*)dbi_first(iter); dbi_exists(iter); bl = (block_list*)dbi_next(iter) )
-	{
-		va_list args;
-		int32 ret;
-
-		va_start(args, func);
-		ret = func(bl, args);
-		va_end(args);
-		if( ret == -1 )
-			break;// stop iterating
-	}
-	dbi_destroy(iter);
-}
-
 /// Applies func to everything in the db.
 /// Stops iterating if func returns -1.
 void map_foreachiddb(int32 (*func)(block_list* bl, va_list args), ...)
@@ -4244,6 +4377,22 @@ int32 map_config_read(const char *cfgName)
 			console_msg_log = atoi(w2);//[Ind]
 		else if (strcmpi(w1, "console_log_filepath") == 0)
 			safestrncpy(console_log_filepath, w2, sizeof(console_log_filepath));
+		else if (strcmpi(w1, "console_log_format") == 0)
+			console_log_format = strcmpi(w2, "binary") == 0 ? CONSOLE_LOG_BINARY : CONSOLE_LOG_TEXT;
+		else if (strcmpi(w1, "console_async") == 0)
+			console_async = config_switch(w2);
+		else if (strcmpi(w1, "console_rate_limit") == 0)
+			console_rate_limit = cap_value(atoi(w2), 0, INT_MAX);
+		else if (strcmpi(w1, "profiler") == 0)
+			profiler_set_enabled(config_switch(w2) != 0);
+		else if (strcmpi(w1, "profiler_slow_tick") == 0)
+			profiler_set_slow_tick((uint32)cap_value(atoi(w2), 0, INT_MAX));
+		else if (strcmpi(w1, "profiler_dump_interval") == 0)
+			profiler_set_dump_interval((uint32)cap_value(atoi(w2), 0, INT_MAX));
+		else if (strcmpi(w1, "packet_trace") == 0)
+			trace_config.enabled = config_switch(w2) != 0;
+		else if (strcmpi(w1, "packet_trace_file") == 0)
+			safestrncpy(trace_config.file, w2, sizeof(trace_config.file));
 		else if (strcmpi(w1, "import") == 0)
 			map_config_read(w2);
 		else
@@ -4421,6 +4570,8 @@ int32 inter_config_read(const char *cfgName)
 		}
 		if( mapreg_config_read(w1,w2) )
 			continue;
+		if( script_query_config_read(w1,w2) )
+			continue;
 		//support the import command, just like any other config
 		else
 		if(strcmpi(w1,"import")==0)
@@ -5096,6 +5247,10 @@ void MapServer::finalize(){
 	do_final_battle();
 	do_final_chrif();
 	do_final_clan();
+	do_final_trace();
+#ifdef MAP_BENCH
+	do_final_bench();
+#endif
 #ifndef MAP_GENERATOR
 	do_final_clif();
 #endif
@@ -5131,6 +5286,7 @@ void MapServer::finalize(){
 	do_final_rune();	
 	do_final_stall();
 	do_final_aura();
+	do_final_autocombat();
 
 	map_db->destroy(map_db, map_db_final);
 
@@ -5160,7 +5316,6 @@ void MapServer::finalize(){
 	nick_db->destroy(nick_db, nick_db_final);
 	charid_db->destroy(charid_db, nullptr);
 	iwall_db->destroy(iwall_db, nullptr);
-	regen_db->destroy(regen_db, nullptr);
 
 	map_sql_close();
 
@@ -5216,6 +5371,25 @@ void display_helpscreen(bool do_exit)
 	ShowInfo("  --grf-path <file>\t\tAlternative GRF path configuration.\n");
 	ShowInfo("  --inter-config <file>\t\tAlternative inter-server configuration.\n");
 	ShowInfo("  --log-config <file>\t\tAlternative logging configuration.\n");
+	ShowInfo("  --replay <file>\t\tReplays a recorded packet trace and exits.\n");
+	ShowInfo("  --replay-seed <n>\t\tSeed of the random generator during the replay.\n");
+#ifdef MAP_BENCH
+	ShowInfo("  --bench-players <n>\t\tSynthetic players of the benchmark (default 100).\n");
+	ShowInfo("  --bench-mobs <n>\t\tMonsters per map of the benchmark (default 200).\n");
+	ShowInfo("  --bench-maps <a,b,...>\tMaps of the benchmark (default prt_fild08).\n");
+	ShowInfo("  --bench-mob-ids <a,b,...>\tMonsters spawned by the benchmark.\n");
+	ShowInfo("  --bench-ticks <ms>\t\tVirtual duration of the benchmark (default 60000).\n");
+	ShowInfo("  --bench-seed <n>\t\tSeed of the random generator during the benchmark.\n");
+	ShowInfo("  --bench-items <n>\t\tFilled inventory slots of the benchmark players (default 0).\n");
+	ShowInfo("  --bench-script <code>\t\tItem script the benchmark players run (countitem/delitem with --bench-items).\n");
+	ShowInfo("  --bench-rng <n>\t\tCompare the random generators over <n> rolls before the benchmark.\n");
+	ShowInfo("  --bench-vars <n>\t\tTime <n> runs of NPC loops with and without script variable slots.\n");
+	ShowInfo("  --bench-chat <n>\t\tCheck <n> chat messages against NPC patterns with and without the combined pattern.\n");
+	ShowInfo("  --bench-sc <n>\t\tStart <n> buffs on every benchmark player and check the tick they end on.\n");
+	ShowInfo("  --bench-nearest <n>\t\tCompare <n> nearest monster searches of the block grid with full area scans.\n");
+	ShowInfo("  --bench-alloc <n>\t\tReplay the allocations of monsters, floor items and scripts <n> times on every allocator.\n");
+	ShowInfo("  --bench-ers <n>\t\tChurn <n> entries of the timer, skill timer and script state caches through both entry managers.\n");
+#endif
 	if( do_exit )
 		exit(EXIT_SUCCESS);
 }
@@ -5411,10 +5585,21 @@ bool MapServer::initialize( int32 argc, char *argv[] ){
 #ifdef MAP_GENERATOR
 	mapgenerator_get_options(argc, argv);
 #endif
+#ifdef MAP_BENCH
+	bench_get_options(argc, argv);
+#endif
+	trace_get_options(argc, argv);
 	cli_get_options(argc,argv);
 
 	map_config_read(MAP_CONF_NAME);
 
+	// Freezes the clock before the first timer is added
+	if (!trace_replay_open())
+		return false;
+#ifdef MAP_BENCH
+	bench_open();
+#endif
+
 	if (save_settings == CHARSAVE_NONE)
 		ShowWarning("Value of 'save_settings' is not set, player's data only will be saved every 'autosave_time' (%d seconds).\n", autosave_interval/1000);
 
@@ -5456,12 +5641,19 @@ bool MapServer::initialize( int32 argc, char *argv[] ){
 	map_db = uidb_alloc(DB_OPT_BASE);
 	nick_db = idb_alloc(DB_OPT_BASE);
 	charid_db = uidb_alloc(DB_OPT_BASE);
-	regen_db = idb_alloc(DB_OPT_BASE); // efficient status_natural_heal processing
 	iwall_db = strdb_alloc(DB_OPT_RELEASE_DATA,2*NAME_LENGTH+2+1); // [Zephyrus] Invisible Walls
 
+#ifndef MAP_BENCH
 	map_sql_init();
 	if (log_config.sql_logs)
 		log_sql_init();
+#else
+	// The benchmark runs without a database, queries on the unconnected handles fail
+	mmysql_handle = Sql_Malloc();
+	qsmysql_handle = Sql_Malloc();
+	log_config.enable_logs = LOG_TYPE_NONE;
+	log_config.sql_logs = false;
+#endif
 
 	mapindex_init();
 	if(enable_grf)
@@ -5511,6 +5703,9 @@ bool MapServer::initialize( int32 argc, char *argv[] ){
 	do_init_rune();	
 	do_init_stall();
 	do_init_aura();
+	do_init_autocombat();
+
+	do_init_trace();
 
 	npc_event_do_oninit();	// Init npcs (OnInit)
 
@@ -5522,7 +5717,9 @@ bool MapServer::initialize( int32 argc, char *argv[] ){
 	if (battle_config.pk_mode)
 		ShowNotice("Server is running on '" CL_WHITE "PK Mode" CL_RESET "'.\n");
 
-#ifndef MAP_GENERATOR
+#if defined(MAP_BENCH)
+	ShowStatus("Server is '" CL_GREEN "ready" CL_RESET "' for the benchmark.\n\n");
+#elif !defined(MAP_GENERATOR)
 	ShowStatus("Server is '" CL_GREEN "ready" CL_RESET "' and listening on port '" CL_WHITE "%d" CL_RESET "'.\n\n", map_port);
 #else
 	// depending on gen_options, generate the correct things
@@ -5540,9 +5737,26 @@ bool MapServer::initialize( int32 argc, char *argv[] ){
 		add_timer_interval(gettick()+1000, parse_console_timer, 0, 0, 1000); //start in 1s each 1sec
 	}
 
+	trace_replay_start();
+#ifdef MAP_BENCH
+	bench_start();
+#endif
+
 	return true;
 }
 
+/// Replaying a packet trace or running the benchmark takes the place of the socket handling.
+void MapServer::handle_main( t_tick next ){
+#ifdef MAP_BENCH
+	bench_step( next );
+#else
+	if( trace_replaying() )
+		trace_replay_step( next );
+	else
+		Core::handle_main( next );
+#endif
+}
+
 int32 main( int32 argc, char *argv[] ){
 	return main_core<MapServer>( argc, argv );
 }
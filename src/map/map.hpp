@@ -6,6 +6,7 @@
 
 #include <algorithm>
 #include <cstdarg>
+#include <functional>
 #include <string>
 #include <type_traits>
 #include <unordered_map>
@@ -31,6 +32,7 @@ namespace rathena::server_map {
 class MapServer : public Core{
 	protected:
 		bool initialize( int32 argc, char* argv[] ) override;
+		void handle_main( t_tick next ) override;
 		void finalize() override;
 		void handle_crash() override;
 		void handle_shutdown() override;
@@ -1153,6 +1155,8 @@ int32 map_moveblock(block_list *, int32, int32, t_tick);
 int32 map_foreachinrange(int32 (*func)(block_list*,va_list), block_list* center, int16 range, int32 type, ...);
 int32 map_foreachinallrange(int32 (*func)(block_list*,va_list), block_list* center, int16 range, int32 type, ...);
 int32 map_foreachinshootrange(int32 (*func)(block_list*,va_list), block_list* center, int16 range, int32 type, ...);
+block_list* map_findnearest(block_list* center, int16 range, int32 type, const std::function<bool(block_list*)>& predicate);
+size_t map_findnearest_k(block_list* center, int16 range, int32 type, size_t count, const std::function<bool(block_list*)>& predicate, std::vector<block_list*>& result);
 int32 map_foreachinarea(int32 (*func)(block_list*, va_list), int16 m, int16 x0, int16 y0, int16 x1, int16 y1, int32 type, ...);
 int32 map_foreachinallarea(int32 (*func)(block_list*, va_list), int16 m, int16 x0, int16 y0, int16 x1, int16 y1, int32 type, ...);
 int32 map_foreachinshootarea(int32 (*func)(block_list*, va_list), int16 m, int16 x0, int16 y0, int16 x1, int16 y1, int32 type, ...);
@@ -1220,7 +1224,6 @@ void map_deliddb(block_list *bl);
 void map_foreachpc(int32 (*func)(map_session_data* sd, va_list args), ...);
 void map_foreachmob(int32 (*func)(mob_data* md, va_list args), ...);
 void map_foreachnpc(int32 (*func)(npc_data* nd, va_list args), ...);
-void map_foreachregen(int32 (*func)(block_list* bl, va_list args), ...);
 void map_foreachiddb(int32 (*func)(block_list* bl, va_list args), ...);
 map_session_data * map_nick2sd(const char* nick, bool allow_partial);
 mob_data * map_getmob_boss(int16 m);
@@ -1330,6 +1333,18 @@ extern Sql* qsmysql_handle;
 extern Sql* logmysql_handle;
 #endif
 
+extern std::string default_codepage;
+extern int32 map_server_port;
+extern std::string map_server_ip;
+extern std::string map_server_id;
+extern std::string map_server_pw;
+extern std::string map_server_db;
+extern std::string log_db_ip;
+extern uint16 log_db_port;
+extern std::string log_db_id;
+extern std::string log_db_pw;
+extern std::string log_db_db;
+
 extern char barter_table[32];
 extern char buyingstores_table[32];
 extern char buyingstore_items_table[32];
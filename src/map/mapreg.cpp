@@ -3,16 +3,23 @@
 
 #include "mapreg.hpp"
 
+#include <algorithm>
 #include <cstdlib>
+#include <string>
+#include <unordered_set>
+#include <vector>
 
 #include <common/cbasetypes.hpp>
 #include <common/db.hpp>
 #include <common/ers.hpp>
 #include <common/malloc.hpp>
+#include <common/profiler.hpp>
 #include <common/showmsg.hpp>
 #include <common/sql.hpp>
+#include <common/sqlworker.hpp>
 #include <common/strlib.hpp>
 #include <common/timer.hpp>
+#include <common/utils.hpp>
 
 #include "map.hpp" // mmysql_handle
 #include "script.hpp"
@@ -22,12 +29,34 @@ static struct eri *mapreg_ers;
 bool skip_insert = false;
 
 static char mapreg_table[32] = "mapreg";
-static bool mapreg_dirty = false; // Whether there are modified regs to be saved
+static uint32 mapreg_save_interval = 10; // Seconds between two flushes of the dirty variables
+static bool mapreg_async_writes = true; // Whether flushes are written by a background connection
+static std::unordered_set<int64> mapreg_dirty; // Permanent variables whose row in the database is outdated
+static SqlWorkerPool mapreg_sql_workers;
+static s_mapreg_metrics mapreg_metrics;
 struct reg_db regs;
 
-#define MAPREG_AUTOSAVE_INTERVAL (300*1000)
+/// Maximum amount of rows per INSERT or DELETE query of a flush
+#define MAPREG_BATCH_SIZE 500
 
 
+/**
+ * Queues a permanent variable for the next flush.
+ * The flush writes whatever state the variable has at that time: an upsert if it
+ * still exists, a delete otherwise.
+ *
+ * @param uid: variable's unique identifier
+ */
+static void mapreg_mark_dirty(int64 uid)
+{
+	struct mapreg_save *m = (struct mapreg_save *)i64db_get(regs.vars, uid);
+
+	if (m != nullptr)
+		m->save = true;
+
+	mapreg_dirty.insert(uid);
+}
+
 /**
  * Looks up the value of an integer variable using its uid.
  *
@@ -69,10 +98,8 @@ bool mapreg_setreg(int64 uid, int64 val)
 	if (val != 0) {
 		if ((m = static_cast<mapreg_save *>(i64db_get(regs.vars, uid)))) {
 			m->u.i = val;
-			if (name[1] != '@') {
-				m->save = true;
-				mapreg_dirty = true;
-			}
+			if (name[1] != '@')
+				mapreg_mark_dirty(m->uid);
 		} else {
 			if (i)
 				script_array_update(&regs, uid, false);
@@ -84,12 +111,8 @@ bool mapreg_setreg(int64 uid, int64 val)
 			m->save = false;
 			m->is_string = false;
 
-			if (name[1] != '@' && !skip_insert) {// write new variable to database
-				char esc_name[32 * 2 + 1];
-				Sql_EscapeStringLen(mmysql_handle, esc_name, name, strnlen(name, 32));
-				if (SQL_ERROR == Sql_Query(mmysql_handle, "INSERT INTO `%s`(`varname`,`index`,`value`) VALUES ('%s','%" PRIu32 "','%" PRId64 "')", mapreg_table, esc_name, i, val))
-					Sql_ShowDebug(mmysql_handle);
-			}
+			if (name[1] != '@' && !skip_insert) // write new variable to database
+				mapreg_mark_dirty(uid);
 			i64db_put(regs.vars, uid, m);
 		}
 	} else { // val == 0
@@ -100,12 +123,8 @@ bool mapreg_setreg(int64 uid, int64 val)
 		}
 		i64db_remove(regs.vars, uid);
 
-		if (name[1] != '@') {// Remove from database because it is unused.
-			char esc_name[32 * 2 + 1];
-			Sql_EscapeStringLen(mmysql_handle, esc_name, name, strnlen(name, 32));
-			if (SQL_ERROR == Sql_Query(mmysql_handle, "DELETE FROM `%s` WHERE `varname`='%s' AND `index`='%" PRIu32 "'", mapreg_table, esc_name, i))
-				Sql_ShowDebug(mmysql_handle);
-		}
+		if (name[1] != '@') // Remove from database because it is unused.
+			mapreg_mark_dirty(uid);
 	}
 
 	return true;
@@ -128,12 +147,8 @@ bool mapreg_setregstr(int64 uid, const char* str)
 	if (str == nullptr || *str == 0) {
 		if (i)
 			script_array_update(&regs, uid, true);
-		if (name[1] != '@') {
-			char esc_name[32 * 2 + 1];
-			Sql_EscapeStringLen(mmysql_handle, esc_name, name, strnlen(name, 32));
-			if (SQL_ERROR == Sql_Query(mmysql_handle, "DELETE FROM `%s` WHERE `varname`='%s' AND `index`='%" PRIu32 "'", mapreg_table, esc_name, i))
-				Sql_ShowDebug(mmysql_handle);
-		}
+		if (name[1] != '@')
+			mapreg_mark_dirty(uid);
 		if ((m = static_cast<mapreg_save *>(i64db_get(regs.vars, uid)))) {
 			if (m->u.str != nullptr)
 				aFree(m->u.str);
@@ -145,10 +160,8 @@ bool mapreg_setregstr(int64 uid, const char* str)
 			if (m->u.str != nullptr)
 				aFree(m->u.str);
 			m->u.str = aStrdup(str);
-			if (name[1] != '@') {
-				mapreg_dirty = true;
-				m->save = true;
-			}
+			if (name[1] != '@')
+				mapreg_mark_dirty(m->uid);
 		} else {
 			if (i)
 				script_array_update(&regs, uid, false);
@@ -160,14 +173,8 @@ bool mapreg_setregstr(int64 uid, const char* str)
 			m->save = false;
 			m->is_string = true;
 
-			if (name[1] != '@' && !skip_insert) { //put returned null, so we must insert.
-				char esc_name[32 * 2 + 1];
-				char esc_str[255 * 2 + 1];
-				Sql_EscapeStringLen(mmysql_handle, esc_name, name, strnlen(name, 32));
-				Sql_EscapeStringLen(mmysql_handle, esc_str, str, strnlen(str, 255));
-				if (SQL_ERROR == Sql_Query(mmysql_handle, "INSERT INTO `%s`(`varname`,`index`,`value`) VALUES ('%s','%" PRIu32 "','%s')", mapreg_table, esc_name, i, esc_str))
-					Sql_ShowDebug(mmysql_handle);
-			}
+			if (name[1] != '@' && !skip_insert) //put returned null, so we must insert.
+				mapreg_mark_dirty(uid);
 			i64db_put(regs.vars, uid, m);
 		}
 	}
@@ -221,51 +228,147 @@ static void script_load_mapreg(void)
 	}
 
 	skip_insert = false;
-	mapreg_dirty = false;
 }
 
 /**
- * Saves permanent variables to database.
+ * Sends a batch of a flush to the database.
+ * Failed batches are queued again, so they are retried by the next flush.
+ *
+ * @param query: complete query
+ * @param uids: variables written by the query
+ * @param async: whether the query may be executed by the background connection
  */
-static void script_save_mapreg(void)
+static void script_save_mapreg_batch(const std::string& query, std::vector<int64>& uids, bool async)
 {
-	if (mapreg_dirty) {
-		DBIterator *iter = db_iterator(regs.vars);
-		struct mapreg_save *m;
-		for (m = static_cast<mapreg_save *>(dbi_first(iter)); dbi_exists(iter); m = static_cast<mapreg_save *>(dbi_next(iter))) {
-			if (m->save) {
-				int32 num = script_getvarid(m->uid);
-				uint32 i = script_getvaridx(m->uid);
-				const char* name = get_str(num);
-				if (!m->is_string) {
-					char esc_name[32 * 2 + 1];
-					Sql_EscapeStringLen(mmysql_handle, esc_name, name, strnlen(name, 32));
-					if (SQL_ERROR == Sql_Query(mmysql_handle, "UPDATE `%s` SET `value`='%" PRId64 "' WHERE `varname`='%s' AND `index`='%" PRIu32 "' LIMIT 1", mapreg_table, m->u.i, esc_name, i))
-						Sql_ShowDebug(mmysql_handle);
-				} else {
-					char esc_str[2 * 255 + 1];
-					char esc_name[32 * 2 + 1];
-					Sql_EscapeStringLen(mmysql_handle, esc_name, name, strnlen(name, 32));
-					Sql_EscapeStringLen(mmysql_handle, esc_str, m->u.str, safestrnlen(m->u.str, 255));
-					if (SQL_ERROR == Sql_Query(mmysql_handle, "UPDATE `%s` SET `value`='%s' WHERE `varname`='%s' AND `index`='%" PRIu32 "' LIMIT 1", mapreg_table, esc_str, esc_name, i))
-						Sql_ShowDebug(mmysql_handle);
-				}
-				m->save = false;
+	mapreg_metrics.rows_written += uids.size();
+
+	if (async && mapreg_sql_workers.is_enabled()) {
+		mapreg_sql_workers.enqueue(query, [uids](s_sql_worker_result& result) {
+			mapreg_metrics.last_write = result.duration;
+			mapreg_metrics.max_write = std::max(mapreg_metrics.max_write, result.duration);
+
+			if (!result.success) {
+				mapreg_metrics.failed++;
+				// Variables that changed again since then are already queued with their current value
+				mapreg_dirty.insert(uids.begin(), uids.end());
 			}
+		});
+	} else {
+		t_tick start = gettick_nocache();
+
+		if (SQL_ERROR == Sql_QueryStr(mmysql_handle, query.c_str())) {
+			Sql_ShowDebug(mmysql_handle);
+			mapreg_metrics.failed++;
+			mapreg_dirty.insert(uids.begin(), uids.end());
 		}
-		dbi_destroy(iter);
-		mapreg_dirty = false;
+
+		mapreg_metrics.last_write = DIFF_TICK(gettick_nocache(), start);
+		mapreg_metrics.max_write = std::max(mapreg_metrics.max_write, mapreg_metrics.last_write);
 	}
+
+	uids.clear();
+}
+
+/**
+ * Saves the modified permanent variables to database.
+ * Variables that still exist are written with batched upserts, removed ones with batched deletes.
+ *
+ * @param async: whether the batches may be written by the background connection
+ */
+static void script_save_mapreg(bool async)
+{
+	if (mapreg_dirty.empty())
+		return;
+
+	uint64 start = profiler_clock();
+	std::unordered_set<int64> dirty;
+	const std::string upsert_head = "INSERT INTO `" + std::string(mapreg_table) + "`(`varname`,`index`,`value`) VALUES ";
+	const std::string upsert_tail = " ON DUPLICATE KEY UPDATE `value`=VALUES(`value`)";
+	const std::string delete_head = "DELETE FROM `" + std::string(mapreg_table) + "` WHERE (`varname`,`index`) IN (";
+	std::string upserts, deletes;
+	std::vector<int64> upsert_uids, delete_uids;
+	char esc_name[32 * 2 + 1];
+	char esc_str[255 * 2 + 1];
+	char row[32 * 2 + 255 * 2 + 32];
+
+	mapreg_metrics.flushes++;
+	// Failed batches are queued again while iterating
+	dirty.swap(mapreg_dirty);
+
+	for (int64 uid : dirty) {
+		struct mapreg_save *m = (struct mapreg_save *)i64db_get(regs.vars, uid);
+		const char* name = get_str(script_getvarid(uid));
+		uint32 i = script_getvaridx(uid);
+
+		Sql_EscapeStringLen(mmysql_handle, esc_name, name, strnlen(name, 32));
+
+		if (m == nullptr) {
+			safesnprintf(row, sizeof(row), "%s('%s','%" PRIu32 "')", delete_uids.empty() ? "" : ",", esc_name, i);
+			deletes += row;
+			delete_uids.push_back(uid);
+
+			if (delete_uids.size() >= MAPREG_BATCH_SIZE) {
+				script_save_mapreg_batch(delete_head + deletes + ")", delete_uids, async);
+				deletes.clear();
+			}
+			continue;
+		}
+
+		if (m->is_string) {
+			Sql_EscapeStringLen(mmysql_handle, esc_str, m->u.str, safestrnlen(m->u.str, 255));
+			safesnprintf(row, sizeof(row), "%s('%s','%" PRIu32 "','%s')", upsert_uids.empty() ? "" : ",", esc_name, i, esc_str);
+		} else
+			safesnprintf(row, sizeof(row), "%s('%s','%" PRIu32 "','%" PRId64 "')", upsert_uids.empty() ? "" : ",", esc_name, i, m->u.i);
+		upserts += row;
+		upsert_uids.push_back(uid);
+		m->save = false;
+
+		if (upsert_uids.size() >= MAPREG_BATCH_SIZE) {
+			script_save_mapreg_batch(upsert_head + upserts + upsert_tail, upsert_uids, async);
+			upserts.clear();
+		}
+	}
+
+	if (!upsert_uids.empty())
+		script_save_mapreg_batch(upsert_head + upserts + upsert_tail, upsert_uids, async);
+	if (!delete_uids.empty())
+		script_save_mapreg_batch(delete_head + deletes + ")", delete_uids, async);
+
+	mapreg_metrics.last_flush = profiler_clock() - start;
+	mapreg_metrics.max_flush = std::max(mapreg_metrics.max_flush, mapreg_metrics.last_flush);
+}
+
+/**
+ * Waits until all flushes were written to database.
+ */
+static void script_sync_mapreg(void)
+{
+	// Earlier batches first, failed ones are queued again and written below
+	mapreg_sql_workers.wait();
+	script_save_mapreg(false);
 }
 
 /**
  * Timer event to auto-save permanent variables.
  */
 static TIMER_FUNC(script_autosave_mapreg){
-	script_save_mapreg();
+	// Deliver the results of the previous flushes
+	mapreg_sql_workers.process();
+	script_save_mapreg(mapreg_async_writes);
 	return 0;
 }
 
+/**
+ * Statistics of the mapreg persistence.
+ */
+const s_mapreg_metrics& mapreg_get_metrics(void)
+{
+	mapreg_metrics.dirty = mapreg_dirty.size();
+	mapreg_metrics.pending = mapreg_sql_workers.get_pending();
+
+	return mapreg_metrics;
+}
+
 /**
  * Destroys a mapreg_save structure, freeing the contained string, if any.
  *
@@ -297,7 +400,8 @@ int32 mapreg_destroyreg(DBKey key, DBData *data, va_list ap)
  */
 void mapreg_reload(void)
 {
-	script_save_mapreg();
+	// The reload reads the table, so every flush must have been written
+	script_sync_mapreg();
 
 	regs.vars->clear(regs.vars, mapreg_destroyreg);
 
@@ -314,7 +418,8 @@ void mapreg_reload(void)
  */
 void mapreg_final(void)
 {
-	script_save_mapreg();
+	script_sync_mapreg();
+	mapreg_sql_workers.finalize();
 
 	regs.vars->destroy(regs.vars, mapreg_destroyreg);
 
@@ -337,8 +442,11 @@ void mapreg_init(void)
 
 	script_load_mapreg();
 
+	if (mapreg_async_writes && !mapreg_sql_workers.initialize(1, map_server_id.c_str(), map_server_pw.c_str(), map_server_ip.c_str(), map_server_port, map_server_db.c_str(), default_codepage.c_str()))
+		ShowWarning("mapreg_init: Could not open the background connection, permanent global variables are saved synchronously.\n");
+
 	add_timer_func_list(script_autosave_mapreg, "script_autosave_mapreg");
-	add_timer_interval(gettick() + MAPREG_AUTOSAVE_INTERVAL, script_autosave_mapreg, 0, 0, MAPREG_AUTOSAVE_INTERVAL);
+	add_timer_interval(gettick() + mapreg_save_interval * 1000, script_autosave_mapreg, 0, 0, mapreg_save_interval * 1000);
 }
 
 /**
@@ -348,6 +456,10 @@ bool mapreg_config_read(const char* w1, const char* w2)
 {
 	if(!strcmpi(w1, "mapreg_table"))
 		safestrncpy(mapreg_table, w2, sizeof(mapreg_table));
+	else if(!strcmpi(w1, "mapreg_save_interval"))
+		mapreg_save_interval = cap_value(atoi(w2), 1, 3600);
+	else if(!strcmpi(w1, "mapreg_async_writes"))
+		mapreg_async_writes = config_switch(w2) != 0;
 	else
 		return false;
 
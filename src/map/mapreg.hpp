@@ -6,6 +6,7 @@
 
 #include <common/cbasetypes.hpp>
 #include <common/db.hpp>
+#include <common/timer.hpp>
 
 struct mapreg_save {
 	int64 uid;         ///< Unique ID
@@ -17,6 +18,19 @@ struct mapreg_save {
 	bool save;         ///< Whether a save operation is pending
 };
 
+/// Statistics of the mapreg persistence
+struct s_mapreg_metrics {
+	size_t dirty;       ///< Variables waiting for the next flush
+	size_t pending;     ///< Batches queued on the background connection
+	uint64 flushes;
+	uint64 rows_written;
+	uint64 failed;      ///< Batches that failed and were queued again
+	uint64 last_flush;  ///< Time the main thread spent on the last flush in microseconds
+	uint64 max_flush;
+	t_tick last_write;  ///< Time the database needed for the last batch in milliseconds
+	t_tick max_write;
+};
+
 extern struct reg_db regs;
 extern bool skip_insert;
 
@@ -24,6 +38,7 @@ void mapreg_reload(void);
 void mapreg_final(void);
 void mapreg_init(void);
 bool mapreg_config_read(const char* w1, const char* w2);
+const s_mapreg_metrics& mapreg_get_metrics(void);
 
 int64 mapreg_readreg(int64 uid);
 char* mapreg_readregstr(int64 uid);
@@ -1626,60 +1626,49 @@ int32 mob_target(mob_data *md,block_list *bl,int32 dist)
 }
 
 /*==========================================
- * The ?? routine of an active monster
+ * Whether an active monster can pick a new target
+ * @param md: Monster searching for a target
+ * @param bl: Candidate
+ * @param target: Current target of the monster or nullptr
+ * @param mode: Mode of the monster
  *------------------------------------------*/
-static int32 mob_ai_sub_hard_activesearch(block_list *bl,va_list ap)
+static bool mob_ai_sub_hard_activesearch(mob_data *md, block_list *bl, block_list *target, enum e_mode mode)
 {
-	mob_data *md;
-	block_list **target;
-	enum e_mode mode;
-	int32 dist;
-
-	nullpo_ret(bl);
-	md=va_arg(ap,mob_data *);
-	target= va_arg(ap,block_list**);
-	mode= static_cast<enum e_mode>(va_arg(ap, int32));
-	
-	ac_mob_ai_search_mvpcheck(bl, md);
-
 	//If can't seek yet, not an enemy, or you can't attack it, skip.
-	if ((*target) == bl || !status_check_skilluse(md, bl, 0, 0))
-		return 0;
+	if (target == bl || !status_check_skilluse(md, bl, 0, 0))
+		return false;
 
 	if ((mode&MD_TARGETWEAK) && status_get_lv(bl) >= md->level-5)
-		return 0;
+		return false;
 
 	if(battle_check_target(md,bl,BCT_ENEMY)<=0)
-		return 0;
+		return false;
 
 	if (bl->type == BL_PC && BL_CAST(BL_PC, bl)->state.gangsterparadise &&
 		!status_has_mode(&md->status,MD_STATUSIMMUNE))
-		return 0; //Gangster paradise protection.
+		return false; //Gangster paradise protection.
 
 	if (battle_config.hom_setting&HOMSET_FIRST_TARGET &&
-		(*target) != nullptr && (*target)->type == BL_HOM && bl->type != BL_HOM)
-		return 0; //For some reason Homun targets are never overriden.
+		target != nullptr && target->type == BL_HOM && bl->type != BL_HOM)
+		return false; //For some reason Homun targets are never overriden.
+
+	//Only pick a target that is closer than the current one
+	if (target != nullptr && check_distance_bl(md, target, distance_bl(md, bl)))
+		return false;
+
+	if (!battle_check_range(md,bl,md->db->range2))
+		return false;
 
-	dist = distance_bl(md, bl);
-	if(
-		((*target) == nullptr || !check_distance_bl(md, *target, dist)) &&
-		battle_check_range(md,bl,md->db->range2)
-	) { //Pick closest target?
 #ifdef ACTIVEPATHSEARCH
-		struct walkpath_data wpd;
-		if (!path_search(&wpd, md->m, md->x, md->y, bl->x, bl->y, 0, CELL_CHKWALL)) // Count walk path cells
-			return 0;
-		//Standing monsters use range2, walking monsters use range3
-		if ((md->ud.walktimer == INVALID_TIMER && wpd.path_len > md->db->range2)
-			|| (md->ud.walktimer != INVALID_TIMER && wpd.path_len > md->db->range3))
-			return 0;
+	struct walkpath_data wpd;
+	if (!path_search(&wpd, md->m, md->x, md->y, bl->x, bl->y, 0, CELL_CHKWALL)) // Count walk path cells
+		return false;
+	//Standing monsters use range2, walking monsters use range3
+	if ((md->ud.walktimer == INVALID_TIMER && wpd.path_len > md->db->range2)
+		|| (md->ud.walktimer != INVALID_TIMER && wpd.path_len > md->db->range3))
+		return false;
 #endif
-		(*target) = bl;
-		md->target_id=bl->id;
-		return 1;
-
-	}
-	return 0;
+	return true;
 }
 
 /*==========================================
@@ -2343,7 +2332,22 @@ static bool mob_ai_sub_hard(mob_data *md, t_tick tick)
 	if ((mode&MD_AGGRESSIVE && (!tbl || slave_lost_target)) || md->state.skillstate == MSS_FOLLOW)
 	{
 		int32 prev_id = md->target_id;
-		map_foreachinallrange (mob_ai_sub_hard_activesearch, md, view_range, DEFAULT_ENEMY_TYPE(md), md, &tbl, mode);
+		int32 search_range = view_range;
+
+		ac_mob_ai_search_mvpcheck(md, view_range);
+
+		// Nothing farther than the current target can replace it
+		if (tbl != nullptr)
+			search_range = i32min(search_range, distance_bl(md, tbl));
+
+		block_list *nearest = map_findnearest(md, search_range, DEFAULT_ENEMY_TYPE(md), [md, tbl, mode](block_list *bl) {
+			return mob_ai_sub_hard_activesearch(md, bl, tbl, static_cast<enum e_mode>(mode));
+		});
+
+		if (nearest != nullptr) { //Pick closest target
+			tbl = nearest;
+			md->target_id = nearest->id;
+		}
 		// If a monster finds a new target that is already in attack range it immediately switches to rush mode
 		// This behavior overrides even angry mode and other mode-specific behavior
 		if (tbl != nullptr && prev_id != md->target_id && battle_check_range(md, tbl, md->status.rhw.range)) {
@@ -3608,7 +3612,7 @@ int32 mob_dead(mob_data *md, block_list *src, int32 type)
 						//it's positive, then it goes as it is
 						drop_rate = it.rate;
 
-					if (rnd()%10000 >= drop_rate)
+					if (rnd_value(RND_STREAM_DROP, 0, 9999) >= drop_rate)
 						continue;
 
 					if (sd && sd->state.autocombat)
@@ -3642,7 +3646,15 @@ int32 mob_dead(mob_data *md, block_list *src, int32 type)
 		}
 
 		// Regular mob drops drop after script-granted drops
-		for( const std::shared_ptr<s_mob_drop>& entry : md->db->dropitem ){
+		// Roll the whole drop table at once
+		static std::vector<int32> drop_rolls;
+
+		drop_rolls.resize( md->db->dropitem.size() );
+		rnd_fill( RND_STREAM_DROP, drop_rolls.data(), drop_rolls.size(), 0, 9999 );
+
+		for( size_t drop_index = 0; drop_index < md->db->dropitem.size(); drop_index++ ){
+			const std::shared_ptr<s_mob_drop>& entry = md->db->dropitem[drop_index];
+
 			if (entry->nameid == 0)
 				continue;
 
@@ -3654,7 +3666,7 @@ int32 mob_dead(mob_data *md, block_list *src, int32 type)
 			drop_rate = mob_getdroprate(src, md->db, entry->rate, drop_modifier, md);
 
 			// attempt to drop the item
-			if (rnd() % 10000 >= drop_rate)
+			if (drop_rolls[drop_index] >= drop_rate)
 				continue;
 
 			if (first_sd != nullptr && it->type == IT_PETEGG) {
@@ -3,16 +3,25 @@
 
 #include "npc.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cerrno>
 #include <cstdlib>
 #include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include <sys/stat.h>
+
 #include <common/cbasetypes.hpp>
 #include <common/db.hpp>
 #include <common/ers.hpp>
 #include <common/malloc.hpp>
 #include <common/nullpo.hpp>
+#include <common/profiler.hpp>
 #include <common/showmsg.hpp>
 #include <common/strlib.hpp>
 #include <common/timer.hpp>
@@ -42,6 +51,50 @@ npc_data* fake_nd;
 
 std::vector<std::string> npc_src_files;
 
+/// Maximum amount of threads reading npc source files
+#define NPC_LOAD_THREADS 8
+
+/// Fingerprint of a parsed npc source file, to find the files that changed since
+struct s_npc_source_state{
+	time_t mtime;
+	uint64 size;
+	uint64 hash;
+};
+
+/// Why a npc source file could not be read
+enum e_npc_source_error : uint8{
+	NPC_SOURCE_OK = 0,
+	NPC_SOURCE_NOT_FILE,
+	NPC_SOURCE_NOT_FOUND,
+	NPC_SOURCE_READ_FAILED,
+	NPC_SOURCE_BOM,
+};
+
+/// A line of a npc source file split into w1<TAB>w2<TAB>w3<TAB>w4
+struct s_npc_source_line{
+	size_t offset; ///< Offset of the line in the buffer
+	size_t pos[9]; ///< Field positions of sv_parse, relative to the line
+	size_t count; ///< Amount of fields
+};
+
+/// Contents of a npc source file, read and split ahead of parsing.
+/// npc_readsrcfile and npc_splitsrcfile do not touch any map-server state, so files can be
+/// read and split on worker threads, while compiling and registering the npcs stays on the main thread.
+struct s_npc_source{
+	std::string path;
+	std::string buffer;
+	std::vector<s_npc_source_line> lines; ///< Lines split by npc_splitsrcfile, in buffer order
+	e_npc_source_error error;
+	int32 error_code; ///< errno of a failed read
+	s_npc_source_state state;
+	uint64 parse_time; ///< Microseconds spent parsing the file
+};
+
+/// Fingerprints of the parsed npc source files by path
+static std::unordered_map<std::string, s_npc_source_state> npc_src_states;
+
+static int32 npc_parsesource( s_npc_source& source );
+
 static int32 npc_id=START_NPC_NUM;
 static int32 npc_warp=0;
 static int32 npc_shop=0;
@@ -95,6 +148,10 @@ struct event_data {
 	int32 pos;
 };
 
+// Lowercase label -> names of the events in ev_db with that label, in export order.
+// Lets "::<label>" broadcasts and clock events only visit the NPCs that have the label.
+static std::unordered_map<std::string, std::vector<std::string>> npc_event_index;
+
 static struct eri *timer_event_ers; //For the npc timer data. [Skotlex]
 
 /* hello */
@@ -113,7 +170,7 @@ static struct view_data npc_viewdb2[MAX_NPC_CLASS2_END-MAX_NPC_CLASS2_START];
 
 struct script_event_s{
 	struct event_data *event;
-	const char *event_name;
+	std::string event_name;
 };
 
 // Holds pointers to the commonly executed scripts for speedup. [Skotlex]
@@ -1224,6 +1281,57 @@ int32 npc_event_dequeue(map_session_data* sd,bool free_script_stack)
 	return 1;
 }
 
+/**
+ * Get the lowercase label of an event name.
+ * @param name: "<npc>::<label>" or "::<label>"
+ * @return empty string if the name has no label
+ */
+static std::string npc_event_index_label( const char* name ){
+	const char* label = strstr( name, "::" );
+
+	if( label == nullptr ){
+		return std::string();
+	}
+
+	std::string lower( label + 2 );
+
+	std::transform( lower.begin(), lower.end(), lower.begin(), ::tolower );
+
+	return lower;
+}
+
+static void npc_event_index_add( const char* name ){
+	npc_event_index[npc_event_index_label( name )].push_back( name );
+}
+
+static void npc_event_index_remove( const char* name ){
+	auto it = npc_event_index.find( npc_event_index_label( name ) );
+
+	if( it == npc_event_index.end() ){
+		return;
+	}
+
+	util::vector_erase_if_exists( it->second, std::string( name ) );
+
+	if( it->second.empty() ){
+		npc_event_index.erase( it );
+	}
+}
+
+/**
+ * Names of the events with the given label.
+ * Returns a copy, because running the events can load or unload NPCs.
+ */
+static std::vector<std::string> npc_event_index_find( const char* name ){
+	auto it = npc_event_index.find( npc_event_index_label( name ) );
+
+	if( it == npc_event_index.end() ){
+		return std::vector<std::string>();
+	}
+
+	return it->second;
+}
+
 /*==========================================
  * exports a npc event label
  * called from npc_parse_script
@@ -1261,6 +1369,7 @@ static int32 npc_event_export(npc_data *nd, int32 i)
 		ev->pos = pos;
 		if (strdb_put(ev_db, buf, ev)) // There was already another event of the same name?
 			return 1;
+		npc_event_index_add(buf);
 	}
 	return 0;
 }
@@ -1268,69 +1377,48 @@ static int32 npc_event_export(npc_data *nd, int32 i)
 int32 npc_event_sub(map_session_data* sd, struct event_data* ev, const char* eventname); //[Lance]
 
 /**
- * Exec name (NPC events) on player or global
- * Do on all NPC when called with foreach
- * @see DBApply
+ * Runs the events of the index that match a name
+ * @param name: "::<label>" runs the label of every NPC, "<npc>::<label>" only the one of the NPC
+ * @param rid: unit the scripts are attached to
+ * @param player: rid is a player, that may only have 1 script running at the same time
+ * @return amount of events that were run
  */
-int32 npc_event_doall_sub(DBKey key, DBData *data, va_list ap)
-{
-	const char* p = key.str;
-	struct event_data* ev;
-	int32* c;
-	const char* name;
-	int32 rid;
+static int32 npc_event_run_index(const char* name, int32 rid, bool player) {
+	bool all = ( name[0] == ':' && name[1] == ':' );
+	int32 c = 0;
 
-	nullpo_ret(ev = (struct event_data*)db_data2ptr(data));
-	nullpo_ret(c = va_arg(ap, int32 *));
-	nullpo_ret(name = va_arg(ap, const char *));
-	rid = va_arg(ap, int32);
+	for( const std::string& event_name : npc_event_index_find( name ) ){
+		if( !all && strcmpi( name, event_name.c_str() ) != 0 )
+			continue;
 
-	p = strchr(p, ':'); // match only the event name
-	if( p && strcmpi(name, p) == 0 /* && !ev->nd->src_id */ ) // Do not run on duplicates. [Paradox924X]
-	{
-		if(rid) // a player may only have 1 script running at the same time
-			npc_event_sub(map_id2sd(rid),ev,key.str);
+		// Events run before may have unloaded this one
+		struct event_data* ev = (struct event_data*)strdb_get( ev_db, event_name.c_str() );
+
+		if( ev == nullptr )
+			continue;
+
+		if( player )
+			npc_event_sub(map_id2sd(rid),ev,event_name.c_str());
 		else
 			run_script(ev->nd->u.scr.script,ev->pos,rid,ev->nd->id);
-		(*c)++;
+		c++;
 	}
 
-	return 0;
+	return c;
 }
 
 /**
- * @see DBApply
+ * Exec name (NPC events) on a unit or global
+ * Events of all NPCs are run without any attached unit.
+ * @param name: "::<label>" runs the label of every NPC, "<npc>::<label>" only the one of the NPC
+ * @param rid: unit the event of a single NPC is attached to, may be a monster or any other unit
+ * @return amount of events that were run
  */
-static int32 npc_event_do_sub(DBKey key, DBData *data, va_list ap)
-{
-	const char* p = key.str;
-	struct event_data* ev;
-	int32* c, rid;
-	const char* name;
-
-	nullpo_ret(ev = (struct event_data*)db_data2ptr(data));
-	nullpo_ret(c = va_arg(ap, int32 *));
-	nullpo_ret(name = va_arg(ap, const char *));
-	rid = va_arg(ap, int32);
-
-	if( p && strcmpi(name, p) == 0 )
-	{
-		run_script(ev->nd->u.scr.script,ev->pos,rid,ev->nd->id);
-		(*c)++;
-	}
-
-	return 0;
-}
-
 int32 npc_event_do_id(const char* name, int32 rid) {
-	int32 c = 0;
-
 	if( name[0] == ':' && name[1] == ':' )
-		ev_db->foreach(ev_db,npc_event_doall_sub,&c,name,0,rid);
-	else
-		ev_db->foreach(ev_db,npc_event_do_sub,&c,name,rid);
+		return npc_event_run_index( name, 0, false );
 
-	return c;
+	return npc_event_run_index( name, rid, false );
 }
 
 // runs the specified event (supports both single-npc and global events)
@@ -1352,11 +1440,9 @@ void npc_event_runall( const char* eventname ){
 // runs the specified event, with a RID attached (global only)
 int32 npc_event_doall_id(const char* name, int32 rid)
 {
-	int32 c = 0;
 	char buf[EVENT_NAME_LENGTH];
 	safesnprintf(buf, sizeof(buf), "::%s", name);
-	ev_db->foreach(ev_db,npc_event_doall_sub,&c,buf,rid);
-	return c;
+	return npc_event_run_index(buf, rid, rid != 0);
 }
 
 // runs the specified event on all NPCs with the given path
@@ -3477,6 +3563,7 @@ static int32 npc_unload_ev(DBKey key, DBData *data, va_list ap)
 	char* npcname = va_arg(ap, char *);
 
 	if(strcmp(ev->nd->exname,npcname)==0){
+		npc_event_index_remove(key.str);
 		db_remove(ev_db, key);
 		return 1;
 	}
@@ -3625,6 +3712,207 @@ int32 npc_unload(npc_data* nd, bool single) {
 // NPC Source Files
 //
 
+/**
+ * Read a npc source file and take its fingerprint.
+ * Safe to call from worker threads.
+ * @param source : source with the path to read, error and state are filled
+ */
+static void npc_readsrcfile( s_npc_source& source ){
+	struct stat st;
+
+	source.error = NPC_SOURCE_OK;
+	source.error_code = 0;
+
+	if( stat( source.path.c_str(), &st ) != 0 || ( st.st_mode & S_IFMT ) != S_IFREG ){
+		source.error = NPC_SOURCE_NOT_FILE;
+		return;
+	}
+
+	FILE* fp = fopen( source.path.c_str(), "rb" );
+
+	if( fp == nullptr ){
+		source.error = NPC_SOURCE_NOT_FOUND;
+		return;
+	}
+
+	fseek( fp, 0, SEEK_END );
+	long size = ftell( fp );
+
+	if( size < 0 ){
+		source.error = NPC_SOURCE_READ_FAILED;
+		source.error_code = errno;
+		fclose( fp );
+		return;
+	}
+
+	source.buffer.resize( size );
+	fseek( fp, 0, SEEK_SET );
+	source.buffer.resize( fread( &source.buffer[0], 1, source.buffer.size(), fp ) );
+
+	if( ferror( fp ) ){
+		source.error = NPC_SOURCE_READ_FAILED;
+		source.error_code = errno;
+		source.buffer.clear();
+		fclose( fp );
+		return;
+	}
+
+	fclose( fp );
+
+	if( source.buffer.size() >= 3 && (unsigned char)source.buffer[0] == 0xEF && (unsigned char)source.buffer[1] == 0xBB && (unsigned char)source.buffer[2] == 0xBF ){
+		source.error = NPC_SOURCE_BOM;
+	}
+
+	// FNV-1a
+	uint64 hash = 14695981039346656037ULL;
+
+	for( char c : source.buffer ){
+		hash = ( hash ^ static_cast<uint8>( c ) ) * 1099511628211ULL;
+	}
+
+	source.state.mtime = st.st_mtime;
+	source.state.size = source.buffer.size();
+	source.state.hash = hash;
+}
+
+/**
+ * Skips spaces and comments like skip_space, without reporting anything.
+ * @return nullptr on an unterminated block comment
+ */
+static const char* npc_split_space( const char* p ){
+	for( ;; ){
+		while( ISSPACE( *p ) ){
+			++p;
+		}
+
+		if( *p == '/' && p[1] == '/' ){
+			while( *p && *p != '\n' ){
+				++p;
+			}
+		}else if( *p == '/' && p[1] == '*' ){
+			p = strstr( p + 2, "*/" );
+
+			if( p == nullptr ){
+				return nullptr;
+			}
+
+			p += 2;
+		}else{
+			return p;
+		}
+	}
+}
+
+/**
+ * Skips a script block like npc_skip_script, without reporting anything.
+ * @return position after the last '}', nullptr on an error
+ */
+static const char* npc_split_script( const char* p ){
+	p = strchr( p, '{' );
+
+	if( p == nullptr ){
+		return nullptr;
+	}
+
+	for( int32 curly_count = 1; curly_count > 0; ){
+		p = npc_split_space( p + 1 );
+
+		if( p == nullptr || *p == '\0' ){
+			return nullptr;
+		}else if( *p == '}' ){
+			--curly_count;
+		}else if( *p == '{' ){
+			++curly_count;
+		}else if( *p == '"' ){
+			for( ++p; *p != '"'; ++p ){
+				if( *p == '\\' && (unsigned char)p[-1] <= 0x7e ){
+					++p;
+				}else if( *p == '\0' || *p == '\n' ){
+					return nullptr;
+				}
+			}
+		}
+	}
+
+	return p + 1;
+}
+
+/**
+ * Split the lines of a read npc source file into their fields and skip the script blocks.
+ * Safe to call from worker threads, errors are left to npc_parsesource, which splits
+ * the rest of the file itself once a parser does not end where the next line was expected.
+ * @param source : source read by npc_readsrcfile
+ */
+static void npc_splitsrcfile( s_npc_source& source ){
+	if( source.error != NPC_SOURCE_OK ){
+		return;
+	}
+
+	const char* buffer = source.buffer.c_str();
+	size_t len = source.buffer.size();
+
+	for( const char* p = npc_split_space( buffer ); p != nullptr && *p; p = npc_split_space( p ) ){
+		s_npc_source_line line;
+		bool error;
+
+		line.offset = p - buffer;
+		line.count = sv_parse( p, len + buffer - p, 0, '\t', line.pos, ARRAYLENGTH( line.pos ), SV_TERMINATE_LF|SV_TERMINATE_CRLF, error );
+
+		if( error || line.count < 3 ){
+			return;
+		}
+
+		source.lines.push_back( line );
+
+		// Same condition as npc_parsesource, the script block ends the entry
+		if( line.count > 3 && line.pos[5] - line.pos[4] >= 6 && strncasecmp( p + line.pos[4], "script", 6 ) == 0 ){
+			p = npc_split_script( p );
+		}else{
+			p = strchr( p, '\n' );
+		}
+
+		if( p == nullptr ){
+			return;
+		}
+	}
+}
+
+/**
+ * Read and split npc source files on up to NPC_LOAD_THREADS threads.
+ * Without worker threads the files are only read and npc_parsesource splits them.
+ * @param sources : sources to read
+ * @return amount of threads used
+ */
+static size_t npc_readsrcfiles( std::vector<s_npc_source>& sources ){
+	size_t count = std::min<size_t>( { sources.size(), std::max<size_t>( std::thread::hardware_concurrency(), 1 ), NPC_LOAD_THREADS } );
+
+	if( count <= 1 ){
+		for( s_npc_source& source : sources ){
+			npc_readsrcfile( source );
+		}
+
+		return 1;
+	}
+
+	std::atomic<size_t> next( 0 );
+	std::vector<std::thread> threads;
+
+	for( size_t i = 0; i < count; i++ ){
+		threads.emplace_back( [&sources, &next](){
+			for( size_t j = next++; j < sources.size(); j = next++ ){
+				npc_readsrcfile( sources[j] );
+				npc_splitsrcfile( sources[j] );
+			}
+		} );
+	}
+
+	for( std::thread& thread : threads ){
+		thread.join();
+	}
+
+	return count;
+}
+
 /**
  * Adds a npc source file (or removes all)
  * @param name : file to add
@@ -3671,15 +3959,43 @@ void npc_delsrcfile(const char* name)
 
 /**
  * Load all npc files
+ * The files are read and split into lines in parallel, then compiled and registered in the order of npc_src_files.
  */
 void npc_loadsrcfiles() {
 	ShowStatus("Loading NPCs...\n");
-	for (const auto& file : npc_src_files) {
+
+	std::vector<s_npc_source> sources( npc_src_files.size() );
+
+	for( size_t i = 0; i < npc_src_files.size(); i++ ){
+		sources[i].path = npc_src_files[i];
+	}
+
+	uint64 start = profiler_clock();
+	size_t threads = npc_readsrcfiles( sources );
+	uint64 read_time = profiler_clock() - start;
+
+	for (auto& source : sources) {
 #ifdef DETAILED_LOADING_OUTPUT
-		ShowStatus("Loading NPC file: %s" CL_CLL "\r", file.c_str());
+		ShowStatus("Loading NPC file: %s" CL_CLL "\r", source.path.c_str());
 #endif
-		npc_parsesrcfile(file.c_str());
+		npc_parsesource(source);
+	}
+
+	uint64 parse_time = profiler_clock() - start - read_time;
+
+	// Report the files that took the longest to parse
+	size_t slowest = std::min<size_t>( sources.size(), 3 );
+
+	std::partial_sort( sources.begin(), sources.begin() + slowest, sources.end(), []( const s_npc_source& a, const s_npc_source& b ){
+		return a.parse_time > b.parse_time;
+	} );
+
+	ShowInfo( "Read and split '" CL_WHITE "%" PRIuPTR CL_RESET "' NPC files in %.1f ms on %" PRIuPTR " threads, parsed them in %.1f ms.\n", sources.size(), read_time / 1000.0, threads, parse_time / 1000.0 );
+
+	for( size_t i = 0; i < slowest; i++ ){
+		ShowInfo( "\t-'" CL_WHITE "%s" CL_RESET "' %.1f ms\n", sources[i].path.c_str(), sources[i].parse_time / 1000.0 );
 	}
+
 	int32 npc_total = npc_warp + npc_shop + npc_script;
 
 	ShowInfo ("Done loading '" CL_WHITE "%d" CL_RESET "' NPCs:" CL_CLL "\n"
@@ -5667,59 +5983,63 @@ static const char* npc_parse_mapflag(char* w1, char* w2, char* w3, char* w4, con
 }
 
 /**
- * Read file and create npc/func/mapflag/monster... accordingly.
- * @param filepath : Relative path of file from map-serv bin
- * @param runOnInit :  should we exec OnInit when it's done ?
+ * Create npc/func/mapflag/monster... from a source file that was read already.
+ * The buffer of the source is released afterwards.
+ * @param source : source read by npc_readsrcfile
  * @return 0:error, 1:success
  */
-int32 npc_parsesrcfile(const char* filepath)
-{
-	if (check_filepath(filepath) != 2) { //this is not a file 
-		ShowDebug("npc_parsesrcfile: Path doesn't seem to be a file skipping it : '%s'.\n", filepath);
-		return 0;
-	} 
-            
-	// read whole file to buffer
-	FILE* fp = fopen(filepath, "rb");
-	if (fp == nullptr) {
-		ShowError("npc_parsesrcfile: File not found '%s'.\n", filepath);
-		return 0;
-	}
-	fseek(fp, 0, SEEK_END);
-	size_t len = ftell(fp);
-	char* buffer = (char*)aMalloc(len+1);
-	fseek(fp, 0, SEEK_SET);
-	len = fread(buffer, 1, len, fp);
-	buffer[len] = '\0';
-	if (ferror(fp)) {
-		ShowError("npc_parsesrcfile: Failed to read file '%s' - %s\n", filepath, strerror(errno));
-		aFree(buffer);
-		fclose(fp);
-		return 0;
-	}
-	fclose(fp);
+static int32 npc_parsesource( s_npc_source& source ){
+	const char* filepath = source.path.c_str();
 
-	if ((unsigned char)buffer[0] == 0xEF && (unsigned char)buffer[1] == 0xBB && (unsigned char)buffer[2] == 0xBF) {
-		// UTF-8 BOM. This is most likely an error on the user's part, because:
-		// - BOM is discouraged in UTF-8, and the only place where you see it is Notepad and such.
-		// - It's unlikely that the user wants to use UTF-8 data here, since we don't really support it, nor does the client by default.
-		// - If the user really wants to use UTF-8 (instead of latin1, EUC-KR, SJIS, etc), then they can still do it <without BOM>.
-		// More info at http://unicode.org/faq/utf_bom.html#bom5 and http://en.wikipedia.org/wiki/Byte_order_mark#UTF-8
-		ShowError("npc_parsesrcfile: Detected unsupported UTF-8 BOM in file '%s'. Stopping (please consider using another character set).\n", filepath);
-		aFree(buffer);
-		return 0;
+	switch( source.error ){
+		case NPC_SOURCE_NOT_FILE: //this is not a file 
+			ShowDebug("npc_parsesrcfile: Path doesn't seem to be a file skipping it : '%s'.\n", filepath);
+			return 0;
+		case NPC_SOURCE_NOT_FOUND:
+			ShowError("npc_parsesrcfile: File not found '%s'.\n", filepath);
+			return 0;
+		case NPC_SOURCE_READ_FAILED:
+			ShowError("npc_parsesrcfile: Failed to read file '%s' - %s\n", filepath, strerror(source.error_code));
+			return 0;
+		case NPC_SOURCE_BOM:
+			// UTF-8 BOM. This is most likely an error on the user's part, because:
+			// - BOM is discouraged in UTF-8, and the only place where you see it is Notepad and such.
+			// - It's unlikely that the user wants to use UTF-8 data here, since we don't really support it, nor does the client by default.
+			// - If the user really wants to use UTF-8 (instead of latin1, EUC-KR, SJIS, etc), then they can still do it <without BOM>.
+			// More info at http://unicode.org/faq/utf_bom.html#bom5 and http://en.wikipedia.org/wiki/Byte_order_mark#UTF-8
+			ShowError("npc_parsesrcfile: Detected unsupported UTF-8 BOM in file '%s'. Stopping (please consider using another character set).\n", filepath);
+			return 0;
+		default:
+			break;
 	}
 
+	uint64 start = profiler_clock();
+	const char* buffer = source.buffer.c_str();
+	size_t len = source.buffer.size();
+
 	int32 lines = 0;
+	size_t next_line = 0;
 
 	// parse buffer
 	for ( const char* p = skip_space(buffer); p && *p ; p = skip_space(p) ) {
 		size_t pos[9];
+		size_t count;
+		bool error = false;
 		lines++;
 
-		// w1<TAB>w2<TAB>w3<TAB>w4
-		bool error;
-		size_t count = sv_parse( p, len + buffer - p, 0, '\t', pos, ARRAYLENGTH( pos ), SV_TERMINATE_LF|SV_TERMINATE_CRLF, error );
+		// Take the split of the workers, as long as the parsers end where the workers expected them to
+		while( next_line < source.lines.size() && source.lines[next_line].offset < static_cast<size_t>( p - buffer ) )
+			next_line++;
+
+		if( next_line < source.lines.size() && source.lines[next_line].offset == static_cast<size_t>( p - buffer ) ){
+			const s_npc_source_line& line = source.lines[next_line++];
+
+			memcpy( pos, line.pos, sizeof( pos ) );
+			count = line.count;
+		}else{
+			// w1<TAB>w2<TAB>w3<TAB>w4
+			count = sv_parse( p, len + buffer - p, 0, '\t', pos, ARRAYLENGTH( pos ), SV_TERMINATE_LF|SV_TERMINATE_CRLF, error );
+		}
 
 		if( error ){
 			ShowError("npc_parsesrcfile: Parse error in file '%s', line '%d'. Stopping...\n", filepath, strline(buffer,p-buffer));
@@ -5845,11 +6165,31 @@ int32 npc_parsesrcfile(const char* filepath)
 			p = strchr(p,'\n');// skip and continue
 		}
 	}
-	aFree(buffer);
+
+	npc_src_states[source.path] = source.state;
+	source.parse_time = profiler_clock() - start;
+	std::string().swap( source.buffer );
+	std::vector<s_npc_source_line>().swap( source.lines );
 
 	return 1;
 }
 
+/**
+ * Read file and create npc/func/mapflag/monster... accordingly.
+ * @param filepath : Relative path of file from map-serv bin
+ * @param runOnInit :  should we exec OnInit when it's done ?
+ * @return 0:error, 1:success
+ */
+int32 npc_parsesrcfile(const char* filepath)
+{
+	s_npc_source source = {};
+
+	source.path = filepath;
+	npc_readsrcfile( source );
+
+	return npc_parsesource( source );
+}
+
 size_t npc_script_event( map_session_data& sd, enum npce_event type ){
 	if (type == NPCE_MAX)
 		return 0;
@@ -5857,7 +6197,7 @@ size_t npc_script_event( map_session_data& sd, enum npce_event type ){
 	std::vector<struct script_event_s>& vector = script_event[type];
 
 	for( struct script_event_s& evt : vector ){
-		npc_event_sub( &sd, evt.event, evt.event_name );
+		npc_event_sub( &sd, evt.event, evt.event_name.c_str() );
 	}
 
 	return vector.size();
@@ -6040,29 +6380,20 @@ void npc_read_event_script(void)
 
 	for (i = 0; i < NPCE_MAX; i++)
 	{
-		DBIterator* iter;
-		DBKey key;
-		DBData *data;
 		char name[EVENT_NAME_LENGTH];
 
 		safesnprintf(name,EVENT_NAME_LENGTH,"::%s", npc_get_script_event_name(i));
 
-		iter = db_iterator(ev_db);
-		for( data = iter->first(iter,&key); iter->exists(iter); data = iter->next(iter,&key) )
-		{
-			const char* p = key.str;
-			struct event_data* ed = (struct event_data*)db_data2ptr(data);
-
-			if( (p=strchr(p,':')) && strcmpi(name,p)==0 ){
-				struct script_event_s evt;
+		for( const std::string& event_name : npc_event_index_find( name ) ){
+			struct script_event_s evt;
 
-				evt.event = ed;
-				evt.event_name = key.str;
+			evt.event = (struct event_data*)strdb_get(ev_db, event_name.c_str());
+			if( evt.event == nullptr )
+				continue;
+			evt.event_name = event_name;
 
-				script_event[static_cast<enum npce_event>(i)].push_back(evt);
-			}
+			script_event[static_cast<enum npce_event>(i)].push_back(evt);
 		}
-		dbi_destroy(iter);
 	}
 
 	if (battle_config.etc_log) {
@@ -6100,6 +6431,7 @@ int32 npc_reload(void) {
 
 	db_clear(npcname_db);
 	db_clear(ev_db);
+	npc_event_index.clear();
 
 	//Remove all npcs/mobs. [Skotlex]
 
@@ -6153,6 +6485,7 @@ int32 npc_reload(void) {
 	// reset mapflags
 	map_flags_init();
 
+	npc_src_states.clear();
 	npc_loadsrcfiles();
 
 	stylist_db.reload();
@@ -6183,8 +6516,12 @@ int32 npc_reload(void) {
 	return 0;
 }
 
-//Unload all npc in the given file
-bool npc_unloadfile( const char* path ) {
+/**
+ * Unload all npcs and monster spawns of a file, without removing it from the source files
+ * @param path : path of the file
+ * @return true if anything was unloaded
+ */
+static bool npc_unloadpath( const char* path ) {
 	DBIterator * iter = db_iterator(npcname_db);
 	npc_data* nd = nullptr;
 	bool found = false;
@@ -6203,6 +6540,15 @@ bool npc_unloadfile( const char* path ) {
 		found = true;
 	}
 
+	npc_src_states.erase( path );
+
+	return found;
+}
+
+//Unload all npc in the given file
+bool npc_unloadfile( const char* path ) {
+	bool found = npc_unloadpath( path );
+
 	if( found ) /* refresh event cache */
 		npc_read_event_script();
 
@@ -6211,6 +6557,130 @@ bool npc_unloadfile( const char* path ) {
 	return found;
 }
 
+/**
+ * Reload the npc source files that changed since they were parsed.
+ * A file changed if its size or modification time differ and its content hash does too.
+ * Files duplicating npcs of a changed file are reloaded as well, since unloading the
+ * originals removes the duplicates. Files no longer listed in npc_src_files are unloaded.
+ * Mapflags of the reloaded files are kept.
+ * @return amount of reloaded and unloaded files
+ */
+int32 npc_reload_changed( void ){
+	uint64 start = profiler_clock();
+	std::unordered_set<std::string> listed( npc_src_files.begin(), npc_src_files.end() );
+	std::vector<std::string> removed;
+
+	for( const auto& pair : npc_src_states ){
+		if( listed.find( pair.first ) == listed.end() ){
+			removed.push_back( pair.first );
+		}
+	}
+
+	for( const std::string& path : removed ){
+		npc_unloadpath( path.c_str() );
+		ShowStatus( "NPC file '" CL_WHITE "%s" CL_RESET "' is no longer listed and was unloaded.\n", path.c_str() );
+	}
+
+	// Only read files whose size or modification time changed
+	std::vector<s_npc_source> candidates;
+
+	for( const std::string& path : npc_src_files ){
+		auto it = npc_src_states.find( path );
+		struct stat st;
+
+		if( it != npc_src_states.end() && stat( path.c_str(), &st ) == 0 && st.st_mtime == it->second.mtime && static_cast<uint64>( st.st_size ) == it->second.size ){
+			continue;
+		}
+
+		candidates.emplace_back();
+		candidates.back().path = path;
+	}
+
+	npc_readsrcfiles( candidates );
+
+	std::unordered_map<std::string, s_npc_source> changed;
+
+	for( s_npc_source& source : candidates ){
+		auto it = npc_src_states.find( source.path );
+
+		// Only touched
+		if( source.error == NPC_SOURCE_OK && it != npc_src_states.end() && it->second.size == source.state.size && it->second.hash == source.state.hash ){
+			it->second.mtime = source.state.mtime;
+			continue;
+		}
+
+		changed[source.path] = std::move( source );
+	}
+
+	// Add the files that duplicate npcs of changed files
+	for( bool added = !changed.empty(); added; ){
+		added = false;
+
+		s_mapiterator* iter = mapit_geteachnpc();
+
+		for( npc_data* nd = (npc_data*)mapit_first( iter ); mapit_exists( iter ); nd = (npc_data*)mapit_next( iter ) ){
+			if( nd->src_id == 0 || nd->path == nullptr || changed.find( nd->path ) != changed.end() || listed.find( nd->path ) == listed.end() ){
+				continue;
+			}
+
+			npc_data* src = map_id2nd( nd->src_id );
+
+			if( src != nullptr && src->path != nullptr && changed.find( src->path ) != changed.end() ){
+				s_npc_source& source = changed[nd->path];
+
+				source.path = nd->path;
+				npc_readsrcfile( source );
+				added = true;
+			}
+		}
+
+		mapit_free( iter );
+	}
+
+	if( changed.empty() ){
+		// The event cache still points to the npcs of the unloaded files
+		if( !removed.empty() ){
+			npc_read_event_script();
+		}else{
+			ShowStatus( "No NPC file changed.\n" );
+		}
+
+		return static_cast<int32>( removed.size() );
+	}
+
+	for( const auto& pair : changed ){
+		npc_unloadpath( pair.first.c_str() );
+	}
+
+	// Parse in the original order, files may depend on functions and npcs of earlier files
+	int32 count = static_cast<int32>( removed.size() );
+
+	for( const std::string& path : npc_src_files ){
+		auto it = changed.find( path );
+
+		if( it == changed.end() ){
+			continue;
+		}
+
+		if( npc_parsesource( it->second ) ){
+			ShowStatus( "NPC file '" CL_WHITE "%s" CL_RESET "' was reloaded in %.1f ms.\n", path.c_str(), it->second.parse_time / 1000.0 );
+			count++;
+		}
+	}
+
+	npc_read_event_script();
+
+	for( const std::string& path : npc_src_files ){
+		if( changed.find( path ) != changed.end() ){
+			npc_event_doall_path( script_config.init_event_name, path.c_str() );
+		}
+	}
+
+	ShowInfo( "Reloaded '" CL_WHITE "%d" CL_RESET "' and unloaded '" CL_WHITE "%" PRIuPTR CL_RESET "' of '" CL_WHITE "%" PRIuPTR CL_RESET "' NPC files in %.1f ms.\n", count - static_cast<int32>( removed.size() ), removed.size(), npc_src_files.size(), ( profiler_clock() - start ) / 1000.0 );
+
+	return count;
+}
+
 bool npc_remove_mob_spawns(const char* path) {
 	int32 spawn_count = {};
 	int32 unit_count = {};
@@ -6289,6 +6759,7 @@ bool npc_remove_mob_spawns(const char* path) {
 void do_clear_npc(void) {
 	db_clear(npcname_db);
 	db_clear(ev_db);
+	npc_event_index.clear();
 }
 
 /*==========================================
@@ -6298,6 +6769,7 @@ void do_final_npc(void) {
 	npc_clear_pathlist();
 	script_event.clear();
 	ev_db->destroy(ev_db, nullptr);
+	npc_event_index.clear();
 	npcname_db->destroy(npcname_db, nullptr);
 	npc_path_db->destroy(npc_path_db, nullptr);
 #if PACKETVER >= 20131223
@@ -6308,6 +6780,7 @@ void do_final_npc(void) {
 	ers_destroy(timer_event_ers);
 	ers_destroy(npc_sc_display_ers);
 	npc_src_files.clear();
+	npc_src_states.clear();
 }
 
 static void npc_debug_warps_sub(npc_data* nd)
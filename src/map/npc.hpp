@@ -2947,6 +2947,7 @@ enum e_job_types
 
 #ifdef PCRE_SUPPORT
 void npc_chat_finalize(npc_data* nd);
+const char* npc_chat_match(npc_data* nd, const char* msg, int32 len, bool prefilter);
 #endif
 
 //Script NPC events.
@@ -3028,6 +3029,7 @@ int32 npc_remove_map(npc_data* nd);
 void npc_unload_duplicates (npc_data* nd);
 int32 npc_unload(npc_data* nd, bool single);
 int32 npc_reload(void);
+int32 npc_reload_changed(void);
 void npc_read_event_script(void);
 size_t npc_script_event( map_session_data& sd, enum npce_event type );
 
@@ -5,6 +5,8 @@
 
 #include "npc.hpp"
 
+#include <string>
+
 #include <pcre.h>
 
 #include <common/malloc.hpp>
@@ -91,6 +93,11 @@ struct pcrematch_set {
 struct npc_parse {
 	struct pcrematch_set* active;
 	struct pcrematch_set* inactive;
+	// All active patterns combined into one alternation, a message that does
+	// not match it cannot match any single pattern either
+	pcre* prefilter;
+	pcre_extra* prefilter_extra;
+	bool dirty; // active patterns changed, prefilter has to be rebuilt
 };
 
 
@@ -102,11 +109,85 @@ struct npc_parse {
 void finalize_pcrematch_entry(struct pcrematch_entry* e)
 {
 	pcre_free(e->pcre_);
-	pcre_free(e->pcre_extra_);
+	if (e->pcre_extra_ != nullptr)
+		pcre_free_study(e->pcre_extra_);
 	aFree(e->pattern);
 	aFree(e->label);
 }
 
+/**
+ * Release the combined pattern of a NPC and mark it for rebuilding
+ */
+static void invalidate_prefilter(struct npc_parse* npcParse)
+{
+	if (npcParse->prefilter != nullptr)
+		pcre_free(npcParse->prefilter);
+	if (npcParse->prefilter_extra != nullptr)
+		pcre_free_study(npcParse->prefilter_extra);
+	npcParse->prefilter = nullptr;
+	npcParse->prefilter_extra = nullptr;
+	npcParse->dirty = true;
+}
+
+/**
+ * Check if a pattern keeps its meaning when it is embedded into a larger one.
+ * Back references, named groups and subroutine calls depend on the group numbering.
+ */
+static bool pcrematch_entry_combinable(struct pcrematch_entry* e)
+{
+	int32 backrefmax = 0, namecount = 0;
+
+	if (e->pcre_ == nullptr)
+		return false;
+
+	pcre_fullinfo(e->pcre_, e->pcre_extra_, PCRE_INFO_BACKREFMAX, &backrefmax);
+	pcre_fullinfo(e->pcre_, e->pcre_extra_, PCRE_INFO_NAMECOUNT, &namecount);
+
+	if (backrefmax > 0 || namecount > 0)
+		return false;
+
+	for (const char* p = strstr(e->pattern, "(?"); p != nullptr; p = strstr(p + 2, "(?")) {
+		if (ISDIGIT(p[2]) || strchr("+-R&P", p[2]) != nullptr)
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * Combine all active patterns of a NPC into a single alternation.
+ * If any pattern cannot be combined, no prefilter is used and every pattern is tried on its own.
+ */
+static void build_prefilter(struct npc_parse* npcParse)
+{
+	std::string combined;
+	const char *err;
+	int32 erroff;
+
+	npcParse->dirty = false;
+
+	for (struct pcrematch_set* pcreset = npcParse->active; pcreset != nullptr; pcreset = pcreset->next) {
+		for (struct pcrematch_entry* e = pcreset->head; e != nullptr; e = e->next) {
+			if (!pcrematch_entry_combinable(e))
+				return;
+
+			if (!combined.empty())
+				combined += '|';
+			combined += "(?:";
+			combined += e->pattern;
+			combined += ')';
+		}
+	}
+
+	if (combined.empty())
+		return;
+
+	// Captures are only needed from the pattern that actually matches
+	npcParse->prefilter = pcre_compile(combined.c_str(), PCRE_CASELESS|PCRE_NO_AUTO_CAPTURE, &err, &erroff, nullptr);
+	if (npcParse->prefilter != nullptr)
+		npcParse->prefilter_extra = pcre_study(npcParse->prefilter, PCRE_STUDY_JIT_COMPILE, &err);
+}
+
 /**
  * Lookup (and possibly create) a new set of patterns by the set id
  */
@@ -177,6 +258,7 @@ static void activate_pcreset(npc_data* nd, int64 setid)
 	if (pcreset->next != nullptr)
 		pcreset->next->prev = pcreset;
 	npcParse->active = pcreset;
+	invalidate_prefilter(npcParse);
 }
 
 /**
@@ -215,6 +297,7 @@ static void deactivate_pcreset(npc_data* nd, int64 setid)
 	if (pcreset->next != nullptr)
 		pcreset->next->prev = pcreset;
 	npcParse->inactive = pcreset;
+	invalidate_prefilter(npcParse);
 }
 
 /**
@@ -254,6 +337,9 @@ static void delete_pcreset(npc_data* nd, int64 setid)
 		npcParse->active = pcreset->next;
 	else
 		npcParse->inactive = pcreset->next;
+
+	if (active)
+		invalidate_prefilter(npcParse);
 	
 	pcreset->prev = nullptr;
 	pcreset->next = nullptr;
@@ -310,7 +396,10 @@ void npc_chat_def_pattern(npc_data* nd, int64 setid, const char* pattern, const
 	e->pattern = aStrdup(pattern);
 	e->label = aStrdup(label);
 	e->pcre_ = pcre_compile(pattern, PCRE_CASELESS, &err, &erroff, nullptr);
-	e->pcre_extra_ = pcre_study(e->pcre_, 0, &err);
+	e->pcre_extra_ = pcre_study(e->pcre_, PCRE_STUDY_JIT_COMPILE, &err);
+
+	// The pattern might have been added to an active set
+	invalidate_prefilter((struct npc_parse *) nd->chatdb);
 }
 
 /**
@@ -330,11 +419,62 @@ void npc_chat_finalize(npc_data* nd)
 	
 	while(npcParse->inactive)
 		delete_pcreset(nd, npcParse->inactive->setid);
-	
+
+	invalidate_prefilter(npcParse);
+
 	// Additional cleaning up [Lance]
 	aFree(npcParse);
 }
 
+/**
+ * Find the first active pattern of a NPC that matches a message
+ * @param prefilter: reject the message with the combined pattern first
+ * @param offsets: capture offsets of the match, 1/3 reserved for temp space requred by pcre_exec
+ * @param matches: amount of captured strings
+ * @return matching pattern or nullptr
+ */
+static struct pcrematch_entry* npc_chat_find(struct npc_parse* npcParse, const char* msg, int32 len, bool prefilter, int32* offsets, int32 size, int32* matches)
+{
+	if (npcParse == nullptr || npcParse->active == nullptr)
+		return nullptr;
+
+	if (npcParse->dirty)
+		build_prefilter(npcParse);
+
+	// scan the message once against all patterns before trying them one by one
+	if (prefilter && npcParse->prefilter != nullptr && pcre_exec(npcParse->prefilter, npcParse->prefilter_extra, msg, len, 0, 0, nullptr, 0) < 0)
+		return nullptr;
+
+	// iterate across all active sets
+	for (struct pcrematch_set* pcreset = npcParse->active; pcreset != nullptr; pcreset = pcreset->next)
+	{
+		// interate across all patterns in that set
+		for (struct pcrematch_entry* e = pcreset->head; e != nullptr; e = e->next)
+		{
+			// perform pattern match
+			*matches = pcre_exec(e->pcre_, e->pcre_extra_, msg, len, 0, 0, offsets, size);
+			if (*matches > 0)
+				return e;
+		}
+	}
+
+	return nullptr;
+}
+
+/**
+ * Label a message would run on a NPC, without running it
+ * @param prefilter: false to try every pattern on its own, for comparing against the prefilter
+ * @return label of the first matching pattern or nullptr
+ */
+const char* npc_chat_match(npc_data* nd, const char* msg, int32 len, bool prefilter)
+{
+	int32 offsets[2*10 + 10];
+	int32 matches;
+	struct pcrematch_entry* e = npc_chat_find((struct npc_parse *) nd->chatdb, msg, len, prefilter, offsets, ARRAYLENGTH(offsets), &matches);
+
+	return e != nullptr ? e->label : nullptr;
+}
+
 /**
  * Handler called whenever a global message is spoken in a NPC's area
  */
@@ -343,11 +483,11 @@ int32 npc_chat_sub(block_list* bl, va_list ap)
 	npc_data* nd = (npc_data *) bl;
 	struct npc_parse* npcParse = (struct npc_parse *) nd->chatdb;
 	char* msg;
-	int32 len, i;
+	int32 len, i, r;
 	map_session_data* sd;
 	struct npc_label_list* lst;
-	struct pcrematch_set* pcreset;
 	struct pcrematch_entry* e;
+	int32 offsets[2*10 + 10]; // 1/3 reserved for temp space requred by pcre_exec
 	
 	// Not interested in anything you might have to say...
 	if (npcParse == nullptr || npcParse->active == nullptr)
@@ -356,43 +496,30 @@ int32 npc_chat_sub(block_list* bl, va_list ap)
 	msg = va_arg(ap,char*);
 	len = va_arg(ap,int32);
 	sd = va_arg(ap,map_session_data *);
-	
-	// iterate across all active sets
-	for (pcreset = npcParse->active; pcreset != nullptr; pcreset = pcreset->next)
+
+	e = npc_chat_find(npcParse, msg, len, true, offsets, ARRAYLENGTH(offsets), &r);
+	if (e == nullptr)
+		return 0;
+
+	// save out the matched strings
+	for (i = 0; i < r; i++)
 	{
-		// interate across all patterns in that set
-		for (e = pcreset->head; e != nullptr; e = e->next)
-		{
-			int32 offsets[2*10 + 10]; // 1/3 reserved for temp space requred by pcre_exec
-			
-			// perform pattern match
-			int32 r = pcre_exec(e->pcre_, e->pcre_extra_, msg, len, 0, 0, offsets, ARRAYLENGTH(offsets));
-			if (r > 0)
-			{
-				// save out the matched strings
-				for (i = 0; i < r; i++)
-				{
-					char var[255], val[255];
-					snprintf(var, sizeof(var), "$@p%i$", i);
-					pcre_copy_substring(msg, offsets, r, i, val, sizeof(val));
-					set_var_str( sd, var, val );
-				}
-				
-				// find the target label.. this sucks..
-				lst = nd->u.scr.label_list;
-				ARR_FIND(0, nd->u.scr.label_list_num, i, strncmp(lst[i].name, e->label, sizeof(lst[i].name)) == 0);
-				if (i == nd->u.scr.label_list_num) {
-					ShowWarning("Unable to find label: %s\n", e->label);
-					return 0;
-				}
-				
-				// run the npc script
-				run_script(nd->u.scr.script,lst[i].pos,sd->id,nd->id);
-				return 0;
-			}
-		}
+		char var[255], val[255];
+		snprintf(var, sizeof(var), "$@p%i$", i);
+		pcre_copy_substring(msg, offsets, r, i, val, sizeof(val));
+		set_var_str( sd, var, val );
 	}
-	
+
+	// find the target label.. this sucks..
+	lst = nd->u.scr.label_list;
+	ARR_FIND(0, nd->u.scr.label_list_num, i, strncmp(lst[i].name, e->label, sizeof(lst[i].name)) == 0);
+	if (i == nd->u.scr.label_list_num) {
+		ShowWarning("Unable to find label: %s\n", e->label);
+		return 0;
+	}
+
+	// run the npc script
+	run_script(nd->u.scr.script,lst[i].pos,sd->id,nd->id);
 	return 0;
 }
 
@@ -22,7 +22,10 @@
 #endif
 #define MAX_ACHIEVEMENT_DB MAX_ACHIEVEMENT_OBJECTIVES
 
-#define DEFINE_PACKET_HEADER(name, id) const int16 HEADER_##name = id;
+// Tools may hook the definition to inspect the packet layouts
+#ifndef DEFINE_PACKET_HEADER
+	#define DEFINE_PACKET_HEADER(name, id) const int16 HEADER_##name = id;
+#endif
 #define DEFINE_PACKET_ID(name, id) DEFINE_PACKET_HEADER(name, id)
 
 #include "packets_struct.hpp"
@@ -856,6 +859,16 @@ struct PACKET_ZC_NOTIFY_POSITION_TO_GUILDM {
 } __attribute__((packed));
 DEFINE_PACKET_HEADER(ZC_NOTIFY_POSITION_TO_GUILDM, 0x1eb)
 
+struct PACKET_ZC_BATTLEFIELD_NOTIFY_POSITION {
+	int16 packetType;
+	uint32 aid;
+	char name[NAME_LENGTH];
+	uint16 job;
+	int16 xPos;
+	int16 yPos;
+} __attribute__((packed));
+DEFINE_PACKET_HEADER(ZC_BATTLEFIELD_NOTIFY_POSITION, 0x2df)
+
 struct PACKET_ZC_GUILD_CHAT {
 	int16 packetType;
 	int16 packetLength;
@@ -1179,11 +1179,15 @@ int32 party_skill_check(map_session_data *sd, int32 party_id, uint16 skill_id, u
 
 TIMER_FUNC(party_send_xy_timer){
 	struct party_data* p;
+	s_member_update_stats& stats = member_update_stats[MEMBER_UPDATE_PARTY];
 
 	DBIterator *iter = db_iterator(party_db);
 
 	// for each existing party
 	for( p = (struct party_data*)dbi_first(iter); dbi_exists(iter); p = (struct party_data*)dbi_next(iter) ) {
+		map_session_data* moved[MAX_PARTY];
+		map_session_data* hurt[MAX_PARTY];
+		size_t moved_count = 0, hurt_count = 0;
 		int32 i;
 
 		if( !p->party.count ) // no online party members so do not iterate
@@ -1196,17 +1200,26 @@ TIMER_FUNC(party_send_xy_timer){
 			if( !sd )
 				continue;
 
-			if( p->data[i].x != sd->x || p->data[i].y != sd->y ) { // perform position update
-				clif_party_xy( *sd );
+			if( p->data[i].m != sd->m || distance( p->data[i].x - sd->x, p->data[i].y - sd->y ) >= battle_config.party_update_distance ) { // perform position update
+				moved[moved_count++] = sd;
+				p->data[i].m = sd->m;
 				p->data[i].x = sd->x;
 				p->data[i].y = sd->y;
-			}
-
-			if (battle_config.party_hp_mode && p->data[i].hp != sd->battle_status.hp) { // perform hp update
-				clif_party_hp( *sd );
-				p->data[i].hp = sd->battle_status.hp;
+			} else
+				stats.suppressed++;
+
+			if (battle_config.party_hp_mode) {
+				if (p->data[i].hp != sd->battle_status.hp) { // perform hp update
+					hurt[hurt_count++] = sd;
+					p->data[i].hp = sd->battle_status.hp;
+				} else
+					stats.suppressed++;
 			}
 		}
+
+		// Send all updates of the party at once, one write per member
+		if( moved_count > 0 || hurt_count > 0 )
+			clif_party_updates( *p, moved, moved_count, hurt, hurt_count );
 	}
 	dbi_destroy(iter);
 
@@ -1224,6 +1237,7 @@ int32 party_send_xy_clear(struct party_data *p)
 			continue;
 
 		p->data[i].hp = 0;
+		p->data[i].m = -1;
 		p->data[i].x = 0;
 		p->data[i].y = 0;
 	}
@@ -19,6 +19,7 @@ struct item;
 struct party_member_data {
 	map_session_data *sd;
 	uint32 hp; //For HP,x,y refreshing.
+	int16 m;
 	uint16 x, y;
 };
 
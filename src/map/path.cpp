@@ -12,6 +12,7 @@
 #include <common/db.hpp>
 #include <common/malloc.hpp>
 #include <common/nullpo.hpp>
+#include <common/profiler.hpp>
 #include <common/random.hpp>
 #include <common/showmsg.hpp>
 
@@ -268,6 +269,7 @@ static int32 add_path(struct node_heap *heap, struct path_node *tp, int16 x, int
  *------------------------------------------*/
 bool path_search(struct walkpath_data *wpd, int16 m, int16 x0, int16 y0, int16 x1, int16 y1, int32 flag, cell_chk cell)
 {
+	ProfilerScope profile("path_search");
 	int32 i, x, y, dx = 0, dy = 0;
 	struct map_data *mapdata = map_getmapdata(m);
 	struct walkpath_data s_wpd;
@@ -3,6 +3,7 @@
 
 #include "pc.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <map>
@@ -1722,6 +1723,73 @@ void pc_setinventorydata( map_session_data& sd ){
 			sd.inventory_data[i] = nullptr;
 		}
 	}
+
+	pc_inventory_index_rebuild( sd );
+}
+
+/**
+ * Rebuild the item id -> inventory index lookup from scratch
+ * @param sd : player session
+ */
+void pc_inventory_index_rebuild( map_session_data& sd ){
+	sd.inventory_index.clear();
+
+	for( int16 i = 0; i < MAX_INVENTORY; i++ ){
+		sd.inventory_index[sd.inventory.u.items_inventory[i].nameid].push_back( i );
+	}
+}
+
+/**
+ * Move an inventory index to the list of the item id it currently holds
+ * Must be called whenever the nameid of an inventory slot changes
+ * @param sd : player session
+ * @param index : inventory index that changed
+ * @param previous : item id the index held before the change
+ */
+void pc_inventory_index_update( map_session_data& sd, int16 index, t_itemid previous ){
+	t_itemid current = sd.inventory.u.items_inventory[index].nameid;
+
+	if( current == previous ){
+		return;
+	}
+
+	auto it = sd.inventory_index.find( previous );
+
+	if( it != sd.inventory_index.end() ){
+		std::vector<int16>& slots = it->second;
+		auto slot = std::lower_bound( slots.begin(), slots.end(), index );
+
+		if( slot != slots.end() && *slot == index ){
+			slots.erase( slot );
+		}
+
+		if( slots.empty() && previous != 0 ){
+			sd.inventory_index.erase( it );
+		}
+	}
+
+	std::vector<int16>& slots = sd.inventory_index[current];
+
+	slots.insert( std::lower_bound( slots.begin(), slots.end(), index ), index );
+}
+
+/**
+ * Get the inventory indexes holding an item id, in ascending order
+ * Copy the result if the inventory is modified while iterating it
+ * @param sd : player session
+ * @param nameid : item id, 0 for empty slots
+ * @return Inventory indexes, may be empty
+ */
+const std::vector<int16>& pc_inventory_slots( map_session_data& sd, t_itemid nameid ){
+	static const std::vector<int16> empty;
+
+	auto it = sd.inventory_index.find( nameid );
+
+	if( it == sd.inventory_index.end() ){
+		return empty;
+	}
+
+	return it->second;
 }
 
 /**
@@ -2389,6 +2457,7 @@ bool pc_authok(map_session_data *sd, uint32 login_id2, time_t expiration_time, i
 		sd->state.showdelay = 1;
 
 	memset(&sd->inventory, 0, sizeof(struct s_storage));
+	pc_inventory_index_rebuild( *sd );
 	memset(&sd->cart, 0, sizeof(struct s_storage));
 	memset(&sd->storage, 0, sizeof(struct s_storage));
 	memset(&sd->premiumStorage, 0, sizeof(struct s_storage));
@@ -2405,6 +2474,7 @@ bool pc_authok(map_session_data *sd, uint32 login_id2, time_t expiration_time, i
 
 	sd->guild_x = -1;
 	sd->guild_y = -1;
+	sd->guild_m = -1;
 
 	sd->delayed_damage = 0;
 
@@ -2766,6 +2836,7 @@ void pc_reg_received(map_session_data *sd)
 	}
 	//Autocombat
 	sd->ac.duration_ = static_cast<int>(pc_readaccountreg(sd, add_str("#ac_duration")));
+	sd->ac.duration_dirty = false;
 
 	// Rune system
 	clif_onlogenable_rune(sd);
@@ -6198,11 +6269,15 @@ int32 pc_getcash(map_session_data *sd, int32 cash, int32 points, e_log_pick_type
  * @return Stored index in inventory, or -1 if not found.
  **/
 int16 pc_search_inventory(map_session_data *sd, t_itemid nameid) {
-	int16 i;
 	nullpo_retr(-1, sd);
 
-	ARR_FIND( 0, MAX_INVENTORY, i, sd->inventory.u.items_inventory[i].nameid == nameid && (sd->inventory.u.items_inventory[i].amount > 0 || nameid == 0) );
-	return ( i < MAX_INVENTORY ) ? i : -1;
+	for( int16 i : pc_inventory_slots( *sd, nameid ) ){
+		if( sd->inventory.u.items_inventory[i].amount > 0 || nameid == 0 ){
+			return i;
+		}
+	}
+
+	return -1;
 }
 
 /** Attempt to add a new item to player inventory
@@ -6247,28 +6322,28 @@ enum e_additem_result pc_additem(map_session_data *sd,struct item *item,int32 am
 	if (id->flag.guid && !item->unique_id)
 		item->unique_id = pc_generate_unique_id(sd);
 
+	i = MAX_INVENTORY;
+
 	// Stackable | Non Rental
 	if( itemdb_isstackable2(id) && item->expire_time == 0 ) {
-		for( i = 0; i < MAX_INVENTORY; i++ ) {
-			if( sd->inventory.u.items_inventory[i].nameid == item->nameid &&
-				sd->inventory.u.items_inventory[i].bound == item->bound &&
-				sd->inventory.u.items_inventory[i].expire_time == 0 &&
-				sd->inventory.u.items_inventory[i].unique_id == item->unique_id &&
-				memcmp(&sd->inventory.u.items_inventory[i].card, &item->card, sizeof(item->card)) == 0 ) {
-				if( amount > MAX_AMOUNT - sd->inventory.u.items_inventory[i].amount || ( id->stack.inventory && amount > id->stack.amount - sd->inventory.u.items_inventory[i].amount ) )
+		for( int16 slot : pc_inventory_slots( *sd, item->nameid ) ) {
+			if( sd->inventory.u.items_inventory[slot].bound == item->bound &&
+				sd->inventory.u.items_inventory[slot].expire_time == 0 &&
+				sd->inventory.u.items_inventory[slot].unique_id == item->unique_id &&
+				memcmp(&sd->inventory.u.items_inventory[slot].card, &item->card, sizeof(item->card)) == 0 ) {
+				if( amount > MAX_AMOUNT - sd->inventory.u.items_inventory[slot].amount || ( id->stack.inventory && amount > id->stack.amount - sd->inventory.u.items_inventory[slot].amount ) )
 					return ADDITEM_OVERAMOUNT;
 				// If the item is in the inventory already, but the player is not allowed to use that many slots anymore
-				if( i >= sd->status.inventory_slots ){
+				if( slot >= sd->status.inventory_slots ){
 					return ADDITEM_OVERAMOUNT;
 				}
-				sd->inventory.u.items_inventory[i].amount += amount;
-				clif_additem(sd,i,amount,0);
+				sd->inventory.u.items_inventory[slot].amount += amount;
+				clif_additem(sd,slot,amount,0);
+				i = slot;
 				break;
 			}
 		}
-	}else{
-		i = MAX_INVENTORY;
- 	}
+	}
 
 	if (i >= MAX_INVENTORY) {
 		i = pc_search_inventory(sd,0);
@@ -6279,6 +6354,7 @@ enum e_additem_result pc_additem(map_session_data *sd,struct item *item,int32 am
 		}
 
 		memcpy(&sd->inventory.u.items_inventory[i], item, sizeof(sd->inventory.u.items_inventory[0]));
+		pc_inventory_index_update( *sd, i, 0 );
 		// clear equip and equip switch fields first, just in case
 		if( item->equip )
 			sd->inventory.u.items_inventory[i].equip = 0;
@@ -6346,8 +6422,10 @@ char pc_delitem(map_session_data *sd,int32 n,int32 amount,int32 type, int16 reas
 	if( sd->inventory.u.items_inventory[n].amount <= 0 ){
 		if(sd->inventory.u.items_inventory[n].equip)
 			pc_unequipitem(sd,n,2|(!(type&4) ? 1 : 0));
+		t_itemid nameid = sd->inventory.u.items_inventory[n].nameid;
 		memset(&sd->inventory.u.items_inventory[n],0,sizeof(sd->inventory.u.items_inventory[0]));
 		sd->inventory_data[n] = nullptr;
+		pc_inventory_index_update( *sd, n, nameid );
 	}
 	if(!(type&1))
 		clif_delitem( *sd, n, amount, reason );
@@ -7236,9 +7314,7 @@ enum e_setpos pc_setpos(map_session_data* sd, uint16 mapindex, int32 x, int32 y,
 					if (it.second->flag[SCF_RESTARTONMAPWARP] && it.second->skill_id > 0) {
 						status_change_entry *sce = sd->sc.getSCE(it.first);
 
-						if (sce->timer != INVALID_TIMER)
-							delete_timer(sce->timer, status_change_timer);
-						sce->timer = add_timer(gettick() + skill_get_time(it.second->skill_id, sce->val1), status_change_timer, sd->id, it.first);
+						sce->timer = status_change_add_timer(*sd, static_cast<sc_type>(it.first), gettick() + skill_get_time(it.second->skill_id, sce->val1));
 					}
 				}
 			}
@@ -15485,8 +15561,8 @@ uint8 pc_itemcd_check(map_session_data *sd, struct item_data *id, t_tick tick, u
 
 	// Send reply of delay remains
 	if (sc->getSCE(id->delay.sc)) {
-		const struct TimerData *timer = get_timer(sc->getSCE(id->delay.sc)->timer);
-		clif_msg_value( *sd, MSI_ITEM_REUSE_LIMIT_SECOND, (int32)(timer ? DIFF_TICK(timer->tick, tick) / 1000 : 99) );
+		t_tick timer = status_change_get_timer_tick(*sc, id->delay.sc);
+		clif_msg_value( *sd, MSI_ITEM_REUSE_LIMIT_SECOND, (int32)(timer != INFINITE_TICK ? DIFF_TICK(timer, tick) / 1000 : 99) );
 		return 1;
 	}
 
@@ -16814,6 +16890,8 @@ void do_final_pc(void) {
 	ers_destroy(num_reg_ers);
 	ers_destroy(str_reg_ers);
 
+	// The job bonus scripts have to be freed before the memory manager
+	job_db.clear();
 	attendance_db.clear();
 	reputation_db.clear();
 #ifdef MAP_GENERATOR
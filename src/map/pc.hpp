@@ -6,6 +6,7 @@
 
 #include <bitset>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include <common/cbasetypes.hpp>
@@ -524,6 +525,7 @@ public:
 	struct s_storage cart;
 
 	struct item_data* inventory_data[MAX_INVENTORY]; // direct pointers to itemdb entries (faster than doing item_id lookups)
+	std::unordered_map<t_itemid, std::vector<int16>> inventory_index; // item id -> ascending inventory indexes holding it, empty slots are listed under 0
 	int16 equip_index[EQI_MAX];
 	int16 equip_switch_index[EQI_MAX];
 	uint32 weight,max_weight,add_max_weight;
@@ -769,6 +771,7 @@ public:
 	int32 guild_invite,guild_invite_account;
 	int32 guild_emblem_id,guild_alliance,guild_alliance_account;
 	int16 guild_x,guild_y; // For guildmate position display. [Skotlex]
+	int16 guild_m; // Map of the last guildmate position update
 	int32 guildspy; // [Syrus22]
 	int32 partyspy; // [Syrus22]
 	int32 clanspy;
@@ -1588,6 +1591,9 @@ uint8 pc_isequip(map_session_data *sd,int32 n);
 int32 pc_equippoint(map_session_data *sd,int32 n);
 int32 pc_equippoint_sub(map_session_data *sd, struct item_data* id);
 void pc_setinventorydata( map_session_data& sd );
+void pc_inventory_index_rebuild( map_session_data& sd );
+void pc_inventory_index_update( map_session_data& sd, int16 index, t_itemid previous );
+const std::vector<int16>& pc_inventory_slots( map_session_data& sd, t_itemid nameid );
 
 int32 pc_get_skillcooldown(map_session_data *sd, uint16 skill_id, uint16 skill_lv);
 uint8 pc_checkskill(const map_session_data *sd,uint16 skill_id);
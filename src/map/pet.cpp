@@ -2311,8 +2311,10 @@ void pet_evolution(map_session_data *sd, int16 pet_id) {
 	clif_delitem( *sd, idx, 1, 0 );
 
 	// Change the old egg to the new one
+	t_itemid old_egg = sd->inventory.u.items_inventory[idx].nameid;
 	sd->inventory.u.items_inventory[idx].nameid = new_data->EggID;
 	sd->inventory_data[idx] = itemdb_search(new_data->EggID);
+	pc_inventory_index_update( *sd, idx, old_egg );
 
 	// Virtually add it to the inventory
 	log_pick_pc(sd, LOG_TYPE_OTHER, 1, &sd->inventory.u.items_inventory[idx]);
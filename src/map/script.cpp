@@ -26,6 +26,7 @@
 #include <common/random.hpp>
 #include <common/showmsg.hpp>
 #include <common/socket.hpp>
+#include <common/sqlworker.hpp>
 #include <common/strlib.hpp>
 #include <common/timer.hpp>
 #include <common/utilities.hpp>
@@ -213,6 +214,18 @@ static inline void SETVALUE(unsigned char* buf, int32 i, int32 n)
 	buf[i+2] = GetByte(n, 2);
 }
 
+/// Storage class of a variable, resolved from its prefix once when the name is added to str_data
+enum e_script_vartype : uint8 {
+	SCRIPT_VAR_CHAR = 0,		///< char variable (no prefix)
+	SCRIPT_VAR_CHAR_TEMP,		///< temporary char variable (@)
+	SCRIPT_VAR_ACCOUNT,			///< account variable (#)
+	SCRIPT_VAR_ACCOUNT_GLOBAL,	///< global account variable (##)
+	SCRIPT_VAR_MAP,				///< permanent or temporary global variable ($ and $@)
+	SCRIPT_VAR_NPC,				///< npc variable (.)
+	SCRIPT_VAR_SCOPE,			///< scope variable (.@)
+	SCRIPT_VAR_INSTANCE,		///< instance variable (')
+};
+
 // String buffer structures.
 // str_data stores string information
 static struct str_data_struct {
@@ -225,6 +238,11 @@ static struct str_data_struct {
 	int32 next;
 	const char *name;
 	bool deprecated;
+	// Resolved at add_str time, so variable accesses do not have to inspect the name again
+	size_t len;
+	bool valid_key; // name passes the registry key length check
+	e_script_vartype vartype;
+	bool is_string;
 } *str_data = nullptr;
 static int32 str_data_size = 0; // size of the data
 static int32 str_num = LABEL_START; // next id to be assigned
@@ -389,6 +407,19 @@ extern script_function buildin_func[];
 
 static struct linkdb_node *sleep_db; // int32 oid -> struct script_state *
 
+/// Query of query_sql_async, keyed by the id of the script state that waits for it
+struct s_script_query {
+	bool done;
+	s_sql_worker_result result;
+};
+
+static std::unordered_map<uint32, s_script_query> script_queries;
+static SqlWorkerPool script_sql_workers; // For query_sql_async
+static SqlWorkerPool script_logsql_workers; // For query_logsql_async
+static uint16 script_query_workers = 2;
+static int32 script_query_timeout = 60000;
+#define SCRIPT_QUERY_INTERVAL 10
+
 /*==========================================
  * (Only those needed) local declaration prototype
  *------------------------------------------*/
@@ -416,6 +447,7 @@ const char* script_op2name(int32 op)
 	RETURN_OP_NAME(C_USERFUNC_POS);
 
 	RETURN_OP_NAME(C_REF);
+	RETURN_OP_NAME(C_SLOT);
 
 	// operators
 	RETURN_OP_NAME(C_OP3);
@@ -704,6 +736,25 @@ static int32 search_str(const char* p)
 	return -1;
 }
 
+/// Resolves the storage class of a variable from its prefix.
+static e_script_vartype script_get_vartype(const char* name)
+{
+	switch( name[0] ){
+		case '@':
+			return SCRIPT_VAR_CHAR_TEMP;
+		case '#':
+			return ( name[1] == '#' ) ? SCRIPT_VAR_ACCOUNT_GLOBAL : SCRIPT_VAR_ACCOUNT;
+		case '$':
+			return SCRIPT_VAR_MAP;
+		case '.':
+			return ( name[1] == '@' ) ? SCRIPT_VAR_SCOPE : SCRIPT_VAR_NPC;
+		case '\'':
+			return SCRIPT_VAR_INSTANCE;
+		default:
+			return SCRIPT_VAR_CHAR;
+	}
+}
+
 /// Stores a copy of the string and returns its id.
 /// If an identical string is already present, returns its id instead.
 int32 add_str(const char* p)
@@ -757,6 +808,10 @@ int32 add_str(const char* p)
 	str_data[str_num].func = nullptr;
 	str_data[str_num].backpatch = -1;
 	str_data[str_num].label = -1;
+	str_data[str_num].len = len;
+	str_data[str_num].valid_key = script_check_RegistryVariableLength( 0, p, nullptr );
+	str_data[str_num].vartype = script_get_vartype(p);
+	str_data[str_num].is_string = ( len > 0 && p[len - 1] == '$' );
 	str_pos += len+1;
 
 	return str_num++;
@@ -802,6 +857,20 @@ static void add_scripti(int64 a){
 	add_scriptb(((a & (int64)0x3f)|(int64)0x80));
 }
 
+/**
+ * Whether the parser addresses a variable by slot.
+ * Only integer scope and npc variables are, strings keep their ownership rules in the databases.
+ */
+static bool script_slot_candidate( int32 id ){
+	const struct str_data_struct& var = str_data[id];
+
+	return ( var.vartype == SCRIPT_VAR_SCOPE || var.vartype == SCRIPT_VAR_NPC ) && !var.is_string && var.valid_key;
+}
+
+/// Positions of the references to slot candidates in the script that is parsed, as pairs of variable id and position.
+/// Collected for every reference, whether the name is new to this script or not, see parse_script_.
+static std::vector<std::pair<int32, int32>> parse_slot_refs;
+
 /// Appends a str_data object (label/function/variable/integer) to the script buffer.
 
 ///
@@ -823,6 +892,8 @@ static void add_scriptl(int32 l)
 	case C_USERFUNC:
 		// Embedded data backpatch there is a possibility of label
 		add_scriptc(C_NAME);
+		if( script_slot_candidate( l ) )
+			parse_slot_refs.emplace_back( l, script_pos );
 		str_data[l].backpatch = script_pos;
 		add_scriptb(backpatch);
 		add_scriptb(backpatch>>8);
@@ -835,6 +906,8 @@ static void add_scriptl(int32 l)
 		break;
 	default: // assume C_NAME
 		add_scriptc(C_NAME);
+		if( script_slot_candidate( l ) )
+			parse_slot_refs.emplace_back( l, script_pos );
 		add_scriptb(l);
 		add_scriptb(l>>8);
 		add_scriptb(l>>16);
@@ -2475,6 +2548,71 @@ void script_warning(const char* src, const char* file, int32 start_line, const c
 	ShowWarning("%s", StringBuf_Value(&buf));
 }
 
+/**
+ * Allocates the values of the variables a script addresses by slot.
+ * @param code: script the values belong to
+ * @param count: number of values
+ * @return values or nullptr if the script has no such variable
+ */
+static struct script_slots* script_slots_alloc( const struct script_code* code, uint16 count ){
+	if( count == 0 ){
+		return nullptr;
+	}
+
+	struct script_slots* slots = (struct script_slots*)aCalloc( sizeof( struct script_slots ) + count * sizeof( int64 ), 1 );
+
+	slots->code = code;
+	slots->values = reinterpret_cast<int64*>( slots + 1 );
+
+	return slots;
+}
+
+static void script_slots_free( struct script_slots* slots ){
+	if( slots != nullptr ){
+		aFree( slots );
+	}
+}
+
+/**
+ * Looks up the slot the parser assigned to a variable of a script.
+ * @return index in the scope or npc values, -1 if the variable lives in its database
+ */
+static int32 script_slot_find( const struct script_code* code, int32 id ){
+	const struct script_slot* begin = code->slots;
+	const struct script_slot* end = begin + code->slot_count;
+	const struct script_slot* slot = std::lower_bound( begin, end, id, []( const struct script_slot& slot, int32 id ){
+		return slot.id < id;
+	} );
+
+	if( slot == end || slot->id != id ){
+		return -1;
+	}
+
+	return slot->index;
+}
+
+/**
+ * Returns the storage of an integer scope or npc variable that is addressed by slot.
+ * Only element 0 is, the other elements of an array always live in the database.
+ * @param src: variable source
+ * @param uid: variable uid
+ * @param slot: index pushed by C_SLOT, -1 if unknown or if the variable was passed by reference
+ * @return value or nullptr if the variable lives in src->vars
+ */
+static int64* script_slot_value( struct reg_db* src, int64 uid, int32 slot ){
+	struct script_slots* slots = src->slots;
+
+	if( slots == nullptr || script_getvaridx( uid ) != 0 ){
+		return nullptr;
+	}
+
+	if( slot < 0 && ( slot = script_slot_find( slots->code, script_getvarid( uid ) ) ) < 0 ){
+		return nullptr;
+	}
+
+	return &slots->values[slot];
+}
+
 /*==========================================
  * Analysis of the script
  *------------------------------------------*/
@@ -2497,6 +2635,7 @@ struct script_code* parse_script_( const char *src, const char *file, int32 line
 	script_buf=(unsigned char *)aMalloc(SCRIPT_BLOCK_SIZE*sizeof(unsigned char));
 	script_pos=0;
 	script_size=SCRIPT_BLOCK_SIZE;
+	parse_slot_refs.clear();
 	parse_nextline(true, nullptr);
 
 	// who called parse_script is responsible for clearing the database after using it, but just in case... lets clear it here
@@ -2618,6 +2757,30 @@ struct script_code* parse_script_( const char *src, const char *file, int32 line
 		disp_error_message("parse_script: unresolved function references", p);
 	}
 
+	// integer scope and npc variables get a dense slot, sorting by id keeps slots sorted for script_slot_find
+	std::vector<struct script_slot> slots;
+	uint16 scope_slots = 0, npc_slots = 0;
+
+	if( !( parse_options&SCRIPT_NO_VARIABLE_SLOTS ) ){
+		std::sort( parse_slot_refs.begin(), parse_slot_refs.end() );
+
+		for( const auto& ref : parse_slot_refs ){
+			if( slots.empty() || slots.back().id != ref.first ){
+				if( slots.size() >= UINT16_MAX )
+					break;
+
+				uint16& count = ( str_data[ref.first].vartype == SCRIPT_VAR_SCOPE ) ? scope_slots : npc_slots;
+
+				slots.push_back( { ref.first, count++ } );
+			}
+
+			script_buf[ref.second - 1] = C_SLOT;
+			SETVALUE( script_buf, ref.second, static_cast<int32>( slots.size() - 1 ) );
+		}
+	}
+
+	parse_slot_refs.clear();
+
 #ifdef DEBUG_DISP
 	for(i=0;i<script_pos;i++){
 		if((i&15)==0) ShowMessage("%04x : ",i);
@@ -2647,6 +2810,11 @@ struct script_code* parse_script_( const char *src, const char *file, int32 line
 				ShowMessage(" %s", ( j == 0xffffff ) ? "?? unknown ??" : get_str(j));
 				i += 3;
 				break;
+			case C_SLOT:
+				j = (*(int32*)(script_buf+i)&0xffffff);
+				ShowMessage(" %s", get_str(slots[j].id));
+				i += 3;
+				break;
 			case C_STR:
 				j = strlen(script_buf + i);
 				ShowMessage(" %s", script_buf + i);
@@ -2663,6 +2831,14 @@ struct script_code* parse_script_( const char *src, const char *file, int32 line
 	code->script_size = script_size;
 	code->local.vars = nullptr;
 	code->local.arrays = nullptr;
+	if( !slots.empty() ){
+		CREATE( code->slots, struct script_slot, slots.size() );
+		std::copy( slots.begin(), slots.end(), code->slots );
+	}
+	code->slot_count = static_cast<uint16>( slots.size() );
+	code->scope_slots = scope_slots;
+	code->npc_slots = npc_slots;
+	code->local.slots = script_slots_alloc( code, npc_slots );
 	return code;
 }
 
@@ -2690,26 +2866,20 @@ static bool script_rid2sd_( struct script_state *st, map_session_data** sd, cons
  */
 struct script_data *get_val_(struct script_state* st, struct script_data* data, map_session_data *sd)
 {
-	const char* name;
-	char prefix;
-	char postfix;
-
 	if( !data_isreference(data) )
 		return data;// not a variable/constant
 
-	name = reference_getname(data);
-	prefix = name[0];
-	postfix = name[strlen(name) - 1];
+	const struct str_data_struct& var = str_data[reference_getid(data)];
 
 	//##TODO use reference_tovariable(data) when it's confirmed that it works [FlavioJS]
-	if( !reference_toconstant(data) && not_server_variable(prefix) ) {
+	if( var.type != C_INT && var.vartype != SCRIPT_VAR_MAP && var.vartype != SCRIPT_VAR_NPC && var.vartype != SCRIPT_VAR_SCOPE && var.vartype != SCRIPT_VAR_INSTANCE ) {
 		if( sd == nullptr && !script_rid2sd(sd) ) {// needs player attached
-			if( postfix == '$' ) {// string variable
-				ShowWarning("script:get_val: cannot access player variable '%s', defaulting to \"\"\n", name);
+			if( var.is_string ) {// string variable
+				ShowWarning("script:get_val: cannot access player variable '%s', defaulting to \"\"\n", reference_getname(data));
 				data->type = C_CONSTSTR;
 				data->u.str = const_cast<char *>("");
 			} else {// integer variable
-				ShowWarning("script:get_val: cannot access player variable '%s', defaulting to 0\n", name);
+				ShowWarning("script:get_val: cannot access player variable '%s', defaulting to 0\n", reference_getname(data));
 				data->type = C_INT;
 				data->u.num = 0;
 			}
@@ -2717,25 +2887,26 @@ struct script_data *get_val_(struct script_state* st, struct script_data* data,
 		}
 	}
 
-	if( postfix == '$' ) {// string variable
+	if( var.is_string ) {// string variable
 
-		switch( prefix ) {
-			case '@':
+		switch( var.vartype ) {
+			case SCRIPT_VAR_CHAR_TEMP:
 				data->u.str = pc_readregstr(sd, data->u.num);
 				break;
-			case '$':
+			case SCRIPT_VAR_MAP:
 				data->u.str = mapreg_readregstr(data->u.num);
 				break;
-			case '#':
-				if( name[1] == '#' )
-					data->u.str = pc_readaccountreg2str(sd, data->u.num);// global
-				else
-					data->u.str = pc_readaccountregstr(sd, data->u.num);// local
+			case SCRIPT_VAR_ACCOUNT_GLOBAL:
+				data->u.str = pc_readaccountreg2str(sd, data->u.num);
 				break;
-			case '.':
+			case SCRIPT_VAR_ACCOUNT:
+				data->u.str = pc_readaccountregstr(sd, data->u.num);
+				break;
+			case SCRIPT_VAR_SCOPE:
+			case SCRIPT_VAR_NPC:
 				{
 					struct DBMap* n = data->ref ?
-							data->ref->vars : name[1] == '@' ?
+							data->ref->vars : var.vartype == SCRIPT_VAR_SCOPE ?
 							st->stack->scope.vars : // instance/scope variable
 							st->script->local.vars; // npc variable
 					if( n )
@@ -2744,7 +2915,7 @@ struct script_data *get_val_(struct script_state* st, struct script_data* data,
 						data->u.str = nullptr;
 				}
 				break;
-			case '\'':
+			case SCRIPT_VAR_INSTANCE:
 				{
 					struct DBMap* n = nullptr;
 					if (data->ref)
@@ -2758,7 +2929,7 @@ struct script_data *get_val_(struct script_state* st, struct script_data* data,
 					if (n)
 						data->u.str = (char*)i64db_get(n,reference_getuid(data));
 					else {
-						ShowWarning("script:get_val: cannot access instance variable '%s', defaulting to \"\"\n", name);
+						ShowWarning("script:get_val: cannot access instance variable '%s', defaulting to \"\"\n", reference_getname(data));
 						data->u.str = nullptr;
 					}
 					break;
@@ -2780,37 +2951,42 @@ struct script_data *get_val_(struct script_state* st, struct script_data* data,
 
 		data->type = C_INT;
 
-		if( reference_toconstant(data) ) {
-			data->u.num = reference_getconstant(data);
-		} else if( reference_toparam(data) ) {
-			data->u.num = pc_readparam(sd, reference_getparamtype(data));
+		if( var.type == C_INT ) {
+			data->u.num = var.val;
+		} else if( var.type == C_PARAM ) {
+			data->u.num = pc_readparam(sd, var.val);
 		} else
-			switch( prefix ) {
-				case '@':
+			switch( var.vartype ) {
+				case SCRIPT_VAR_CHAR_TEMP:
 					data->u.num = pc_readreg(sd, data->u.num);
 					break;
-				case '$':
+				case SCRIPT_VAR_MAP:
 					data->u.num = mapreg_readreg(data->u.num);
 					break;
-				case '#':
-					if( name[1] == '#' )
-						data->u.num = pc_readaccountreg2(sd, data->u.num);// global
-					else
-						data->u.num = pc_readaccountreg(sd, data->u.num);// local
+				case SCRIPT_VAR_ACCOUNT_GLOBAL:
+					data->u.num = pc_readaccountreg2(sd, data->u.num);
+					break;
+				case SCRIPT_VAR_ACCOUNT:
+					data->u.num = pc_readaccountreg(sd, data->u.num);
 					break;
-				case '.':
+				case SCRIPT_VAR_SCOPE:
+				case SCRIPT_VAR_NPC:
 					{
-						struct DBMap* n = data->ref ?
-								data->ref->vars : name[1] == '@' ?
-								st->stack->scope.vars : // instance/scope variable
-								st->script->local.vars; // npc variable
-						if( n )
-							data->u.num = i64db_i64get(n,reference_getuid(data));
+						struct reg_db* src = data->ref ?
+								data->ref : var.vartype == SCRIPT_VAR_SCOPE ?
+								&st->stack->scope : // instance/scope variable
+								&st->script->local; // npc variable
+						int64* value = script_slot_value(src, reference_getuid(data), data->ref ? -1 : data->slot);
+
+						if( value )
+							data->u.num = *value;
+						else if( src->vars )
+							data->u.num = i64db_i64get(src->vars,reference_getuid(data));
 						else
 							data->u.num = 0;
 					}
 					break;
-				case '\'':
+				case SCRIPT_VAR_INSTANCE:
 					{
 						struct DBMap* n = nullptr;
 						if (data->ref)
@@ -2824,7 +3000,7 @@ struct script_data *get_val_(struct script_state* st, struct script_data* data,
 						if (n)
 							data->u.num = i64db_i64get(n,reference_getuid(data));
 						else {
-							ShowWarning("script:get_val: cannot access instance variable '%s', defaulting to 0\n", name);
+							ShowWarning("script:get_val: cannot access instance variable '%s', defaulting to 0\n", reference_getname(data));
 							data->u.num = 0;
 						}
 						break;
@@ -3144,29 +3320,31 @@ void script_array_update(struct reg_db *src, int64 num, bool empty)
  * TODO: return values are screwed up, have been for some time (reaad: years), e.g. some functions return 1 failure and success.
  *------------------------------------------*/
 bool set_reg_str( struct script_state* st, map_session_data* sd, int64 num, const char* name, const char* value, struct reg_db *ref ){
-	char prefix = name[0];
-	size_t vlen = 0;
+	const struct str_data_struct& var = str_data[script_getvarid( num )];
 
-	if( !script_check_RegistryVariableLength( 0, name, &vlen ) ){
-		ShowError( "set_reg: Variable name length is too long (aid: %d, cid: %d): '%s' sz=%" PRIuPTR "\n", sd ? sd->status.account_id : -1, sd ? sd->status.char_id : -1, name, vlen );
+	if( !var.valid_key ){
+		ShowError( "set_reg: Variable name length is too long (aid: %d, cid: %d): '%s' sz=%" PRIuPTR "\n", sd ? sd->status.account_id : -1, sd ? sd->status.char_id : -1, name, var.len );
 		return false;
 	}
 
-	if( !is_string_variable( name ) ){
+	if( !var.is_string ){
 		// integer variable
 		return false;
 	}
 
-	switch( prefix ){
-		case '@':
+	switch( var.vartype ){
+		case SCRIPT_VAR_CHAR_TEMP:
 			pc_setregstr( sd, num, value );
 			return true;
-		case '$':
+		case SCRIPT_VAR_MAP:
 			return mapreg_setregstr( num, value );
-		case '#':
-			return ( name[1] == '#' ) ? pc_setaccountreg2str( sd, num, value ) : pc_setaccountregstr( sd, num, value );
-		case '.': {
-				struct reg_db *n = ( ref ) ? ref : ( name[1] == '@' ) ? &st->stack->scope : &st->script->local;
+		case SCRIPT_VAR_ACCOUNT_GLOBAL:
+			return pc_setaccountreg2str( sd, num, value );
+		case SCRIPT_VAR_ACCOUNT:
+			return pc_setaccountregstr( sd, num, value );
+		case SCRIPT_VAR_SCOPE:
+		case SCRIPT_VAR_NPC: {
+				struct reg_db *n = ( ref ) ? ref : ( var.vartype == SCRIPT_VAR_SCOPE ) ? &st->stack->scope : &st->script->local;
 
 				if( n ){
 					if( value[0] ){
@@ -3185,7 +3363,7 @@ bool set_reg_str( struct script_state* st, map_session_data* sd, int64 num, cons
 				}
 			}
 			return true;
-		case '\'': {
+		case SCRIPT_VAR_INSTANCE: {
 				struct reg_db *src = nullptr;
 
 				if( ref ){
@@ -3223,22 +3401,25 @@ bool set_reg_str( struct script_state* st, map_session_data* sd, int64 num, cons
 	}
 }
 
-bool set_reg_num( struct script_state* st, map_session_data* sd, int64 num, const char* name, int64 value, struct reg_db *ref ){
-	char prefix = name[0];
-	size_t vlen = 0;
+/**
+ * Sets an integer variable
+ * @param slot: index pushed by C_SLOT for scope and npc variables, -1 if unknown
+ */
+static bool set_reg_num_( struct script_state* st, map_session_data* sd, int64 num, const char* name, int64 value, struct reg_db *ref, int32 slot ){
+	const struct str_data_struct& var = str_data[script_getvarid( num )];
 
-	if( !script_check_RegistryVariableLength( 0, name, &vlen ) ){
-		ShowError( "set_reg: Variable name length is too long (aid: %d, cid: %d): '%s' sz=%" PRIuPTR "\n", sd ? sd->status.account_id : -1, sd ? sd->status.char_id : -1, name, vlen );
+	if( !var.valid_key ){
+		ShowError( "set_reg: Variable name length is too long (aid: %d, cid: %d): '%s' sz=%" PRIuPTR "\n", sd ? sd->status.account_id : -1, sd ? sd->status.char_id : -1, name, var.len );
 		return false;
 	}
 
-	if( is_string_variable( name ) ){
+	if( var.is_string ){
 		// string variable
 		return false;
 	}
 
-	if( str_data[script_getvarid(num)].type == C_PARAM ){
-		if( pc_setparam( sd, str_data[script_getvarid(num)].val, value ) == 0 ){
+	if( var.type == C_PARAM ){
+		if( pc_setparam( sd, var.val, value ) == 0 ){
 			if( st != nullptr ) {
 				ShowError( "script_set_reg: failed to set param '%s' to %" PRId64 ".\n", name, value );
 				script_reportsrc( st );
@@ -3251,18 +3432,24 @@ bool set_reg_num( struct script_state* st, map_session_data* sd, int64 num, cons
 		return true;
 	}
 
-	switch( prefix ){
-		case '@':
+	switch( var.vartype ){
+		case SCRIPT_VAR_CHAR_TEMP:
 			pc_setreg( sd, num, value );
 			return true;
-		case '$':
+		case SCRIPT_VAR_MAP:
 			return mapreg_setreg( num, value );
-		case '#':
-			return ( name[1] == '#' ) ? pc_setaccountreg2(sd, num, value) :	pc_setaccountreg( sd, num, value );
-		case '.': {
-				struct reg_db *n = ( ref ) ? ref : ( name[1] == '@' ) ? &st->stack->scope : &st->script->local;
-
-				if( n ){
+		case SCRIPT_VAR_ACCOUNT_GLOBAL:
+			return pc_setaccountreg2( sd, num, value );
+		case SCRIPT_VAR_ACCOUNT:
+			return pc_setaccountreg( sd, num, value );
+		case SCRIPT_VAR_SCOPE:
+		case SCRIPT_VAR_NPC: {
+				struct reg_db *n = ( ref ) ? ref : ( var.vartype == SCRIPT_VAR_SCOPE ) ? &st->stack->scope : &st->script->local;
+				int64* storage = script_slot_value( n, num, ref ? -1 : slot );
+
+				if( storage ){
+					*storage = value;
+				}else if( n ){
 					if( value != 0 ){
 						i64db_i64put( n->vars, num, value );
 
@@ -3279,7 +3466,7 @@ bool set_reg_num( struct script_state* st, map_session_data* sd, int64 num, cons
 				}
 			}
 			return true;
-		case '\'': {
+		case SCRIPT_VAR_INSTANCE: {
 				struct reg_db *src = nullptr;
 
 				if( ref ){
@@ -3317,6 +3504,10 @@ bool set_reg_num( struct script_state* st, map_session_data* sd, int64 num, cons
 	}
 }
 
+bool set_reg_num( struct script_state* st, map_session_data* sd, int64 num, const char* name, int64 value, struct reg_db *ref ){
+	return set_reg_num_( st, sd, num, name, value, ref, -1 );
+}
+
 bool set_var_str( map_session_data* sd, const char* name, const char* val ){
 	return set_reg_str( nullptr, sd, reference_uid( add_str( name ), 0 ), name, val, nullptr );
 }
@@ -3470,6 +3661,7 @@ struct script_data* push_val2(struct script_stack* stack, enum c_op type, int64
 	if( stack->sp >= stack->sp_max )
 		stack_expand(stack);
 	stack->stack_data[stack->sp].type  = type;
+	stack->stack_data[stack->sp].slot  = -1;
 	stack->stack_data[stack->sp].u.num = val;
 	stack->stack_data[stack->sp].ref   = ref;
 	stack->sp++;
@@ -3482,6 +3674,7 @@ struct script_data* push_str(struct script_stack* stack, enum c_op type, char* s
 	if( stack->sp >= stack->sp_max )
 		stack_expand(stack);
 	stack->stack_data[stack->sp].type  = type;
+	stack->stack_data[stack->sp].slot  = -1;
 	stack->stack_data[stack->sp].u.str = str;
 	stack->stack_data[stack->sp].ref   = nullptr;
 	stack->sp++;
@@ -3494,6 +3687,7 @@ struct script_data* push_retinfo(struct script_stack* stack, struct script_retin
 	if( stack->sp >= stack->sp_max )
 		stack_expand(stack);
 	stack->stack_data[stack->sp].type = C_RETINFO;
+	stack->stack_data[stack->sp].slot = -1;
 	stack->stack_data[stack->sp].u.ri = ri;
 	stack->stack_data[stack->sp].ref  = ref;
 	stack->sp++;
@@ -3514,13 +3708,16 @@ struct script_data* push_copy(struct script_stack* stack, int32 pos)
 			ShowFatalError("script:push_copy: can't create copies of C_RETINFO. Exiting...\n");
 			exit(1);
 			break;
-		default:
-			return push_val2(
-				stack,stack->stack_data[pos].type,
-				stack->stack_data[pos].u.num,
-				stack->stack_data[pos].ref
-			);
-			break;
+		default: {
+				struct script_data* data = push_val2(
+					stack,stack->stack_data[pos].type,
+					stack->stack_data[pos].u.num,
+					stack->stack_data[pos].ref
+				);
+
+				data->slot = stack->stack_data[pos].slot;
+				return data;
+			}
 	}
 }
 
@@ -3556,6 +3753,8 @@ void pop_stack(struct script_state* st, int32 start, int32 end)
 				ri->scope.arrays->destroy(ri->scope.arrays, script_free_array_db);
 				ri->scope.arrays = nullptr;
 			}
+			script_slots_free(ri->scope.slots);
+			ri->scope.slots = nullptr;
 			if( data->ref )
 				aFree(data->ref);
 			aFree(ri);
@@ -3617,6 +3816,9 @@ void script_free_code(struct script_code* code)
 	script_free_vars(code->local.vars);
 	if (code->local.arrays)
 		code->local.arrays->destroy(code->local.arrays, script_free_array_db);
+	script_slots_free(code->local.slots);
+	if (code->slots)
+		aFree(code->slots);
 	aFree(code->script_buf);
 	aFree(code);
 }
@@ -3640,6 +3842,7 @@ struct script_state* script_alloc_state(struct script_code* rootscript, int32 po
 	st->stack->defsp = st->stack->sp;
 	st->stack->scope.vars = i64db_alloc(DB_OPT_RELEASE_DATA);
 	st->stack->scope.arrays = nullptr;
+	st->stack->scope.slots = script_slots_alloc(rootscript, rootscript->scope_slots);
 	st->state = RUN;
 	st->script = rootscript;
 	st->pos = pos;
@@ -3689,10 +3892,12 @@ void script_free_state(struct script_state* st)
 
 		if (st->sleep.timer != INVALID_TIMER)
 			delete_timer(st->sleep.timer, run_script_timer);
+		script_queries.erase(st->id); // The result of a pending query_sql_async is discarded
 		if (st->stack) {
 			script_free_vars(st->stack->scope.vars);
 			if (st->stack->scope.arrays)
 				st->stack->scope.arrays->destroy(st->stack->scope.arrays, script_free_array_db);
+			script_slots_free(st->stack->scope.slots);
 			pop_stack(st, 0, st->stack->sp);
 			aFree(st->stack->stack_data);
 			ers_free(stack_ers, st->stack);
@@ -4168,6 +4373,7 @@ int32 run_func(struct script_state *st)
 		}
 		script_free_vars(st->stack->scope.vars);
 		st->stack->scope.arrays->destroy(st->stack->scope.arrays, script_free_array_db);
+		script_slots_free(st->stack->scope.slots);
 
 		ri = st->stack->stack_data[st->stack->defsp-1].u.ri;
 		nargs = ri->nargs;
@@ -4175,6 +4381,7 @@ int32 run_func(struct script_state *st)
 		st->script = ri->script;
 		st->stack->scope.vars = ri->scope.vars;
 		st->stack->scope.arrays = ri->scope.arrays;
+		st->stack->scope.slots = ri->scope.slots;
 		st->stack->defsp = ri->defsp;
 		memset(ri, 0, sizeof(struct script_retinfo));
 
@@ -4262,6 +4469,33 @@ TIMER_FUNC(run_script_timer){
 	return 0;
 }
 
+/**
+ * Hands the results of query_sql_async to the scripts that wait for them.
+ */
+static TIMER_FUNC(script_query_timer){
+	if( script_sql_workers.get_pending() > 0 )
+		script_sql_workers.process();
+	if( script_logsql_workers.get_pending() > 0 )
+		script_logsql_workers.process();
+	return 0;
+}
+
+/**
+ * Reads the query_sql_async settings of the inter configuration.
+ * @return true if the setting was handled
+ */
+bool script_query_config_read(const char* w1, const char* w2)
+{
+	if( !strcmpi(w1, "query_sql_async_workers") )
+		script_query_workers = (uint16)cap_value(atoi(w2), 0, 16);
+	else if( !strcmpi(w1, "query_sql_async_timeout") )
+		script_query_timeout = cap_value(atoi(w2), 1000, INT_MAX);
+	else
+		return false;
+
+	return true;
+}
+
 /**
  * Remove sleep timers from the NPC
  * @param id: NPC ID
@@ -4412,6 +4646,14 @@ void run_script_main(struct script_state *st)
 			push_val(stack,c,GETVALUE(st->script->script_buf,st->pos));
 			st->pos+=3;
 			break;
+		case C_SLOT:
+			{
+				const struct script_slot& slot = st->script->slots[GETVALUE(st->script->script_buf,st->pos)];
+
+				push_val(stack,C_NAME,slot.id)->slot = slot.index;
+				st->pos+=3;
+			}
+			break;
 		case C_ARG:
 			push_val(stack,c,0);
 			break;
@@ -4826,6 +5068,11 @@ void do_final_script() {
 		script_free_state(st);
 	dbi_destroy(iter);
 
+	// Pending queries are still executed, their results are discarded
+	script_sql_workers.finalize();
+	script_logsql_workers.finalize();
+	script_queries.clear();
+
 	if (str_data)
 		aFree(str_data);
 	if (str_buf)
@@ -4870,6 +5117,16 @@ void do_init_script(void) {
 	next_id = 0;
 
 	mapreg_init();
+
+	if( script_query_workers > 0 ) {
+		if( !script_sql_workers.initialize(script_query_workers, map_server_id.c_str(), map_server_pw.c_str(), map_server_ip.c_str(), map_server_port, map_server_db.c_str(), default_codepage.c_str()) )
+			ShowWarning("do_init_script: Could not open the background connections, query_sql_async runs synchronously.\n");
+		if( log_config.sql_logs && !script_logsql_workers.initialize(script_query_workers, log_db_id.c_str(), log_db_pw.c_str(), log_db_ip.c_str(), log_db_port, log_db_db.c_str(), default_codepage.c_str()) )
+			ShowWarning("do_init_script: Could not open the background log connections, query_logsql_async runs synchronously.\n");
+	}
+
+	add_timer_func_list(script_query_timer, "script_query_timer");
+	add_timer_interval(gettick() + SCRIPT_QUERY_INTERVAL, script_query_timer, 0, 0, SCRIPT_QUERY_INTERVAL);
 	add_buildin_func();
 	constant_db.load();
 	script_hardcoded_constants();
@@ -5427,10 +5684,12 @@ BUILDIN_FUNC(callfunc)
 	if (!st->stack->scope.arrays)
 		st->stack->scope.arrays = idb_alloc(DB_OPT_BASE); // TODO: Can this happen? when?
 	ref[0].arrays = st->stack->scope.arrays;
+	ref[0].slots = st->stack->scope.slots;
 	ref[1].vars = st->script->local.vars;
 	if (!st->script->local.arrays)
 		st->script->local.arrays = idb_alloc(DB_OPT_BASE); // TODO: Can this happen? when?
 	ref[1].arrays = st->script->local.arrays;
+	ref[1].slots = st->script->local.slots;
 
 	for(i = st->start+3, j = 0; i < st->end; i++, j++) {
 		struct script_data* data = push_copy(st->stack,i);
@@ -5447,6 +5706,7 @@ BUILDIN_FUNC(callfunc)
 	ri->script       = st->script;              // script code
 	ri->scope.vars   = st->stack->scope.vars;   // scope variables
 	ri->scope.arrays = st->stack->scope.arrays; // scope arrays
+	ri->scope.slots  = st->stack->scope.slots;  // scope variables addressed by slot
 	ri->pos          = st->pos;                 // script location
 	ri->nargs        = j;                       // argument count
 	ri->defsp        = st->stack->defsp;        // default stack pointer
@@ -5458,6 +5718,7 @@ BUILDIN_FUNC(callfunc)
 	st->state = GOTO;
 	st->stack->scope.vars = i64db_alloc(DB_OPT_RELEASE_DATA);
 	st->stack->scope.arrays = idb_alloc(DB_OPT_BASE);
+	st->stack->scope.slots = script_slots_alloc(scr, scr->scope_slots);
 
 	if (!st->script->local.vars)
 		st->script->local.vars = i64db_alloc(DB_OPT_RELEASE_DATA);
@@ -5487,6 +5748,7 @@ BUILDIN_FUNC(callsub)
 	if (!st->stack->scope.arrays)
 		st->stack->scope.arrays = idb_alloc(DB_OPT_BASE); // TODO: Can this happen? when?
 	ref[0].arrays = st->stack->scope.arrays;
+	ref[0].slots = st->stack->scope.slots;
 
 	for(i = st->start+3, j = 0; i < st->end; i++, j++) {
 		struct script_data* data = push_copy(st->stack,i);
@@ -5503,6 +5765,7 @@ BUILDIN_FUNC(callsub)
 	ri->script       = st->script;              // script code
 	ri->scope.vars   = st->stack->scope.vars;   // scope variables
 	ri->scope.arrays = st->stack->scope.arrays; // scope arrays
+	ri->scope.slots  = st->stack->scope.slots;  // scope variables addressed by slot
 	ri->pos          = st->pos;                 // script location
 	ri->nargs        = j;                       // argument count
 	ri->defsp        = st->stack->defsp;        // default stack pointer
@@ -5513,6 +5776,7 @@ BUILDIN_FUNC(callsub)
 	st->state = GOTO;
 	st->stack->scope.vars = i64db_alloc(DB_OPT_RELEASE_DATA);
 	st->stack->scope.arrays = idb_alloc(DB_OPT_BASE);
+	st->stack->scope.slots = script_slots_alloc(st->script, st->script->scope_slots);
 
 	return SCRIPT_CMD_SUCCESS;
 }
@@ -5569,6 +5833,8 @@ BUILDIN_FUNC(return)
 				if( data->ref && data->ref->vars == st->stack->stack_data[st->stack->defsp-1].u.ri->scope.vars )
 					data->ref = nullptr; // Reference to the parent scope, remove reference pointer
 			}
+			if( data_isreference(data) )
+				data->slot = -1; // The slot belongs to the slot table of this script, the caller looks the variable up by id
 		}
 	}
 	else
@@ -6219,8 +6485,8 @@ BUILDIN_FUNC(setr)
 	//struct script_data* datavalue;
 	int64 num;
 	uint8 pos = 4;
-	const char* name, *command = script_getfuncname(st);
-	char prefix;
+	const char* name;
+	bool is_setr = !strcmp( script_getfuncname( st ), "setr" );
 
 	data = script_getdata(st,2);
 	//datavalue = script_getdata(st,3);
@@ -6234,12 +6500,15 @@ BUILDIN_FUNC(setr)
 
 	num = reference_getuid(data);
 	name = reference_getname(data);
-	prefix = *name;
 
-	if (!strcmp(command, "setr"))
+	const struct str_data_struct& var = str_data[reference_getid( data )];
+	// read before the stack grows below
+	int32 slot = data->slot;
+
+	if (is_setr)
 		pos = 5;
 
-	if (not_server_variable(prefix) && !script_charid2sd(pos,sd)) {
+	if (var.vartype != SCRIPT_VAR_MAP && var.vartype != SCRIPT_VAR_NPC && var.vartype != SCRIPT_VAR_SCOPE && var.vartype != SCRIPT_VAR_INSTANCE && !script_charid2sd(pos,sd)) {
 		ShowError("buildin_set: No player attached for player variable '%s'\n", name);
 		return SCRIPT_CMD_FAILURE;
 	}
@@ -6272,18 +6541,18 @@ BUILDIN_FUNC(setr)
 	}
 #endif
 
-	if( !strcmp(command, "setr") && script_hasdata(st, 4) ) { // Optional argument used by post-increment/post-decrement constructs to return the previous value
-		if( is_string_variable(name) )
+	if( is_setr && script_hasdata(st, 4) ) { // Optional argument used by post-increment/post-decrement constructs to return the previous value
+		if( var.is_string )
 			script_pushstrcopy(st,script_getstr(st, 4));
 		else
 			script_pushint(st,script_getnum64(st, 4));
 	} else // Return a copy of the variable reference
 		script_pushcopy(st, 2);
 
-	if( is_string_variable(name) )
+	if( var.is_string )
 		set_reg_str( st, sd, num, name, script_getstr( st, 3 ), script_getref( st, 2 ) );
 	else
-		set_reg_num( st, sd, num, name, script_getnum64( st, 3 ), script_getref( st, 2 ) );
+		set_reg_num_( st, sd, num, name, script_getnum64( st, 3 ), script_getref( st, 2 ), slot );
 
 	return SCRIPT_CMD_SUCCESS;
 }
@@ -7136,6 +7405,26 @@ static bool script_getitem_randomoption(struct script_state *st, map_session_dat
 	return true;
 }
 
+/**
+ * Call func for every item of a storage that may match nameid
+ * The inventory of sd is looked up through its item id index, other storages are scanned
+ * @param items: Storage items
+ * @param size: Storage size
+ * @param nameid: Item ID
+ * @param sd: Owner of items, if it is the inventory
+ * @param func: Called with each candidate item
+ */
+template <typename F>
+static void script_foreach_item(struct item *items, int32 size, t_itemid nameid, map_session_data *sd, F func) {
+	if (sd != nullptr && items == sd->inventory.u.items_inventory) {
+		for (int16 i : pc_inventory_slots(*sd, nameid))
+			func(items[i]);
+	} else {
+		for (int32 i = 0; i < size; i++)
+			func(items[i]);
+	}
+}
+
 /**
  * Sub function for counting items
  * @param items: Item array to search
@@ -7158,14 +7447,12 @@ static int32 script_countitem_sub(struct item *items, std::shared_ptr<item_data>
 	if (!expanded) { // For non-expanded functions
 		t_itemid nameid = id->nameid;
 
-		for (int32 i = 0; i < size; i++) {
-			item *itm = &items[i];
-
-			if (itm == nullptr || itm->nameid == 0 || itm->amount < 1)
-				continue;
-			if (itm->nameid == nameid && ((rental && itm->expire_time > 0) || (!rental && itm->expire_time == 0)))
-				count += itm->amount;
-		}
+		script_foreach_item(items, size, nameid, sd, [&](item &itm) {
+			if (itm.nameid == 0 || itm.amount < 1)
+				return;
+			if (itm.nameid == nameid && ((rental && itm.expire_time > 0) || (!rental && itm.expire_time == 0)))
+				count += itm.amount;
+		});
 	} else { // For expanded functions
 		item it = {};
 		int32 offset = 10;
@@ -7197,30 +7484,28 @@ static int32 script_countitem_sub(struct item *items, std::shared_ptr<item_data>
 				return -1;
 		}
 
-		for (int32 i = 0; i < size; i++) {
-			item *itm = &items[i];
-
-			if (itm == nullptr || itm->nameid == 0 || itm->amount < 1)
-				continue;
-			if (itm->nameid != it.nameid || itm->identify != it.identify || itm->refine != it.refine || itm->attribute != it.attribute || itm->enchantgrade != it.enchantgrade)
-				continue;
-			if ((!rental && itm->expire_time > 0) || (rental && itm->expire_time == 0))
-				continue;
-			if (memcmp(it.card, itm->card, sizeof(it.card)))
-				continue;
+		script_foreach_item(items, size, it.nameid, sd, [&](item &itm) {
+			if (itm.nameid == 0 || itm.amount < 1)
+				return;
+			if (itm.nameid != it.nameid || itm.identify != it.identify || itm.refine != it.refine || itm.attribute != it.attribute || itm.enchantgrade != it.enchantgrade)
+				return;
+			if ((!rental && itm.expire_time > 0) || (rental && itm.expire_time == 0))
+				return;
+			if (memcmp(it.card, itm.card, sizeof(it.card)))
+				return;
 			if (expanded&2) {
 				uint8 j;
 
 				for (j = 0; j < MAX_ITEM_RDM_OPT; j++) {
-					if (itm->option[j].id != it.option[j].id || itm->option[j].value != it.option[j].value || itm->option[j].param != it.option[j].param)
+					if (itm.option[j].id != it.option[j].id || itm.option[j].value != it.option[j].value || itm.option[j].param != it.option[j].param)
 						break;
 				}
 				if (j != MAX_ITEM_RDM_OPT)
-					continue;
+					return;
 			}
 
-			count += items[i].amount;
-		}
+			count += itm.amount;
+		});
 	}
 
 	return count;
@@ -8429,7 +8714,7 @@ static void buildin_delitem_delete(map_session_data* sd, int32 idx, int32* amoun
 static bool buildin_delitem_search(map_session_data* sd, struct item* it, uint8 exact_match, uint8 loc)
 {
 	bool delete_items = false;
-	int32 i, amount, size;
+	int32 i, amount, size, start = 0;
 	struct item *items;
 
 	// prefer always non-equipped items
@@ -8462,8 +8747,14 @@ static bool buildin_delitem_search(map_session_data* sd, struct item* it, uint8
 		}
 			break;
 		default: // TABLE_INVENTORY
-			size = MAX_INVENTORY;
+		{
+			// Only scan the index range that can hold the item
+			const std::vector<int16>& slots = pc_inventory_slots(*sd, it->nameid);
+
+			start = slots.empty() ? 0 : slots.front();
+			size = slots.empty() ? 0 : slots.back() + 1;
 			items = sd->inventory.u.items_inventory;
+		}
 			break;
 	}
 
@@ -8473,7 +8764,7 @@ static bool buildin_delitem_search(map_session_data* sd, struct item* it, uint8
 		amount = it->amount;
 
 		// 1st pass -- less important items / exact match
-		for( i = 0; amount && i < size; i++ )
+		for( i = start; amount && i < size; i++ )
 		{
 			struct item *itm = nullptr;
 
@@ -8529,7 +8820,7 @@ static bool buildin_delitem_search(map_session_data* sd, struct item* it, uint8
 		{// either everything was already consumed or no items were skipped
 			;
 		}
-		else for( i = 0; amount && i < size; i++ )
+		else for( i = start; amount && i < size; i++ )
 		{
 			struct item *itm = nullptr;
 
@@ -12626,11 +12917,11 @@ BUILDIN_FUNC(getstatus)
 			break;
 		case 5:
 			{
-				const struct TimerData* timer = get_timer( sce->timer );
+				t_tick timer = status_change_get_timer_tick( sd->sc, static_cast<sc_type>( id ) );
 
-				if( timer )
+				if( timer != INFINITE_TICK )
 				{// return the amount of time remaining
-					script_pushint(st, timer->tick - gettick());
+					script_pushint(st, timer - gettick());
 				} else {
 					script_pushint(st, -1);
 				}
@@ -18075,18 +18366,16 @@ BUILDIN_FUNC(setd)
 	return SCRIPT_CMD_SUCCESS;
 }
 
-int32 buildin_query_sql_sub(struct script_state* st, Sql* handle)
+/**
+ * Checks the target variables of query_sql, attaching the player if one of them needs it.
+ * @return amount of target variables or -1 on failure
+ */
+static int32 buildin_query_sql_checkvars(struct script_state* st, TBL_PC*& sd)
 {
-	int32 i, j;
-	TBL_PC* sd = nullptr;
-	const char* query;
+	int32 i;
 	struct script_data* data;
 	const char* name;
-	uint32 max_rows = SCRIPT_MAX_ARRAYSIZE; // maximum number of rows
-	int32 num_vars;
-	int32 num_cols;
 
-	// check target variables
 	for( i = 3; script_hasdata(st,i); ++i ) {
 		data = script_getdata(st, i);
 		if( data_isreference(data) ) { // it's a variable
@@ -18095,17 +18384,63 @@ int32 buildin_query_sql_sub(struct script_state* st, Sql* handle)
 				if( !script_rid2sd(sd) ) { // no player attached
 					script_reportdata(data);
 					st->state = END;
-					return SCRIPT_CMD_FAILURE;
+					return -1;
 				}
 			}
 		} else {
 			ShowError("script:query_sql: not a variable\n");
 			script_reportdata(data);
 			st->state = END;
-			return SCRIPT_CMD_FAILURE;
+			return -1;
 		}
 	}
-	num_vars = i - 3;
+
+	return i - 3;
+}
+
+/**
+ * Warns about columns and variables that don't match.
+ */
+static void buildin_query_sql_checkcols(struct script_state* st, int32 num_vars, int32 num_cols)
+{
+	if( num_vars < num_cols ) {
+		ShowWarning("script:query_sql: Too many columns, discarding last %u columns.\n", (uint32)(num_cols-num_vars));
+		script_reportsrc(st);
+	} else if( num_vars > num_cols ) {
+		ShowWarning("script:query_sql: Too many variables (%u extra).\n", (uint32)(num_vars-num_cols));
+		script_reportsrc(st);
+	}
+}
+
+/**
+ * Stores a value of a query_sql result.
+ * @param var: index of the target variable
+ * @param row: index of the row
+ * @param str: value or nullptr for a missing column
+ */
+static void buildin_query_sql_setdata(struct script_state* st, TBL_PC* sd, int32 var, uint32 row, const char* str)
+{
+	struct script_data* data = script_getdata(st, var+3);
+	const char* name = reference_getname(data);
+
+	if( is_string_variable(name) )
+		setd_sub_str( st, sd, name, row, str ? str : "", reference_getref( data ) );
+	else
+		setd_sub_num( st, sd, name, row, str ? strtoll( str, nullptr, 10 ) : 0, reference_getref( data ) );
+}
+
+int32 buildin_query_sql_sub(struct script_state* st, Sql* handle)
+{
+	int32 i, j;
+	TBL_PC* sd = nullptr;
+	const char* query;
+	uint32 max_rows = SCRIPT_MAX_ARRAYSIZE; // maximum number of rows
+	int32 num_vars;
+	int32 num_cols;
+
+	// check target variables
+	if( ( num_vars = buildin_query_sql_checkvars(st, sd) ) < 0 )
+		return SCRIPT_CMD_FAILURE;
 
 	// Execute the query
 	query = script_getstr(st,2);
@@ -18124,13 +18459,7 @@ int32 buildin_query_sql_sub(struct script_state* st, Sql* handle)
 
 	// Count the number of columns to store
 	num_cols = Sql_NumColumns(handle);
-	if( num_vars < num_cols ) {
-		ShowWarning("script:query_sql: Too many columns, discarding last %u columns.\n", (uint32)(num_cols-num_vars));
-		script_reportsrc(st);
-	} else if( num_vars > num_cols ) {
-		ShowWarning("script:query_sql: Too many variables (%u extra).\n", (uint32)(num_vars-num_cols));
-		script_reportsrc(st);
-	}
+	buildin_query_sql_checkcols(st, num_vars, num_cols);
 
 	// Store data
 	for( i = 0; i < max_rows && SQL_SUCCESS == Sql_NextRow(handle); ++i ) {
@@ -18140,13 +18469,7 @@ int32 buildin_query_sql_sub(struct script_state* st, Sql* handle)
 			if( j < num_cols )
 				Sql_GetData(handle, j, &str, nullptr);
 
-			data = script_getdata(st, j+3);
-			name = reference_getname(data);
-
-			if( is_string_variable(name) )
-				setd_sub_str( st, sd, name, i, str ? str : "", reference_getref( data ) );
-			else
-				setd_sub_num( st, sd, name, i, str ? strtoll( str, nullptr, 10 ) : 0, reference_getref( data ) );
+			buildin_query_sql_setdata(st, sd, j, i, str);
 		}
 	}
 	if( i == max_rows && max_rows < Sql_NumRows(handle) ) {
@@ -18174,6 +18497,130 @@ BUILDIN_FUNC(query_logsql) {
 	return buildin_query_sql_sub(st, logmysql_handle);
 }
 
+/**
+ * A query of query_sql_async finished, wakes up the script that waits for it.
+ * @param id: id of the waiting script state
+ */
+static void script_query_done(uint32 id, s_sql_worker_result& result)
+{
+	auto it = script_queries.find(id);
+
+	if( it == script_queries.end() ) // The script ended meanwhile
+		return;
+
+	struct script_state* st = static_cast<script_state*>(idb_get(st_db, id));
+
+	if( st == nullptr ) {
+		script_queries.erase(it);
+		return;
+	}
+
+	it->second.done = true;
+	it->second.result = std::move(result);
+
+	if( st->sleep.timer == INVALID_TIMER ) // Not asleep yet, the script picks the result up when it resumes
+		return;
+
+	// Resume like awake does
+	delete_timer(st->sleep.timer, run_script_timer);
+	run_script_timer(INVALID_TIMER, gettick(), st->sleep.charid, (intptr_t)st);
+}
+
+/**
+ * Runs a query on a background connection, suspending the script until the result arrived.
+ * The attached player stays attached like with sleep2; if they log out meanwhile the script ends
+ * once the query finished.
+ */
+static int32 buildin_query_sql_async_sub(struct script_state* st, SqlWorkerPool& workers, Sql* handle)
+{
+	int32 num_vars;
+	TBL_PC* sd = nullptr;
+
+	// Without background connections the query runs synchronously
+	if( !workers.is_enabled() )
+		return buildin_query_sql_sub(st, handle);
+
+	if( ( num_vars = buildin_query_sql_checkvars(st, sd) ) < 0 )
+		return SCRIPT_CMD_FAILURE;
+
+	// First call, queue the query and sleep until the result arrives or the timeout expires
+	if( st->sleep.tick == 0 ) {
+		uint32 id = st->id;
+
+		script_queries[id] = {};
+		workers.enqueue(script_getstr(st,2), [id]( s_sql_worker_result& result ){
+			script_query_done(id, result);
+		});
+
+		st->state = RERUNLINE;
+		st->sleep.tick = script_query_timeout;
+		return SCRIPT_CMD_SUCCESS;
+	}
+
+	// Second call, by the result or the timeout
+	st->state = RUN;
+	st->sleep.tick = 0;
+
+	auto it = script_queries.find(st->id);
+
+	if( it == script_queries.end() || !it->second.done ) {
+		ShowWarning("script:query_sql_async: No result after %d ms, the result of the query will be discarded.\n", script_query_timeout);
+		script_reportsrc(st);
+		if( it != script_queries.end() )
+			script_queries.erase(it);
+		script_pushint(st, -1);
+		return SCRIPT_CMD_FAILURE;
+	}
+
+	s_sql_worker_result result = std::move(it->second.result);
+	uint32 max_rows = SCRIPT_MAX_ARRAYSIZE; // maximum number of rows
+	uint32 i;
+
+	script_queries.erase(it);
+
+	if( !result.success ) { // Already reported by the worker pool
+		script_pushint(st, -1);
+		return SCRIPT_CMD_FAILURE;
+	}
+
+	if( result.rows.empty() ) { // No data received
+		script_pushint(st, 0);
+		return SCRIPT_CMD_SUCCESS;
+	}
+
+	int32 num_cols = static_cast<int32>(result.rows.front().size());
+
+	buildin_query_sql_checkcols(st, num_vars, num_cols);
+
+	// Store data
+	for( i = 0; i < max_rows && i < result.rows.size(); ++i ) {
+		for( int32 j = 0; j < num_vars; ++j ) {
+			buildin_query_sql_setdata(st, sd, j, i, j < num_cols ? result.rows[i][j].c_str() : nullptr);
+		}
+	}
+	if( i == max_rows && max_rows < result.rows.size() ) {
+		ShowWarning("script:query_sql_async: Only %u/%u rows have been stored.\n", max_rows, (uint32)result.rows.size());
+		script_reportsrc(st);
+	}
+
+	script_pushint(st, i);
+	return SCRIPT_CMD_SUCCESS;
+}
+
+BUILDIN_FUNC(query_sql_async) {
+	return buildin_query_sql_async_sub(st, script_sql_workers, qsmysql_handle);
+}
+
+BUILDIN_FUNC(query_logsql_async) {
+	if( !log_config.sql_logs ) {// logmysql_handle == nullptr
+		ShowWarning("buildin_query_logsql_async: SQL logs are disabled, query '%s' will not be executed.\n", script_getstr(st,2));
+		script_pushint(st,-1);
+		return SCRIPT_CMD_FAILURE;
+	}
+
+	return buildin_query_sql_async_sub(st, script_logsql_workers, logmysql_handle);
+}
+
 //Allows escaping of a given string.
 BUILDIN_FUNC(escape_sql)
 {
@@ -28313,6 +28760,8 @@ struct script_function buildin_func[] = {
 	BUILDIN_DEF(axtoi,"s"),
 	BUILDIN_DEF(query_sql,"s*"),
 	BUILDIN_DEF(query_logsql,"s*"),
+	BUILDIN_DEF(query_sql_async,"s*"),
+	BUILDIN_DEF(query_logsql_async,"s*"),
 	BUILDIN_DEF(escape_sql,"v"),
 	BUILDIN_DEF(atoi,"s"),
 	BUILDIN_DEF(strtol,"si"),
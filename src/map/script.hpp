@@ -235,6 +235,7 @@ typedef enum c_op {
 	C_USERFUNC, // internal script function
 	C_USERFUNC_POS, // internal script function label
 	C_REF, // the next call to c_op2 should push back a ref to the left operand
+	C_SLOT, // scope or npc variable addressed by its slot in the script (see script_code::slots)
 
 	// operators
 	C_OP3, // a ? b : c
@@ -271,6 +272,22 @@ typedef enum c_op {
 struct reg_db {
 	struct DBMap *vars;
 	struct DBMap *arrays;
+	struct script_slots *slots; ///< values of the variables the script addresses by slot, only for scope and npc variables
+};
+
+/**
+ * Values of the integer scope or npc variables a script addresses by slot.
+ * Element 0 of these variables is stored here instead of in reg_db::vars.
+ */
+struct script_slots {
+	const struct script_code* code; ///< script whose slot table indexes the values
+	int64* values;
+};
+
+/// Scope or npc variable the parser assigned a slot to
+struct script_slot {
+	int32 id;     ///< variable id
+	uint16 index; ///< index in the scope or npc values of the script
 };
 
 struct script_retinfo {
@@ -283,6 +300,7 @@ struct script_retinfo {
 
 struct script_data {
 	enum c_op type;
+	int32 slot; ///< index in the values of a scope or npc variable pushed by C_SLOT, -1 otherwise
 	union script_data_val {
 		int64 num;
 		char *str;
@@ -298,6 +316,10 @@ struct script_code {
 	unsigned char* script_buf;
 	struct reg_db local;
 	uint16 instances;
+	struct script_slot* slots; ///< variables addressed by slot, sorted by id
+	uint16 slot_count;         ///< entries in slots
+	uint16 scope_slots;        ///< values of each scope of this script
+	uint16 npc_slots;          ///< values of the npc variables of this script
 };
 
 struct script_stack {
@@ -355,7 +377,8 @@ struct script_array {
 enum script_parse_options {
 	SCRIPT_USE_LABEL_DB = 0x1,// records labels in scriptlabel_db
 	SCRIPT_IGNORE_EXTERNAL_BRACKETS = 0x2,// ignores the check for {} brackets around the script
-	SCRIPT_RETURN_EMPTY_SCRIPT = 0x4// returns the script object instead of nullptr for empty scripts
+	SCRIPT_RETURN_EMPTY_SCRIPT = 0x4,// returns the script object instead of nullptr for empty scripts
+	SCRIPT_NO_VARIABLE_SLOTS = 0x8// keeps all scope and npc variables in their databases, used to benchmark the slots
 };
 
 enum e_monsterinfo_types : uint8 {
@@ -3198,6 +3221,7 @@ void script_free_code(struct script_code* code);
 void script_free_vars(struct DBMap *storage);
 struct script_state* script_alloc_state(struct script_code* rootscript, int32 pos, int32 rid, int32 oid);
 void script_free_state(struct script_state* st);
+bool script_query_config_read(const char* w1, const char* w2);
 
 struct DBMap* script_get_label_db(void);
 struct DBMap* script_get_userfunc_db(void);
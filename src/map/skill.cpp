@@ -14,6 +14,7 @@
 #include <common/ers.hpp>
 #include <common/malloc.hpp>
 #include <common/nullpo.hpp>
+#include <common/profiler.hpp>
 #include <common/random.hpp>
 #include <common/showmsg.hpp>
 #include <common/strlib.hpp>
@@ -3326,9 +3327,7 @@ void skill_combo(block_list* src,block_list *dsrc, block_list *bl, uint16 skill_
 			if (sd && pc_famerank(sd->status.char_id,MAPID_TAEKWON)) {//Extend combo time.
 				sce->val1 = skill_id; //Update combo-skill
 				sce->val3 = skill_id;
-				if( sce->timer != INVALID_TIMER )
-					delete_timer(sce->timer, status_change_timer);
-				sce->timer = add_timer(tick+sce->val4, status_change_timer, src->id, SC_COMBO);
+				sce->timer = status_change_add_timer(*src, SC_COMBO, tick+sce->val4);
 				break;
 			}
 			unit_cancel_combo(src); // Cancel combo wait
@@ -3587,6 +3586,85 @@ void skill_attack_blow(block_list *src, block_list *dsrc, block_list *target, ui
 	clif_fixpos( *target );
 }
 
+/**
+ * Checks the conditions under which a skill attack deals no damage before its damage is calculated.
+ * @param src: master behind the attack
+ * @param dsrc: actual originator of the damage
+ * @param bl: target
+ * @param flag: flags of skill_attack
+ * @return true if the attack deals no damage
+ */
+static bool skill_attack_blocked(block_list* src, block_list* dsrc, block_list* bl, uint16 skill_id, int32 flag)
+{
+	if (status_bl_has_mode(bl,MD_SKILLIMMUNE) || (status_get_class(bl) == MOBID_EMPERIUM && !skill_get_inf2(skill_id, INF2_TARGETEMPERIUM)))
+		return true;
+
+	if (src != dsrc) {
+		//When caster is not the src of attack, this is a ground skill, and as such, do the relevant target checking. [Skotlex]
+		if (!status_check_skilluse(battle_config.skill_caster_check?src:nullptr, bl, skill_id, 2))
+			return true;
+	} else if ((flag&SD_ANIMATION) && skill_get_nk(skill_id, NK_SPLASH)) {
+		//Note that splash attacks often only check versus the targetted mob, those around the splash area normally don't get checked for being hidden/cloaked/etc. [Skotlex]
+		if (!status_check_skilluse(src, bl, skill_id, 2))
+			return true;
+	}
+
+	status_change* tsc = status_get_sc(bl);
+
+	 //Trick Dead protects you from damage, but not from buffs and the like, hence it's placed here.
+	if (tsc && tsc->getSCE(SC_TRICKDEAD))
+		return true;
+
+#ifndef RENEWAL
+	map_session_data* sd = BL_CAST(BL_PC, src);
+	status_change* sc = status_get_sc(src);
+
+	//When Gravitational Field is active, damage can only be dealt by Gravitational Field and Autospells
+	if(sd && sc && sc->getSCE(SC_GRAVITATION) && sc->getSCE(SC_GRAVITATION)->val3 == BCT_SELF && skill_id != HW_GRAVITATION && !sd->state.autocast)
+		return true;
+#endif
+
+	return false;
+}
+
+/// Damage of a splash target, calculated before the first target of the cast is hit
+struct s_skill_splash_damage {
+	int32 src_id;
+	int32 target_id;
+	uint16 skill_id;
+	uint16 skill_lv;
+	int32 attack_type;
+	int32 flag;
+	struct Damage damage;
+};
+
+/// Damages calculated for the splash cast that is currently hitting its targets, see skill_area_splash
+static std::vector<s_skill_splash_damage>* skill_splash_damages = nullptr;
+/// Seed of the random streams of the splash targets, drawn once per cast
+static uint64 skill_splash_seed = 0;
+
+/**
+ * Takes the damage calculated in advance for a splash target.
+ * Each damage is only used once, further hits on the same target are calculated as usual.
+ * @param dmg: damage to fill
+ * @return true if a damage for this attack was calculated in advance
+ */
+static bool skill_splash_damage_take(block_list* src, block_list* bl, uint16 skill_id, uint16 skill_lv, int32 attack_type, int32 flag, struct Damage& dmg)
+{
+	if (skill_splash_damages == nullptr)
+		return false;
+
+	for (auto it = skill_splash_damages->begin(); it != skill_splash_damages->end(); ++it) {
+		if (it->target_id == bl->id && it->src_id == src->id && it->skill_id == skill_id && it->skill_lv == skill_lv && it->attack_type == attack_type && it->flag == flag) {
+			dmg = it->damage;
+			skill_splash_damages->erase(it);
+			return true;
+		}
+	}
+
+	return false;
+}
+
 /*
  * =========================================================================
  * Does a skill attack with the given properties.
@@ -3626,19 +3704,9 @@ int64 skill_attack (int32 attack_type, block_list* src, block_list *dsrc, block_
 	nullpo_ret(dsrc);	//dsrc is the actual originator of the damage, can be the same as src, or a skill casted by src.
 	nullpo_ret(bl);		//Target to be attacked.
 
-	if (status_bl_has_mode(bl,MD_SKILLIMMUNE) || (status_get_class(bl) == MOBID_EMPERIUM && !skill_get_inf2(skill_id, INF2_TARGETEMPERIUM)))
+	if (skill_attack_blocked(src, dsrc, bl, skill_id, flag))
 		return 0;
 
-	if (src != dsrc) {
-		//When caster is not the src of attack, this is a ground skill, and as such, do the relevant target checking. [Skotlex]
-		if (!status_check_skilluse(battle_config.skill_caster_check?src:nullptr, bl, skill_id, 2))
-			return 0;
-	} else if ((flag&SD_ANIMATION) && skill_get_nk(skill_id, NK_SPLASH)) {
-		//Note that splash attacks often only check versus the targetted mob, those around the splash area normally don't get checked for being hidden/cloaked/etc. [Skotlex]
-		if (!status_check_skilluse(src, bl, skill_id, 2))
-			return 0;
-	}
-
 	sd = BL_CAST(BL_PC, src);
 	tsd = BL_CAST(BL_PC, bl);
 
@@ -3649,17 +3717,8 @@ int64 skill_attack (int32 attack_type, block_list* src, block_list *dsrc, block_
 	if (tsc != nullptr && tsc->empty())
 		tsc = nullptr; //Don't need it.
 
-	 //Trick Dead protects you from damage, but not from buffs and the like, hence it's placed here.
-	if (tsc && tsc->getSCE(SC_TRICKDEAD))
-		return 0;
-
-#ifndef RENEWAL
-	//When Gravitational Field is active, damage can only be dealt by Gravitational Field and Autospells
-	if(sd && sc && sc->getSCE(SC_GRAVITATION) && sc->getSCE(SC_GRAVITATION)->val3 == BCT_SELF && skill_id != HW_GRAVITATION && !sd->state.autocast)
-		return 0;
-#endif
-
-	dmg = battle_calc_attack(attack_type,src,bl,skill_id,skill_lv,flag&0xFFF);
+	if (!skill_splash_damage_take(src, bl, skill_id, skill_lv, attack_type, flag&0xFFF, dmg))
+		dmg = battle_calc_attack(attack_type,src,bl,skill_id,skill_lv,flag&0xFFF);
 
 	//If the damage source is a unit, the damage is not delayed
 	if (src != dsrc)
@@ -4559,6 +4618,164 @@ int32 skill_area_sub_count (block_list *src, block_list *target, uint16 skill_id
 	return 1;
 }
 
+/// Target count ranges a splash cast is profiled in
+static const int32 skill_splash_profile_ranges[] = { 0, 1, 2, 5, 10, 25, 50, 100 };
+
+/**
+ * Resolves the name of a splash cast entry for the profiler.
+ * The key holds the skill id and the index of the target count range.
+ */
+static const char* skill_splash_profile_name(uintptr_t key)
+{
+	static char name[64];
+	uint16 skill_id = static_cast<uint16>(key >> 4);
+	size_t range = key & 0xF;
+
+	if (range + 1 < ARRAYLENGTH(skill_splash_profile_ranges))
+		safesnprintf(name, sizeof(name), "%s (%d-%d targets)", skill_get_name(skill_id), skill_splash_profile_ranges[range], skill_splash_profile_ranges[range + 1] - 1);
+	else
+		safesnprintf(name, sizeof(name), "%s (%d+ targets)", skill_get_name(skill_id), skill_splash_profile_ranges[range]);
+
+	return name;
+}
+
+/**
+ * Determines the flag a splash target is hit with by the recursive invocation of skill_castend_damage_id().
+ * Shared by the hit and the damage calculation in advance, so both skip the same targets.
+ * @param src: caster
+ * @param bl: splash target
+ * @param flag: flag of the recursive invocation
+ * @return flag for skill_attack or -1 if the target is not hit
+ */
+int32 skill_area_splash_flag(block_list* src, block_list* bl, uint16 skill_id, int32 flag)
+{
+	int32 sflag = skill_area_temp[0] & 0xFFF;
+	std::bitset<INF2_MAX> inf2 = skill_db.find(skill_id)->inf2;
+	status_change* tsc = status_get_sc(bl);
+
+	if (tsc && tsc->getSCE(SC_HOVERING) && inf2[INF2_IGNOREHOVERING])
+		return -1; // Under Hovering characters are immune to select trap and ground target skills.
+
+	if (skill_id == AB_ADORAMUS && map_getcell(bl->m, bl->x, bl->y, CELL_CHKLANDPROTECTOR))
+		return -1; // No damage should happen if the target is on Land Protector
+
+	// Servant Weapon - Demol only hits if the target is marked with a sign by the attacking caster.
+	if (skill_id == DK_SERVANT_W_DEMOL && !(tsc && tsc->getSCE(SC_SERVANT_SIGN) && tsc->getSCE(SC_SERVANT_SIGN)->val1 == src->id))
+		return -1;
+
+	switch (skill_id) {
+		case MG_FIREBALL:
+			// For players, the distance between original target and splash target determines the damage
+			if (src->type == BL_PC) {
+				if (block_list* orig_bl = map_id2bl(skill_area_temp[1]); orig_bl != nullptr)
+					sflag |= distance_bl(orig_bl, bl);
+			}
+			break;
+		case ABC_DEFT_STAB:
+			// Deft Stab - Make sure the flag of 2 is passed on when the skill is double casted.
+			if (flag&2)
+				sflag |= 2;
+			break;
+	}
+
+	if( flag&SD_LEVEL )
+		sflag |= SD_LEVEL; // -1 will be used in packets instead of the skill level
+	if( skill_area_temp[1] != bl->id && !inf2[INF2_ISNPC] )
+		sflag |= SD_ANIMATION; // original target gets no animation (as well as all NPC skills)
+
+	// If a enemy player is standing next to a mob when splash Es- skill is casted, the player won't get hurt.
+	if ((skill_id == SP_SHA || skill_id == SP_SWHOO) && !battle_config.allow_es_magic_pc && bl->type != BL_MOB)
+		return -1;
+
+	return sflag;
+}
+
+/**
+ * Calculates the damage of a splash target before the first target of the cast is hit.
+ * The target rolls from its own random streams, seeded from the cast and its id, so its damage does not
+ * depend on the amount of targets or the order they are hit in.
+ * @see skill_area_splash
+ */
+static int32 skill_area_splash_calc(block_list* src, block_list* bl, uint16 skill_id, uint16 skill_lv, t_tick tick, int32 flag)
+{
+	int32 sflag = skill_area_splash_flag(src, bl, skill_id, flag);
+
+	// The calculation is not side effect free, it can consume status changes of the target
+	if (sflag < 0 || skill_attack_blocked(src, src, bl, skill_id, sflag))
+		return 0;
+
+	s_skill_splash_damage entry = {};
+
+	entry.src_id = src->id;
+	entry.target_id = bl->id;
+	entry.skill_id = skill_id;
+	entry.skill_lv = skill_lv;
+	entry.attack_type = skill_get_type(skill_id);
+	entry.flag = sflag & 0xFFF;
+
+	Xoshiro256 cast_generator = generator;
+	Xoshiro256 cast_battle = random_streams[RND_STREAM_BATTLE];
+
+	generator.seed(skill_splash_seed ^ (static_cast<uint64>(bl->id) * 0x9E3779B97F4A7C15ULL));
+	random_streams[RND_STREAM_BATTLE] = generator;
+	random_streams[RND_STREAM_BATTLE].jump();
+
+	entry.damage = battle_calc_attack(entry.attack_type, src, bl, skill_id, skill_lv, entry.flag);
+
+	generator = cast_generator;
+	random_streams[RND_STREAM_BATTLE] = cast_battle;
+
+	skill_splash_damages->push_back(entry);
+
+	return 1;
+}
+
+/**
+ * Recursive invocation of skill_castend_damage_id() with flag|1 on every target around the center.
+ * The targets are gathered by map_foreachinrange before the first one is hit and are hit in that order.
+ * With skill_splash_precalc, the damage of all targets is calculated first, each one from its own random streams,
+ * and then applied in the same order.
+ * When the profiler is enabled, the processing time of the whole cast is recorded by target count.
+ * @param src: caster
+ * @param center: center of the splash
+ * @param range: splash range
+ * @param type: block types that can be hit
+ * @param flag: flags of the cast, BCT_ENEMY|SD_SPLASH|1 are added
+ * @return sum of skill_castend_damage_id() results
+ */
+int32 skill_area_splash(block_list* src, block_list* center, int16 range, int32 type, uint16 skill_id, uint16 skill_lv, t_tick tick, int32 flag)
+{
+	uint64 start = profiler_enabled ? profiler_clock() : 0;
+	int32 targets = skill_area_temp[2];
+	std::vector<s_skill_splash_damage> damages;
+	std::vector<s_skill_splash_damage>* outer_damages = skill_splash_damages;
+
+	skill_splash_damages = &damages;
+
+	if (battle_config.skill_splash_precalc) {
+		skill_splash_seed = generator();
+		map_foreachinrange(skill_area_sub, center, range, type, src, skill_id, skill_lv, tick, (flag&~SD_PREAMBLE)|BCT_ENEMY|1, skill_area_splash_calc);
+	}
+
+	int32 result = map_foreachinrange(skill_area_sub, center, range, type, src, skill_id, skill_lv, tick, flag|BCT_ENEMY|SD_SPLASH|1, skill_castend_damage_id);
+
+	// Splash casts can nest, for example through autospells triggered by a hit
+	skill_splash_damages = outer_damages;
+
+	if (profiler_enabled) {
+		size_t index = 0;
+
+		targets = skill_area_temp[2] - targets;
+
+		while (index + 1 < ARRAYLENGTH(skill_splash_profile_ranges) && targets >= skill_splash_profile_ranges[index + 1])
+			index++;
+
+		profiler_record(PROFILER_SKILL, (static_cast<uintptr_t>(skill_id) << 4) | index, start, skill_splash_profile_name);
+	}
+
+	return result;
+}
+
 /*==========================================
  *
  *------------------------------------------*/
@@ -5903,42 +6120,10 @@ int32 skill_castend_damage_id (block_list* src, block_list *bl, uint16 skill_id,
 	case SKE_SKY_MOON:
 	case SKE_STAR_LIGHT_KICK:
 		if( flag&1 ) {//Recursive invocation
-			int32 sflag = skill_area_temp[0] & 0xFFF;
+			int32 sflag = skill_area_splash_flag(src, bl, skill_id, flag);
 			int32 heal = 0;
-			std::bitset<INF2_MAX> inf2 = skill_db.find(skill_id)->inf2;
-
-			if (tsc && tsc->getSCE(SC_HOVERING) && inf2[INF2_IGNOREHOVERING])
-				break; // Under Hovering characters are immune to select trap and ground target skills.
-
-			if (skill_id == AB_ADORAMUS && map_getcell(bl->m, bl->x, bl->y, CELL_CHKLANDPROTECTOR))
-				break; // No damage should happen if the target is on Land Protector
-
-			// Servant Weapon - Demol only hits if the target is marked with a sign by the attacking caster.
-			if (skill_id == DK_SERVANT_W_DEMOL && !(tsc && tsc->getSCE(SC_SERVANT_SIGN) && tsc->getSCE(SC_SERVANT_SIGN)->val1 == src->id))
-				break;
-
-			switch (skill_id) {
-				case MG_FIREBALL:
-					// For players, the distance between original target and splash target determines the damage
-					if (sd != nullptr) {
-						if (block_list* orig_bl = map_id2bl(skill_area_temp[1]); orig_bl != nullptr)
-							sflag |= distance_bl(orig_bl, bl);
-					}
-					break;
-				case ABC_DEFT_STAB:
-					// Deft Stab - Make sure the flag of 2 is passed on when the skill is double casted.
-					if (flag&2)
-						sflag |= 2;
-					break;
-			}
-
-			if( flag&SD_LEVEL )
-				sflag |= SD_LEVEL; // -1 will be used in packets instead of the skill level
-			if( skill_area_temp[1] != bl->id && !inf2[INF2_ISNPC] )
-				sflag |= SD_ANIMATION; // original target gets no animation (as well as all NPC skills)
 
-			// If a enemy player is standing next to a mob when splash Es- skill is casted, the player won't get hurt.
-			if ((skill_id == SP_SHA || skill_id == SP_SWHOO) && !battle_config.allow_es_magic_pc && bl->type != BL_MOB)
+			if (sflag < 0)
 				break;
 
 			heal = (int32)skill_attack(skill_get_type(skill_id), src, src, bl, skill_id, skill_lv, tick, sflag);
@@ -6211,7 +6396,7 @@ int32 skill_castend_damage_id (block_list* src, block_list *bl, uint16 skill_id,
 			}
 
 			// recursive invocation of skill_castend_damage_id() with flag|1
-			map_foreachinrange(skill_area_sub, bl, splash_size, starget, src, skill_id, skill_lv, tick, flag|BCT_ENEMY|SD_SPLASH|1, skill_castend_damage_id);
+			skill_area_splash(src, bl, splash_size, starget, skill_id, skill_lv, tick, flag);
 
 			if (skill_id == RA_ARROWSTORM)
 				status_change_end(src, SC_CAMOUFLAGE);
@@ -14221,9 +14406,9 @@ TIMER_FUNC(skill_castend_id){
 					type = SC_STRIPSHIELD;
 
 				if (sc && sc->getSCE(type)) {
-					const struct TimerData* timer = get_timer(sc->getSCE(type)->timer);
+					t_tick timer = status_change_get_timer_tick(*sc, type);
 
-					if (timer && timer->func == status_change_timer && DIFF_TICK(timer->tick, gettick() + skill_get_time(ud->skill_id, ud->skill_lv)) > 0)
+					if (timer != INFINITE_TICK && DIFF_TICK(timer, gettick() + skill_get_time(ud->skill_id, ud->skill_lv)) > 0)
 						break;
 				}
 				sc_start2(src, src, type, 100, 0, 1, skill_get_time(ud->skill_id, ud->skill_lv));
@@ -16674,7 +16859,7 @@ static int32 skill_unit_onplace(skill_unit *unit, block_list *bl, t_tick tick)
 				//Duration in PVM is: 1st - 8s, 2nd - 16s, 3rd - 8s
 				//Duration in PVP is: 1st - 4s, 2nd - 8s, 3rd - 12s
 				t_tick sec = skill_get_time2(sg->skill_id, sg->skill_lv);
-				const struct TimerData* td;
+				t_tick td;
 				struct map_data *mapdata = map_getmapdata(bl->m);
 
 				if (mapdata_flag_vs(mapdata))
@@ -16698,15 +16883,15 @@ static int32 skill_unit_onplace(skill_unit *unit, block_list *bl, t_tick tick)
 					else if (sc->getSCE(type)->val4 == 0)
 						sc->getSCE(type)->val4 = sg->group_id;
 					//Overwrite status change with new duration
-					if ((td = get_timer(sc->getSCE(type)->timer))!=nullptr)
+					if ((td = status_change_get_timer_tick(*sc, type)) != INFINITE_TICK)
 						status_change_start(ss, bl, type, 10000, sc->getSCE(type)->val1 + 1, sc->getSCE(type)->val2, sc->getSCE(type)->val3, sc->getSCE(type)->val4,
-							i64max(DIFF_TICK(td->tick, tick), sec), SCSTART_NORATEDEF);
+							i64max(DIFF_TICK(td, tick), sec), SCSTART_NORATEDEF);
 				}
 				else {
 					if (status_change_start(ss, bl, type, 10000, 1, sg->group_id, 0, 0, sec, SCSTART_NORATEDEF)) {
-						td = sc->getSCE(type) ? get_timer(sc->getSCE(type)->timer) : nullptr;
-						if (td)
-							sec = DIFF_TICK(td->tick, tick);
+						td = sc->getSCE(type) ? status_change_get_timer_tick(*sc, type) : INFINITE_TICK;
+						if (td != INFINITE_TICK)
+							sec = DIFF_TICK(td, tick);
 						map_moveblock(bl, unit->x, unit->y, tick);
 						clif_fixpos( *bl );
 
@@ -16849,8 +17034,7 @@ static int32 skill_unit_onplace(skill_unit *unit, block_list *bl, t_tick tick)
 				sc_start4(ss, bl, type, 100, sg->skill_lv, sg->val1, sg->val2, 0, sg->limit + SKILLUNITTIMER_INTERVAL);
 			else if (battle_config.refresh_song == 1 && sce->val4 == 1) { //Readjust timers since the effect will not last long.
 				sce->val4 = 0; //remove the mark that we stepped out
-				delete_timer(sce->timer, status_change_timer);
-				sce->timer = add_timer(tick + sg->limit + SKILLUNITTIMER_INTERVAL, status_change_timer, bl->id, type);
+				sce->timer = status_change_add_timer(*bl, type, tick + sg->limit + SKILLUNITTIMER_INTERVAL);
 				// Update icon duration
 				if (battle_config.refresh_song_icon == 1) {
 					if (auto scdb = status_db.find(type); scdb != nullptr)
@@ -17282,10 +17466,10 @@ int32 skill_unit_onplace_timer(skill_unit *unit, block_list *bl, t_tick tick)
 				}
 
 				if( status_change_start(ss, bl,type,10000,sg->skill_lv,sg->group_id,0,0,sec, SCSTART_NORATEDEF) ) {
-					const struct TimerData* td = tsc->getSCE(type)?get_timer(tsc->getSCE(type)->timer):nullptr;
+					t_tick td = tsc->getSCE(type)?status_change_get_timer_tick(*tsc, type):INFINITE_TICK;
 
-					if( td )
-						sec = DIFF_TICK(td->tick, tick);
+					if( td != INFINITE_TICK )
+						sec = DIFF_TICK(td, tick);
 					if( (sg->unit_id == UNT_MANHOLE && bl->type == BL_PC)
 						|| !unit_blown_immune(bl,0x1) )
 					{
@@ -17671,9 +17855,9 @@ int32 skill_unit_onplace_timer(skill_unit *unit, block_list *bl, t_tick tick)
 				if( !sg->val2 ) {
 					t_tick sec = skill_get_time2(sg->skill_id, sg->skill_lv);
 					if( sc_start(ss, bl, type, 100, sg->skill_lv, sec) ) {
-						const struct TimerData* td = tsc->getSCE(type)?get_timer(tsc->getSCE(type)->timer):nullptr;
-						if( td )
-							sec = DIFF_TICK(td->tick, tick);
+						t_tick td = tsc->getSCE(type)?status_change_get_timer_tick(*tsc, type):INFINITE_TICK;
+						if( td != INFINITE_TICK )
+							sec = DIFF_TICK(td, tick);
 						///map_moveblock(bl, src->x, src->y, tick); // in official server it doesn't behave like this. [malufett]
 						clif_fixpos( *bl );
 						sg->val2 = bl->id;
@@ -18034,12 +18218,11 @@ int32 skill_unit_onleft(uint16 skill_id, block_list *bl, t_tick tick)
 		case DC_SERVICEFORYOU:
 			if (bl->type == BL_PC && sce && sce->val4 == 0)
 			{
-				delete_timer(sce->timer, status_change_timer);
 				//NOTE: It'd be nice if we could get the skill_lv for a more accurate extra time, but alas...
 				//not possible on our current implementation.
 				t_tick duration = skill_get_time2(skill_id, 1);
 				sce->val4 = 1; //Store the fact that this is a "reduced" duration effect.
-				sce->timer = add_timer(tick + duration, status_change_timer, bl->id, type);
+				sce->timer = status_change_add_timer(*bl, type, tick + duration);
 				// Update icon duration
 				if (battle_config.refresh_song_icon == 1) {
 					if (auto scdb = status_db.find(type); scdb != nullptr)
@@ -18059,8 +18242,7 @@ int32 skill_unit_onleft(uint16 skill_id, block_list *bl, t_tick tick)
 					if (bl->type == BL_PC) //Players get blind ended inmediately, others have it still for 30 secs. [Skotlex]
 						status_change_end(bl, SC_BLIND);
 					else {
-						delete_timer(sce->timer, status_change_timer);
-						sce->timer = add_timer(30000+tick, status_change_timer, bl->id, SC_BLIND);
+						sce->timer = status_change_add_timer(*bl, SC_BLIND, 30000+tick);
 					}
 				}
 			}
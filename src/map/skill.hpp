@@ -644,6 +644,9 @@ int32 skill_castend_nodamage_id( block_list *src, block_list *bl,uint16 skill_id
 int32 skill_castend_damage_id( block_list* src, block_list *bl,uint16 skill_id,uint16 skill_lv,t_tick tick,int32 flag );
 int32 skill_castend_pos2( block_list *src, int32 x,int32 y,uint16 skill_id,uint16 skill_lv,t_tick tick,int32 flag);
 int32 skill_area_sub(block_list *bl, va_list ap);
+int32 skill_area_sub_count(block_list *src, block_list *target, uint16 skill_id, uint16 skill_lv, t_tick tick, int32 flag);
+int32 skill_area_splash_flag(block_list* src, block_list* bl, uint16 skill_id, int32 flag);
+int32 skill_area_splash(block_list* src, block_list* center, int16 range, int32 type, uint16 skill_id, uint16 skill_lv, t_tick tick, int32 flag);
 extern int32 skill_area_temp[8];
 
 bool skill_blockpc_start(map_session_data &sd, uint16 skill_id, t_tick tick);
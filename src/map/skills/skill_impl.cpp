@@ -41,20 +41,12 @@ SkillImplRecursiveDamageSplash::SkillImplRecursiveDamageSplash(e_skill skill_id)
 }
 
 void SkillImplRecursiveDamageSplash::castendDamageId(block_list* src, block_list* target, uint16 skill_lv, t_tick tick, int32& flag) const {
-	status_change* tsc = status_get_sc(target);
-
 	if (flag & 1){
 		// Recursive invocation
-		int32 sflag = skill_area_temp[0] & 0xFFF;
-		std::bitset<INF2_MAX> inf2 = skill_db.find(getSkillId())->inf2;
-
-		if (tsc && tsc->getSCE(SC_HOVERING) && inf2[INF2_IGNOREHOVERING])
-			return; // Under Hovering characters are immune to select trap and ground target skills.
+		int32 sflag = skill_area_splash_flag(src, target, getSkillId(), flag);
 
-		if (flag & SD_LEVEL)
-			sflag |= SD_LEVEL; // -1 will be used in packets instead of the skill level
-		if (skill_area_temp[1] != target->id && !inf2[INF2_ISNPC])
-			sflag |= SD_ANIMATION; // original target gets no animation (as well as all NPC skills)
+		if (sflag < 0)
+			return;
 
 		this->splashDamage(src, target, skill_lv, tick, sflag);
 	}else{
@@ -92,14 +84,14 @@ void SkillImplRecursiveDamageSplash::splashSearch(block_list* src, block_list* t
 	// if skill damage should be split among targets, count them
 	// SD_LEVEL -> Forced splash damage -> count targets
 	if (flag & SD_LEVEL || skill_get_nk(getSkillId(), NK_SPLASHSPLIT)){
-		skill_area_temp[0] = map_foreachinallrange(skill_area_sub, target, this->getSearchSize(skill_lv), BL_CHAR, src, getSkillId(), skill_lv, tick, BCT_ENEMY, 1);
+		skill_area_temp[0] = map_foreachinallrange(skill_area_sub, target, this->getSearchSize(skill_lv), BL_CHAR, src, getSkillId(), skill_lv, tick, BCT_ENEMY, skill_area_sub_count);
 		// If there are no characters in the area, then it always counts as if there was one target
 		// This happens when targetting skill units such as icewall
 		skill_area_temp[0] = std::max(1, skill_area_temp[0]);
 	}
 
 	// recursive invocation of skill_castend_damage_id() with flag|1
-	map_foreachinrange(skill_area_sub, target, this->getSplashSearchSize(skill_lv), this->getSplashTarget(src), src, getSkillId(), skill_lv, tick, flag | BCT_ENEMY | SD_SPLASH | 1, skill_castend_damage_id);
+	skill_area_splash(src, target, this->getSplashSearchSize(skill_lv), this->getSplashTarget(src), getSkillId(), skill_lv, tick, flag);
 }
 
 int64 SkillImplRecursiveDamageSplash::splashDamage(block_list* src, block_list* target, uint16 skill_lv, t_tick tick, int32 flag) const {
@@ -7,11 +7,14 @@
 #include <cstdlib>
 #include <functional>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <common/cbasetypes.hpp>
 #include <common/ers.hpp>
 #include <common/malloc.hpp>
 #include <common/nullpo.hpp>
+#include <common/profiler.hpp>
 #include <common/random.hpp>
 #include <common/showmsg.hpp>
 #include <common/strlib.hpp>
@@ -1171,10 +1174,8 @@ status_change_entry::status_change_entry(){
 }
 
 status_change_entry::~status_change_entry(){
-	if( this->timer != INVALID_TIMER ){
-		delete_timer( this->timer, status_change_timer );
-		this->timer = INVALID_TIMER;
-	}
+	// The timer event is part of the owner's timeline, see status_change::deleteSCE
+	this->timer = INVALID_TIMER;
 }
 
 status_change::status_change(){
@@ -1192,6 +1193,15 @@ status_change::status_change(){
 #endif
 	this->data = {};
 	this->lastStatus = { SC_NONE, nullptr };
+	this->timeline = {};
+	this->timeline_timer = INVALID_TIMER;
+}
+
+status_change::~status_change(){
+	if( this->timeline_timer != INVALID_TIMER ){
+		delete_timer( this->timeline_timer, status_change_timer );
+		this->timeline_timer = INVALID_TIMER;
+	}
 }
 
 bool status_change::hasSCE( enum sc_type type ){
@@ -1231,6 +1241,7 @@ status_change_entry* status_change::createSCE( enum sc_type type ){
  * free the sce, then clear it
  */
 void status_change::deleteSCE(enum sc_type type) {
+	status_change_delete_timer( *this, type );
 	this->data.erase( type );
 
 	this->lastStatus.first = type;
@@ -5086,6 +5097,8 @@ int32 status_calc_pc_sub(map_session_data* sd, uint8 opt)
 
 /// Intermediate function since C++ does not have a try-finally syntax
 int32 status_calc_pc_( map_session_data* sd, uint8 opt ){
+	ProfilerScope profile( "status_calc_pc" );
+
 	// Save the old script the player was attached to
 	struct script_state* previous_st = sd->st;
 
@@ -5352,6 +5365,8 @@ int32 status_calc_npc_(npc_data *nd, uint8 opt)
  * @param status: Object's status
  * @param regen: Object's base regeneration data
  */
+static void status_regen_refresh(block_list* bl, struct regen_data* regen);
+
 void status_calc_regen(block_list *bl, struct status_data *status, struct regen_data *regen)
 {
 	map_session_data *sd;
@@ -5457,6 +5472,8 @@ void status_calc_regen(block_list *bl, struct status_data *status, struct regen_
 		val = static_cast<decltype(val)>((status->max_sp * (status->int_ + 10.0) / 750.0) + 1.0);
 		regen->sp = cap_value(val, 1, SHRT_MAX);
 	}
+
+	status_regen_refresh(bl, regen);
 }
 
 /**
@@ -5489,8 +5506,10 @@ void status_calc_regen_rate(block_list *bl, struct regen_data *regen, status_cha
 	}
 	regen->rate.hp = regen->rate.sp = 100;
 
-	if (sc == nullptr || sc->empty())
+	if (sc == nullptr || sc->empty()) {
+		status_regen_refresh(bl, regen);
 		return;
+	}
 
 	// No HP or SP regen
 	if ((sc->getSCE(SC_POISON) && !sc->getSCE(SC_SLOWPOISON))
@@ -5596,6 +5615,8 @@ void status_calc_regen_rate(block_list *bl, struct regen_data *regen, status_cha
 		regen->rate.hp += sc->getSCE(SC_SIRCLEOFNATURE)->val2;
 	if (sc->getSCE(SC_SONGOFMANA))
 		regen->rate.sp += sc->getSCE(SC_SONGOFMANA)->val3;
+
+	status_regen_refresh(bl, regen);
 }
 
 void status_calc_state_sub( block_list& bl, status_change& sc, bool start, std::shared_ptr<s_status_change_db> scdb_main, bool& restriction, e_scs_flag flag, e_scs_flag flag_conditional, std::function<bool ( block_list&, status_change&, bool&, const sc_type, const status_change_entry& )> func_switch ){
@@ -11634,8 +11655,7 @@ static bool status_change_start_post_delay(block_list* src, block_list* bl, sc_t
 					sc_start4(src2,src2,SC_CLOSECONFINE,100,val1,1,val3,0,tick+1000);
 				} else { // Increase count of locked enemies and refresh time.
 					(sce2->val2)++;
-					delete_timer(sce2->timer, status_change_timer);
-					sce2->timer = add_timer(gettick()+tick+1000, status_change_timer, src2->id, SC_CLOSECONFINE);
+					sce2->timer = status_change_add_timer(*src2, SC_CLOSECONFINE, gettick()+tick+1000);
 				}
 			} else // Status failed.
 				return false;
@@ -13380,7 +13400,7 @@ static bool status_change_start_post_delay(block_list* src, block_list* bl, sc_t
 
 	if (sce != nullptr) {
 		if( sce->timer != INVALID_TIMER )
-			delete_timer(sce->timer, status_change_timer);
+			status_change_delete_timer(*sc, type);
 		sc_isnew = false;
 	} else {
 		// New sc
@@ -13391,7 +13411,7 @@ static bool status_change_start_post_delay(block_list* src, block_list* bl, sc_t
 	sce->val3 = val3;
 	sce->val4 = val4;
 	if (tick >= 0)
-		sce->timer = add_timer(gettick() + tick, status_change_timer, bl->id, type);
+		sce->timer = status_change_add_timer(*bl, type, gettick() + tick);
 	else
 		sce->timer = INVALID_TIMER; // Infinite duration
 
@@ -14311,60 +14331,147 @@ int32 status_change_end( block_list* bl, enum sc_type type, int32 tid ){
 	return 1;
 }
 
+/// Status change whose timeline is being processed, it is rescheduled once all due events ran
+static status_change* status_timeline_running = nullptr;
+
+/**
+ * Makes sure the global timer of a status change fires for the earliest event of its timeline.
+ * A timer that fires too early, because the earliest event was removed, simply schedules itself again.
+ * @param bl: Owner of the status change
+ * @param sc: Status change
+ */
+static void status_change_schedule_timer(block_list& bl, status_change& sc){
+	if( &sc == status_timeline_running ){
+		return;
+	}
+
+	if( sc.timeline.empty() ){
+		if( sc.timeline_timer != INVALID_TIMER ){
+			delete_timer( sc.timeline_timer, status_change_timer );
+			sc.timeline_timer = INVALID_TIMER;
+		}
+		return;
+	}
+
+	t_tick next = sc.timeline.front().first;
+
+	if( sc.timeline_timer != INVALID_TIMER ){
+		const TimerData* td = get_timer( sc.timeline_timer );
+
+		if( td != nullptr && DIFF_TICK( td->tick, next ) <= 0 ){
+			return;
+		}
+
+		delete_timer( sc.timeline_timer, status_change_timer );
+	}
+
+	sc.timeline_timer = add_timer( next, status_change_timer, bl.id, 0 );
+}
+
+/**
+ * Schedules the timer event of a status change on the timeline of its owner.
+ * Replaces a previously scheduled event of the same status.
+ * @param bl: Owner of the status change
+ * @param type: Status change
+ * @param tick: Tick of the event
+ * @return value for status_change_entry::timer
+ */
+int32 status_change_add_timer(block_list& bl, enum sc_type type, t_tick tick){
+	status_change* sc = status_get_sc( &bl );
+
+	if( sc == nullptr ){
+		return INVALID_TIMER;
+	}
+
+	status_change_delete_timer( *sc, type );
+
+	// Events of the same tick run in the order they were scheduled
+	auto it = std::upper_bound( sc->timeline.begin(), sc->timeline.end(), tick, []( t_tick tick, const std::pair<t_tick, enum sc_type>& event ){
+		return DIFF_TICK( tick, event.first ) < 0;
+	} );
+
+	sc->timeline.insert( it, std::make_pair( tick, type ) );
+	status_change_schedule_timer( bl, *sc );
+
+	return type;
+}
+
+/**
+ * Removes the timer event of a status change from the timeline.
+ * @param sc: Status change
+ * @param type: Status change
+ */
+void status_change_delete_timer(status_change& sc, enum sc_type type){
+	auto it = std::find_if( sc.timeline.begin(), sc.timeline.end(), [type]( const std::pair<t_tick, enum sc_type>& event ){
+		return event.second == type;
+	} );
+
+	if( it == sc.timeline.end() ){
+		return;
+	}
+
+	sc.timeline.erase( it );
+
+	if( sc.timeline.empty() && sc.timeline_timer != INVALID_TIMER && &sc != status_timeline_running ){
+		delete_timer( sc.timeline_timer, status_change_timer );
+		sc.timeline_timer = INVALID_TIMER;
+	}
+}
+
+/**
+ * Tick of the next timer event of a status change.
+ * @param sc: Status change
+ * @param type: Status change
+ * @return tick of the event or INFINITE_TICK if no event is scheduled
+ */
+t_tick status_change_get_timer_tick(status_change& sc, enum sc_type type){
+	for( const auto& event : sc.timeline ){
+		if( event.second == type ){
+			return event.first;
+		}
+	}
+
+	return INFINITE_TICK;
+}
+
 /**
  * Resets timers for statuses
  * Used with reoccurring status effects, such as dropping SP every 5 seconds
- * @param tid: Timer ID
- * @param tick: How long before next call
- * @param id: ID of character
- * @param data: Information passed through the timer call
+ * @param bl: Owner of the status change
+ * @param sc: Status change of the owner
+ * @param type: Status change whose event is due
+ * @param tick: Tick of the event
  * @return 1: Success 0: Fail
  */
-TIMER_FUNC(status_change_timer){
-	enum sc_type type = (sc_type)data;
-	block_list *bl;
+static int32 status_change_timer_event(block_list* bl, status_change* sc, enum sc_type type, t_tick tick){
 	map_session_data *sd;
 	int32 interval = status_get_sc_interval(type);
 
-	bl = map_id2bl(id);
-	if(!bl) {
-		ShowDebug("status_change_timer: Null pointer id: %d data: %" PRIdPTR "\n", id, data);
-		return 0;
-	}
-
-	status_change * const sc = status_get_sc(bl);
-
-	if(!sc) {
-		ShowDebug("status_change_timer: Null pointer id: %d data: %" PRIdPTR " bl-type: %d\n", id, data, bl->type);
-		return 0;
-	}
-	
 	struct status_change_entry * const sce = sc->getSCE(type);
 	if(!sce) {
-		ShowDebug("status_change_timer: Null pointer id: %d data: %" PRIdPTR " bl-type: %d\n", id, data, bl->type);
-		return 0;
-	}
-	if( sce->timer != tid ) {
-		ShowError("status_change_timer: Mismatch for type %d: %d != %d (bl id %d)\n",type,tid,sce->timer, bl->id);
+		ShowDebug("status_change_timer: Null pointer id: %d type: %d bl-type: %d\n", bl->id, type, bl->type);
 		return 0;
 	}
 
+	// Status changes that end naturally are identified by their timer
+	int32 tid = sce->timer;
 	const status_data* status = status_get_status_data(*bl);
 
 	sd = BL_CAST(BL_PC, bl);
 
-	std::function<void (t_tick)> sc_timer_next = [&sce, &bl, &data](t_tick t) {
-		sce->timer = add_timer(t, status_change_timer, bl->id, data);
+	std::function<void (t_tick)> sc_timer_next = [&sce, &bl, &type](t_tick t) {
+		sce->timer = status_change_add_timer(*bl, type, t);
 	};
 
 	FreeBlockLock freeLock(false);
 
 	switch(type) {
 	case SC_AUTOCOMBAT:
-		if (ac_status(sd))
-			sce->timer = add_timer(battle_config.autocombat_timer + tick, status_change_timer, bl->id, data);
+		// The bot scheduler runs the brain from now on, the status lasts until it is ended
+		if (sd != nullptr)
+			ac_scheduler_add(sd);
+		sce->timer = INVALID_TIMER;
 		return 0;
-		break;		
 	case SC_MAXIMIZEPOWER:
 	case SC_CLOAKING:
 		if(!status_damage(nullptr, bl, 0, 1, 0, 3, 0))
@@ -15430,6 +15537,53 @@ TIMER_FUNC(status_change_timer){
 	return status_change_end( bl,type,tid );
 }
 
+/**
+ * Runs the due timer events of a status change.
+ * Every unit registers only the earliest event of its timeline with the global timers.
+ * @param tid: Timer ID
+ * @param tick: Current tick (time)
+ * @param id: ID of the owner
+ * @param data: unused
+ * @return 0
+ */
+TIMER_FUNC(status_change_timer){
+	block_list* bl = map_id2bl(id);
+
+	if(!bl) {
+		ShowDebug("status_change_timer: Null pointer id: %d\n", id);
+		return 0;
+	}
+
+	status_change* sc = status_get_sc(bl);
+
+	if(!sc) {
+		ShowDebug("status_change_timer: Null pointer id: %d bl-type: %d\n", id, bl->type);
+		return 0;
+	}
+	if( sc->timeline_timer != tid ) {
+		ShowError("status_change_timer: Mismatch %d != %d (bl id %d)\n", tid, sc->timeline_timer, bl->id);
+		return 0;
+	}
+
+	sc->timeline_timer = INVALID_TIMER;
+	status_timeline_running = sc;
+	map_freeblock_lock();
+
+	while( !sc->timeline.empty() && DIFF_TICK(sc->timeline.front().first, tick) <= 0 ) {
+		std::pair<t_tick, enum sc_type> event = sc->timeline.front();
+
+		sc->timeline.erase(sc->timeline.begin());
+		// Like the global timers, events that were delayed for more than a second use the current tick
+		status_change_timer_event(bl, sc, event.second, DIFF_TICK(event.first, tick) < -1000 ? tick : event.first);
+	}
+
+	status_timeline_running = nullptr;
+	status_change_schedule_timer(*bl, *sc);
+	map_freeblock_unlock();
+
+	return 0;
+}
+
 /**
  * For each iteration of repetitive status
  * @param bl: Object [PC|MOB|HOM|MER|ELEM]
@@ -15612,18 +15766,17 @@ int32 status_change_spread(block_list *src, block_list *bl)
 
 	for (const auto &it : status_db) {
 		sc_type type = static_cast<sc_type>(it.first);
-		const TimerData *timer;
 
 		if (sc->getSCE(type) && it.second->flag[SCF_SPREADEFFECT]) {
 			if (sc->getSCE(type)->timer != INVALID_TIMER) {
-				timer = get_timer(sc->getSCE(type)->timer);
+				t_tick timer = status_change_get_timer_tick(*sc, type);
 
-				if (timer == nullptr || timer->func != status_change_timer || DIFF_TICK(timer->tick, tick) < 0)
+				if (timer == INFINITE_TICK || DIFF_TICK(timer, tick) < 0)
 					continue;
 
 				int32 val4 = sc->getSCE(type)->val4;
 
-				sc_tick = DIFF_TICK(timer->tick, tick) + (val4 > 0 ? val4 : 0);
+				sc_tick = DIFF_TICK(timer, tick) + (val4 > 0 ? val4 : 0);
 			} else
 				sc_tick = INFINITE_TICK;
 
@@ -15637,36 +15790,194 @@ int32 status_change_spread(block_list *src, block_list *bl)
 	return hasSpread;
 }
 
+/// Packed table of the units processed by the natural heal timer [PC|HOM|MER|ELEM].
+/// Each column holds one field of every unit, so the timer walks contiguous arrays
+/// instead of iterating a DBMap and resolving the unit type for every lookup.
+/// The pointers refer to data embedded in the unit and stay valid until it is removed.
+/// The regeneration inputs are copied by value, status_calc_regen and status_calc_regen_rate
+/// are the only writers of them and refresh the row through status_regen_refresh.
+static struct s_regen_table {
+	std::vector<block_list*> bl;
+	std::vector<struct regen_data*> regen;
+	std::vector<uint8> flag; ///< regen_data::flag
+	std::vector<uint16> hp; ///< regen_data::hp
+	std::vector<uint16> sp; ///< regen_data::sp
+	std::vector<uint16> rate_hp; ///< regen_data::rate.hp
+	std::vector<uint16> rate_sp; ///< regen_data::rate.sp
+	std::vector<status_data*> status;
+	std::vector<status_change*> sc;
+	std::vector<struct unit_data*> ud;
+	std::vector<map_session_data*> sd;
+	std::unordered_map<int32, size_t> index; ///< Unit id -> row
+	bool iterating; ///< Rows are only cleared while the timer walks the table
+	bool holes; ///< Cleared rows that still have to be compacted
+} regen_table;
+
+/**
+ * Adds a unit to the natural heal table.
+ * @param bl: Object to add [PC|HOM|MER|ELEM]
+ */
+void status_regen_add(block_list* bl)
+{
+	nullpo_retv(bl);
+
+	struct regen_data* regen = status_get_regen_data(bl);
+
+	if (regen == nullptr)
+		return;
+
+	auto it = regen_table.index.find(bl->id);
+	size_t row;
+
+	if (it != regen_table.index.end()) {
+		row = it->second;
+	} else {
+		row = regen_table.bl.size();
+		regen_table.bl.push_back(nullptr);
+		regen_table.regen.push_back(nullptr);
+		regen_table.flag.push_back(RGN_NONE);
+		regen_table.hp.push_back(0);
+		regen_table.sp.push_back(0);
+		regen_table.rate_hp.push_back(0);
+		regen_table.rate_sp.push_back(0);
+		regen_table.status.push_back(nullptr);
+		regen_table.sc.push_back(nullptr);
+		regen_table.ud.push_back(nullptr);
+		regen_table.sd.push_back(nullptr);
+		regen_table.index[bl->id] = row;
+	}
+
+	regen_table.bl[row] = bl;
+	regen_table.regen[row] = regen;
+	regen_table.status[row] = status_get_status_data(*bl);
+	regen_table.sc[row] = status_get_sc(bl);
+	regen_table.ud[row] = unit_bl2ud(bl);
+	regen_table.sd[row] = BL_CAST(BL_PC, bl);
+	status_regen_refresh(bl, regen);
+}
+
+/**
+ * Copies the regeneration inputs of a unit into its row of the natural heal table.
+ * @param bl: Object whose regeneration was recalculated [PC|HOM|MER|ELEM]
+ * @param regen: Regeneration data of the object
+ */
+static void status_regen_refresh(block_list* bl, struct regen_data* regen)
+{
+	auto it = regen_table.index.find(bl->id);
+
+	if (it == regen_table.index.end() || regen_table.regen[it->second] != regen)
+		return;
+
+	size_t row = it->second;
+
+	regen_table.flag[row] = regen->flag;
+	regen_table.hp[row] = regen->hp;
+	regen_table.sp[row] = regen->sp;
+	regen_table.rate_hp[row] = regen->rate.hp;
+	regen_table.rate_sp[row] = regen->rate.sp;
+}
+
+/**
+ * Moves the last row of the natural heal table into the given row.
+ */
+static void status_regen_move_last(size_t row)
+{
+	size_t last = regen_table.bl.size() - 1;
+
+	if (row != last) {
+		regen_table.bl[row] = regen_table.bl[last];
+		regen_table.regen[row] = regen_table.regen[last];
+		regen_table.flag[row] = regen_table.flag[last];
+		regen_table.hp[row] = regen_table.hp[last];
+		regen_table.sp[row] = regen_table.sp[last];
+		regen_table.rate_hp[row] = regen_table.rate_hp[last];
+		regen_table.rate_sp[row] = regen_table.rate_sp[last];
+		regen_table.status[row] = regen_table.status[last];
+		regen_table.sc[row] = regen_table.sc[last];
+		regen_table.ud[row] = regen_table.ud[last];
+		regen_table.sd[row] = regen_table.sd[last];
+
+		if (regen_table.bl[row] != nullptr)
+			regen_table.index[regen_table.bl[row]->id] = row;
+	}
+
+	regen_table.bl.pop_back();
+	regen_table.regen.pop_back();
+	regen_table.flag.pop_back();
+	regen_table.hp.pop_back();
+	regen_table.sp.pop_back();
+	regen_table.rate_hp.pop_back();
+	regen_table.rate_sp.pop_back();
+	regen_table.status.pop_back();
+	regen_table.sc.pop_back();
+	regen_table.ud.pop_back();
+	regen_table.sd.pop_back();
+}
+
+/**
+ * Removes a unit from the natural heal table.
+ * Units can be removed by the heal timer itself (a player dying from bleeding),
+ * so the row is only cleared in that case and compacted once the timer is done.
+ * @param bl: Object to remove [PC|HOM|MER|ELEM]
+ */
+void status_regen_remove(block_list* bl)
+{
+	nullpo_retv(bl);
+
+	auto it = regen_table.index.find(bl->id);
+
+	if (it == regen_table.index.end() || regen_table.bl[it->second] != bl)
+		return;
+
+	size_t row = it->second;
+
+	regen_table.index.erase(it);
+
+	if (regen_table.iterating) {
+		regen_table.bl[row] = nullptr;
+		regen_table.holes = true;
+		return;
+	}
+
+	status_regen_move_last(row);
+}
+
+/**
+ * Removes the rows that were cleared while the heal timer walked the table.
+ */
+static void status_regen_compact(void)
+{
+	for (size_t row = regen_table.bl.size(); row > 0; row--) {
+		if (regen_table.bl[row - 1] == nullptr)
+			status_regen_move_last(row - 1);
+	}
+
+	regen_table.holes = false;
+}
+
 /**
  * Applying natural heal bonuses (sit, skill, homun, etc...)
- * TODO: the va_list doesn't seem to be used, safe to remove?
- * @param bl: Object applying bonuses to [PC|HOM|MER|ELEM]
- * @param args: va_list arguments
+ * @param row: Row of the object in the natural heal table [PC|HOM|MER|ELEM]
  * @return which regeneration bonuses have been applied (flag)
  */
 static t_tick natural_heal_prev_tick,natural_heal_diff_tick;
-static int32 status_natural_heal(block_list* bl, va_list args)
+static int32 status_natural_heal(size_t row)
 {
-	struct regen_data *regen;
-	status_change *sc;
-	struct unit_data *ud;
+	block_list* bl = regen_table.bl[row];
+	struct regen_data *regen = regen_table.regen[row];
+	status_data* status = regen_table.status[row];
+	status_change *sc = regen_table.sc[row];
+	struct unit_data *ud = regen_table.ud[row];
+	map_session_data *sd = regen_table.sd[row];
+	uint16 regen_hp = regen_table.hp[row], regen_sp = regen_table.sp[row];
 	struct view_data *vd = nullptr;
 	struct regen_data_sub *sregen;
-	map_session_data *sd;
 	int32 rate, multi = 1, flag;
 
-	regen = status_get_regen_data(bl);
-	if (!regen)
-		return 0;
-
-	status_data* status = status_get_status_data(*bl);
-
-	sc = status_get_sc(bl);
 	if (sc != nullptr && sc->empty())
 		sc = nullptr;
-	sd = BL_CAST(BL_PC,bl);
 
-	flag = regen->flag;
+	flag = regen_table.flag[row];
 	if (flag&RGN_HP && (regen->state.block&1))
 		flag &= ~(RGN_HP|RGN_SHP);
 	if (flag&RGN_SP && (regen->state.block&2))
@@ -15725,8 +16036,6 @@ static int32 status_natural_heal(block_list* bl, va_list args)
 	if (flag && regen->state.overweight)
 		flag = RGN_NONE;
 
-	ud = unit_bl2ud(bl);
-
 	if (ud && ud->walktimer != INVALID_TIMER) {
 		flag &= ~(RGN_SHP|RGN_SSP);
 		//Mercenaries recover HP even while walking
@@ -15749,7 +16058,7 @@ static int32 status_natural_heal(block_list* bl, va_list args)
 	// Natural Hp regen
 	if (flag&RGN_HP) {
 		// Interval to next recovery tick
-		rate = (int32)(battle_config.natural_healhp_interval / (regen->rate.hp/100. * multi));
+		rate = (int32)(battle_config.natural_healhp_interval / (regen_table.rate_hp[row]/100. * multi));
 		// Half recovery while moving only applies to players with certain traits
 		if (sd && ud && ud->walktimer != INVALID_TIMER)
 			rate *= 2;
@@ -15767,7 +16076,7 @@ static int32 status_natural_heal(block_list* bl, va_list args)
 			regen->tick.hp = natural_heal_prev_tick;
 			if (status->hp >= status->max_hp)
 				flag &= ~(RGN_HP | RGN_SHP);
-			else if (status_heal(bl, regen->hp, 0, 1) < regen->hp)
+			else if (status_heal(bl, regen_hp, 0, 1) < regen_hp)
 				flag &= ~RGN_SHP; // Full
 		}
 	}
@@ -15778,7 +16087,7 @@ static int32 status_natural_heal(block_list* bl, va_list args)
 	// Natural SP regen
 	if(flag&RGN_SP) {
 		// Interval to next recovery tick
-		rate = (int32)(battle_config.natural_healsp_interval / (regen->rate.sp/100. * multi));
+		rate = (int32)(battle_config.natural_healsp_interval / (regen_table.rate_sp[row]/100. * multi));
 		// Homun SP regen fix (4 seconds instead of 8 seconds)
 		if(bl->type==BL_HOM)
 			rate /= 2;
@@ -15798,7 +16107,7 @@ static int32 status_natural_heal(block_list* bl, va_list args)
 			regen->tick.sp = natural_heal_prev_tick;
 			if (status->sp >= status->max_sp)
 				flag &= ~(RGN_SP | RGN_SSP);
-			else if (status_heal(bl, 0, regen->sp, 1) < regen->sp)
+			else if (status_heal(bl, 0, regen_sp, 1) < regen_sp)
 				flag &= ~RGN_SSP; // Full
 		}
 	}
@@ -15859,7 +16168,29 @@ static int32 status_natural_heal(block_list* bl, va_list args)
 static TIMER_FUNC(status_natural_heal_timer){
 	natural_heal_diff_tick = DIFF_TICK(tick,natural_heal_prev_tick);
 	natural_heal_prev_tick = tick;
-	map_foreachregen(status_natural_heal);
+
+	regen_table.iterating = true;
+
+	// Rows added by the heal itself are processed as well
+	for (size_t row = 0; row < regen_table.bl.size(); row++) {
+		if (regen_table.bl[row] == nullptr)
+			continue;
+
+		if (regen_table.flag[row] != RGN_NONE || regen_table.sd[row] != nullptr) {
+			status_natural_heal(row);
+			continue;
+		}
+
+		// Nothing to recover, only keep the ticks current
+		regen_table.regen[row]->tick.hp = tick;
+		regen_table.regen[row]->tick.sp = tick;
+	}
+
+	regen_table.iterating = false;
+
+	if (regen_table.holes)
+		status_regen_compact();
+
 	return 0;
 }
 
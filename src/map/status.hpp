@@ -8,6 +8,7 @@
 #include <bitset>
 #include <memory>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <common/database.hpp>
@@ -3579,12 +3580,15 @@ public:
 #ifndef RENEWAL
 	unsigned char sg_counter; //Storm gust counter (previous hits from storm gust)
 #endif
+	std::vector<std::pair<t_tick, enum sc_type>> timeline; // Pending timer events of the status changes, sorted by tick
+	int32 timeline_timer; // Global timer for the earliest event of the timeline
 private:
 	std::unordered_map<enum sc_type, status_change_entry> data;
 	std::pair<enum sc_type, status_change_entry*> lastStatus; // last-fetched status
 
 public:
 	status_change();
+	~status_change();
 
 	bool hasSCE( enum sc_type type );
 	status_change_entry* getSCE( enum sc_type type );
@@ -3742,6 +3746,9 @@ static bool sc_start4(block_list *src, block_list *bl, sc_type type, int32 rate,
 }
 int32 status_change_end(block_list* bl, enum sc_type type, int32 tid = INVALID_TIMER);
 TIMER_FUNC(status_change_timer);
+int32 status_change_add_timer(block_list& bl, enum sc_type type, t_tick tick);
+void status_change_delete_timer(status_change& sc, enum sc_type type);
+t_tick status_change_get_timer_tick(status_change& sc, enum sc_type type);
 int32 status_change_timer_sub(block_list* bl, va_list ap);
 int32 status_change_clear(block_list* bl, int32 type);
 void status_change_clear_buffs(block_list* bl, uint8 type);
@@ -3781,6 +3788,8 @@ static void status_calc_bl(block_list *bl, std::vector<e_scb_flag> flags) {
 void status_calc_misc(block_list *bl, struct status_data *status, int32 level);
 void status_calc_regen(block_list *bl, struct status_data *status, struct regen_data *regen);
 void status_calc_regen_rate(block_list *bl, struct regen_data *regen, status_change *sc);
+void status_regen_add(block_list* bl);
+void status_regen_remove(block_list* bl);
 void status_calc_state(block_list *bl, status_change *sc, std::bitset<SCS_MAX> flag, bool start);
 
 void status_calc_slave_mode(mob_data& md);
@@ -0,0 +1,590 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <unordered_map>
+#include <vector>
+
+#include <common/core.hpp>
+#include <common/ers.hpp>
+#include <common/malloc.hpp>
+#include <common/profiler.hpp>
+#include <common/random.hpp>
+#include <common/showmsg.hpp>
+#include <common/socket.hpp>
+#include <common/strlib.hpp>
+
+#include "chrif.hpp"
+#include "clif.hpp"
+#include "pc.hpp"
+
+/// Magic bytes at the start of every trace file
+static const char trace_magic[4] = { 'R', 'A', 'T', 'R' };
+static const uint16 trace_version = 1;
+
+struct s_trace_config trace_config = { false, "log/packet_trace.bin" };
+bool trace_recording = false;
+
+/// Recording
+static FILE* trace_out = nullptr;
+static t_tick trace_last_tick = 0;
+static uint32 trace_next_session = 0;
+/// Session id of every traced client fd, 0 if the fd is not traced
+static uint32 trace_sessions[MAXCONN];
+
+/// A record read from a trace
+struct s_trace_record{
+	e_trace_record type;
+	t_tick tick;
+	uint32 session;
+	uint32 ip;
+	std::vector<uint8> data;
+};
+
+/// Replay
+static const char* trace_replay_file = nullptr;
+static uint32 trace_replay_seed = 0;
+static FILE* trace_in = nullptr;
+static s_trace_record trace_next;
+static bool trace_next_valid = false;
+static int32 trace_char_fd = -1;
+/// Session id of the trace -> fd of the virtual session
+static std::unordered_map<uint32, int32> trace_replay_sessions;
+
+static struct{
+	uint64 records;
+	uint64 packets;
+	uint64 server_packets;
+	uint64 sessions;
+	uint64 skipped;
+	uint64 bytes_sent;
+	t_tick tick_start;
+	uint64 wall_start;
+	std::clock_t cpu_start;
+	size_t memory_start;
+	uint64 allocs_start;
+} trace_stats;
+
+/*==========================================
+ * Recording
+ *------------------------------------------*/
+
+static void trace_write( const void* data, size_t length ){
+	if( trace_out == nullptr ){
+		return;
+	}
+
+	if( fwrite( data, 1, length, trace_out ) != length ){
+		ShowError( "trace_write: Failed to write to the packet trace, recording stopped.\n" );
+		trace_record_stop();
+	}
+}
+
+/// Encodes a value with 7 bits per byte, the high bit marks that more bytes follow
+static size_t trace_varint( uint8* buf, uint64 value ){
+	size_t length = 0;
+
+	while( value >= 0x80 ){
+		buf[length++] = static_cast<uint8>( value | 0x80 );
+		value >>= 7;
+	}
+
+	buf[length++] = static_cast<uint8>( value );
+
+	return length;
+}
+
+/**
+ * Write a record.
+ * @param data: payload of the record, nullptr if it has none
+ */
+static void trace_write_record( e_trace_record type, uint32 session, const uint8* data, int32 length ){
+	uint8 buf[1 + 10 + 5 + 5];
+	size_t pos = 0;
+	t_tick now = gettick();
+
+	buf[pos++] = type;
+	pos += trace_varint( buf + pos, static_cast<uint64>( std::max<t_tick>( 0, now - trace_last_tick ) ) );
+	pos += trace_varint( buf + pos, session );
+
+	if( data != nullptr ){
+		pos += trace_varint( buf + pos, static_cast<uint32>( length ) );
+	}
+
+	trace_last_tick = now;
+	trace_write( buf, pos );
+
+	if( data != nullptr ){
+		trace_write( data, length );
+	}
+}
+
+/**
+ * Start recording the client and char-server traffic into a file.
+ * Clients that are already connected are not recorded.
+ */
+bool trace_record_start( const char* file ){
+	if( trace_recording ){
+		return true;
+	}
+
+	if( trace_replaying() ){
+		ShowError( "trace_record_start: Cannot record while a trace is replayed.\n" );
+		return false;
+	}
+
+	trace_out = fopen( file, "wb" );
+
+	if( trace_out == nullptr ){
+		ShowError( "trace_record_start: Cannot open '%s' for writing.\n", file );
+		return false;
+	}
+
+	setvbuf( trace_out, nullptr, _IOFBF, 64 * 1024 );
+
+	uint16 flags = 0;
+	int32 packetver = PACKETVER;
+	int64 start = gettick();
+
+	trace_write( trace_magic, sizeof( trace_magic ) );
+	trace_write( &trace_version, sizeof( trace_version ) );
+	trace_write( &flags, sizeof( flags ) );
+	trace_write( &packetver, sizeof( packetver ) );
+	trace_write( &start, sizeof( start ) );
+
+	if( trace_out == nullptr ){
+		return false;
+	}
+
+	trace_last_tick = start;
+	trace_next_session = 0;
+	memset( trace_sessions, 0, sizeof( trace_sessions ) );
+	trace_recording = true;
+
+	ShowStatus( "Recording the packet trace to '" CL_WHITE "%s" CL_RESET "'.\n", file );
+
+	return true;
+}
+
+void trace_record_stop(){
+	if( trace_out == nullptr ){
+		return;
+	}
+
+	fclose( trace_out );
+	trace_out = nullptr;
+	trace_recording = false;
+
+	ShowStatus( "Stopped recording the packet trace (%u sessions).\n", trace_next_session );
+}
+
+/**
+ * Record a packet of a client, called right before its handler.
+ * @param connecting: the session has no player yet, a new trace session is started for untraced fds
+ */
+void trace_record_packet( int32 fd, const uint8* data, int32 length, bool connecting ){
+	if( !trace_recording || fd <= 0 || fd >= MAXCONN ){
+		return;
+	}
+
+	if( trace_sessions[fd] == 0 ){
+		// Connected before the recording started
+		if( !connecting ){
+			return;
+		}
+
+		uint32 ip = session[fd]->client_addr;
+
+		trace_sessions[fd] = ++trace_next_session;
+		trace_write_record( TRACE_CONNECT, trace_sessions[fd], nullptr, 0 );
+		trace_write( &ip, sizeof( ip ) );
+	}
+
+	trace_write_record( TRACE_PACKET, trace_sessions[fd], data, length );
+}
+
+void trace_record_close( int32 fd ){
+	if( !trace_recording || fd <= 0 || fd >= MAXCONN || trace_sessions[fd] == 0 ){
+		return;
+	}
+
+	trace_write_record( TRACE_CLOSE, trace_sessions[fd], nullptr, 0 );
+	trace_sessions[fd] = 0;
+}
+
+/**
+ * Record a packet of the char-server, called right before it is parsed.
+ */
+void trace_record_server( const uint8* data, int32 length ){
+	if( !trace_recording ){
+		return;
+	}
+
+	trace_write_record( TRACE_SERVER, 0, data, length );
+}
+
+/*==========================================
+ * Replay
+ *------------------------------------------*/
+
+/**
+ * Read the replay options from the command line.
+ * Consumed options are cleared, so that cli_get_options skips them.
+ */
+void trace_get_options( int32 argc, char** argv ){
+	for( int32 i = 1; i < argc; i++ ){
+		if( argv[i] == nullptr ){
+			continue;
+		}
+
+		if( strcmp( argv[i], "--replay" ) == 0 || strcmp( argv[i], "--replay-seed" ) == 0 ){
+			if( i + 1 >= argc || argv[i + 1] == nullptr ){
+				ShowError( "Missing value for option '%s'.\n", argv[i] );
+				exit( EXIT_FAILURE );
+			}
+
+			if( strcmp( argv[i], "--replay" ) == 0 ){
+				trace_replay_file = argv[i + 1];
+			}else{
+				trace_replay_seed = static_cast<uint32>( strtoul( argv[i + 1], nullptr, 10 ) );
+			}
+
+			argv[i] = nullptr;
+			argv[i + 1] = nullptr;
+			i++;
+		}
+	}
+}
+
+bool trace_replaying(){
+	return trace_replay_file != nullptr;
+}
+
+static bool trace_read( void* data, size_t length ){
+	return fread( data, 1, length, trace_in ) == length;
+}
+
+static bool trace_read_varint( uint64& value ){
+	value = 0;
+
+	for( uint32 shift = 0; shift < 64; shift += 7 ){
+		int32 c = fgetc( trace_in );
+
+		if( c == EOF ){
+			return false;
+		}
+
+		value |= static_cast<uint64>( c & 0x7f ) << shift;
+
+		if( ( c & 0x80 ) == 0 ){
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Read ahead the next record of the trace.
+ * @return false at the end of the trace or if it is corrupted
+ */
+static bool trace_read_record( s_trace_record& record ){
+	uint8 type;
+	uint64 delta, session, length;
+
+	if( !trace_read( &type, sizeof( type ) ) ){
+		return false;
+	}
+
+	if( type < TRACE_CONNECT || type > TRACE_SERVER || !trace_read_varint( delta ) || !trace_read_varint( session ) ){
+		ShowError( "trace_read_record: The packet trace is corrupted.\n" );
+		return false;
+	}
+
+	record.type = static_cast<e_trace_record>( type );
+	record.tick += static_cast<t_tick>( delta );
+	record.session = static_cast<uint32>( session );
+	record.data.clear();
+
+	switch( record.type ){
+		case TRACE_CONNECT:
+			if( !trace_read( &record.ip, sizeof( record.ip ) ) ){
+				ShowError( "trace_read_record: The packet trace is truncated.\n" );
+				return false;
+			}
+			break;
+		case TRACE_PACKET:
+		case TRACE_SERVER:
+			if( !trace_read_varint( length ) || length < 2 || length > 0xFFFF ){
+				ShowError( "trace_read_record: The packet trace is corrupted.\n" );
+				return false;
+			}
+
+			record.data.resize( static_cast<size_t>( length ) );
+
+			if( !trace_read( record.data.data(), record.data.size() ) ){
+				ShowError( "trace_read_record: The packet trace is truncated.\n" );
+				return false;
+			}
+			break;
+		default:
+			break;
+	}
+
+	return true;
+}
+
+/**
+ * Open the trace given on the command line.
+ * Stops the clock at the start of the trace and seeds the random generator, before any timer is added.
+ */
+bool trace_replay_open(){
+	if( !trace_replaying() ){
+		return true;
+	}
+
+	trace_in = fopen( trace_replay_file, "rb" );
+
+	if( trace_in == nullptr ){
+		ShowError( "trace_replay_open: Cannot open the packet trace '%s'.\n", trace_replay_file );
+		return false;
+	}
+
+	setvbuf( trace_in, nullptr, _IOFBF, 64 * 1024 );
+
+	char magic[4];
+	uint16 version, flags;
+	int32 packetver;
+	int64 start;
+
+	if( !trace_read( magic, sizeof( magic ) ) || memcmp( magic, trace_magic, sizeof( magic ) ) != 0
+		|| !trace_read( &version, sizeof( version ) ) || !trace_read( &flags, sizeof( flags ) )
+		|| !trace_read( &packetver, sizeof( packetver ) ) || !trace_read( &start, sizeof( start ) ) ){
+		ShowError( "trace_replay_open: '%s' is not a packet trace.\n", trace_replay_file );
+		return false;
+	}
+
+	if( version != trace_version ){
+		ShowError( "trace_replay_open: The packet trace has version %hu, but only version %hu is supported.\n", version, trace_version );
+		return false;
+	}
+
+	if( packetver != PACKETVER ){
+		ShowError( "trace_replay_open: The packet trace was recorded with PACKETVER %d, but the server was compiled with %d.\n", packetver, PACKETVER );
+		return false;
+	}
+
+	timer_set_virtual_tick( start );
+	rnd_seed( trace_replay_seed );
+
+	trace_next = {};
+	trace_next.tick = start;
+	trace_next_valid = trace_read_record( trace_next );
+
+	ShowStatus( "Replaying the packet trace '" CL_WHITE "%s" CL_RESET "' with seed %u.\n", trace_replay_file, trace_replay_seed );
+
+	return true;
+}
+
+/**
+ * Send function of the virtual sessions, the data is only counted.
+ */
+static int32 trace_replay_send( int32 fd ){
+	trace_stats.bytes_sent += session[fd]->wdata_size;
+	session[fd]->wdata_size = 0;
+
+	return 0;
+}
+
+/**
+ * Append data to the read buffer of a virtual session.
+ */
+static void trace_replay_feed( int32 fd, const std::vector<uint8>& data ){
+	socket_data* s = session[fd];
+
+	RFIFOFLUSH( fd );
+
+	if( s->max_rdata < s->rdata_size + data.size() ){
+		realloc_fifo( fd, static_cast<uint32>( s->rdata_size + data.size() ), static_cast<uint32>( s->max_wdata ) );
+	}
+
+	memcpy( s->rdata + s->rdata_size, data.data(), data.size() );
+	s->rdata_size += data.size();
+}
+
+static uint64 trace_replay_allocs(){
+	std::vector<s_ers_stats> stats;
+	uint64 allocs = 0;
+
+	ers_stats( stats );
+
+	for( const s_ers_stats& entry : stats ){
+		allocs += entry.allocs;
+	}
+
+	return allocs;
+}
+
+/**
+ * Called once the server is initialized.
+ * Creates the virtual char-server link and takes the baseline of the report.
+ */
+void trace_replay_start(){
+	if( !trace_replaying() ){
+		return;
+	}
+
+	trace_char_fd = make_virtual_session( trace_replay_send, nullptr );
+
+	if( trace_char_fd == -1 ){
+		ShowFatalError( "trace_replay_start: Cannot create the char-server session.\n" );
+		exit( EXIT_FAILURE );
+	}
+
+	chrif_attach( trace_char_fd );
+	profiler_set_enabled( true );
+
+	trace_stats = {};
+	trace_stats.tick_start = gettick();
+	trace_stats.wall_start = profiler_clock();
+	trace_stats.cpu_start = std::clock();
+	trace_stats.memory_start = malloc_usage();
+	trace_stats.allocs_start = trace_replay_allocs();
+}
+
+/**
+ * Deliver a record to the server.
+ */
+static void trace_replay_record( s_trace_record& record ){
+	trace_stats.records++;
+
+	switch( record.type ){
+		case TRACE_CONNECT: {
+			int32 fd = make_virtual_session( trace_replay_send, clif_parse );
+
+			if( fd == -1 ){
+				trace_stats.skipped++;
+				return;
+			}
+
+			session[fd]->client_addr = record.ip;
+			trace_replay_sessions[record.session] = fd;
+			trace_stats.sessions++;
+		} break;
+		case TRACE_PACKET: {
+			auto it = trace_replay_sessions.find( record.session );
+
+			if( it == trace_replay_sessions.end() || !session_isActive( it->second ) ){
+				trace_stats.skipped++;
+				return;
+			}
+
+			int32 fd = it->second;
+			int32 cmd = WBUFW( record.data.data(), 0 );
+
+			if( cmd < MIN_PACKET_DB || cmd > MAX_PACKET_DB || packet_db[cmd].len == 0 ){
+				trace_stats.skipped++;
+				return;
+			}
+
+			trace_replay_feed( fd, record.data );
+			clif_parse_packet( fd, static_cast<map_session_data*>( session[fd]->session_data ), cmd, static_cast<int32>( record.data.size() ) );
+			trace_stats.packets++;
+		} break;
+		case TRACE_CLOSE: {
+			auto it = trace_replay_sessions.find( record.session );
+
+			if( it == trace_replay_sessions.end() ){
+				trace_stats.skipped++;
+				return;
+			}
+
+			set_eof( it->second );
+			trace_replay_sessions.erase( it );
+		} break;
+		case TRACE_SERVER:
+			if( !session_isActive( trace_char_fd ) ){
+				trace_stats.skipped++;
+				return;
+			}
+
+			trace_replay_feed( trace_char_fd, record.data );
+			session[trace_char_fd]->func_parse( trace_char_fd );
+			trace_stats.server_packets++;
+			break;
+	}
+}
+
+/**
+ * Print the summary of the replay.
+ */
+static void trace_replay_report(){
+	uint64 wall = profiler_clock() - trace_stats.wall_start;
+	double cpu = static_cast<double>( std::clock() - trace_stats.cpu_start ) / CLOCKS_PER_SEC;
+	int64 memory = static_cast<int64>( malloc_usage() ) - static_cast<int64>( trace_stats.memory_start );
+
+	ShowStatus( "Replay of '" CL_WHITE "%s" CL_RESET "' finished.\n", trace_replay_file );
+	ShowInfo( "Records: %" PRIu64 " (%" PRIu64 " client packets, %" PRIu64 " char-server packets, %" PRIu64 " skipped), %" PRIu64 " sessions.\n",
+		trace_stats.records, trace_stats.packets, trace_stats.server_packets, trace_stats.skipped, trace_stats.sessions );
+	ShowInfo( "Recorded duration: %" PRtf " ms, wall time: %" PRIu64 " ms, CPU time: %.3f s.\n",
+		gettick() - trace_stats.tick_start, wall / 1000, cpu );
+	ShowInfo( "ERS allocations: %" PRIu64 ", memory: %+" PRId64 " KB, sent: %" PRIu64 " bytes.\n",
+		trace_replay_allocs() - trace_stats.allocs_start, memory, trace_stats.bytes_sent );
+
+	profiler_dump( 20, []( const char* line ){
+		ShowInfo( "%s\n", line );
+	} );
+}
+
+/**
+ * Replaces the socket handling of the main loop while replaying.
+ * Advances the clock to the next timer or record and delivers every record that is due.
+ * @param next: milliseconds until the next timer
+ */
+void trace_replay_step( t_tick next ){
+	t_tick target = gettick() + std::max<t_tick>( next, 1 );
+
+	if( trace_next_valid && trace_next.tick < target ){
+		target = trace_next.tick;
+	}
+
+	timer_set_virtual_tick( std::max( target, gettick() ) );
+
+	while( trace_next_valid && trace_next.tick <= gettick() ){
+		trace_replay_record( trace_next );
+		trace_next_valid = trace_read_record( trace_next );
+	}
+
+	send_shortlist_do_sends();
+
+	if( !trace_next_valid && trace_in != nullptr ){
+		fclose( trace_in );
+		trace_in = nullptr;
+
+		trace_replay_report();
+		global_core->signal_shutdown();
+	}
+}
+
+void do_init_trace(){
+	if( trace_config.enabled && !trace_replaying() ){
+		trace_record_start( trace_config.file );
+	}
+}
+
+void do_final_trace(){
+	trace_record_stop();
+
+	if( trace_in != nullptr ){
+		fclose( trace_in );
+		trace_in = nullptr;
+	}
+
+	trace_replay_sessions.clear();
+}
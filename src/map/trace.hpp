@@ -0,0 +1,42 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <common/cbasetypes.hpp>
+#include <common/mmo.hpp>
+#include <common/timer.hpp>
+
+/// Kind of a record in a packet trace
+enum e_trace_record : uint8{
+	TRACE_CONNECT = 1, ///< A client connected, followed by its ip
+	TRACE_PACKET,      ///< A packet of a client, after its id was decrypted
+	TRACE_CLOSE,       ///< A client disconnected
+	TRACE_SERVER,      ///< A packet of the char-server
+};
+
+struct s_trace_config{
+	bool enabled; ///< Start recording when the server starts
+	char file[256];
+};
+
+extern struct s_trace_config trace_config;
+extern bool trace_recording;
+
+bool trace_record_start( const char* file );
+void trace_record_stop();
+void trace_record_packet( int32 fd, const uint8* data, int32 length, bool connecting );
+void trace_record_close( int32 fd );
+void trace_record_server( const uint8* data, int32 length );
+
+void trace_get_options( int32 argc, char** argv );
+bool trace_replaying();
+bool trace_replay_open();
+void trace_replay_start();
+void trace_replay_step( t_tick next );
+
+void do_init_trace();
+void do_final_trace();
+
+#endif /* TRACE_HPP */
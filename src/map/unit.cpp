@@ -3923,14 +3923,7 @@ int32 unit_free(block_list *bl, clr_type clrtype)
 	if( bl->prev )	// Players are supposed to logout with a "warp" effect.
 		unit_remove_map(bl, clrtype);
 
-		struct s_unit_common_data* ucd = nullptr;
-		if ((ucd = status_get_ucd(bl)) != nullptr) {
-			for (auto &it : ucd->aura.effects) {
-				if (it->replay_tid == INVALID_TIMER) continue;
-				delete_timer(it->replay_tid, aura_effects_timer);
-				it->replay_tid = INVALID_TIMER;
-			}
-		}
+	aura_effects_unschedule(bl);
 
 	switch( bl->type ) {
 		case BL_PC: {
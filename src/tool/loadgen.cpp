@@ -0,0 +1,545 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#include "loadgen.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+#include <common/cli.hpp>
+#include <common/core.hpp>
+#include <common/profiler.hpp>
+#include <common/random.hpp>
+#include <common/showmsg.hpp>
+#include <common/socket.hpp>
+#include <common/strlib.hpp>
+
+using namespace rathena::server_core;
+
+s_loadgen_config loadgen_config;
+
+static std::vector<s_loadgen_bot> loadgen_bots;
+static std::unordered_map<int32, s_loadgen_bot*> loadgen_sessions;
+static uint32 loadgen_started = 0;
+static t_tick loadgen_start_tick = 0;
+
+/// Latencies of one kind of request
+struct s_loadgen_stats{
+	uint64 count;
+	uint64 total; ///< Cumulative latency in microseconds
+	uint64 max;
+	uint64 timeouts;
+	uint64 histogram[PROFILER_HISTOGRAM_BUCKETS];
+};
+
+/// Everything that happened since the start of a report period
+struct s_loadgen_report{
+	t_tick start;
+	s_loadgen_stats requests[LOADGEN_REQ_MAX];
+	uint64 packets;
+	uint64 bytes;
+	std::unordered_map<std::string, uint64> failures;
+};
+
+/// Reports of the current interval and of the whole run
+static s_loadgen_report loadgen_interval, loadgen_total;
+
+static const char* loadgen_request_names[LOADGEN_REQ_MAX] = {
+	"login", "char enter", "char make", "char select", "map enter", "ping", "walk", "chat", "attack", "skill", "vending"
+};
+
+static TIMER_FUNC(loadgen_think_timer);
+static TIMER_FUNC(loadgen_reconnect_timer);
+
+s_loadgen_bot* loadgen_bot( int32 fd ){
+	auto it = loadgen_sessions.find( fd );
+
+	if( it == loadgen_sessions.end() ){
+		return nullptr;
+	}
+
+	return it->second;
+}
+
+/**
+ * Bind a bot to a new connection.
+ * @param func: parser of the packets the server sends on this connection
+ */
+void loadgen_bot_attach( s_loadgen_bot& bot, int32 fd, e_loadgen_phase phase, int32 (*func)( int32 fd ) ){
+	session[fd]->func_parse = func;
+	loadgen_sessions[fd] = &bot;
+	bot.fd = fd;
+	bot.phase = phase;
+}
+
+/**
+ * Close the connection of a bot, e.g. when it moves on to the next server.
+ */
+void loadgen_bot_detach( s_loadgen_bot& bot ){
+	if( bot.fd > 0 ){
+		loadgen_sessions.erase( bot.fd );
+
+		if( session_isValid( bot.fd ) ){
+			do_close( bot.fd );
+		}
+	}
+
+	bot.fd = -1;
+	bot.phase = LOADGEN_PHASE_NONE;
+	bot.online = false;
+}
+
+/**
+ * Drop the connection of a bot after an error and log in again after a few seconds.
+ * @param reason: counted in the reports
+ */
+void loadgen_bot_fail( s_loadgen_bot& bot, const char* reason ){
+	loadgen_interval.failures[reason]++;
+
+	if( loadgen_total.failures[reason]++ == 0 ){
+		ShowWarning( "Bot %u (%s): %s.\n", bot.index, bot.userid, reason );
+	}
+
+	loadgen_bot_detach( bot );
+
+	std::fill( std::begin( bot.pending ), std::end( bot.pending ), 0 );
+	bot.monsters.clear();
+	bot.vendors.clear();
+
+	// A pending think timer notices that it was replaced and does nothing
+	bot.timer = add_timer( gettick() + rnd_value( 1000, 5000 ), loadgen_reconnect_timer, 0, bot.index );
+}
+
+/**
+ * The bot finished loading the map and starts acting on its own.
+ */
+void loadgen_bot_online( s_loadgen_bot& bot ){
+	bot.online = true;
+
+	if( bot.timer == INVALID_TIMER ){
+		bot.timer = add_timer( gettick() + rnd_value<uint32>( 0, loadgen_config.think * 2 ), loadgen_think_timer, 0, bot.index );
+	}
+}
+
+void loadgen_request_begin( s_loadgen_bot& bot, e_loadgen_request request ){
+	bot.pending[request] = profiler_clock();
+}
+
+static void loadgen_stats_record( s_loadgen_stats& stats, uint64 duration ){
+	size_t bucket = 0;
+
+	while( bucket < PROFILER_HISTOGRAM_BUCKETS - 1 && ( 1ULL << bucket ) <= duration ){
+		bucket++;
+	}
+
+	stats.count++;
+	stats.total += duration;
+	stats.max = std::max( stats.max, duration );
+	stats.histogram[bucket]++;
+}
+
+/**
+ * The server answered a request, record its latency.
+ * Responses to requests that are not pending (e.g. pushed by the server) are ignored.
+ */
+void loadgen_request_end( s_loadgen_bot& bot, e_loadgen_request request ){
+	if( bot.pending[request] == 0 ){
+		return;
+	}
+
+	uint64 duration = profiler_clock() - bot.pending[request];
+
+	bot.pending[request] = 0;
+
+	loadgen_stats_record( loadgen_interval.requests[request], duration );
+	loadgen_stats_record( loadgen_total.requests[request], duration );
+}
+
+void loadgen_traffic( size_t packets, size_t bytes ){
+	loadgen_interval.packets += packets;
+	loadgen_interval.bytes += bytes;
+	loadgen_total.packets += packets;
+	loadgen_total.bytes += bytes;
+}
+
+/**
+ * Upper bound of the bucket that contains the given percentile.
+ * @see profiler_percentile
+ */
+static uint64 loadgen_percentile( const s_loadgen_stats& stats, uint32 percentile ){
+	uint64 target = ( stats.count * percentile + 99 ) / 100;
+	uint64 seen = 0;
+
+	for( size_t i = 0; i < PROFILER_HISTOGRAM_BUCKETS; i++ ){
+		seen += stats.histogram[i];
+
+		if( seen >= target ){
+			return std::min<uint64>( 1ULL << i, stats.max );
+		}
+	}
+
+	return stats.max;
+}
+
+static void loadgen_report( s_loadgen_report& report, const char* title ){
+	uint64 elapsed = std::max<uint64>( DIFF_TICK( gettick(), report.start ), 1 );
+	uint32 online = 0;
+
+	for( const s_loadgen_bot& bot : loadgen_bots ){
+		if( bot.online ){
+			online++;
+		}
+	}
+
+	ShowInfo( "%s: %u/%u bots online, %" PRIu64 " packets/s, %" PRIu64 " KB/s received.\n", title, online, loadgen_started, report.packets * 1000 / elapsed, report.bytes * 1000 / 1024 / elapsed );
+
+	for( size_t i = 0; i < LOADGEN_REQ_MAX; i++ ){
+		const s_loadgen_stats& stats = report.requests[i];
+
+		if( stats.count == 0 && stats.timeouts == 0 ){
+			continue;
+		}
+
+		ShowInfo( "  [%s] %" PRIu64 " responses (%" PRIu64 "/s), %" PRIu64 " us avg, %" PRIu64 " us p50, %" PRIu64 " us p99, %" PRIu64 " us max, %" PRIu64 " timeouts\n",
+			loadgen_request_names[i], stats.count, stats.count * 1000 / elapsed, stats.count > 0 ? stats.total / stats.count : 0, loadgen_percentile( stats, 50 ), loadgen_percentile( stats, 99 ), stats.max, stats.timeouts );
+	}
+
+	for( const auto& pair : report.failures ){
+		ShowInfo( "  [failure] %s: %" PRIu64 "\n", pair.first.c_str(), pair.second );
+	}
+}
+
+static void loadgen_report_reset( s_loadgen_report& report ){
+	report.start = gettick();
+	std::fill( std::begin( report.requests ), std::end( report.requests ), s_loadgen_stats{} );
+	report.packets = 0;
+	report.bytes = 0;
+	report.failures.clear();
+}
+
+/**
+ * Periodic report of the latencies and the throughput since the last report.
+ */
+static TIMER_FUNC(loadgen_report_timer){
+	loadgen_report( loadgen_interval, "Load" );
+	loadgen_report_reset( loadgen_interval );
+
+	return 0;
+}
+
+/**
+ * Start the next bots, spread evenly over each second.
+ */
+static TIMER_FUNC(loadgen_spawn_timer){
+	uint64 due = static_cast<uint64>( DIFF_TICK( tick, loadgen_start_tick ) ) * loadgen_config.rate / 1000 + 1;
+
+	while( loadgen_started < loadgen_config.bots && loadgen_started < due ){
+		s_loadgen_bot& bot = loadgen_bots[loadgen_started++];
+
+		if( !loadgen_login_connect( bot ) ){
+			loadgen_bot_fail( bot, "cannot connect to the login-server" );
+		}
+	}
+
+	if( loadgen_started < loadgen_config.bots ){
+		add_timer( tick + 100, loadgen_spawn_timer, 0, 0 );
+	}else{
+		ShowStatus( "All %u bots have been started.\n", loadgen_started );
+	}
+
+	return 0;
+}
+
+static TIMER_FUNC(loadgen_reconnect_timer){
+	s_loadgen_bot& bot = loadgen_bots[data];
+
+	if( bot.timer != tid ){
+		return 0;
+	}
+
+	bot.timer = INVALID_TIMER;
+
+	if( !loadgen_login_connect( bot ) ){
+		loadgen_bot_fail( bot, "cannot connect to the login-server" );
+	}
+
+	return 0;
+}
+
+static TIMER_FUNC(loadgen_think_timer){
+	s_loadgen_bot& bot = loadgen_bots[data];
+
+	if( bot.timer != tid ){
+		return 0;
+	}
+
+	bot.timer = INVALID_TIMER;
+
+	if( !bot.online ){
+		return 0;
+	}
+
+	loadgen_map_think( bot );
+
+	// The bot might have been disconnected while acting
+	if( bot.online && bot.timer == INVALID_TIMER ){
+		bot.timer = add_timer( tick + rnd_value<uint32>( loadgen_config.think / 2, loadgen_config.think * 3 / 2 ), loadgen_think_timer, 0, bot.index );
+	}
+
+	return 0;
+}
+
+/**
+ * Count requests without a response in time.
+ * Bots stuck while connecting are disconnected and start over.
+ */
+static TIMER_FUNC(loadgen_timeout_timer){
+	uint64 now = profiler_clock();
+	uint64 timeout = loadgen_config.timeout * 1000ULL;
+
+	for( s_loadgen_bot& bot : loadgen_bots ){
+		for( size_t i = 0; i < LOADGEN_REQ_MAX; i++ ){
+			if( bot.pending[i] == 0 || now - bot.pending[i] < timeout ){
+				continue;
+			}
+
+			bot.pending[i] = 0;
+			loadgen_interval.requests[i].timeouts++;
+			loadgen_total.requests[i].timeouts++;
+
+			if( i <= LOADGEN_REQ_MAP_ENTER ){
+				loadgen_bot_fail( bot, "timed out while connecting" );
+				break;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static TIMER_FUNC(loadgen_stop_timer){
+	ShowStatus( "The duration of the run has passed, stopping.\n" );
+	global_core->signal_shutdown();
+
+	return 0;
+}
+
+/**
+ * Parse the names of the actions, separated by commas.
+ */
+static bool loadgen_parse_actions( const char* str ){
+	static const struct{
+		const char* name;
+		uint8 action;
+	} names[] = {
+		{ "walk", LOADGEN_ACTION_WALK },
+		{ "chat", LOADGEN_ACTION_CHAT },
+		{ "attack", LOADGEN_ACTION_ATTACK },
+		{ "skill", LOADGEN_ACTION_SKILL },
+		{ "vending", LOADGEN_ACTION_VENDING },
+		{ "all", LOADGEN_ACTION_ALL },
+		{ "none", 0 },
+	};
+	char buf[256];
+
+	safestrncpy( buf, str, sizeof( buf ) );
+	loadgen_config.actions = 0;
+
+	for( char* token = strtok( buf, "," ); token != nullptr; token = strtok( nullptr, "," ) ){
+		size_t i;
+
+		for( i = 0; i < ARRAYLENGTH( names ); i++ ){
+			if( strcmpi( token, names[i].name ) == 0 ){
+				loadgen_config.actions |= names[i].action;
+				break;
+			}
+		}
+
+		if( i == ARRAYLENGTH( names ) ){
+			ShowError( "Unknown action '%s'.\n", token );
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool loadgen_parse_options( int32 argc, char* argv[] ){
+	loadgen_config.login_ip = host2ip( "127.0.0.1" );
+	loadgen_config.login_port = 6900;
+	loadgen_config.bots = 100;
+	loadgen_config.rate = 50;
+	loadgen_config.duration = 0;
+	loadgen_config.account = "loadbot";
+	loadgen_config.password = "loadbot";
+	loadgen_config.first = 1;
+	loadgen_config.register_accounts = false;
+	loadgen_config.think = 1000;
+	loadgen_config.report = 10;
+	loadgen_config.timeout = 10000;
+	loadgen_config.actions = LOADGEN_ACTION_ALL;
+
+	for( int32 i = 1; i < argc; i++ ){
+		const char* arg = argv[i];
+
+		if( strcmp( arg, "--help" ) == 0 || strcmp( arg, "-h" ) == 0 || strcmp( arg, "-?" ) == 0 ){
+			display_helpscreen( true );
+		}else if( strcmp( arg, "--register" ) == 0 ){
+			loadgen_config.register_accounts = true;
+		}else if( !opt_has_next_value( arg, i, argc ) ){
+			ShowError( "Unknown option '%s'.\n", arg );
+			display_helpscreen( true );
+		}else if( strcmp( arg, "--login-ip" ) == 0 ){
+			loadgen_config.login_ip = host2ip( argv[++i] );
+		}else if( strcmp( arg, "--login-port" ) == 0 ){
+			loadgen_config.login_port = static_cast<uint16>( strtoul( argv[++i], nullptr, 10 ) );
+		}else if( strcmp( arg, "--bots" ) == 0 ){
+			loadgen_config.bots = strtoul( argv[++i], nullptr, 10 );
+		}else if( strcmp( arg, "--rate" ) == 0 ){
+			loadgen_config.rate = std::max<uint32>( strtoul( argv[++i], nullptr, 10 ), 1 );
+		}else if( strcmp( arg, "--duration" ) == 0 ){
+			loadgen_config.duration = strtoul( argv[++i], nullptr, 10 );
+		}else if( strcmp( arg, "--account" ) == 0 ){
+			loadgen_config.account = argv[++i];
+		}else if( strcmp( arg, "--password" ) == 0 ){
+			loadgen_config.password = argv[++i];
+		}else if( strcmp( arg, "--first" ) == 0 ){
+			loadgen_config.first = strtoul( argv[++i], nullptr, 10 );
+		}else if( strcmp( arg, "--think" ) == 0 ){
+			loadgen_config.think = std::max<uint32>( strtoul( argv[++i], nullptr, 10 ), 10 );
+		}else if( strcmp( arg, "--report" ) == 0 ){
+			loadgen_config.report = strtoul( argv[++i], nullptr, 10 );
+		}else if( strcmp( arg, "--timeout" ) == 0 ){
+			loadgen_config.timeout = std::max<uint32>( strtoul( argv[++i], nullptr, 10 ), 100 );
+		}else if( strcmp( arg, "--actions" ) == 0 ){
+			if( !loadgen_parse_actions( argv[++i] ) ){
+				return false;
+			}
+		}else{
+			ShowError( "Unknown option '%s'.\n", arg );
+			display_helpscreen( true );
+		}
+	}
+
+	if( loadgen_config.bots == 0 ){
+		ShowError( "At least one bot is required.\n" );
+		return false;
+	}
+
+	// Account names are limited to 23 characters, the registration suffix needs 2 of them
+	if( loadgen_config.account.length() + 10 > NAME_LENGTH - 3 ){
+		ShowError( "The account prefix '%s' is too long.\n", loadgen_config.account.c_str() );
+		return false;
+	}
+
+	if( loadgen_config.bots >= MAXCONN - 16 ){
+		ShowError( "At most %d bots are supported on this system.\n", MAXCONN - 16 );
+		return false;
+	}
+
+	return true;
+}
+
+class LoadgenTool : public Core{
+	protected:
+		bool initialize( int32 argc, char* argv[] ) override;
+		void finalize() override;
+
+	public:
+		LoadgenTool() : Core( e_core_type::TOOL ){
+
+		}
+};
+
+bool LoadgenTool::initialize( int32 argc, char* argv[] ){
+	if( !loadgen_parse_options( argc, argv ) ){
+		return false;
+	}
+
+	if( !loadgen_map_init() ){
+		return false;
+	}
+
+	add_timer_func_list( loadgen_spawn_timer, "loadgen_spawn_timer" );
+	add_timer_func_list( loadgen_reconnect_timer, "loadgen_reconnect_timer" );
+	add_timer_func_list( loadgen_think_timer, "loadgen_think_timer" );
+	add_timer_func_list( loadgen_report_timer, "loadgen_report_timer" );
+	add_timer_func_list( loadgen_timeout_timer, "loadgen_timeout_timer" );
+	add_timer_func_list( loadgen_stop_timer, "loadgen_stop_timer" );
+
+	// The bots are referenced by index and pointer, never grow the vector afterwards
+	loadgen_bots.resize( loadgen_config.bots );
+
+	for( uint32 i = 0; i < loadgen_config.bots; i++ ){
+		s_loadgen_bot& bot = loadgen_bots[i];
+
+		bot.index = i;
+		bot.fd = -1;
+		bot.timer = INVALID_TIMER;
+		safesnprintf( bot.userid, sizeof( bot.userid ), "%s%u", loadgen_config.account.c_str(), loadgen_config.first + i );
+	}
+
+	loadgen_start_tick = gettick();
+	loadgen_report_reset( loadgen_interval );
+	loadgen_report_reset( loadgen_total );
+
+	add_timer( loadgen_start_tick, loadgen_spawn_timer, 0, 0 );
+	add_timer_interval( loadgen_start_tick + 1000, loadgen_timeout_timer, 0, 0, 1000 );
+
+	if( loadgen_config.report > 0 ){
+		add_timer_interval( loadgen_start_tick + loadgen_config.report * 1000, loadgen_report_timer, 0, 0, loadgen_config.report * 1000 );
+	}
+
+	if( loadgen_config.duration > 0 ){
+		add_timer( loadgen_start_tick + loadgen_config.duration * 1000, loadgen_stop_timer, 0, 0 );
+	}
+
+	ShowStatus( "Starting %u bots at %u per second against %d.%d.%d.%d:%u.\n", loadgen_config.bots, loadgen_config.rate, CONVIP( loadgen_config.login_ip ), loadgen_config.login_port );
+
+	return true;
+}
+
+void LoadgenTool::finalize(){
+	if( loadgen_started > 0 ){
+		loadgen_report( loadgen_total, "Total" );
+	}
+
+	for( s_loadgen_bot& bot : loadgen_bots ){
+		loadgen_bot_detach( bot );
+	}
+
+	loadgen_bots.clear();
+	loadgen_sessions.clear();
+}
+
+void display_helpscreen( bool do_exit ){
+	ShowInfo( "Usage: %s [options]\n", SERVER_NAME );
+	ShowInfo( "\n" );
+	ShowInfo( "Options:\n" );
+	ShowInfo( "  -?, -h [--help]\t\tDisplays this help screen.\n" );
+	ShowInfo( "  --login-ip <ip>\t\tAddress of the login-server (default: 127.0.0.1).\n" );
+	ShowInfo( "  --login-port <port>\t\tPort of the login-server (default: 6900).\n" );
+	ShowInfo( "  --bots <count>\t\tAmount of bots (default: 100).\n" );
+	ShowInfo( "  --rate <count>\t\tBots that log in per second (default: 50).\n" );
+	ShowInfo( "  --duration <seconds>\t\tStops after the given time (default: 0, never).\n" );
+	ShowInfo( "  --account <prefix>\t\tAccounts are named <prefix><number> (default: loadbot).\n" );
+	ShowInfo( "  --first <number>\t\tNumber of the first account (default: 1).\n" );
+	ShowInfo( "  --password <password>\t\tPassword of all accounts (default: loadbot).\n" );
+	ShowInfo( "  --register\t\t\tCreates the accounts with the _M/_F suffix.\n" );
+	ShowInfo( "  --think <ms>\t\t\tAverage time between two actions of a bot (default: 1000).\n" );
+	ShowInfo( "  --actions <list>\t\twalk,chat,attack,skill,vending, all or none (default: all).\n" );
+	ShowInfo( "  --report <seconds>\t\tInterval of the reports (default: 10).\n" );
+	ShowInfo( "  --timeout <ms>\t\tTime until a request counts as timed out (default: 10000).\n" );
+	if( do_exit )
+		exit( EXIT_SUCCESS );
+}
+
+int32 parse_console( const char* buf ){
+	return 0;
+}
+
+int32 main( int32 argc, char *argv[] ){
+	return main_core<LoadgenTool>( argc, argv );
+}
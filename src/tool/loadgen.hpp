@@ -0,0 +1,130 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#ifndef LOADGEN_HPP
+#define LOADGEN_HPP
+
+#include <string>
+#include <vector>
+
+#include <common/cbasetypes.hpp>
+#include <common/mmo.hpp>
+#include <common/timer.hpp>
+
+/// Server a bot is currently connected to
+enum e_loadgen_phase : uint8{
+	LOADGEN_PHASE_NONE = 0,
+	LOADGEN_PHASE_LOGIN,
+	LOADGEN_PHASE_CHAR,
+	LOADGEN_PHASE_MAP,
+};
+
+/// Requests whose response latency is measured
+enum e_loadgen_request : uint8{
+	LOADGEN_REQ_LOGIN = 0,   ///< CA_LOGIN until AC_ACCEPT_LOGIN
+	LOADGEN_REQ_CHAR_ENTER,  ///< CH_ENTER until the character list
+	LOADGEN_REQ_CHAR_MAKE,   ///< CH_MAKE_CHAR until HC_ACCEPT_MAKECHAR
+	LOADGEN_REQ_CHAR_SELECT, ///< CH_SELECT_CHAR until HC_NOTIFY_ZONESVR
+	LOADGEN_REQ_MAP_ENTER,   ///< CZ_ENTER until ZC_ACCEPT_ENTER
+	LOADGEN_REQ_PING,        ///< CZ_REQUEST_TIME until ZC_NOTIFY_TIME
+	LOADGEN_REQ_WALK,        ///< CZ_REQUEST_MOVE until ZC_NOTIFY_PLAYERMOVE
+	LOADGEN_REQ_CHAT,        ///< CZ_REQUEST_CHAT until the own message is echoed
+	LOADGEN_REQ_ATTACK,      ///< CZ_REQUEST_ACT until the first reaction of the server
+	LOADGEN_REQ_SKILL,       ///< CZ_USE_SKILL until the skill is cast or refused
+	LOADGEN_REQ_VENDING,     ///< CZ_REQ_BUY_FROMMC until the item list of the vendor
+	LOADGEN_REQ_MAX
+};
+
+/// Skill a bot can use on a monster or on itself
+struct s_loadgen_skill{
+	uint16 id;
+	uint16 level;
+	bool self;
+};
+
+/// A scripted client
+struct s_loadgen_bot{
+	uint32 index;
+	int32 fd;
+	e_loadgen_phase phase;
+	char userid[NAME_LENGTH];
+	char name[NAME_LENGTH];
+
+	uint32 account_id;
+	uint32 char_id;
+	uint32 login_id1;
+	uint32 login_id2;
+	uint8 sex;
+	uint8 slot;
+
+	uint32 char_ip;
+	uint16 char_port;
+	uint32 map_ip;
+	uint16 map_port;
+
+	bool registered; ///< Tried to register the account already
+	bool skip_aid; ///< The server sends the raw account id before the first packet
+	bool online;   ///< Finished loading the map
+	bool dead;
+	uint32 crypt_key;
+	int16 x;
+	int16 y;
+	std::vector<uint32> monsters;
+	std::vector<uint32> vendors;
+	std::vector<s_loadgen_skill> skills;
+	t_tick next_ping;
+
+	/// Start of the pending requests in microseconds, 0 if the request is not pending
+	uint64 pending[LOADGEN_REQ_MAX];
+	int32 timer;
+};
+
+/// Actions the bots may take once they are on the map
+enum e_loadgen_action : uint8{
+	LOADGEN_ACTION_WALK = 0x01,
+	LOADGEN_ACTION_CHAT = 0x02,
+	LOADGEN_ACTION_ATTACK = 0x04,
+	LOADGEN_ACTION_SKILL = 0x08,
+	LOADGEN_ACTION_VENDING = 0x10,
+	LOADGEN_ACTION_ALL = 0x1f,
+};
+
+struct s_loadgen_config{
+	uint32 login_ip;
+	uint16 login_port;
+	uint32 bots;
+	uint32 rate;     ///< Bots that are started per second
+	uint32 duration; ///< Seconds until the run stops, 0 to run until interrupted
+	std::string account;
+	std::string password;
+	uint32 first;    ///< Number of the first account
+	bool register_accounts;
+	uint32 think;    ///< Average interval between two actions in milliseconds
+	uint32 report;   ///< Interval of the reports in seconds
+	uint32 timeout;  ///< Milliseconds until a pending request counts as timed out
+	uint8 actions;
+};
+
+extern s_loadgen_config loadgen_config;
+
+s_loadgen_bot* loadgen_bot( int32 fd );
+void loadgen_bot_attach( s_loadgen_bot& bot, int32 fd, e_loadgen_phase phase, int32 (*func)( int32 fd ) );
+void loadgen_bot_detach( s_loadgen_bot& bot );
+void loadgen_bot_fail( s_loadgen_bot& bot, const char* reason );
+void loadgen_bot_online( s_loadgen_bot& bot );
+void loadgen_request_begin( s_loadgen_bot& bot, e_loadgen_request request );
+void loadgen_request_end( s_loadgen_bot& bot, e_loadgen_request request );
+void loadgen_traffic( size_t packets, size_t bytes );
+
+// loadgen_login.cpp
+bool loadgen_login_connect( s_loadgen_bot& bot );
+
+// loadgen_char.cpp
+bool loadgen_char_connect( s_loadgen_bot& bot );
+
+// loadgen_map.cpp
+bool loadgen_map_init();
+bool loadgen_map_connect( s_loadgen_bot& bot );
+void loadgen_map_think( s_loadgen_bot& bot );
+
+#endif /* LOADGEN_HPP */
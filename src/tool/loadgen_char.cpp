@@ -0,0 +1,247 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#include "loadgen.hpp"
+
+#include <common/socket.hpp>
+#include <common/strlib.hpp>
+
+#include <char/packets.hpp>
+
+/**
+ * Length of the packets the char-server sends during the character selection.
+ * @return -1 for variable length packets, 0 for unknown packets
+ */
+static int32 loadgen_char_packet_length( uint16 cmd ){
+	switch( cmd ){
+		case 0x6b:
+		case 0x20d:
+		case 0x82d:
+		case HEADER_HC_ACK_CHARINFO_PER_PAGE:
+		case HEADER_HC_NOTIFY_ACCESSIBLE_MAPNAME:
+			return -1;
+		case 0x6c:
+		case 0x6e:
+		case 0x81:
+			return 3;
+#if defined(PACKETVER_RE) && PACKETVER >= 20151001 && PACKETVER < 20180103
+		case 0x9a0:
+			return 10;
+#else
+		case 0x9a0:
+			return 6;
+#endif
+		case 0x8b9:
+			return 12;
+		case 0x71:
+			return 28;
+		case 0xac5:
+			return 156;
+		case HEADER_HC_ACCEPT_MAKECHAR:
+			return 2 + sizeof( CHARACTER_INFO );
+		default:
+			return 0;
+	}
+}
+
+/**
+ * Select the character in the given slot.
+ */
+static void loadgen_char_select( s_loadgen_bot& bot, int32 fd, const CHARACTER_INFO& info ){
+	bot.char_id = info.GID;
+	bot.slot = info.CharNum;
+	safestrncpy( bot.name, info.name, sizeof( bot.name ) );
+
+	WFIFOHEAD( fd, 3 );
+	WFIFOW( fd, 0 ) = 0x66;
+	WFIFOB( fd, 2 ) = bot.slot;
+	loadgen_request_begin( bot, LOADGEN_REQ_CHAR_SELECT );
+	WFIFOSET( fd, 3 );
+}
+
+/**
+ * Create a novice named like the account in the first slot.
+ */
+static void loadgen_char_make( s_loadgen_bot& bot, int32 fd ){
+#if PACKETVER >= 20151001
+	WFIFOHEAD( fd, 36 );
+	WFIFOW( fd, 0 ) = 0xa39;
+	safestrncpy( WFIFOCP( fd, 2 ), bot.userid, NAME_LENGTH );
+	WFIFOB( fd, 26 ) = 0; // slot
+	WFIFOW( fd, 27 ) = 0; // hair color
+	WFIFOW( fd, 29 ) = 1; // hair style
+	WFIFOW( fd, 31 ) = JOB_NOVICE;
+	WFIFOW( fd, 33 ) = 0;
+	WFIFOB( fd, 35 ) = bot.sex;
+	loadgen_request_begin( bot, LOADGEN_REQ_CHAR_MAKE );
+	WFIFOSET( fd, 36 );
+#elif PACKETVER >= 20120307
+	WFIFOHEAD( fd, 31 );
+	WFIFOW( fd, 0 ) = 0x970;
+	safestrncpy( WFIFOCP( fd, 2 ), bot.userid, NAME_LENGTH );
+	WFIFOB( fd, 26 ) = 0; // slot
+	WFIFOW( fd, 27 ) = 0; // hair color
+	WFIFOW( fd, 29 ) = 1; // hair style
+	loadgen_request_begin( bot, LOADGEN_REQ_CHAR_MAKE );
+	WFIFOSET( fd, 31 );
+#else
+	WFIFOHEAD( fd, 37 );
+	WFIFOW( fd, 0 ) = 0x67;
+	safestrncpy( WFIFOCP( fd, 2 ), bot.userid, NAME_LENGTH );
+	memset( WFIFOP( fd, 26 ), 5, 6 ); // stats
+	WFIFOB( fd, 32 ) = 0; // slot
+	WFIFOW( fd, 33 ) = 0; // hair color
+	WFIFOW( fd, 35 ) = 1; // hair style
+	loadgen_request_begin( bot, LOADGEN_REQ_CHAR_MAKE );
+	WFIFOSET( fd, 37 );
+#endif
+}
+
+/**
+ * Parse the answers of the char-server.
+ * The bot selects its first character or creates one and moves on to the map-server.
+ */
+static int32 loadgen_char_parse( int32 fd ){
+	s_loadgen_bot* bot = loadgen_bot( fd );
+
+	if( bot == nullptr ){
+		do_close( fd );
+		return 0;
+	}
+
+	if( session[fd]->flag.eof ){
+		loadgen_bot_fail( *bot, "disconnected by the char-server" );
+		return 0;
+	}
+
+	// The char-server sends the account id without a packet header first
+	if( bot->skip_aid ){
+		if( RFIFOREST( fd ) < 4 ){
+			return 0;
+		}
+
+		loadgen_traffic( 1, 4 );
+		RFIFOSKIP( fd, 4 );
+		bot->skip_aid = false;
+	}
+
+	while( RFIFOREST( fd ) >= 2 ){
+		uint16 cmd = RFIFOW( fd, 0 );
+		int32 length = loadgen_char_packet_length( cmd );
+
+		if( length == 0 ){
+			loadgen_bot_fail( *bot, "unknown packet from the char-server" );
+			return 0;
+		}
+
+		if( length == -1 ){
+			if( RFIFOREST( fd ) < 4 ){
+				return 0;
+			}
+
+			length = RFIFOW( fd, 2 );
+
+			if( length < 4 ){
+				loadgen_bot_fail( *bot, "invalid packet from the char-server" );
+				return 0;
+			}
+		}
+
+		if( RFIFOREST( fd ) < static_cast<size_t>( length ) ){
+			return 0;
+		}
+
+		loadgen_traffic( 1, length );
+
+		switch( cmd ){
+			case 0x6b: {
+#if PACKETVER >= 20100413
+				int32 offset = 27;
+#else
+				int32 offset = 24;
+#endif
+				loadgen_request_end( *bot, LOADGEN_REQ_CHAR_ENTER );
+
+				if( length >= offset + static_cast<int32>( sizeof( CHARACTER_INFO ) ) ){
+					CHARACTER_INFO info;
+
+					memcpy( &info, RFIFOP( fd, offset ), sizeof( info ) );
+					loadgen_char_select( *bot, fd, info );
+				}else{
+					loadgen_char_make( *bot, fd );
+				}
+			} break;
+			case HEADER_HC_ACCEPT_MAKECHAR: {
+				CHARACTER_INFO info;
+
+				memcpy( &info, RFIFOP( fd, 2 ), sizeof( info ) );
+				loadgen_request_end( *bot, LOADGEN_REQ_CHAR_MAKE );
+				loadgen_char_select( *bot, fd, info );
+			} break;
+			case 0x8b9:
+				if( RFIFOW( fd, 10 ) != 0 ){
+					RFIFOSKIP( fd, length );
+					loadgen_bot_fail( *bot, "pincodes are enabled on the char-server" );
+					return 0;
+				}
+				break;
+			case 0x71:
+			case 0xac5:
+				loadgen_request_end( *bot, LOADGEN_REQ_CHAR_SELECT );
+				bot->char_id = RFIFOL( fd, 2 );
+				bot->map_ip = ntohl( RFIFOL( fd, 22 ) );
+				bot->map_port = RFIFOW( fd, 26 );
+				RFIFOSKIP( fd, length );
+
+				loadgen_bot_detach( *bot );
+
+				if( !loadgen_map_connect( *bot ) ){
+					loadgen_bot_fail( *bot, "cannot connect to the map-server" );
+				}
+				return 0;
+			case 0x6c:
+			case 0x81:
+				RFIFOSKIP( fd, length );
+				loadgen_bot_fail( *bot, "rejected by the char-server" );
+				return 0;
+			case 0x6e:
+				RFIFOSKIP( fd, length );
+				loadgen_bot_fail( *bot, "character creation refused" );
+				return 0;
+			case HEADER_HC_NOTIFY_ACCESSIBLE_MAPNAME:
+				RFIFOSKIP( fd, length );
+				loadgen_bot_fail( *bot, "no map-server is connected to the char-server" );
+				return 0;
+		}
+
+		RFIFOSKIP( fd, length );
+	}
+
+	return 0;
+}
+
+/**
+ * Connect to the char-server the login-server sent the bot to.
+ */
+bool loadgen_char_connect( s_loadgen_bot& bot ){
+	int32 fd = make_connection( bot.char_ip, bot.char_port, true, 10 );
+
+	if( fd == -1 ){
+		return false;
+	}
+
+	loadgen_bot_attach( bot, fd, LOADGEN_PHASE_CHAR, loadgen_char_parse );
+	bot.skip_aid = true;
+
+	WFIFOHEAD( fd, 17 );
+	WFIFOW( fd, 0 ) = 0x65;
+	WFIFOL( fd, 2 ) = bot.account_id;
+	WFIFOL( fd, 6 ) = bot.login_id1;
+	WFIFOL( fd, 10 ) = bot.login_id2;
+	WFIFOW( fd, 14 ) = 0;
+	WFIFOB( fd, 16 ) = bot.sex;
+	loadgen_request_begin( bot, LOADGEN_REQ_CHAR_ENTER );
+	WFIFOSET( fd, 17 );
+
+	return true;
+}
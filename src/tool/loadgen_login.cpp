@@ -0,0 +1,124 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#include "loadgen.hpp"
+
+#include <common/packets.hpp>
+#include <common/showmsg.hpp>
+#include <common/socket.hpp>
+#include <common/strlib.hpp>
+
+/**
+ * Parse the answer of the login-server.
+ * The bot moves on to the first char-server once it was accepted.
+ */
+static int32 loadgen_login_parse( int32 fd ){
+	s_loadgen_bot* bot = loadgen_bot( fd );
+
+	if( bot == nullptr ){
+		do_close( fd );
+		return 0;
+	}
+
+	if( session[fd]->flag.eof ){
+		loadgen_bot_fail( *bot, "disconnected by the login-server" );
+		return 0;
+	}
+
+	while( RFIFOREST( fd ) >= 2 ){
+		int16 cmd = RFIFOW( fd, 0 );
+
+		if( cmd == HEADER_AC_ACCEPT_LOGIN ){
+			if( RFIFOREST( fd ) < 4 || RFIFOREST( fd ) < RFIFOW( fd, 2 ) ){
+				return 0;
+			}
+
+			const PACKET_AC_ACCEPT_LOGIN* p = reinterpret_cast<PACKET_AC_ACCEPT_LOGIN*>( RFIFOP( fd, 0 ) );
+
+			loadgen_traffic( 1, p->packetLength );
+			loadgen_request_end( *bot, LOADGEN_REQ_LOGIN );
+			bot->registered = true;
+
+			if( static_cast<size_t>( p->packetLength ) < sizeof( *p ) + sizeof( p->char_servers[0] ) ){
+				loadgen_bot_fail( *bot, "no char-server is connected to the login-server" );
+				return 0;
+			}
+
+			bot->login_id1 = p->login_id1;
+			bot->account_id = p->AID;
+			bot->login_id2 = p->login_id2;
+			bot->sex = p->sex;
+			bot->char_ip = ntohl( p->char_servers[0].ip );
+			bot->char_port = p->char_servers[0].port;
+
+			RFIFOSKIP( fd, p->packetLength );
+
+			loadgen_bot_detach( *bot );
+
+			if( !loadgen_char_connect( *bot ) ){
+				loadgen_bot_fail( *bot, "cannot connect to the char-server" );
+			}
+
+			return 0;
+		}else if( cmd == HEADER_AC_REFUSE_LOGIN ){
+			if( RFIFOREST( fd ) < sizeof( PACKET_AC_REFUSE_LOGIN ) ){
+				return 0;
+			}
+
+			loadgen_traffic( 1, sizeof( PACKET_AC_REFUSE_LOGIN ) );
+			loadgen_request_end( *bot, LOADGEN_REQ_LOGIN );
+			bot->registered = true;
+			RFIFOSKIP( fd, sizeof( PACKET_AC_REFUSE_LOGIN ) );
+			loadgen_bot_fail( *bot, "login refused, check the accounts and the password" );
+			return 0;
+		}else if( cmd == HEADER_SC_NOTIFY_BAN ){
+			if( RFIFOREST( fd ) < sizeof( PACKET_SC_NOTIFY_BAN ) ){
+				return 0;
+			}
+
+			loadgen_traffic( 1, sizeof( PACKET_SC_NOTIFY_BAN ) );
+			loadgen_request_end( *bot, LOADGEN_REQ_LOGIN );
+			bot->registered = true;
+			RFIFOSKIP( fd, sizeof( PACKET_SC_NOTIFY_BAN ) );
+			loadgen_bot_fail( *bot, "login banned, allow the address of the bots in packet_athena.conf" );
+			return 0;
+		}else{
+			loadgen_bot_fail( *bot, "unknown packet from the login-server" );
+			return 0;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Connect to the login-server and request to log in.
+ */
+bool loadgen_login_connect( s_loadgen_bot& bot ){
+	int32 fd = make_connection( loadgen_config.login_ip, loadgen_config.login_port, true, 10 );
+
+	if( fd == -1 ){
+		return false;
+	}
+
+	loadgen_bot_attach( bot, fd, LOADGEN_PHASE_LOGIN, loadgen_login_parse );
+
+	WFIFOHEAD( fd, sizeof( PACKET_CA_LOGIN ) );
+	PACKET_CA_LOGIN* p = reinterpret_cast<PACKET_CA_LOGIN*>( WFIFOP( fd, 0 ) );
+
+	p->packetType = HEADER_CA_LOGIN;
+	p->version = 55;
+	// Only the first login registers the account, it exists afterwards
+	if( loadgen_config.register_accounts && !bot.registered ){
+		safesnprintf( p->username, sizeof( p->username ), "%s_%c", bot.userid, ( bot.index % 2 ) == 0 ? 'M' : 'F' );
+	}else{
+		safestrncpy( p->username, bot.userid, sizeof( p->username ) );
+	}
+	safestrncpy( p->password, loadgen_config.password.c_str(), sizeof( p->password ) );
+	p->clienttype = 0;
+
+	loadgen_request_begin( bot, LOADGEN_REQ_LOGIN );
+	WFIFOSET( fd, sizeof( *p ) );
+
+	return true;
+}
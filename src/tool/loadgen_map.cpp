@@ -0,0 +1,705 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#include "loadgen.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <cstdarg>
+#include <cstring>
+#include <type_traits>
+
+/// Length of every packet the map-server may send, -1 for variable length packets and 0 for unknown packets
+static int32 loadgen_packet_length[UINT16_MAX + 1];
+
+static bool loadgen_header_register( int32 id, int32 length ){
+	if( length != 0 ){
+		loadgen_packet_length[static_cast<uint16>( id )] = length;
+	}
+
+	return true;
+}
+
+template <typename T, typename = void> struct loadgen_is_complete : std::false_type{};
+template <typename T> struct loadgen_is_complete<T, std::void_t<decltype( sizeof( T ) )>> : std::true_type{};
+
+#define LOADGEN_HAS_MEMBER( member ) \
+	template <typename T, typename = void> struct loadgen_has_##member : std::false_type{}; \
+	template <typename T> struct loadgen_has_##member<T, std::void_t<decltype( &T::member )>> : std::true_type{};
+
+LOADGEN_HAS_MEMBER( packetLength )
+LOADGEN_HAS_MEMBER( PacketLength )
+LOADGEN_HAS_MEMBER( packetLen )
+LOADGEN_HAS_MEMBER( packetSize )
+LOADGEN_HAS_MEMBER( length )
+
+#undef LOADGEN_HAS_MEMBER
+
+/**
+ * Length of a packet structure.
+ * Structures with a length field are sent with a variable length.
+ * @return -1 for variable length packets, 0 if the structure does not exist
+ */
+template <typename T> constexpr int32 loadgen_struct_length(){
+	if constexpr( !loadgen_is_complete<T>::value ){
+		return 0;
+	}else if constexpr( loadgen_has_packetLength<T>::value || loadgen_has_PacketLength<T>::value || loadgen_has_packetLen<T>::value || loadgen_has_packetSize<T>::value || loadgen_has_length<T>::value ){
+		return -1;
+	}else{
+		return static_cast<int32>( sizeof( T ) );
+	}
+}
+
+// Collect the length of all packets while the map-server packet definitions are read
+#define DEFINE_PACKET_HEADER( name, id ) \
+	const int16 HEADER_##name = id; \
+	static const bool loadgen_header_##name = loadgen_header_register( id, loadgen_struct_length<struct PACKET_##name>() );
+
+#include <common/showmsg.hpp>
+#include <common/socket.hpp>
+#include <common/strlib.hpp>
+#include <common/random.hpp>
+
+#include <map/clif.hpp>
+#include <map/clif_obfuscation.hpp>
+#include <map/skill.hpp>
+
+/// Packet database entry of a packet the client sends
+struct s_loadgen_packet_db{
+	int32 length;
+	const char* func;
+	uint32 order;
+	int16 pos[MAX_PACKET_POS];
+};
+
+static s_loadgen_packet_db loadgen_packet_db[MAX_PACKET_DB + 1];
+static uint32 loadgen_packet_order = 0;
+
+/// Packets the bots send, identified by the packet handler of the map-server
+enum e_loadgen_cz : uint8{
+	LOADGEN_CZ_ENTER = 0,
+	LOADGEN_CZ_LOADEND,
+	LOADGEN_CZ_TICK,
+	LOADGEN_CZ_WALK,
+	LOADGEN_CZ_CHAT,
+	LOADGEN_CZ_ACTION,
+	LOADGEN_CZ_SKILL,
+	LOADGEN_CZ_VENDING,
+	LOADGEN_CZ_RESTART,
+	LOADGEN_CZ_NPC_NEXT,
+	LOADGEN_CZ_NPC_CLOSE,
+	LOADGEN_CZ_NPC_MENU,
+	LOADGEN_CZ_MAX
+};
+
+static const char* loadgen_cz_names[LOADGEN_CZ_MAX] = {
+	"clif_parse_WantToConnection",
+	"clif_parse_LoadEndAck",
+	"clif_parse_TickSend",
+	"clif_parse_WalkToXY",
+	"clif_parse_GlobalMessage",
+	"clif_parse_ActionRequest",
+	"clif_parse_UseSkillToId",
+	"clif_parse_VendingListReq",
+	"clif_parse_Restart",
+	"clif_parse_NpcNextClicked",
+	"clif_parse_NpcCloseClicked",
+	"clif_parse_NpcSelectMenu",
+};
+
+/// Packet id of each packet the bots send, 0 if the packet version does not support it
+static uint16 loadgen_cz[LOADGEN_CZ_MAX];
+
+/// Unknown packets that were reported already
+static std::bitset<UINT16_MAX + 1> loadgen_unknown_packets;
+
+/**
+ * Same as packetdb_addpacket of the map-server, but remembers the name of the packet handler.
+ */
+static void loadgen_addpacket( int32 cmd, int32 length, const char* func, ... ){
+	va_list argp;
+
+	if( cmd <= 0 || cmd > MAX_PACKET_DB ){
+		return;
+	}
+
+	s_loadgen_packet_db& entry = loadgen_packet_db[cmd];
+
+	entry = {};
+	entry.length = length;
+	entry.func = func;
+	entry.order = ++loadgen_packet_order;
+
+	va_start( argp, func );
+
+	for( int32 i = 0; i < MAX_PACKET_POS; i++ ){
+		int32 offset = va_arg( argp, int32 );
+
+		if( offset == 0 ){
+			break;
+		}
+
+		entry.pos[i] = offset;
+	}
+
+	va_end( argp );
+}
+
+/**
+ * Read the packet database of the map-server, it has to match the packet version of the server.
+ */
+static void loadgen_packetdb_read(){
+#define packetdb_addpacket( cmd, length, func, ... ) loadgen_addpacket( cmd, length, #func, __VA_ARGS__ )
+#include <map/clif_packetdb.hpp>
+#include <map/clif_shuffle.hpp>
+#undef packetdb_addpacket
+#undef packet
+#undef parseable_packet
+}
+
+bool loadgen_map_init(){
+	// Unit packets are only defined by their type
+	loadgen_header_register( idle_unitType, loadgen_struct_length<packet_idle_unit>() );
+	loadgen_header_register( spawn_unitType, loadgen_struct_length<packet_spawn_unit>() );
+	loadgen_header_register( unit_walkingType, loadgen_struct_length<packet_unit_walking>() );
+	loadgen_header_register( damageType, loadgen_struct_length<packet_damage>() );
+	loadgen_header_register( status_changeType, loadgen_struct_length<packet_status_change>() );
+	loadgen_header_register( status_change_endType, loadgen_struct_length<packet_status_change_end>() );
+
+	loadgen_packetdb_read();
+
+	for( int32 cmd = 1; cmd <= MAX_PACKET_DB; cmd++ ){
+		const s_loadgen_packet_db& entry = loadgen_packet_db[cmd];
+
+		// The layout from the structures is more accurate than the old packet length table
+		if( entry.length != 0 && loadgen_packet_length[cmd] == 0 ){
+			loadgen_packet_length[cmd] = entry.length;
+		}
+
+		if( entry.func == nullptr ){
+			continue;
+		}
+
+		// Packet ids get reassigned to other handlers by newer clients, use the last one that is still valid
+		for( size_t i = 0; i < LOADGEN_CZ_MAX; i++ ){
+			if( strcmp( entry.func, loadgen_cz_names[i] ) == 0 && ( loadgen_cz[i] == 0 || loadgen_packet_db[loadgen_cz[i]].order < entry.order ) ){
+				loadgen_cz[i] = static_cast<uint16>( cmd );
+			}
+		}
+	}
+
+	for( size_t i = 0; i < LOADGEN_CZ_MAX; i++ ){
+		if( loadgen_cz[i] == 0 ){
+			if( i <= LOADGEN_CZ_TICK ){
+				ShowError( "The packet version %d does not support %s.\n", PACKETVER, loadgen_cz_names[i] );
+				return false;
+			}
+
+			ShowWarning( "The packet version %d does not support %s, the bots will not use it.\n", PACKETVER, loadgen_cz_names[i] );
+		}
+	}
+
+	ShowStatus( "Using packet version: " CL_WHITE "%d" CL_RESET ".\n", PACKETVER );
+
+	return true;
+}
+
+/**
+ * Start a packet to the map-server, the fields are placed at the positions of the packet database.
+ * @return the packet database entry or nullptr if the packet is not supported
+ */
+static const s_loadgen_packet_db* loadgen_map_packet( s_loadgen_bot& bot, e_loadgen_cz packet, int32 length = 0 ){
+	if( loadgen_cz[packet] == 0 ){
+		return nullptr;
+	}
+
+	const s_loadgen_packet_db* entry = &loadgen_packet_db[loadgen_cz[packet]];
+
+	if( length == 0 ){
+		length = entry->length;
+	}
+
+	WFIFOHEAD( bot.fd, length );
+	memset( WFIFOP( bot.fd, 0 ), 0, length );
+	WFIFOW( bot.fd, 0 ) = loadgen_cz[packet];
+
+	return entry;
+}
+
+/**
+ * Send a packet that was started with loadgen_map_packet.
+ */
+static void loadgen_map_send( s_loadgen_bot& bot, int32 length ){
+#ifdef PACKET_OBFUSCATION
+	// Every packet id is encrypted with the next key, see clif_parse
+	WFIFOW( bot.fd, 0 ) = WFIFOW( bot.fd, 0 ) ^ ( ( bot.crypt_key >> 16 ) & 0x7FFF );
+	bot.crypt_key = bot.crypt_key * clif_cryptKey[1] + clif_cryptKey[2];
+#endif
+
+	WFIFOSET( bot.fd, length );
+}
+
+static void loadgen_map_loadend( s_loadgen_bot& bot ){
+	const s_loadgen_packet_db* entry = loadgen_map_packet( bot, LOADGEN_CZ_LOADEND );
+
+	loadgen_map_send( bot, entry->length );
+}
+
+static void loadgen_map_ping( s_loadgen_bot& bot ){
+	const s_loadgen_packet_db* entry = loadgen_map_packet( bot, LOADGEN_CZ_TICK );
+
+	WFIFOL( bot.fd, entry->pos[0] ) = static_cast<uint32>( gettick() );
+	loadgen_request_begin( bot, LOADGEN_REQ_PING );
+	loadgen_map_send( bot, entry->length );
+
+	bot.next_ping = gettick() + 10000;
+}
+
+static void loadgen_map_walk( s_loadgen_bot& bot ){
+	const s_loadgen_packet_db* entry = loadgen_map_packet( bot, LOADGEN_CZ_WALK );
+
+	if( entry == nullptr ){
+		return;
+	}
+
+	int16 x = static_cast<int16>( std::max( 0, bot.x + rnd_value( -8, 8 ) ) );
+	int16 y = static_cast<int16>( std::max( 0, bot.y + rnd_value( -8, 8 ) ) );
+	uint8* p = WFIFOP( bot.fd, entry->pos[0] );
+
+	// Same encoding as WBUFPOS
+	p[0] = static_cast<uint8>( x >> 2 );
+	p[1] = static_cast<uint8>( ( x << 6 ) | ( ( y >> 4 ) & 0x3f ) );
+	p[2] = static_cast<uint8>( y << 4 );
+
+	loadgen_request_begin( bot, LOADGEN_REQ_WALK );
+	loadgen_map_send( bot, entry->length );
+}
+
+static void loadgen_map_chat( s_loadgen_bot& bot ){
+	char message[CHAT_SIZE_MAX];
+	int32 length = safesnprintf( message, sizeof( message ), "%s : loadgen %u", bot.name, static_cast<uint32>( rnd() ) ) + 1;
+
+	if( loadgen_cz[LOADGEN_CZ_CHAT] == 0 || length <= 0 ){
+		return;
+	}
+
+	int32 offset = loadgen_packet_db[loadgen_cz[LOADGEN_CZ_CHAT]].pos[1];
+	const s_loadgen_packet_db* entry = loadgen_map_packet( bot, LOADGEN_CZ_CHAT, offset + length );
+
+	WFIFOW( bot.fd, entry->pos[0] ) = static_cast<uint16>( offset + length );
+	memcpy( WFIFOP( bot.fd, offset ), message, length );
+
+	loadgen_request_begin( bot, LOADGEN_REQ_CHAT );
+	loadgen_map_send( bot, offset + length );
+}
+
+static void loadgen_map_attack( s_loadgen_bot& bot ){
+	const s_loadgen_packet_db* entry = loadgen_map_packet( bot, LOADGEN_CZ_ACTION );
+
+	if( entry == nullptr ){
+		return;
+	}
+
+	WFIFOL( bot.fd, entry->pos[0] ) = bot.monsters[rnd_value<size_t>( 0, bot.monsters.size() - 1 )];
+	WFIFOB( bot.fd, entry->pos[1] ) = 0; // single attack
+
+	loadgen_request_begin( bot, LOADGEN_REQ_ATTACK );
+	loadgen_map_send( bot, entry->length );
+}
+
+static void loadgen_map_skill( s_loadgen_bot& bot ){
+	const s_loadgen_skill& skill = bot.skills[rnd_value<size_t>( 0, bot.skills.size() - 1 )];
+	uint32 target;
+
+	if( skill.self ){
+		target = bot.account_id;
+	}else if( !bot.monsters.empty() ){
+		target = bot.monsters[rnd_value<size_t>( 0, bot.monsters.size() - 1 )];
+	}else{
+		return;
+	}
+
+	const s_loadgen_packet_db* entry = loadgen_map_packet( bot, LOADGEN_CZ_SKILL );
+
+	if( entry == nullptr ){
+		return;
+	}
+
+	WFIFOW( bot.fd, entry->pos[0] ) = skill.level;
+	WFIFOW( bot.fd, entry->pos[1] ) = skill.id;
+	WFIFOL( bot.fd, entry->pos[2] ) = target;
+
+	loadgen_request_begin( bot, LOADGEN_REQ_SKILL );
+	loadgen_map_send( bot, entry->length );
+}
+
+static void loadgen_map_vending( s_loadgen_bot& bot ){
+	const s_loadgen_packet_db* entry = loadgen_map_packet( bot, LOADGEN_CZ_VENDING );
+
+	if( entry == nullptr ){
+		return;
+	}
+
+	WFIFOL( bot.fd, entry->pos[0] ) = bot.vendors[rnd_value<size_t>( 0, bot.vendors.size() - 1 )];
+
+	loadgen_request_begin( bot, LOADGEN_REQ_VENDING );
+	loadgen_map_send( bot, entry->length );
+}
+
+/**
+ * Let a bot that is on the map do one random action.
+ * Actions whose previous request is still pending are skipped.
+ */
+void loadgen_map_think( s_loadgen_bot& bot ){
+	if( bot.dead ){
+		const s_loadgen_packet_db* entry = loadgen_map_packet( bot, LOADGEN_CZ_RESTART );
+
+		if( entry != nullptr ){
+			WFIFOB( bot.fd, entry->pos[0] ) = 0; // respawn
+			loadgen_map_send( bot, entry->length );
+		}
+
+		bot.dead = false;
+		return;
+	}
+
+	if( DIFF_TICK( gettick(), bot.next_ping ) >= 0 && bot.pending[LOADGEN_REQ_PING] == 0 ){
+		loadgen_map_ping( bot );
+	}
+
+	void (*actions[5])( s_loadgen_bot& bot );
+	size_t count = 0;
+
+	if( ( loadgen_config.actions & LOADGEN_ACTION_WALK ) && bot.pending[LOADGEN_REQ_WALK] == 0 ){
+		actions[count++] = loadgen_map_walk;
+	}
+
+	if( ( loadgen_config.actions & LOADGEN_ACTION_CHAT ) && bot.pending[LOADGEN_REQ_CHAT] == 0 ){
+		actions[count++] = loadgen_map_chat;
+	}
+
+	if( ( loadgen_config.actions & LOADGEN_ACTION_ATTACK ) && bot.pending[LOADGEN_REQ_ATTACK] == 0 && !bot.monsters.empty() ){
+		actions[count++] = loadgen_map_attack;
+	}
+
+	if( ( loadgen_config.actions & LOADGEN_ACTION_SKILL ) && bot.pending[LOADGEN_REQ_SKILL] == 0 && !bot.skills.empty() ){
+		actions[count++] = loadgen_map_skill;
+	}
+
+	if( ( loadgen_config.actions & LOADGEN_ACTION_VENDING ) && bot.pending[LOADGEN_REQ_VENDING] == 0 && !bot.vendors.empty() ){
+		actions[count++] = loadgen_map_vending;
+	}
+
+	if( count > 0 ){
+		actions[rnd_value<size_t>( 0, count - 1 )]( bot );
+	}
+}
+
+static void loadgen_map_forget( std::vector<uint32>& list, uint32 id ){
+	auto it = std::find( list.begin(), list.end(), id );
+
+	if( it != list.end() ){
+		*it = list.back();
+		list.pop_back();
+	}
+}
+
+static void loadgen_map_remember( std::vector<uint32>& list, uint32 id ){
+	// Bots only need a handful of targets
+	if( list.size() < 32 && std::find( list.begin(), list.end(), id ) == list.end() ){
+		list.push_back( id );
+	}
+}
+
+/**
+ * A unit appeared in sight, remember the monsters as attack targets.
+ */
+template <typename T> static void loadgen_map_unit( s_loadgen_bot& bot, const uint8* buf ){
+	T p;
+
+	memcpy( &p, buf, sizeof( p ) );
+
+#if PACKETVER >= 20091103
+	if( p.objecttype == 0x5 ){
+#else
+	if( p.job >= 1001 && p.job < 4000 ){
+#endif
+		loadgen_map_remember( bot.monsters, p.GID );
+	}
+}
+
+/**
+ * Handle a single packet of the map-server.
+ * @return false if the bot was disconnected
+ */
+static bool loadgen_map_handle( s_loadgen_bot& bot, int32 fd, uint16 cmd, int32 length ){
+	const uint8* buf = RFIFOP( fd, 0 );
+
+	switch( cmd ){
+		case HEADER_ZC_ACCEPT_ENTER: {
+			const PACKET_ZC_ACCEPT_ENTER* p = reinterpret_cast<const PACKET_ZC_ACCEPT_ENTER*>( buf );
+
+			bot.x = static_cast<int16>( ( p->posDir[0] << 2 ) | ( p->posDir[1] >> 6 ) );
+			bot.y = static_cast<int16>( ( ( p->posDir[1] & 0x3f ) << 4 ) | ( p->posDir[2] >> 4 ) );
+
+			loadgen_request_end( bot, LOADGEN_REQ_MAP_ENTER );
+			loadgen_map_loadend( bot );
+			loadgen_bot_online( bot );
+		} break;
+		case HEADER_ZC_REFUSE_ENTER:
+		case HEADER_SC_NOTIFY_BAN:
+		case 0x6a:
+			loadgen_bot_fail( bot, "rejected by the map-server" );
+			return false;
+		case HEADER_ZC_NPCACK_SERVERMOVE: {
+			const PACKET_ZC_NPCACK_SERVERMOVE* p = reinterpret_cast<const PACKET_ZC_NPCACK_SERVERMOVE*>( buf );
+
+			bot.map_ip = ntohl( p->ip );
+			bot.map_port = p->port;
+
+			loadgen_bot_detach( bot );
+
+			if( !loadgen_map_connect( bot ) ){
+				loadgen_bot_fail( bot, "cannot connect to the map-server" );
+			}
+		} return false;
+		case HEADER_ZC_NPCACK_MAPMOVE: {
+			const PACKET_ZC_NPCACK_MAPMOVE* p = reinterpret_cast<const PACKET_ZC_NPCACK_MAPMOVE*>( buf );
+
+			bot.x = p->xPos;
+			bot.y = p->yPos;
+			bot.dead = false;
+			bot.monsters.clear();
+			bot.vendors.clear();
+
+			loadgen_map_loadend( bot );
+		} break;
+		case HEADER_ZC_NOTIFY_TIME:
+			loadgen_request_end( bot, LOADGEN_REQ_PING );
+			break;
+		case HEADER_ZC_NOTIFY_PLAYERMOVE: {
+			const PACKET_ZC_NOTIFY_PLAYERMOVE* p = reinterpret_cast<const PACKET_ZC_NOTIFY_PLAYERMOVE*>( buf );
+
+			// Destination of the WBUFPOS2 encoding
+			bot.x = static_cast<int16>( ( ( p->moveData[2] & 0x0f ) << 6 ) | ( p->moveData[3] >> 2 ) );
+			bot.y = static_cast<int16>( ( ( p->moveData[3] & 0x03 ) << 8 ) | p->moveData[4] );
+
+			// Attacking a monster out of range makes the character walk to it first
+			if( bot.pending[LOADGEN_REQ_WALK] != 0 ){
+				loadgen_request_end( bot, LOADGEN_REQ_WALK );
+			}else{
+				loadgen_request_end( bot, LOADGEN_REQ_ATTACK );
+			}
+		} break;
+		case 0x8e:
+			loadgen_request_end( bot, LOADGEN_REQ_CHAT );
+			break;
+		case HEADER_ZC_NOTIFY_ACT: {
+			const PACKET_ZC_NOTIFY_ACT* p = reinterpret_cast<const PACKET_ZC_NOTIFY_ACT*>( buf );
+
+			if( static_cast<uint32>( p->srcID ) == bot.account_id ){
+				loadgen_request_end( bot, LOADGEN_REQ_ATTACK );
+			}
+		} break;
+		case HEADER_ZC_ATTACK_FAILURE_FOR_DISTANCE:
+			loadgen_request_end( bot, LOADGEN_REQ_ATTACK );
+			break;
+		case HEADER_ZC_USESKILL_ACK:
+			if( reinterpret_cast<const PACKET_ZC_USESKILL_ACK*>( buf )->srcId == bot.account_id ){
+				loadgen_request_end( bot, LOADGEN_REQ_SKILL );
+			}
+			break;
+		case HEADER_ZC_NOTIFY_SKILL:
+			if( reinterpret_cast<const PACKET_ZC_NOTIFY_SKILL*>( buf )->AID == bot.account_id ){
+				loadgen_request_end( bot, LOADGEN_REQ_SKILL );
+			}
+			break;
+		case HEADER_ZC_USE_SKILL:
+			if( reinterpret_cast<const PACKET_ZC_USE_SKILL*>( buf )->srcAID == bot.account_id ){
+				loadgen_request_end( bot, LOADGEN_REQ_SKILL );
+			}
+			break;
+		case HEADER_ZC_ACK_TOUSESKILL:
+			loadgen_request_end( bot, LOADGEN_REQ_SKILL );
+			break;
+		case 0x10f:
+			// The skill list is sent without the packet structure, each skill takes 37 bytes
+			bot.skills.clear();
+
+			for( int32 offset = 4; offset + 37 <= length; offset += 37 ){
+				uint16 id = RFIFOW( fd, offset );
+				uint32 inf = RFIFOL( fd, offset + 2 );
+				uint16 level = RFIFOW( fd, offset + 6 );
+
+				if( level > 0 && ( inf & ( INF_ATTACK_SKILL | INF_SELF_SKILL ) ) ){
+					bot.skills.push_back( { id, level, ( inf & INF_SELF_SKILL ) != 0 } );
+				}
+			}
+			break;
+		case HEADER_ZC_PC_PURCHASE_ITEMLIST_FROMMC:
+			loadgen_request_end( bot, LOADGEN_REQ_VENDING );
+			break;
+		case HEADER_ZC_STORE_ENTRY:
+			loadgen_map_remember( bot.vendors, reinterpret_cast<const PACKET_ZC_STORE_ENTRY*>( buf )->makerAID );
+			break;
+		case HEADER_ZC_NOTIFY_VANISH: {
+			const PACKET_ZC_NOTIFY_VANISH* p = reinterpret_cast<const PACKET_ZC_NOTIFY_VANISH*>( buf );
+
+			if( p->gid == bot.account_id ){
+				bot.dead = ( p->type == 1 );
+			}else{
+				loadgen_map_forget( bot.monsters, p->gid );
+				loadgen_map_forget( bot.vendors, p->gid );
+			}
+		} break;
+		case idle_unitType:
+			loadgen_map_unit<packet_idle_unit>( bot, buf );
+			break;
+		case spawn_unitType:
+			loadgen_map_unit<packet_spawn_unit>( bot, buf );
+			break;
+		case unit_walkingType:
+			loadgen_map_unit<packet_unit_walking>( bot, buf );
+			break;
+		case HEADER_ZC_WAIT_DIALOG: {
+			const s_loadgen_packet_db* entry = loadgen_map_packet( bot, LOADGEN_CZ_NPC_NEXT );
+
+			if( entry != nullptr ){
+				WFIFOL( bot.fd, entry->pos[0] ) = reinterpret_cast<const PACKET_ZC_WAIT_DIALOG*>( buf )->NpcID;
+				loadgen_map_send( bot, entry->length );
+			}
+		} break;
+		case HEADER_ZC_CLOSE_DIALOG: {
+			const s_loadgen_packet_db* entry = loadgen_map_packet( bot, LOADGEN_CZ_NPC_CLOSE );
+
+			if( entry != nullptr ){
+				PACKET_CZ_CLOSE_DIALOG* p = reinterpret_cast<PACKET_CZ_CLOSE_DIALOG*>( WFIFOP( bot.fd, 0 ) );
+
+				p->GID = reinterpret_cast<const PACKET_ZC_CLOSE_DIALOG*>( buf )->npcId;
+				loadgen_map_send( bot, entry->length );
+			}
+		} break;
+		case HEADER_ZC_MENU_LIST: {
+			const s_loadgen_packet_db* entry = loadgen_map_packet( bot, LOADGEN_CZ_NPC_MENU );
+
+			if( entry != nullptr ){
+				WFIFOL( bot.fd, entry->pos[0] ) = reinterpret_cast<const PACKET_ZC_MENU_LIST*>( buf )->npcId;
+				WFIFOB( bot.fd, entry->pos[1] ) = 0xff; // cancel
+				loadgen_map_send( bot, entry->length );
+			}
+		} break;
+	}
+
+	return true;
+}
+
+/**
+ * Parse the packets of the map-server.
+ * The length of each packet is taken from the packet definitions of the map-server.
+ */
+static int32 loadgen_map_parse( int32 fd ){
+	s_loadgen_bot* bot = loadgen_bot( fd );
+
+	if( bot == nullptr ){
+		do_close( fd );
+		return 0;
+	}
+
+	if( session[fd]->flag.eof ){
+		loadgen_bot_fail( *bot, "disconnected by the map-server" );
+		return 0;
+	}
+
+	// Old clients receive the account id without a packet header first
+	if( bot->skip_aid ){
+		if( RFIFOREST( fd ) < 4 ){
+			return 0;
+		}
+
+		loadgen_traffic( 1, 4 );
+		RFIFOSKIP( fd, 4 );
+		bot->skip_aid = false;
+	}
+
+	while( RFIFOREST( fd ) >= 2 ){
+		uint16 cmd = RFIFOW( fd, 0 );
+		int32 length = loadgen_packet_length[cmd];
+
+		if( length == 0 ){
+			if( !loadgen_unknown_packets.test( cmd ) ){
+				loadgen_unknown_packets.set( cmd );
+				ShowWarning( "Received unknown packet 0x%04x from the map-server, the bot lost track of the stream.\n", cmd );
+			}
+
+			loadgen_bot_fail( *bot, "unknown packet from the map-server" );
+			return 0;
+		}
+
+		if( length == -1 ){
+			if( RFIFOREST( fd ) < 4 ){
+				return 0;
+			}
+
+			length = RFIFOW( fd, 2 );
+
+			if( length < 4 ){
+				loadgen_bot_fail( *bot, "invalid packet from the map-server" );
+				return 0;
+			}
+		}
+
+		if( RFIFOREST( fd ) < static_cast<size_t>( length ) ){
+			return 0;
+		}
+
+		loadgen_traffic( 1, length );
+
+		if( !loadgen_map_handle( *bot, fd, cmd, length ) ){
+			return 0;
+		}
+
+		RFIFOSKIP( fd, length );
+	}
+
+	return 0;
+}
+
+/**
+ * Connect to the map-server the char-server sent the bot to.
+ */
+bool loadgen_map_connect( s_loadgen_bot& bot ){
+	int32 fd = make_connection( bot.map_ip, bot.map_port, true, 10 );
+
+	if( fd == -1 ){
+		return false;
+	}
+
+	loadgen_bot_attach( bot, fd, LOADGEN_PHASE_MAP, loadgen_map_parse );
+#if PACKETVER < 20070521
+	bot.skip_aid = true;
+#else
+	bot.skip_aid = false;
+#endif
+	bot.dead = false;
+	bot.monsters.clear();
+	bot.vendors.clear();
+	bot.skills.clear();
+	bot.next_ping = gettick() + 10000;
+
+#ifdef PACKET_OBFUSCATION
+	bot.crypt_key = clif_cryptKey[0] * clif_cryptKey[1] + clif_cryptKey[2];
+#endif
+
+	const s_loadgen_packet_db* entry = loadgen_map_packet( bot, LOADGEN_CZ_ENTER );
+
+	WFIFOL( fd, entry->pos[0] ) = bot.account_id;
+	WFIFOL( fd, entry->pos[1] ) = bot.char_id;
+	WFIFOL( fd, entry->pos[2] ) = bot.login_id1;
+	WFIFOL( fd, entry->pos[3] ) = static_cast<uint32>( gettick() );
+	WFIFOB( fd, entry->pos[4] ) = bot.sex;
+
+	loadgen_request_begin( bot, LOADGEN_REQ_MAP_ENTER );
+	loadgen_map_send( bot, entry->length );
+
+	return true;
+}
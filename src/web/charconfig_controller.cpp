@@ -14,6 +14,7 @@
 #include "sqllock.hpp"
 #include "webutils.hpp"
 #include "web.hpp"
+#include "webcache.hpp"
 
 HANDLER_FUNC(charconfig_save) {
 	if (!isAuthorized(req, false)) {
@@ -86,6 +87,7 @@ HANDLER_FUNC(charconfig_save) {
 	}
 
 	sl.unlock();
+	charconfig_cache.invalidate(std::to_string(account_id) + ":" + std::to_string(char_id) + ":" + world_name);
 	res.set_content(data_str, "application/json");
 }
 
@@ -107,7 +109,15 @@ HANDLER_FUNC(charconfig_load) {
 	auto char_id = std::stoi(req.get_file_value("GID").content);
 	auto world_name_str = req.get_file_value("WorldName").content;
 	auto world_name = world_name_str.c_str();
+	auto cache_key = std::to_string(account_id) + ":" + std::to_string(char_id) + ":" + world_name_str;
+	s_web_cache_entry cached;
 
+	if (charconfig_cache.get(cache_key, cached)) {
+		res.set_content(cached.data, cached.content_type.c_str());
+		return;
+	}
+
+	uint64 ticket = charconfig_cache.begin_load();
 	SQLLock sl(WEB_SQL_LOCK);
 	sl.lock();
 	auto handle = sl.getHandle();
@@ -145,6 +155,7 @@ HANDLER_FUNC(charconfig_load) {
 
 		sl.unlock();
 		res.set_content( data, "application/json" );
+		charconfig_cache.fill( cache_key, { 0, "application/json", data }, ticket );
 		return;
 	}
 
@@ -167,4 +178,5 @@ HANDLER_FUNC(charconfig_load) {
 	auto response = nlohmann::json::parse(databuf);
 	response["Type"] = 1;
 	res.set_content(response.dump(), "application/json");
+	charconfig_cache.fill(cache_key, { 0, "application/json", res.body }, ticket);
 }
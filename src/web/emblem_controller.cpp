@@ -14,6 +14,7 @@
 #include "http.hpp"
 #include "sqllock.hpp"
 #include "web.hpp"
+#include "webcache.hpp"
 
 // Max size is 50kb for gif
 #define MAX_EMBLEM_SIZE 50000
@@ -44,7 +45,16 @@ HANDLER_FUNC(emblem_download) {
 	auto world_name_str = req.get_file_value("WorldName").content;
 	auto world_name = world_name_str.c_str();
 	auto guild_id = std::stoi(req.get_file_value("GDID").content);
+	auto cache_key = world_name_str + ":" + std::to_string(guild_id);
+	s_web_cache_entry cached;
 
+	if (emblem_cache.get(cache_key, cached)) {
+		res.body = std::move(cached.data);
+		res.set_header("Content-Type", cached.content_type);
+		return;
+	}
+
+	uint64 ticket = emblem_cache.begin_load();
 	SQLLock sl(WEB_SQL_LOCK);
 	sl.lock();
 	auto handle = sl.getHandle();
@@ -111,6 +121,7 @@ HANDLER_FUNC(emblem_download) {
 
 	res.body.assign(blob, emblem_size);
 	res.set_header("Content-Type", content_type);
+	emblem_cache.fill(cache_key, { version, content_type, res.body }, ticket);
 }
 
 
@@ -273,6 +284,8 @@ HANDLER_FUNC(emblem_upload) {
 
 	sl.unlock();
 
+	emblem_cache.update(world_name_str + ":" + std::to_string(guild_id), { version, imgtype_str == "GIF" ? "image/gif" : "image/bmp", std::move(img) });
+
 	std::ostringstream stream;
 	stream << "{\"Type\":1,\"version\":" << version << "}";
 	res.set_content(stream.str(), "application/json");
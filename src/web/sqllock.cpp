@@ -3,79 +3,99 @@
 
 #include "sqllock.hpp"
 
+#include <condition_variable>
 #include <mutex>
+#include <vector>
 
 #include <common/showmsg.hpp>
 
-std::mutex dbmutex;
-
-extern Sql * login_handle;
-extern Sql * char_handle;
-extern Sql * map_handle;
-extern Sql * web_handle;
-
-
-SQLLock::SQLLock(locktype lt) : ulock(dbmutex, std::defer_lock), lt(lt) {
-	switch(lt) {
-		case LOGIN_SQL_LOCK:
-			handle = login_handle;
-			break;
-		case CHAR_SQL_LOCK:
-			handle = char_handle;
-			break;
-		case MAP_SQL_LOCK:
-			handle = map_handle;
-			break;
-		case WEB_SQL_LOCK:
-			handle = web_handle;
-			break;
-	}
+/// Connections of a single database
+struct s_sql_pool {
+	std::mutex mutex;
+	std::condition_variable available;
+	std::vector<Sql*> handles; ///< All connections
+	std::vector<Sql*> idle; ///< Connections that are not borrowed
+};
+
+static s_sql_pool sql_pools[MAX_SQL_LOCK];
+
+
+SQLLock::SQLLock(locktype lt) : handle(nullptr), lt(lt), locked(false) {
 }
 
+/**
+ * Borrow a connection, waiting until one is returned if all of them are in use.
+ */
 void SQLLock::lock() {
-	// switch(lt) {
-	//     case LOGIN_SQL_LOCK:
-	//         ShowDebug("Locking login sql\n");
-	//         break;
-	//     case CHAR_SQL_LOCK:
-	//         ShowDebug("Locking char sql\n");
-	//         break;
-	//     case MAP_SQL_LOCK:
-	//         ShowDebug("Locking map sql\n");
-	//         break;
-	//     case WEB_SQL_LOCK:
-	//         ShowDebug("Locking web sql\n");
-	//         break;
-	// }
-	ulock.lock();
+	locked = true;
+
+	if (handle != nullptr)
+		return;
+
+	s_sql_pool& pool = sql_pools[lt];
+	std::unique_lock<std::mutex> ulock(pool.mutex);
+
+	pool.available.wait(ulock, [&pool] { return !pool.idle.empty(); });
+	handle = pool.idle.back();
+	pool.idle.pop_back();
 }
 
 void SQLLock::unlock() {
-	ulock.unlock();
-	// switch(lt) {
-	//     case LOGIN_SQL_LOCK:
-	//         ShowDebug("Unlocked login sql\n");
-	//         break;
-	//     case CHAR_SQL_LOCK:
-	//         ShowDebug("Unlocked char sql\n");
-	//         break;
-	//     case MAP_SQL_LOCK:
-	//         ShowDebug("Unlocked map sql\n");
-	//         break;
-	//     case WEB_SQL_LOCK:
-	//         ShowDebug("Unlocked web sql\n");
-	//         break;
-	// }
-
+	locked = false;
 }
 
 
 // can only get handle if locked
 Sql * SQLLock::getHandle() {
-	if (!ulock.owns_lock())
+	if (!locked)
 		return nullptr;
 	return handle;
 }
 
+/**
+ * Return the connection to the pool.
+ */
 SQLLock::~SQLLock() {
+	if (handle == nullptr)
+		return;
+
+	s_sql_pool& pool = sql_pools[lt];
+
+	{
+		std::lock_guard<std::mutex> guard(pool.mutex);
+		pool.idle.push_back(handle);
+	}
+	handle = nullptr;
+	pool.available.notify_one();
+}
+
+/**
+ * Add a connected handle to the pool of a database.
+ * Must be called before the http server starts.
+ */
+void sqllock_add_handle(locktype lt, Sql* handle) {
+	s_sql_pool& pool = sql_pools[lt];
+	std::lock_guard<std::mutex> guard(pool.mutex);
+
+	pool.handles.push_back(handle);
+	pool.idle.push_back(handle);
+}
+
+/**
+ * Free the connections of all pools.
+ * Must be called after the http server stopped.
+ */
+void sqllock_final(void) {
+	for (s_sql_pool& pool : sql_pools) {
+		std::lock_guard<std::mutex> guard(pool.mutex);
+
+		if (pool.idle.size() != pool.handles.size())
+			ShowWarning("sqllock_final: %" PRIuPTR " connections are still in use.\n", pool.handles.size() - pool.idle.size());
+
+		for (Sql* handle : pool.handles)
+			Sql_Free(handle);
+
+		pool.handles.clear();
+		pool.idle.clear();
+	}
 }
@@ -4,22 +4,26 @@
 #ifndef SQLLOCK_HPP
 #define SQLLOCK_HPP
 
-#include <mutex>
-
 #include <common/sql.hpp>
 
 enum locktype {
 	LOGIN_SQL_LOCK,
 	CHAR_SQL_LOCK,
 	MAP_SQL_LOCK,
-	WEB_SQL_LOCK
+	WEB_SQL_LOCK,
+	MAX_SQL_LOCK
 };
 
+/// Borrows a connection of the given database from its pool.
+/// Every request thread works on its own connection, so requests
+/// only wait for each other when all connections are in use.
+/// The connection goes back to the pool when the lock is destroyed,
+/// after the statements declared below it closed their handles.
 class SQLLock {
 private:
-	std::unique_lock<std::mutex> ulock;
 	Sql * handle;
 	locktype lt;
+	bool locked;
 
 public:
 	SQLLock(locktype);
@@ -29,5 +33,7 @@ public:
 	Sql * getHandle();
 };
 
+void sqllock_add_handle(locktype lt, Sql* handle);
+void sqllock_final(void);
 
 #endif
@@ -14,6 +14,7 @@
 #include "sqllock.hpp"
 #include "webutils.hpp"
 #include "web.hpp"
+#include "webcache.hpp"
 
 HANDLER_FUNC(userconfig_save) {
 	if (!isAuthorized(req, false)) {
@@ -84,6 +85,7 @@ HANDLER_FUNC(userconfig_save) {
 	}
 
 	sl.unlock();
+	userconfig_cache.invalidate(std::to_string(account_id) + ":" + world_name);
 	res.set_content(data_str, "application/json");
 }
 
@@ -104,7 +106,15 @@ HANDLER_FUNC(userconfig_load) {
 	auto account_id = std::stoi(req.get_file_value("AID").content);
 	auto world_name_str = req.get_file_value("WorldName").content;
 	auto world_name = world_name_str.c_str();
+	auto cache_key = std::to_string(account_id) + ":" + world_name_str;
+	s_web_cache_entry cached;
 
+	if (userconfig_cache.get(cache_key, cached)) {
+		res.set_content(cached.data, cached.content_type.c_str());
+		return;
+	}
+
+	uint64 ticket = userconfig_cache.begin_load();
 	SQLLock sl(WEB_SQL_LOCK);
 	sl.lock();
 	auto handle = sl.getHandle();
@@ -140,6 +150,7 @@ HANDLER_FUNC(userconfig_load) {
 
 		sl.unlock();
 		res.set_content( data, "application/json" );
+		userconfig_cache.fill( cache_key, { 0, "application/json", data }, ticket );
 		return;
 	}
 
@@ -161,4 +172,5 @@ HANDLER_FUNC(userconfig_load) {
 	auto response = nlohmann::json::parse(databuf);
 	response["Type"] = 1;
 	res.set_content(response.dump(), "application/json");
+	userconfig_cache.fill(cache_key, { 0, "application/json", res.body }, ticket);
 }
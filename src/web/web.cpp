@@ -30,7 +30,9 @@
 #include "http.hpp"
 #include "merchantstore_controller.hpp"
 #include "partybooking_controller.hpp"
+#include "sqllock.hpp"
 #include "userconfig_controller.hpp"
+#include "webcache.hpp"
 
 
 using namespace rathena;
@@ -70,10 +72,6 @@ std::string web_server_db = "ragnarok";
 
 std::string default_codepage = "";
 
-Sql * login_handle = nullptr;
-Sql * char_handle = nullptr;
-Sql * map_handle = nullptr;
-Sql * web_handle = nullptr;
 
 char login_table[32] = "login";
 char guild_emblems_table[32] = "guild_emblems";
@@ -129,6 +127,10 @@ bool web_config_read(const char* cfgName, bool normal) {
 				web_config.web_ip = w2;
 			} else if (!strcmpi(w1, "web_port"))
 				web_config.web_port = (uint16)atoi(w2);
+			else if (!strcmpi(w1, "worker_threads"))
+				web_config.worker_threads = cap_value(atoi(w2), 0, 256);
+			else if (!strcmpi(w1, "sql_connections"))
+				web_config.sql_connections = cap_value(atoi(w2), 1, 64);
 		}
 
 		if (!strcmpi(w1, "timestamp_format"))
@@ -146,12 +148,22 @@ bool web_config_read(const char* cfgName, bool normal) {
 			console_msg_log = atoi(w2);
 		else if (!strcmpi(w1, "console_log_filepath"))
 			safestrncpy(console_log_filepath, w2, sizeof(console_log_filepath));
+		else if (!strcmpi(w1, "console_log_format"))
+			console_log_format = strcmpi(w2, "binary") == 0 ? CONSOLE_LOG_BINARY : CONSOLE_LOG_TEXT;
+		else if (!strcmpi(w1, "console_async"))
+			console_async = config_switch(w2);
+		else if (!strcmpi(w1, "console_rate_limit"))
+			console_rate_limit = cap_value(atoi(w2), 0, INT_MAX);
 		else if (!strcmpi(w1, "print_req_res"))
 			web_config.print_req_res = config_switch(w2);
 		else if (!strcmpi(w1, "import"))
 			web_config_read(w2, normal);
 		else if (!strcmpi(w1, "allow_gifs"))
 			web_config.allow_gifs = config_switch(w2) == 1;
+		else if (!strcmpi(w1, "cache_size"))
+			web_config.cache_size = cap_value(atoi(w2), 0, 1000000);
+		else if (!strcmpi(w1, "cache_ttl"))
+			web_config.cache_ttl = cap_value(atoi(w2), 0, 86400);
 	}
 	fclose(fp);
 	ShowInfo("Finished reading %s.\n", cfgName);
@@ -262,6 +274,10 @@ void web_set_defaults() {
 	safestrncpy(web_config.webconf_name, "conf/web_athena.conf", sizeof(web_config.webconf_name));
 	safestrncpy(web_config.msgconf_name, "conf/msg_conf/web_msg.conf", sizeof(web_config.msgconf_name));
 	web_config.print_req_res = false;
+	web_config.worker_threads = 0;
+	web_config.sql_connections = 4;
+	web_config.cache_size = 2000;
+	web_config.cache_ttl = 300;
 
 	inter_config.emblem_transparency_limit = 100;
 	inter_config.emblem_woe_change = true;
@@ -270,94 +286,49 @@ void web_set_defaults() {
 
 /// Constructor destructor and signal handlers
 
-int32 web_sql_init(void) {
-	// login db connection
-	login_handle = Sql_Malloc();
-	ShowInfo("Connecting to the Login DB server.....\n");
-
-	if (SQL_ERROR == Sql_Connect(login_handle, login_server_id.c_str(), login_server_pw.c_str(), login_server_ip.c_str(), login_server_port, login_server_db.c_str())) {
-		ShowError("Couldn't connect with uname='%s',host='%s',port='%hu',database='%s'\n",
-			login_server_id.c_str(), login_server_ip.c_str(), login_server_port, login_server_db.c_str());
-		Sql_ShowDebug(login_handle);
-		Sql_Free(login_handle);
-		exit(EXIT_FAILURE);
-	}
-	ShowStatus("Connect success! (Login Server Connection)\n");
-
-	if (!default_codepage.empty()) {
-		if (SQL_ERROR == Sql_SetEncoding(login_handle, default_codepage.c_str()))
-			Sql_ShowDebug(login_handle);
-	}
-
-	char_handle = Sql_Malloc();
-	ShowInfo("Connecting to the Char DB server.....\n");
-
-	if (SQL_ERROR == Sql_Connect(char_handle, char_server_id.c_str(), char_server_pw.c_str(), char_server_ip.c_str(), char_server_port, char_server_db.c_str())) {
-		ShowError("Couldn't connect with uname='%s',host='%s',port='%hu',database='%s'\n",
-			char_server_id.c_str(), char_server_ip.c_str(), char_server_port, char_server_db.c_str());
-		Sql_ShowDebug(char_handle);
-		Sql_Free(char_handle);
-		exit(EXIT_FAILURE);
-	}
-	ShowStatus("Connect success! (Char Server Connection)\n");
-
-	if (!default_codepage.empty()) {
-		if (SQL_ERROR == Sql_SetEncoding(char_handle, default_codepage.c_str()))
-			Sql_ShowDebug(char_handle);
-	}
-
-	map_handle = Sql_Malloc();
-	ShowInfo("Connecting to the Map DB server.....\n");
-
-	if (SQL_ERROR == Sql_Connect(map_handle, map_server_id.c_str(), map_server_pw.c_str(), map_server_ip.c_str(), map_server_port, map_server_db.c_str())) {
-		ShowError("Couldn't connect with uname='%s',host='%s',port='%hu',database='%s'\n",
-			map_server_id.c_str(), map_server_ip.c_str(), map_server_port, map_server_db.c_str());
-		Sql_ShowDebug(map_handle);
-		Sql_Free(map_handle);
-		exit(EXIT_FAILURE);
-	}
-	ShowStatus("Connect success! (Map Server Connection)\n");
-
-	if (!default_codepage.empty()) {
-		if (SQL_ERROR == Sql_SetEncoding(map_handle, default_codepage.c_str()))
-			Sql_ShowDebug(map_handle);
-	}
+/**
+ * Open the connection pool of a database.
+ * @param lt: pool the connections are added to
+ * @param name: name of the database, for the console
+ */
+static void web_sql_connect(locktype lt, const char* name, std::string& id, std::string& pw, std::string& ip, uint16 port, std::string& db) {
+	ShowInfo("Connecting to the %s DB server.....\n", name);
+
+	for (uint16 i = 0; i < web_config.sql_connections; i++) {
+		Sql* handle = Sql_Malloc();
+
+		if (SQL_ERROR == Sql_Connect(handle, id.c_str(), pw.c_str(), ip.c_str(), port, db.c_str())) {
+			ShowError("Couldn't connect with uname='%s',host='%s',port='%hu',database='%s'\n",
+				id.c_str(), ip.c_str(), port, db.c_str());
+			Sql_ShowDebug(handle);
+			Sql_Free(handle);
+			exit(EXIT_FAILURE);
+		}
 
-	web_handle = Sql_Malloc();
-	ShowInfo("Connecting to the Web DB server.....\n");
+		if (!default_codepage.empty()) {
+			if (SQL_ERROR == Sql_SetEncoding(handle, default_codepage.c_str()))
+				Sql_ShowDebug(handle);
+		}
 
-	if (SQL_ERROR == Sql_Connect(web_handle, web_server_id.c_str(), web_server_pw.c_str(), web_server_ip.c_str(), web_server_port, web_server_db.c_str())) {
-		ShowError("Couldn't connect with uname='%s',host='%s',port='%hu',database='%s'\n",
-			web_server_id.c_str(), web_server_ip.c_str(), web_server_port, web_server_db.c_str());
-		Sql_ShowDebug(web_handle);
-		Sql_Free(web_handle);
-		exit(EXIT_FAILURE);
+		sqllock_add_handle(lt, handle);
 	}
-	ShowStatus("Connect success! (Web Server Connection)\n");
 
-	if (!default_codepage.empty()) {
-		if (SQL_ERROR == Sql_SetEncoding(web_handle, default_codepage.c_str()))
-			Sql_ShowDebug(web_handle);
-	}
+	ShowStatus("Connect success! (%s Server Connection, %hu connections)\n", name, web_config.sql_connections);
+}
 
+int32 web_sql_init(void) {
+	web_sql_connect(LOGIN_SQL_LOCK, "Login", login_server_id, login_server_pw, login_server_ip, login_server_port, login_server_db);
+	web_sql_connect(CHAR_SQL_LOCK, "Char", char_server_id, char_server_pw, char_server_ip, char_server_port, char_server_db);
+	web_sql_connect(MAP_SQL_LOCK, "Map", map_server_id, map_server_pw, map_server_ip, map_server_port, map_server_db);
+	web_sql_connect(WEB_SQL_LOCK, "Web", web_server_id, web_server_pw, web_server_ip, web_server_port, web_server_db);
 
 	return 0;
 }
 
 int32 web_sql_close(void)
 {
-	ShowStatus("Close Login DB Connection....\n");
-	Sql_Free(login_handle);
-	login_handle = nullptr;
-	ShowStatus("Close Char DB Connection....\n");
-	Sql_Free(char_handle);
-	char_handle = nullptr;
-	ShowStatus("Close Map DB Connection....\n");
-	Sql_Free(map_handle);
-	map_handle = nullptr;
-	ShowStatus("Close Web DB Connection....\n");
-	Sql_Free(web_handle);
-	web_handle = nullptr;
+	ShowStatus("Close DB Connections....\n");
+	sqllock_final();
 
 	return 0;
 }
@@ -371,6 +342,7 @@ void WebServer::finalize(){
 #ifdef WEB_SERVER_ENABLE
 	http_server->stop();
 	svr_thr.join();
+	web_cache_final();
 	web_sql_close();
 #endif
 	do_final_msg();
@@ -442,10 +414,16 @@ bool WebServer::initialize( int32 argc, char* argv[] ){
 	// end config
 
 	web_sql_init();
+	web_cache_init();
 
 	ShowStatus("Starting server...\n");
 
 	http_server = std::make_shared<httplib::Server>();
+	if (web_config.worker_threads > 0) {
+		http_server->new_task_queue = [] {
+			return new httplib::ThreadPool(web_config.worker_threads);
+		};
+	}
 	// set up routes
 	http_server->Post("/charconfig/load", charconfig_load);
 	http_server->Post("/charconfig/save", charconfig_save);
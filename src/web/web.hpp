@@ -42,6 +42,10 @@ struct Web_Config {
 	char webconf_name[256];						/// name of main config file
 	char msgconf_name[256];							/// name of msg_conf config file
 	bool allow_gifs;
+	uint16 worker_threads;							// Request threads, 0 uses the httplib default
+	uint16 sql_connections;							// Connections per database
+	uint32 cache_size;								// Entries per response cache, 0 disables caching
+	uint32 cache_ttl;								// Seconds until a cached response is reloaded
 };
 
 struct Inter_Config {
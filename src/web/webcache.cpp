@@ -0,0 +1,175 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#include "webcache.hpp"
+
+#include <common/showmsg.hpp>
+
+#include "web.hpp"
+
+WebCache emblem_cache;
+WebCache userconfig_cache;
+WebCache charconfig_cache;
+
+/**
+ * Set the limits of the cache and drop all entries.
+ * @param capacity: maximum amount of entries, 0 disables the cache
+ * @param ttl: seconds until an entry has to be reloaded from the database, 0 keeps entries until they are evicted
+ */
+void WebCache::configure(size_t capacity, uint32 ttl) {
+	std::lock_guard<std::mutex> guard(this->mutex);
+
+	this->capacity = capacity;
+	this->ttl = std::chrono::seconds(ttl);
+	this->lru.clear();
+	this->index.clear();
+	this->generation++;
+}
+
+/**
+ * Look up an entry.
+ * @param entry: receives a copy of the entry on success
+ * @return true if the entry is cached and did not expire
+ */
+bool WebCache::get(const std::string& key, s_web_cache_entry& entry) {
+	std::lock_guard<std::mutex> guard(this->mutex);
+	auto it = this->index.find(key);
+
+	if (it == this->index.end()) {
+		this->misses++;
+		return false;
+	}
+
+	if (this->ttl.count() > 0 && it->second->expires <= std::chrono::steady_clock::now()) {
+		this->lru.erase(it->second);
+		this->index.erase(it);
+		this->misses++;
+		return false;
+	}
+
+	this->lru.splice(this->lru.begin(), this->lru, it->second);
+	entry = it->second->entry;
+	this->hits++;
+
+	return true;
+}
+
+/**
+ * Must be called before reading data from the database that will be passed to fill.
+ * @return ticket for fill
+ */
+uint64 WebCache::begin_load() {
+	std::lock_guard<std::mutex> guard(this->mutex);
+
+	return this->generation;
+}
+
+/**
+ * Store data that was read from the database.
+ * The data is dropped if anything was written since begin_load, because the read might have
+ * returned the old data while another request thread was writing the new one.
+ * @param ticket: value of begin_load before the data was read
+ */
+void WebCache::fill(const std::string& key, s_web_cache_entry&& entry, uint64 ticket) {
+	std::lock_guard<std::mutex> guard(this->mutex);
+
+	if (ticket != this->generation)
+		return;
+
+	this->store(key, std::move(entry));
+}
+
+/**
+ * Store data that was just written to the database.
+ * An entry with a newer version is kept, in case another request thread finished writing first.
+ */
+void WebCache::update(const std::string& key, s_web_cache_entry&& entry) {
+	std::lock_guard<std::mutex> guard(this->mutex);
+	auto it = this->index.find(key);
+
+	this->generation++;
+
+	if (it != this->index.end() && it->second->entry.version > entry.version)
+		return;
+
+	this->store(key, std::move(entry));
+}
+
+/**
+ * Drop an entry after its data was written to the database.
+ */
+void WebCache::invalidate(const std::string& key) {
+	std::lock_guard<std::mutex> guard(this->mutex);
+
+	this->generation++;
+	this->erase(key);
+}
+
+void WebCache::clear() {
+	std::lock_guard<std::mutex> guard(this->mutex);
+
+	this->generation++;
+	this->lru.clear();
+	this->index.clear();
+}
+
+void WebCache::stats(size_t& entries, uint64& hits, uint64& misses) {
+	std::lock_guard<std::mutex> guard(this->mutex);
+
+	entries = this->index.size();
+	hits = this->hits;
+	misses = this->misses;
+}
+
+/// Caller must hold the mutex
+void WebCache::store(const std::string& key, s_web_cache_entry&& entry) {
+	if (this->capacity == 0)
+		return;
+
+	this->erase(key);
+
+	while (this->index.size() >= this->capacity) {
+		this->index.erase(this->lru.back().key);
+		this->lru.pop_back();
+	}
+
+	this->lru.push_front({ key, std::move(entry), std::chrono::steady_clock::now() + this->ttl });
+	this->index[key] = this->lru.begin();
+}
+
+/// Caller must hold the mutex
+void WebCache::erase(const std::string& key) {
+	auto it = this->index.find(key);
+
+	if (it == this->index.end())
+		return;
+
+	this->lru.erase(it->second);
+	this->index.erase(it);
+}
+
+void web_cache_init(void) {
+	emblem_cache.configure(web_config.cache_size, web_config.cache_ttl);
+	userconfig_cache.configure(web_config.cache_size, web_config.cache_ttl);
+	charconfig_cache.configure(web_config.cache_size, web_config.cache_ttl);
+
+	if (web_config.cache_size > 0)
+		ShowInfo("Caching up to %u emblems and configurations for %u seconds.\n", web_config.cache_size, web_config.cache_ttl);
+}
+
+void web_cache_final(void) {
+	WebCache* caches[] = { &emblem_cache, &userconfig_cache, &charconfig_cache };
+	const char* names[] = { "emblem", "userconfig", "charconfig" };
+
+	for (size_t i = 0; i < ARRAYLENGTH(caches); i++) {
+		size_t entries;
+		uint64 hits, misses;
+
+		caches[i]->stats(entries, hits, misses);
+
+		if (hits + misses > 0)
+			ShowInfo("The %s cache served %" PRIu64 " of %" PRIu64 " requests from memory.\n", names[i], hits, hits + misses);
+
+		caches[i]->clear();
+	}
+}
@@ -0,0 +1,63 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#ifndef WEB_CACHE_HPP
+#define WEB_CACHE_HPP
+
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <common/cbasetypes.hpp>
+
+/// Response that is served from memory instead of the database
+struct s_web_cache_entry {
+	uint32 version;
+	std::string content_type;
+	std::string data;
+};
+
+/// Least recently used cache shared by all request threads.
+/// Entries are replaced when the data is written and otherwise expire after the configured time,
+/// so changes made directly in the database are picked up eventually.
+class WebCache {
+private:
+	struct s_node {
+		std::string key;
+		s_web_cache_entry entry;
+		std::chrono::steady_clock::time_point expires;
+	};
+
+	std::mutex mutex;
+	std::list<s_node> lru; ///< Most recently used first
+	std::unordered_map<std::string, std::list<s_node>::iterator> index;
+	size_t capacity = 0;
+	std::chrono::seconds ttl{ 0 };
+	uint64 generation = 0; ///< Increased by every write, see begin_load
+	uint64 hits = 0;
+	uint64 misses = 0;
+
+	void store(const std::string& key, s_web_cache_entry&& entry);
+	void erase(const std::string& key);
+
+public:
+	void configure(size_t capacity, uint32 ttl);
+	bool get(const std::string& key, s_web_cache_entry& entry);
+	uint64 begin_load();
+	void fill(const std::string& key, s_web_cache_entry&& entry, uint64 ticket);
+	void update(const std::string& key, s_web_cache_entry&& entry);
+	void invalidate(const std::string& key);
+	void clear();
+	void stats(size_t& entries, uint64& hits, uint64& misses);
+};
+
+extern WebCache emblem_cache;
+extern WebCache userconfig_cache;
+extern WebCache charconfig_cache;
+
+void web_cache_init(void);
+void web_cache_final(void);
+
+#endif /* WEB_CACHE_HPP */
@@ -0,0 +1,106 @@
+#!/usr/bin/python3
+
+"""
+Synthetic login flood against a local login-server.
+
+Opens many client connections at once, like after a maintenance restart,
+sends a plain CA_LOGIN request on each of them and measures the time until
+the login-server answers.
+
+Usage: loginflood.py [--host 127.0.0.1] [--port 6900] [--clients 2000]
+                     [--concurrency 500] [--user test] [--password test]
+
+Accounts are named <user><n> unless --same-account is given. Unknown
+accounts are answered with a refusal, which still exercises the whole
+authentication path (admission, ipban, account lookup and login log).
+Use a password that does not trigger the dynamic ipban from your address.
+"""
+
+import argparse
+import asyncio
+import struct
+import time
+
+HEADER_CA_LOGIN = 0x64
+NAME_LENGTH = 24
+
+RESPONSES = {
+    0x69: 'accepted',
+    0xac4: 'accepted',
+    0x6a: 'refused',
+    0x83e: 'refused',
+    0x81: 'notify ban',
+}
+
+
+def ca_login(username, password, version):
+    return struct.pack('<hI24s24sB', HEADER_CA_LOGIN, version,
+                       username.encode()[:NAME_LENGTH - 1],
+                       password.encode()[:NAME_LENGTH - 1], 0)
+
+
+async def client(args, index, semaphore, results):
+    username = args.user if args.same_account else '%s%d' % (args.user, index)
+
+    async with semaphore:
+        start = time.perf_counter()
+        try:
+            reader, writer = await asyncio.wait_for(
+                asyncio.open_connection(args.host, args.port), args.timeout)
+            writer.write(ca_login(username, args.password, args.version))
+            await writer.drain()
+            header = await asyncio.wait_for(reader.readexactly(2), args.timeout)
+            command = struct.unpack('<H', header)[0]
+            writer.close()
+            result = RESPONSES.get(command, 'unknown 0x%04x' % command)
+        except asyncio.TimeoutError:
+            result = 'timeout'
+        except (OSError, asyncio.IncompleteReadError):
+            result = 'disconnected'
+
+        results.append((result, time.perf_counter() - start))
+
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+
+async def main():
+    parser = argparse.ArgumentParser(description='Synthetic login-server flood')
+    parser.add_argument('--host', default='127.0.0.1')
+    parser.add_argument('--port', type=int, default=6900)
+    parser.add_argument('--clients', type=int, default=2000)
+    parser.add_argument('--concurrency', type=int, default=500)
+    parser.add_argument('--user', default='flood')
+    parser.add_argument('--password', default='flood')
+    parser.add_argument('--same-account', action='store_true')
+    parser.add_argument('--version', type=int, default=55)
+    parser.add_argument('--timeout', type=float, default=30.0)
+    args = parser.parse_args()
+
+    semaphore = asyncio.Semaphore(args.concurrency)
+    results = []
+    start = time.perf_counter()
+
+    await asyncio.gather(*(client(args, i, semaphore, results)
+                           for i in range(args.clients)))
+
+    elapsed = time.perf_counter() - start
+    latencies = sorted(latency * 1000 for _, latency in results)
+    counts = {}
+
+    for result, _ in results:
+        counts[result] = counts.get(result, 0) + 1
+
+    print('%d clients in %.2fs (%.0f logins/s)' % (len(results), elapsed, len(results) / elapsed))
+    for result, count in sorted(counts.items()):
+        print('  %-16s %d' % (result, count))
+    print('latency ms: p50 %.1f, p90 %.1f, p99 %.1f, max %.1f' % (
+        percentile(latencies, 50), percentile(latencies, 90),
+        percentile(latencies, 99), latencies[-1] if latencies else 0.0))
+
+
+if __name__ == '__main__':
+    asyncio.run(main())
@@ -0,0 +1,68 @@
+#!/usr/bin/python3
+
+"""
+Prints a console message log written with console_log_format: binary.
+
+The file starts with the magic "RAMSGLOG" and a uint32 version, followed by
+one record per message: int64 unix time in milliseconds, uint8 message type,
+3 bytes padding, uint32 text length and the text without escape sequences.
+All values are little endian.
+
+Usage: showlog.py <file> [--type warning,error] [--grep text] [--json]
+"""
+
+import argparse
+import datetime
+import json
+import struct
+import sys
+
+MAGIC = b'RAMSGLOG'
+HEADER = struct.Struct('<qB3xI')
+
+TYPES = ['none', 'status', 'sql', 'info', 'notice', 'warning', 'debug', 'error', 'fatal']
+
+
+def records(path):
+    with open(path, 'rb') as file:
+        if file.read(8) != MAGIC:
+            sys.exit('%s is not a binary console log' % path)
+
+        version = struct.unpack('<I', file.read(4))[0]
+        if version != 1:
+            sys.exit('unsupported version %d' % version)
+
+        while True:
+            header = file.read(HEADER.size)
+            if len(header) < HEADER.size:
+                return
+            time, kind, length = HEADER.unpack(header)
+            text = file.read(length).decode('utf-8', 'replace')
+            yield time, TYPES[kind] if kind < len(TYPES) else str(kind), text
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Binary console log reader')
+    parser.add_argument('file')
+    parser.add_argument('--type', help='comma separated message types to show')
+    parser.add_argument('--grep', help='only show messages containing this text')
+    parser.add_argument('--json', action='store_true', help='print one JSON object per message')
+    args = parser.parse_args()
+
+    types = set(args.type.split(',')) if args.type else None
+
+    for time, kind, text in records(args.file):
+        if types and kind not in types:
+            continue
+        if args.grep and args.grep not in text:
+            continue
+
+        if args.json:
+            print(json.dumps({'time': time, 'type': kind, 'text': text.rstrip('\n')}))
+        else:
+            stamp = datetime.datetime.fromtimestamp(time / 1000).strftime('%m/%d/%Y %H:%M:%S.%f')[:-3]
+            print('(%s) [ %s ] : %s' % (stamp, kind, text.rstrip('\n')))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,119 @@
+#!/usr/bin/python3
+
+"""
+Synthetic emblem download load against a local web-server.
+
+Sends many concurrent /emblem/download requests, like a crowded town where
+every client fetches the emblems of the guilds around it, and measures the
+time until the web-server answers.
+
+Usage: webflood.py --aid 2000000 --token <AuthToken> [--host 127.0.0.1]
+                   [--port 8888] [--requests 20000] [--concurrency 200]
+                   [--gdid 1] [--guilds 1] [--world rAthena]
+
+The account must be logged in, the AuthToken is the web_auth_token of the
+account in the login table. Requests are spread over --guilds guild ids
+starting at --gdid, guilds without an emblem are answered with 404.
+"""
+
+import argparse
+import http.client
+import threading
+import time
+import uuid
+
+
+def multipart(fields):
+    boundary = uuid.uuid4().hex
+    body = b''
+
+    for name, value in fields.items():
+        body += ('--%s\r\nContent-Disposition: form-data; name="%s"\r\n\r\n%s\r\n'
+                 % (boundary, name, value)).encode()
+    body += ('--%s--\r\n' % boundary).encode()
+
+    return body, 'multipart/form-data; boundary=%s' % boundary
+
+
+def worker(args, counter, lock, results):
+    connection = http.client.HTTPConnection(args.host, args.port, timeout=args.timeout)
+
+    while True:
+        with lock:
+            index = counter[0]
+            if index >= args.requests:
+                break
+            counter[0] += 1
+
+        body, content_type = multipart({
+            'AID': args.aid,
+            'AuthToken': args.token,
+            'GDID': args.gdid + index % args.guilds,
+            'WorldName': args.world,
+        })
+        start = time.perf_counter()
+        try:
+            connection.request('POST', '/emblem/download', body, {'Content-Type': content_type})
+            response = connection.getresponse()
+            response.read()
+            result = str(response.status)
+        except (OSError, http.client.HTTPException):
+            result = 'disconnected'
+            connection.close()
+            connection = http.client.HTTPConnection(args.host, args.port, timeout=args.timeout)
+
+        with lock:
+            results.append((result, time.perf_counter() - start))
+
+    connection.close()
+
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Synthetic web-server emblem download load')
+    parser.add_argument('--host', default='127.0.0.1')
+    parser.add_argument('--port', type=int, default=8888)
+    parser.add_argument('--requests', type=int, default=20000)
+    parser.add_argument('--concurrency', type=int, default=200)
+    parser.add_argument('--aid', type=int, required=True)
+    parser.add_argument('--token', required=True)
+    parser.add_argument('--gdid', type=int, default=1)
+    parser.add_argument('--guilds', type=int, default=1)
+    parser.add_argument('--world', default='rAthena')
+    parser.add_argument('--timeout', type=float, default=30.0)
+    args = parser.parse_args()
+
+    counter = [0]
+    lock = threading.Lock()
+    results = []
+    threads = [threading.Thread(target=worker, args=(args, counter, lock, results))
+               for _ in range(args.concurrency)]
+    start = time.perf_counter()
+
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+
+    elapsed = time.perf_counter() - start
+    latencies = sorted(latency * 1000 for _, latency in results)
+    counts = {}
+
+    for result, _ in results:
+        counts[result] = counts.get(result, 0) + 1
+
+    print('%d requests in %.2fs (%.0f requests/s)' % (len(results), elapsed, len(results) / elapsed))
+    for result, count in sorted(counts.items()):
+        print('  %-16s %d' % (result, count))
+    print('latency ms: p50 %.1f, p90 %.1f, p99 %.1f, max %.1f' % (
+        percentile(latencies, 50), percentile(latencies, 90),
+        percentile(latencies, 99), latencies[-1] if latencies else 0.0))
+
+
+if __name__ == '__main__':
+    main()